@@ -1,14 +1,22 @@
 import {
+  Buffer,
+  BufferBindFlag,
+  BufferMesh,
+  BufferUsage,
   Color,
   dependentComponents,
   DependentMode,
   GLCapabilityType,
+  IndexBufferBinding,
+  IndexFormat,
   Matrix,
   MeshRenderer,
   MeshTopology,
-  ModelMesh,
   Script,
-  Vector3
+  Vector3,
+  VertexBufferBinding,
+  VertexElement,
+  VertexElementFormat
 } from "@galacean/engine";
 import { WireframePrimitive } from "./WireframePrimitive";
 import { PlainColorMaterial } from "@galacean/engine-toolkit-custom-material";
@@ -19,14 +27,31 @@ import { PlainColorMaterial } from "@galacean/engine-toolkit-custom-material";
  */
 @dependentComponents(MeshRenderer, DependentMode.CheckOnly)
 export class LineDrawer extends Script {
-  private static _positions: Vector3[] = [];
+  /** Byte size of one position. */
+  private static readonly _positionStride = 12;
+  /** Buffers written in turn, one per frame, so an upload never waits for the GPU to finish drawing a buffer. */
+  private static readonly _bufferCount = 3;
+  /** Positions packed as x, y, z. */
+  private static _positions = new Float32Array(128 * 3);
   private static _positionCount: number = 0;
   private static _indices: Uint16Array | Uint32Array;
   private static _indicesCount: number = 0;
   private static _supportUint32Array: boolean;
+  /** Positions of one wireframe primitive as created by `WireframePrimitive`, before they are packed. */
+  private static _primitivePositions: Vector3[] = [];
   private _renderer: MeshRenderer;
   private _material: PlainColorMaterial;
-  private _mesh: ModelMesh;
+  private _mesh: BufferMesh;
+  private _vertexBufferBindings: VertexBufferBinding[] = [];
+  private _indexBufferBindings: IndexBufferBinding[] = [];
+  private _bufferIndex = 0;
+  private _infiniteBounds = false;
+
+  /**
+   * Whether the mesh bounds enclose the lines drawn in the frame, so the renderer is frustum culled.
+   * By default, the bounds are infinite and the lines are never culled, which saves a pass over the positions.
+   */
+  computeBounds: boolean = false;
 
   /**
    * The LineDrawer.matrix stores the position, rotation and scale of the LineDrawer.
@@ -51,15 +76,12 @@ export class LineDrawer extends Script {
   static drawLine(from: Vector3, to: Vector3) {
     LineDrawer._growthPosition(2);
     LineDrawer._growthIndexMemory(2);
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 1;
-    if (LineDrawer.matrix == null) {
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(from);
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(to);
-    } else {
-      Vector3.transformCoordinate(from, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-      Vector3.transformCoordinate(to, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-    }
+    const indices = LineDrawer._indices;
+    const positionCount = LineDrawer._positionCount;
+    indices[LineDrawer._indicesCount++] = positionCount;
+    indices[LineDrawer._indicesCount++] = positionCount + 1;
+    LineDrawer._addPosition(from.x, from.y, from.z);
+    LineDrawer._addPosition(to.x, to.y, to.z);
   }
 
   /**
@@ -72,26 +94,20 @@ export class LineDrawer extends Script {
   static drawRect(leftTop: Vector3, rightTop: Vector3, rightBottom: Vector3, leftBottom: Vector3) {
     LineDrawer._growthPosition(4);
     LineDrawer._growthIndexMemory(8);
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 1;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 2;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 1;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 2;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 3;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount;
-    LineDrawer._indices[LineDrawer._indicesCount++] = LineDrawer._positionCount + 3;
-
-    if (LineDrawer.matrix == null) {
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(leftTop);
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(rightTop);
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(rightBottom);
-      LineDrawer._positions[LineDrawer._positionCount++].copyFrom(leftBottom);
-    } else {
-      Vector3.transformCoordinate(leftTop, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-      Vector3.transformCoordinate(rightTop, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-      Vector3.transformCoordinate(rightBottom, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-      Vector3.transformCoordinate(leftBottom, LineDrawer.matrix, LineDrawer._positions[LineDrawer._positionCount++]);
-    }
+    const indices = LineDrawer._indices;
+    const positionCount = LineDrawer._positionCount;
+    indices[LineDrawer._indicesCount++] = positionCount;
+    indices[LineDrawer._indicesCount++] = positionCount + 1;
+    indices[LineDrawer._indicesCount++] = positionCount + 2;
+    indices[LineDrawer._indicesCount++] = positionCount + 1;
+    indices[LineDrawer._indicesCount++] = positionCount + 2;
+    indices[LineDrawer._indicesCount++] = positionCount + 3;
+    indices[LineDrawer._indicesCount++] = positionCount;
+    indices[LineDrawer._indicesCount++] = positionCount + 3;
+    LineDrawer._addPosition(leftTop.x, leftTop.y, leftTop.z);
+    LineDrawer._addPosition(rightTop.x, rightTop.y, rightTop.z);
+    LineDrawer._addPosition(rightBottom.x, rightBottom.y, rightBottom.z);
+    LineDrawer._addPosition(leftBottom.x, leftBottom.y, leftBottom.z);
   }
 
   /**
@@ -102,27 +118,16 @@ export class LineDrawer extends Script {
   static drawSphere(radius: number, center: Vector3) {
     const positionCount = WireframePrimitive.spherePositionCount;
     const indexCount = WireframePrimitive.sphereIndexCount;
-    const globalPosition = LineDrawer._positions;
 
-    LineDrawer._growthPosition(positionCount);
     LineDrawer._growthIndexMemory(indexCount);
     WireframePrimitive.createSphereWireframe(
       radius,
-      globalPosition,
-      LineDrawer._positionCount,
+      LineDrawer._getPrimitivePositions(positionCount),
+      0,
       LineDrawer._indices,
       LineDrawer._indicesCount
     );
-    for (let i = 0; i < positionCount; i++) {
-      const pos = globalPosition[LineDrawer._positionCount + i];
-      pos.add(center);
-      if (LineDrawer.matrix != null) {
-        Vector3.transformCoordinate(pos, LineDrawer.matrix, pos);
-      }
-    }
-
-    LineDrawer._positionCount += positionCount;
-    LineDrawer._indicesCount += indexCount;
+    LineDrawer._addPrimitive(positionCount, indexCount, center);
   }
 
   /**
@@ -135,29 +140,18 @@ export class LineDrawer extends Script {
   static drawCuboid(width: number, height: number, depth: number, center: Vector3) {
     const positionCount = WireframePrimitive.cuboidPositionCount;
     const indexCount = WireframePrimitive.cuboidIndexCount;
-    const globalPosition = LineDrawer._positions;
 
-    LineDrawer._growthPosition(positionCount);
     LineDrawer._growthIndexMemory(indexCount);
     WireframePrimitive.createCuboidWireframe(
       width,
       height,
       depth,
-      globalPosition,
-      LineDrawer._positionCount,
+      LineDrawer._getPrimitivePositions(positionCount),
+      0,
       LineDrawer._indices,
       LineDrawer._indicesCount
     );
-    for (let i = 0; i < positionCount; i++) {
-      const pos = globalPosition[LineDrawer._positionCount + i];
-      pos.add(center);
-      if (LineDrawer.matrix != null) {
-        Vector3.transformCoordinate(pos, LineDrawer.matrix, pos);
-      }
-    }
-
-    LineDrawer._positionCount += positionCount;
-    LineDrawer._indicesCount += indexCount;
+    LineDrawer._addPrimitive(positionCount, indexCount, center);
   }
 
   /**
@@ -169,28 +163,17 @@ export class LineDrawer extends Script {
   static drawCapsule(radius: number, height: number, center: Vector3) {
     const positionCount = WireframePrimitive.capsulePositionCount;
     const indexCount = WireframePrimitive.capsuleIndexCount;
-    const globalPosition = LineDrawer._positions;
 
-    LineDrawer._growthPosition(positionCount);
     LineDrawer._growthIndexMemory(indexCount);
     WireframePrimitive.createCapsuleWireframe(
       radius,
       height,
-      globalPosition,
-      LineDrawer._positionCount,
+      LineDrawer._getPrimitivePositions(positionCount),
+      0,
       LineDrawer._indices,
       LineDrawer._indicesCount
     );
-    for (let i = 0; i < positionCount; i++) {
-      const pos = globalPosition[LineDrawer._positionCount + i];
-      pos.add(center);
-      if (LineDrawer.matrix != null) {
-        Vector3.transformCoordinate(pos, LineDrawer.matrix, pos);
-      }
-    }
-
-    LineDrawer._positionCount += positionCount;
-    LineDrawer._indicesCount += indexCount;
+    LineDrawer._addPrimitive(positionCount, indexCount, center);
   }
 
   /**
@@ -203,29 +186,18 @@ export class LineDrawer extends Script {
     WireframePrimitive._shift.set(0, 0, 0);
     const positionCount = WireframePrimitive.circlePositionCount;
     const indexCount = WireframePrimitive.circleIndexCount;
-    const globalPosition = LineDrawer._positions;
 
-    LineDrawer._growthPosition(positionCount);
     LineDrawer._growthIndexMemory(indexCount);
     WireframePrimitive.createCircleWireframe(
       radius,
       axis,
       WireframePrimitive._shift,
-      globalPosition,
-      LineDrawer._positionCount,
+      LineDrawer._getPrimitivePositions(positionCount),
+      0,
       LineDrawer._indices,
       LineDrawer._indicesCount
     );
-    for (let i = 0; i < positionCount; i++) {
-      const pos = globalPosition[LineDrawer._positionCount + i];
-      pos.add(center);
-      if (LineDrawer.matrix != null) {
-        Vector3.transformCoordinate(pos, LineDrawer.matrix, pos);
-      }
-    }
-
-    LineDrawer._positionCount += positionCount;
-    LineDrawer._indicesCount += indexCount;
+    LineDrawer._addPrimitive(positionCount, indexCount, center);
   }
 
   static flush() {
@@ -235,7 +207,7 @@ export class LineDrawer extends Script {
 
   override onAwake(): void {
     const engine = this.engine;
-    const mesh = new ModelMesh(engine);
+    const mesh = new BufferMesh(engine, "LineDrawer");
     const material = new PlainColorMaterial(engine);
     const renderer = this.entity.getComponent(MeshRenderer);
     renderer.castShadows = false;
@@ -245,28 +217,27 @@ export class LineDrawer extends Script {
 
     // @ts-ignore
     mesh._enableVAO = false;
+    mesh.setVertexElements([new VertexElement("POSITION", 0, VertexElementFormat.Vector3, 0)]);
     mesh.addSubMesh(0, LineDrawer._indicesCount, MeshTopology.Lines);
     renderer.mesh = mesh;
     renderer.setMaterial(material);
 
-    const { bounds } = mesh;
-    bounds.min.set(-Number.MAX_VALUE, -Number.MAX_VALUE, -Number.MAX_VALUE);
-    bounds.max.set(Number.MAX_VALUE, Number.MAX_VALUE, Number.MAX_VALUE);
     this._mesh = mesh;
     this._material = material;
     this._renderer = renderer;
+    this._setInfiniteBounds();
     LineDrawer._indices = supportUint32Array ? new Uint32Array(128) : new Uint16Array(128);
     LineDrawer._supportUint32Array = supportUint32Array;
   }
 
   override onLateUpdate(deltaTime: number) {
-    const { _mesh: mesh } = this;
-
     if (LineDrawer._positionCount > 0) {
-      mesh.setPositions(LineDrawer._positions);
-      mesh.setIndices(LineDrawer._indices);
-      mesh.uploadData(false);
-      mesh.subMesh.count = LineDrawer._indicesCount;
+      this._uploadData();
+      if (this.computeBounds) {
+        this._updateBounds();
+      } else if (!this._infiniteBounds) {
+        this._setInfiniteBounds();
+      }
       this._renderer.setMaterial(this._material);
     } else {
       this._renderer.setMaterial(null);
@@ -275,28 +246,178 @@ export class LineDrawer extends Script {
     LineDrawer.flush();
   }
 
+  override onDestroy(): void {
+    const vertexBufferBindings = this._vertexBufferBindings;
+    const indexBufferBindings = this._indexBufferBindings;
+    for (let i = 0, n = vertexBufferBindings.length; i < n; i++) {
+      vertexBufferBindings[i]?.buffer.destroy(true);
+    }
+    for (let i = 0, n = indexBufferBindings.length; i < n; i++) {
+      indexBufferBindings[i]?.buffer.destroy(true);
+    }
+    vertexBufferBindings.length = 0;
+    indexBufferBindings.length = 0;
+  }
+
+  /**
+   * Upload the used range of the positions and indices to the next buffers in turn and draw from them.
+   */
+  private _uploadData(): void {
+    const mesh = this._mesh;
+    const positions = LineDrawer._positions;
+    const indices = LineDrawer._indices;
+    const positionLength = LineDrawer._positionCount * 3;
+    const indicesCount = LineDrawer._indicesCount;
+    const bufferIndex = (this._bufferIndex + 1) % LineDrawer._bufferCount;
+    this._bufferIndex = bufferIndex;
+
+    let vertexBufferBinding = this._vertexBufferBindings[bufferIndex];
+    const lastVertexBuffer = vertexBufferBinding?.buffer;
+    const vertexBuffer = this._reserveBuffer(lastVertexBuffer, positionLength * 4, BufferBindFlag.VertexBuffer);
+    if (vertexBuffer !== lastVertexBuffer) {
+      vertexBufferBinding = new VertexBufferBinding(vertexBuffer, LineDrawer._positionStride);
+      this._vertexBufferBindings[bufferIndex] = vertexBufferBinding;
+    }
+    let indexBufferBinding = this._indexBufferBindings[bufferIndex];
+    const lastIndexBuffer = indexBufferBinding?.buffer;
+    const indexByteLength = indicesCount * indices.BYTES_PER_ELEMENT;
+    const indexBuffer = this._reserveBuffer(lastIndexBuffer, indexByteLength, BufferBindFlag.IndexBuffer);
+    if (indexBuffer !== lastIndexBuffer) {
+      const indexFormat = LineDrawer._supportUint32Array ? IndexFormat.UInt32 : IndexFormat.UInt16;
+      indexBufferBinding = new IndexBufferBinding(indexBuffer, indexFormat);
+      this._indexBufferBindings[bufferIndex] = indexBufferBinding;
+    }
+
+    vertexBuffer.setData(positions, 0, 0, positionLength);
+    indexBuffer.setData(indices, 0, 0, indicesCount);
+    mesh.setVertexBufferBinding(vertexBufferBinding, 0);
+    mesh.setIndexBufferBinding(indexBufferBinding);
+    mesh.subMesh.count = indicesCount;
+    // The replaced buffers were bound at most until the frame before last, nothing references them anymore.
+    vertexBuffer !== lastVertexBuffer && lastVertexBuffer?.destroy();
+    indexBuffer !== lastIndexBuffer && lastIndexBuffer?.destroy();
+  }
+
+  /**
+   * Return the buffer if it can hold byteLength bytes, otherwise a new dynamic buffer grown geometrically.
+   */
+  private _reserveBuffer(buffer: Buffer, byteLength: number, type: BufferBindFlag): Buffer {
+    if (buffer && buffer.byteLength >= byteLength) {
+      return buffer;
+    }
+    // Grow by 1.5x, rounded up to a multiple of 4 bytes.
+    const newByteLength = Math.max(byteLength, Math.ceil((buffer?.byteLength ?? 0) * 0.375) * 4);
+    const newBuffer = new Buffer(this.engine, type, newByteLength, BufferUsage.Dynamic);
+    // The buffers not bound this frame are unreferenced, they must survive a resource gc.
+    newBuffer.isGCIgnored = true;
+    return newBuffer;
+  }
+
+  private _updateBounds(): void {
+    const positions = LineDrawer._positions;
+    let minX = Infinity;
+    let minY = Infinity;
+    let minZ = Infinity;
+    let maxX = -Infinity;
+    let maxY = -Infinity;
+    let maxZ = -Infinity;
+    for (let i = 0, n = LineDrawer._positionCount * 3; i < n; i += 3) {
+      const x = positions[i];
+      const y = positions[i + 1];
+      const z = positions[i + 2];
+      x < minX && (minX = x);
+      x > maxX && (maxX = x);
+      y < minY && (minY = y);
+      y > maxY && (maxY = y);
+      z < minZ && (minZ = z);
+      z > maxZ && (maxZ = z);
+    }
+    const { bounds } = this._mesh;
+    bounds.min.set(minX, minY, minZ);
+    bounds.max.set(maxX, maxY, maxZ);
+    this._infiniteBounds = false;
+  }
+
+  private _setInfiniteBounds(): void {
+    const { bounds } = this._mesh;
+    bounds.min.set(-Number.MAX_VALUE, -Number.MAX_VALUE, -Number.MAX_VALUE);
+    bounds.max.set(Number.MAX_VALUE, Number.MAX_VALUE, Number.MAX_VALUE);
+    this._infiniteBounds = true;
+  }
+
+  /**
+   * Write a position at the end, transformed by `LineDrawer.matrix` if set.
+   */
+  private static _addPosition(x: number, y: number, z: number): void {
+    const positions = LineDrawer._positions;
+    const offset = LineDrawer._positionCount++ * 3;
+    const matrix = LineDrawer.matrix;
+    if (matrix == null) {
+      positions[offset] = x;
+      positions[offset + 1] = y;
+      positions[offset + 2] = z;
+    } else {
+      // Same as Vector3.transformCoordinate.
+      const e = matrix.elements;
+      const w = 1.0 / (x * e[3] + y * e[7] + z * e[11] + e[15]);
+      positions[offset] = (x * e[0] + y * e[4] + z * e[8] + e[12]) * w;
+      positions[offset + 1] = (x * e[1] + y * e[5] + z * e[9] + e[13]) * w;
+      positions[offset + 2] = (x * e[2] + y * e[6] + z * e[10] + e[14]) * w;
+    }
+  }
+
+  private static _getPrimitivePositions(count: number): Vector3[] {
+    const positions = LineDrawer._primitivePositions;
+    for (let i = positions.length; i < count; i++) {
+      positions.push(new Vector3());
+    }
+    return positions;
+  }
+
+  /**
+   * Append a primitive created with its positions in `_primitivePositions` and its indices at `_indicesCount`,
+   * both starting from position 0, moved to center.
+   */
+  private static _addPrimitive(positionCount: number, indexCount: number, center: Vector3): void {
+    LineDrawer._growthPosition(positionCount);
+    const indices = LineDrawer._indices;
+    const firstPosition = LineDrawer._positionCount;
+    for (let i = LineDrawer._indicesCount, n = i + indexCount; i < n; i++) {
+      indices[i] += firstPosition;
+    }
+    LineDrawer._indicesCount += indexCount;
+
+    const positions = LineDrawer._primitivePositions;
+    const { x: centerX, y: centerY, z: centerZ } = center;
+    for (let i = 0; i < positionCount; i++) {
+      const position = positions[i];
+      LineDrawer._addPosition(position.x + centerX, position.y + centerY, position.z + centerZ);
+    }
+  }
+
   private static _growthIndexMemory(length: number): void {
     const indices = LineDrawer._indices;
     const neededLength = LineDrawer._indicesCount + length;
     if (neededLength > indices.length) {
-      const maxLength = LineDrawer._supportUint32Array ? 4294967295 : 65535;
-      if (neededLength > maxLength) {
-        throw Error("The vertex count is over limit.");
-      }
-
-      const newIndices = LineDrawer._supportUint32Array ? new Uint32Array(neededLength) : new Uint16Array(neededLength);
-      newIndices.set(indices);
+      // Grow by 1.5x, so drawing n lines reallocates O(log n) times.
+      const newLength = Math.max(neededLength, Math.ceil(indices.length * 1.5));
+      const newIndices = LineDrawer._supportUint32Array ? new Uint32Array(newLength) : new Uint16Array(newLength);
+      newIndices.set(indices.subarray(0, LineDrawer._indicesCount));
       LineDrawer._indices = newIndices;
     }
   }
 
   private static _growthPosition(length: number): void {
-    const position = LineDrawer._positions;
-    const neededLength = LineDrawer._positionCount + length;
-    if (neededLength > position.length) {
-      for (let i = 0, n = neededLength - position.length; i < n; i++) {
-        position.push(new Vector3());
-      }
+    const neededCount = LineDrawer._positionCount + length;
+    if (!LineDrawer._supportUint32Array && neededCount > 65536) {
+      throw Error("The vertex count is over limit.");
+    }
+    const positions = LineDrawer._positions;
+    if (neededCount * 3 > positions.length) {
+      const newCount = Math.max(neededCount, Math.ceil((positions.length / 3) * 1.5));
+      const newPositions = new Float32Array(newCount * 3);
+      newPositions.set(positions.subarray(0, LineDrawer._positionCount * 3));
+      LineDrawer._positions = newPositions;
     }
   }
 }
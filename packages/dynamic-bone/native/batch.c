@@ -0,0 +1,108 @@
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static float* field(const struct Batch* batch, int f) { return batch->particles + f * batch->capacity; }
+
+void create_batch(struct Batch* batch, const struct Scene* scene) {
+    // 槽位数对齐到 4, 每个字段的数组都从 16 字节边界开始
+    int capacity = (scene->particle_count + 3) & ~3;
+    int tree_count = 0;
+    int shape_count = 0;
+    for (int b = 0; b < scene->bone_count; b++) {
+        tree_count += scene->bones[b].tree_count;
+        shape_count += scene->bones[b].shape_count;
+    }
+    batch->capacity = capacity;
+    batch->particles = calloc((size_t)capacity * DB_FIELD_COUNT, sizeof(float));
+    batch->links = calloc((size_t)capacity * DB_LINK_COUNT, sizeof(int));
+    batch->tree_count = tree_count;
+    batch->trees = calloc(tree_count ? tree_count : 1, sizeof(struct DynamicBoneTree));
+    batch->shape_count = shape_count;
+    batch->shapes = calloc(shape_count ? shape_count : 1, sizeof(struct DynamicBoneShape));
+    batch->bone_first = calloc(scene->bone_count ? scene->bone_count : 1, sizeof(int));
+
+    int slot = 0;
+    for (int b = 0; b < scene->bone_count; b++) {
+        const struct SceneBone* bone = &scene->bones[b];
+        batch->bone_first[b] = slot;
+        for (int i = 0; i < bone->particle_count; i++, slot++) {
+            const struct SceneParticle* p = &bone->particles[i];
+            batch->links[DB_PARENT * capacity + slot] = p->parent < 0 ? -1 : batch->bone_first[b] + p->parent;
+            batch->links[DB_FLAGS * capacity + slot] = p->has_transform ? DB_HAS_TRANSFORM : 0;
+            for (int a = 0; a < 3; a++) {
+                field(batch, DB_X + a)[slot] = p->transform_position[a];
+                field(batch, DB_PREV_X + a)[slot] = p->transform_position[a];
+                field(batch, DB_LOCAL_X + a)[slot] = p->local[a];
+            }
+            field(batch, DB_DAMPING)[slot] = bone->damping;
+            field(batch, DB_ELASTICITY)[slot] = bone->elasticity;
+            field(batch, DB_STIFFNESS)[slot] = bone->stiffness;
+            field(batch, DB_INERT)[slot] = bone->inert;
+            field(batch, DB_FRICTION)[slot] = bone->friction;
+            field(batch, DB_RADIUS)[slot] = bone->radius;
+        }
+    }
+}
+
+void destroy_batch(struct Batch* batch) {
+    free(batch->particles);
+    free(batch->links);
+    free(batch->trees);
+    free(batch->shapes);
+    free(batch->bone_first);
+}
+
+static const int MATRIX_ELEMENTS[9] = {0, 1, 2, 4, 5, 6, 8, 9, 10};
+
+void update_batch(struct Batch* batch, struct Scene* scene) {
+    int capacity = batch->capacity;
+    int tree_index = 0;
+    int shape_index = 0;
+    for (int b = 0; b < scene->bone_count; b++) {
+        struct SceneBone* bone = &scene->bones[b];
+        int first = batch->bone_first[b];
+        for (int i = 0; i < bone->particle_count; i++) {
+            const struct SceneParticle* p = &bone->particles[i];
+            if (!p->has_transform) {
+                continue;
+            }
+            int slot = first + i;
+            for (int a = 0; a < 3; a++) {
+                batch->particles[(DB_TRANSFORM_X + a) * capacity + slot] = p->transform_position[a];
+                batch->particles[(DB_LOCAL_X + a) * capacity + slot] = p->local[a];
+            }
+            for (int e = 0; e < 9; e++) {
+                batch->particles[(DB_MATRIX_0 + e) * capacity + slot] = p->matrix[MATRIX_ELEMENTS[e]];
+            }
+        }
+        memcpy(batch->shapes + shape_index, bone->shapes, bone->shape_count * sizeof(struct DynamicBoneShape));
+
+        float time_var;
+        int loop = get_loop_count(bone, scene->delta_time, &time_var);
+        for (int k = 0; k < bone->tree_count; k++) {
+            struct DynamicBoneTree* tree = &batch->trees[tree_index++];
+            tree->first = first + bone->trees[k].first;
+            tree->count = bone->trees[k].count;
+            tree->loop = loop;
+            tree->freeze_axis = bone->freeze_axis;
+            tree->shape_first = shape_index;
+            tree->shape_count = bone->shape_count;
+            tree->time_var = time_var;
+            tree->weight = bone->weight;
+            tree->object_scale = bone->object_scale;
+            get_tree_force(bone, &bone->trees[k], time_var, tree->force);
+            memcpy(tree->object_move, bone->object_move, sizeof(tree->object_move));
+        }
+        shape_index += bone->shape_count;
+    }
+    step_dynamic_bones(batch->particles, batch->links, capacity, batch->trees, tree_index, batch->shapes);
+}
+
+void get_batch_position(const struct Batch* batch, int bone, int index, float* out) {
+    int slot = batch->bone_first[bone] + index;
+    for (int a = 0; a < 3; a++) {
+        out[a] = batch->particles[(DB_X + a) * batch->capacity + slot];
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "scene.h"
+
+/*
+ * The solver side of the harness, what DynamicBoneSolver does in TypeScript: every bone of the scene takes a range
+ * of particle slots, each frame their transforms and colliders are written to the arrays and all trees are stepped
+ * with one step_dynamic_bones call.
+ */
+struct Batch {
+    int capacity;
+    float* particles;
+    int* links;
+    int tree_count;
+    struct DynamicBoneTree* trees;
+    int shape_count;
+    struct DynamicBoneShape* shapes;
+    /* The first slot of every bone. */
+    int* bone_first;
+};
+
+void create_batch(struct Batch* batch, const struct Scene* scene);
+void destroy_batch(struct Batch* batch);
+
+/*
+ * Write the frame's inputs of every bone, then step them all at once.
+ */
+void update_batch(struct Batch* batch, struct Scene* scene);
+
+/*
+ * The position of particle `index` of bone `bone`, `out` receives x, y, z.
+ */
+void get_batch_position(const struct Batch* batch, int bone, int index, float* out);
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * Per-frame cost of the dynamic bone solver against the object path.
+ *
+ * Usage: bench [-n max_characters] [-c chains] [-j joints] [-f frames] [-t min_seconds]
+ *
+ * Character counts go from 1 up to `max_characters` (default 1000) in steps of 1, 2, 5 per decade, each with one
+ * DynamicBone of `chains` hair chains (default 8) of `joints` transforms (default 6) and three colliders. `object`
+ * is reference.c, the C port of DynamicBone's object path updating bone by bone; `solver` writes the same inputs to
+ * the particle arrays and steps every character with one step_dynamic_bones call. Both time only the update, not
+ * the scene. The TypeScript object path runs slower than its C port, so the ratio is a lower bound of what the
+ * solver saves in a browser.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "batch.h"
+#include "reference.h"
+
+struct Options {
+    int max_characters;
+    int chains;
+    int joints;
+    int frames;
+    double min_seconds;
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// 每帧的最短时间, 跑到至少 min_seconds
+static double bench_path(const struct Options* options, int characters, int solver) {
+    double best = 1e30;
+    double start = now_seconds();
+    do {
+        struct Scene scene;
+        create_scene(&scene, characters, options->chains, options->joints);
+        update_scene(&scene);
+        struct ReferenceWorld* world = solver ? NULL : create_reference(&scene);
+        struct Batch batch;
+        if (solver) {
+            create_batch(&batch, &scene);
+        }
+        for (int frame = 0; frame < options->frames; frame++) {
+            update_scene(&scene);
+            double t0 = now_seconds();
+            if (solver) {
+                update_batch(&batch, &scene);
+            } else {
+                update_reference(world, &scene);
+            }
+            double t = now_seconds() - t0;
+            if (t < best) {
+                best = t;
+            }
+        }
+        if (solver) {
+            destroy_batch(&batch);
+        } else {
+            destroy_reference(world);
+        }
+        destroy_scene(&scene);
+    } while (now_seconds() - start < options->min_seconds);
+    return best;
+}
+
+static void usage(const char* name) {
+    fprintf(stderr, "usage: %s [-n max_characters] [-c chains] [-j joints] [-f frames] [-t min_seconds]\n", name);
+}
+
+int main(int argc, char** argv) {
+    struct Options options = {1000, 8, 6, 120, 0.2};
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char* value = argv[++i];
+        if (strcmp(argv[i - 1], "-n") == 0) {
+            options.max_characters = (int)atof(value);
+        } else if (strcmp(argv[i - 1], "-c") == 0) {
+            options.chains = atoi(value);
+        } else if (strcmp(argv[i - 1], "-j") == 0) {
+            options.joints = atoi(value);
+        } else if (strcmp(argv[i - 1], "-f") == 0) {
+            options.frames = atoi(value);
+        } else if (strcmp(argv[i - 1], "-t") == 0) {
+            options.min_seconds = atof(value);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.max_characters < 1 || options.chains < 1 || options.joints < 2 || options.frames < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    printf("%10s %10s %12s %12s %8s\n", "characters", "particles", "object ms", "solver ms", "speedup");
+    static const int STEPS[] = {1, 2, 5};
+    for (int decade = 1; decade <= options.max_characters; decade *= 10) {
+        for (int s = 0; s < 3 && decade * STEPS[s] <= options.max_characters; s++) {
+            int characters = decade * STEPS[s];
+            struct Scene scene;
+            create_scene(&scene, characters, options.chains, options.joints);
+            int particles = scene.particle_count;
+            destroy_scene(&scene);
+            double object = bench_path(&options, characters, 0);
+            double solver = bench_path(&options, characters, 1);
+            printf("%10d %10d %12.4f %12.4f %7.2fx\n", characters, particles, object * 1e3, solver * 1e3,
+                   object / solver);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,439 @@
+#include "reference.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct Particle {
+    int has_transform;
+    int parent;
+    int is_collide;
+    float damping;
+    float elasticity;
+    float stiffness;
+    float inert;
+    float friction;
+    float radius;
+    float position[3];
+    float prev_position[3];
+    float end_offset[3];
+    float transform_position[3];
+    float transform_local_position[3];
+    float transform_local_to_world[16];
+};
+
+struct Collider {
+    int (*collide)(struct Collider* collider, float* position, float radius);
+    struct DynamicBoneShape shape;
+    long* hits;
+};
+
+struct Tree {
+    int count;
+    struct Particle** particles;
+};
+
+struct Bone {
+    int tree_count;
+    struct Tree* trees;
+    int collider_count;
+    struct Collider** colliders;
+};
+
+struct ReferenceWorld {
+    int bone_count;
+    struct Bone* bones;
+    long hits[DB_INSIDE_PLANE + 1];
+};
+
+// Vector3 的静态方法
+static void v_sub(const float* a, const float* b, float* out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+static void v_add(const float* a, const float* b, float* out) {
+    out[0] = a[0] + b[0];
+    out[1] = a[1] + b[1];
+    out[2] = a[2] + b[2];
+}
+
+static void v_scale(const float* a, float s, float* out) {
+    out[0] = a[0] * s;
+    out[1] = a[1] * s;
+    out[2] = a[2] * s;
+}
+
+static float v_dot(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static float v_length_squared(const float* a) { return a[0] * a[0] + a[1] * a[1] + a[2] * a[2]; }
+
+static float v_length(const float* a) { return sqrtf(v_length_squared(a)); }
+
+static void v_transform_to_vec3(const float* v, const float* e, float* out) {
+    float x = v[0], y = v[1], z = v[2];
+    out[0] = x * e[0] + y * e[4] + z * e[8] + e[12];
+    out[1] = x * e[1] + y * e[5] + z * e[9] + e[13];
+    out[2] = x * e[2] + y * e[6] + z * e[10] + e[14];
+}
+
+static float lerp(float a, float b, float t) { return a + (b - a) * (t < 0 ? 0 : t > 1 ? 1 : t); }
+
+static int outside_sphere(float* p, float particle_radius, const float* center, float sphere_radius) {
+    float r = sphere_radius + particle_radius;
+    float d[3];
+    v_sub(p, center, d);
+    float dlen2 = v_length_squared(d);
+    if (dlen2 > 0 && dlen2 < r * r) {
+        v_scale(d, r / sqrtf(dlen2), d);
+        v_add(center, d, p);
+        return 1;
+    }
+    return 0;
+}
+
+static int inside_sphere(float* p, float particle_radius, const float* center, float sphere_radius) {
+    float r = sphere_radius - particle_radius;
+    float d[3];
+    v_sub(p, center, d);
+    float dlen2 = v_length_squared(d);
+    if (dlen2 > r * r) {
+        v_scale(d, r / sqrtf(dlen2), d);
+        v_add(center, d, p);
+        return 1;
+    }
+    return 0;
+}
+
+static int capsule(float* p, float particle_radius, const struct DynamicBoneShape* s, int inside, int two_radii) {
+    float dir[3], d[3];
+    v_sub(s->c1, s->c0, dir);
+    v_sub(p, s->c0, d);
+    float t = v_dot(d, dir);
+    float r0 = inside ? s->radius - particle_radius : s->radius + particle_radius;
+    float r1 = (two_radii ? s->radius2 : s->radius) + (inside ? -particle_radius : particle_radius);
+
+    if (t <= 0) {
+        return inside ? inside_sphere(p, 0, s->c0, r0) : outside_sphere(p, 0, s->c0, r0);
+    }
+    float dirlen = s->c01_distance;
+    float dirlen2 = dirlen * dirlen;
+    if (t >= dirlen2) {
+        return inside ? inside_sphere(p, 0, s->c1, r1) : outside_sphere(p, 0, s->c1, r1);
+    }
+    float q[3];
+    v_scale(dir, t / dirlen2, q);
+    v_sub(d, q, q);
+    float qlen2 = v_length_squared(q);
+    float r = s->radius;
+    if (two_radii) {
+        v_scale(dir, 1 / dirlen, dir);
+        float klen = v_dot(d, dir);
+        r = lerp(s->radius, s->radius2, klen / dirlen);
+    }
+    r = inside ? r - particle_radius : r + particle_radius;
+    if (inside ? qlen2 > r * r : qlen2 > 0 && qlen2 < r * r) {
+        float qlen = sqrtf(qlen2);
+        v_scale(q, (r - qlen) / qlen, q);
+        v_add(p, q, p);
+        return 1;
+    }
+    return 0;
+}
+
+static int collide_collider(struct Collider* collider, float* p, float radius) {
+    const struct DynamicBoneShape* s = &collider->shape;
+    int hit = 0;
+    switch (s->type) {
+        case DB_OUTSIDE_SPHERE:
+            hit = outside_sphere(p, radius, s->c0, s->radius);
+            break;
+        case DB_INSIDE_SPHERE:
+            hit = inside_sphere(p, radius, s->c0, s->radius);
+            break;
+        case DB_OUTSIDE_CAPSULE:
+        case DB_INSIDE_CAPSULE:
+            hit = capsule(p, radius, s, s->type == DB_INSIDE_CAPSULE, 0);
+            break;
+        case DB_OUTSIDE_CAPSULE2:
+        case DB_INSIDE_CAPSULE2:
+            hit = capsule(p, radius, s, s->type == DB_INSIDE_CAPSULE2, 1);
+            break;
+        default:
+            break;
+    }
+    collider->hits[s->type] += hit;
+    return hit;
+}
+
+static int collide_plane(struct Collider* collider, float* p, float radius) {
+    const struct DynamicBoneShape* s = &collider->shape;
+    float d = v_dot(s->c0, p) + s->radius;
+    if (s->type == DB_OUTSIDE_PLANE ? d < 0 : d > 0) {
+        float n[3];
+        v_scale(s->c0, d, n);
+        v_sub(p, n, p);
+        collider->hits[s->type]++;
+        return 1;
+    }
+    return 0;
+}
+
+struct ReferenceWorld* create_reference(const struct Scene* scene) {
+    struct ReferenceWorld* world = calloc(1, sizeof(struct ReferenceWorld));
+    world->bone_count = scene->bone_count;
+    world->bones = calloc(scene->bone_count, sizeof(struct Bone));
+    for (int b = 0; b < scene->bone_count; b++) {
+        const struct SceneBone* source = &scene->bones[b];
+        struct Bone* bone = &world->bones[b];
+        bone->tree_count = source->tree_count;
+        bone->trees = calloc(source->tree_count, sizeof(struct Tree));
+        for (int k = 0; k < source->tree_count; k++) {
+            const struct SceneTree* tree = &source->trees[k];
+            bone->trees[k].count = tree->count;
+            bone->trees[k].particles = calloc(tree->count, sizeof(struct Particle*));
+            for (int i = 0; i < tree->count; i++) {
+                const struct SceneParticle* sp = &source->particles[tree->first + i];
+                struct Particle* p = calloc(1, sizeof(struct Particle));
+                p->has_transform = sp->has_transform;
+                p->parent = sp->parent < 0 ? -1 : sp->parent - tree->first;
+                p->damping = source->damping;
+                p->elasticity = source->elasticity;
+                p->stiffness = source->stiffness;
+                p->inert = source->inert;
+                p->friction = source->friction;
+                p->radius = source->radius;
+                memcpy(p->position, sp->transform_position, sizeof(p->position));
+                memcpy(p->prev_position, sp->transform_position, sizeof(p->prev_position));
+                if (!sp->has_transform) {
+                    memcpy(p->end_offset, sp->local, sizeof(p->end_offset));
+                }
+                bone->trees[k].particles[i] = p;
+            }
+        }
+        bone->collider_count = source->shape_count;
+        bone->colliders = calloc(source->shape_count, sizeof(struct Collider*));
+        for (int j = 0; j < source->shape_count; j++) {
+            struct Collider* collider = calloc(1, sizeof(struct Collider));
+            int type = source->shapes[j].type;
+            collider->collide = type == DB_OUTSIDE_PLANE || type == DB_INSIDE_PLANE ? collide_plane : collide_collider;
+            collider->hits = world->hits;
+            bone->colliders[j] = collider;
+        }
+    }
+    return world;
+}
+
+void destroy_reference(struct ReferenceWorld* world) {
+    for (int b = 0; b < world->bone_count; b++) {
+        struct Bone* bone = &world->bones[b];
+        for (int k = 0; k < bone->tree_count; k++) {
+            for (int i = 0; i < bone->trees[k].count; i++) {
+                free(bone->trees[k].particles[i]);
+            }
+            free(bone->trees[k].particles);
+        }
+        for (int j = 0; j < bone->collider_count; j++) {
+            free(bone->colliders[j]);
+        }
+        free(bone->trees);
+        free(bone->colliders);
+    }
+    free(world->bones);
+    free(world);
+}
+
+static void prepare(struct Bone* bone, const struct SceneBone* source) {
+    for (int k = 0; k < bone->tree_count; k++) {
+        struct Tree* tree = &bone->trees[k];
+        for (int i = 0; i < tree->count; i++) {
+            struct Particle* p = tree->particles[i];
+            const struct SceneParticle* sp = &source->particles[source->trees[k].first + i];
+            if (p->has_transform) {
+                memcpy(p->transform_position, sp->transform_position, sizeof(p->transform_position));
+                memcpy(p->transform_local_position, sp->local, sizeof(p->transform_local_position));
+                memcpy(p->transform_local_to_world, sp->matrix, sizeof(p->transform_local_to_world));
+            }
+        }
+    }
+    for (int j = 0; j < bone->collider_count; j++) {
+        bone->colliders[j]->shape = source->shapes[j];
+    }
+}
+
+static void update_particles1(const struct SceneBone* source, struct Tree* tree, const struct SceneTree* scene_tree,
+                              float time_var, int loop_index) {
+    float force[3];
+    get_tree_force(source, scene_tree, time_var, force);
+    float object_move[3] = {0, 0, 0};
+    if (loop_index == 0) {
+        memcpy(object_move, source->object_move, sizeof(object_move));
+    }
+    for (int i = 0; i < tree->count; i++) {
+        struct Particle* p = tree->particles[i];
+        if (p->parent >= 0) {
+            float v[3], rmove[3];
+            v_sub(p->position, p->prev_position, v);
+            v_scale(object_move, p->inert, rmove);
+            v_add(p->position, rmove, p->prev_position);
+            float damping = p->damping;
+            if (p->is_collide) {
+                damping += p->friction;
+                if (damping > 1) {
+                    damping = 1;
+                }
+                p->is_collide = 0;
+            }
+            v_scale(v, 1 - damping, v);
+            v_add(p->position, v, p->position);
+            v_add(p->position, force, p->position);
+            v_add(p->position, rmove, p->position);
+        } else {
+            memcpy(p->prev_position, p->position, sizeof(p->position));
+            memcpy(p->position, p->transform_position, sizeof(p->position));
+        }
+    }
+}
+
+static float rest_length(const struct Particle* p, const struct Particle* p0) {
+    float d[3];
+    if (p->has_transform) {
+        v_sub(p0->transform_position, p->transform_position, d);
+    } else {
+        v_transform_to_vec3(p->end_offset, p0->transform_local_to_world, d);
+    }
+    return v_length(d);
+}
+
+static void rest_position(const struct Particle* p, const struct Particle* p0, float* out) {
+    float m0[16];
+    memcpy(m0, p0->transform_local_to_world, sizeof(m0));
+    m0[12] = p0->position[0];
+    m0[13] = p0->position[1];
+    m0[14] = p0->position[2];
+    v_transform_to_vec3(p->has_transform ? p->transform_local_position : p->end_offset, m0, out);
+}
+
+static void keep_length(struct Particle* p, const struct Particle* p0, float rest_len) {
+    float dd[3];
+    v_sub(p0->position, p->position, dd);
+    float len = v_length(dd);
+    if (len > 0) {
+        v_scale(dd, (len - rest_len) / len, dd);
+        v_add(p->position, dd, p->position);
+    }
+}
+
+static void update_particles2(const struct SceneBone* source, struct Bone* bone, struct Tree* tree, float time_var) {
+    for (int i = 1; i < tree->count; i++) {
+        struct Particle* p = tree->particles[i];
+        struct Particle* p0 = tree->particles[p->parent];
+        float rest_len = rest_length(p, p0);
+
+        float stiffness = lerp(1, p->stiffness, source->weight);
+        if (stiffness > 0 || p->elasticity > 0) {
+            float rest[3], d[3];
+            rest_position(p, p0, rest);
+            v_sub(rest, p->position, d);
+            v_scale(d, p->elasticity * time_var, d);
+            v_add(p->position, d, p->position);
+            if (stiffness > 0) {
+                v_sub(rest, p->position, d);
+                float len = v_length(d);
+                float max_len = rest_len * (1 - stiffness) * 2;
+                if (len > max_len) {
+                    v_scale(d, (len - max_len) / len, d);
+                    v_add(p->position, d, p->position);
+                }
+            }
+        }
+
+        if (bone->collider_count) {
+            float particle_radius = p->radius * source->object_scale;
+            for (int j = 0; j < bone->collider_count; j++) {
+                struct Collider* c = bone->colliders[j];
+                p->is_collide = p->is_collide || c->collide(c, p->position, particle_radius);
+            }
+        }
+
+        if (source->freeze_axis) {
+            const float* e = p0->transform_local_to_world + (source->freeze_axis - 1) * 4;
+            float n[3] = {e[0], e[1], e[2]};
+            float len = v_length(n);
+            if (len > 1e-6f) {
+                v_scale(n, 1 / len, n);
+            }
+            float distance = -v_dot(n, p0->position);
+            v_scale(n, v_dot(n, p->position) + distance, n);
+            v_sub(p->position, n, p->position);
+        }
+
+        keep_length(p, p0, rest_len);
+    }
+}
+
+static void skip_update_particles(const struct SceneBone* source, struct Tree* tree) {
+    for (int i = 0; i < tree->count; i++) {
+        struct Particle* p = tree->particles[i];
+        if (p->parent >= 0) {
+            v_add(p->prev_position, source->object_move, p->prev_position);
+            v_add(p->position, source->object_move, p->position);
+            struct Particle* p0 = tree->particles[p->parent];
+            float rest_len = rest_length(p, p0);
+            float stiffness = lerp(1, p->stiffness, source->weight);
+            if (stiffness > 0) {
+                float d[3];
+                rest_position(p, p0, d);
+                v_sub(d, p->position, d);
+                float len = v_length(d);
+                float max_len = rest_len * (1 - stiffness) * 2;
+                if (len > max_len) {
+                    v_scale(d, (len - max_len) / len, d);
+                    v_add(p->position, d, p->position);
+                }
+            }
+            keep_length(p, p0, rest_len);
+        } else {
+            memcpy(p->prev_position, p->position, sizeof(p->position));
+            memcpy(p->position, p->transform_position, sizeof(p->position));
+        }
+    }
+}
+
+void update_reference(struct ReferenceWorld* world, struct Scene* scene) {
+    for (int b = 0; b < world->bone_count; b++) {
+        struct Bone* bone = &world->bones[b];
+        struct SceneBone* source = &scene->bones[b];
+        prepare(bone, source);
+        float time_var;
+        int loop = get_loop_count(source, scene->delta_time, &time_var);
+        if (loop > 0) {
+            for (int i = 0; i < loop; i++) {
+                for (int k = 0; k < bone->tree_count; k++) {
+                    update_particles1(source, &bone->trees[k], &source->trees[k], time_var, i);
+                }
+                for (int k = 0; k < bone->tree_count; k++) {
+                    update_particles2(source, bone, &bone->trees[k], time_var);
+                }
+            }
+        } else {
+            for (int k = 0; k < bone->tree_count; k++) {
+                skip_update_particles(source, &bone->trees[k]);
+            }
+        }
+    }
+}
+
+const float* get_reference_position(const struct ReferenceWorld* world, int bone, int index) {
+    const struct Bone* b = &world->bones[bone];
+    for (int k = 0; k < b->tree_count; k++) {
+        if (index < b->trees[k].count) {
+            return b->trees[k].particles[index]->position;
+        }
+        index -= b->trees[k].count;
+    }
+    return NULL;
+}
+
+const long* get_reference_hits(const struct ReferenceWorld* world) { return world->hits; }
@@ -0,0 +1,32 @@
+#ifndef REFERENCE_H
+#define REFERENCE_H
+
+#include "scene.h"
+
+/*
+ * C port of the object path of DynamicBone: a particle object per bone with its own vectors and matrix, trees of
+ * particle pointers and colliders called one by one through their collide method, step by step as
+ * _updateParticles1 / _updateParticles2 / _skipUpdateParticles do. It is the reference the solver is tested against
+ * and the baseline of the benchmark.
+ */
+struct ReferenceWorld;
+
+struct ReferenceWorld* create_reference(const struct Scene* scene);
+void destroy_reference(struct ReferenceWorld* world);
+
+/*
+ * Prepare and step every bone for the current frame of the scene.
+ */
+void update_reference(struct ReferenceWorld* world, struct Scene* scene);
+
+/*
+ * The position of particle `index` of bone `bone`.
+ */
+const float* get_reference_position(const struct ReferenceWorld* world, int bone, int index);
+
+/*
+ * The collisions per shape type since the world was created, DB_INSIDE_PLANE + 1 counts.
+ */
+const long* get_reference_hits(const struct ReferenceWorld* world);
+
+#endif
@@ -0,0 +1,235 @@
+#include "scene.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHARACTERS_PER_ROW 32
+
+// 角色空间里的碰撞体: 头, 身体, 以及限制头发的平面和包围体
+static void set_sphere(struct DynamicBoneShape* shape, int type, float x, float y, float z, float radius) {
+    memset(shape, 0, sizeof(*shape));
+    shape->type = type;
+    shape->radius = radius;
+    shape->c0[0] = x;
+    shape->c0[1] = y;
+    shape->c0[2] = z;
+}
+
+static void set_capsule(struct DynamicBoneShape* shape, int type, float y0, float y1, float radius, float radius2) {
+    set_sphere(shape, type, 0, y0, 0, radius);
+    shape->radius2 = radius2;
+    shape->c1[1] = y1;
+    shape->c01_distance = fabsf(y0 - y1);
+}
+
+// 平面: 法线 n, 过点 (0, y, z)
+static void set_plane(struct DynamicBoneShape* shape, int type, float nx, float ny, float nz, float y, float z) {
+    set_sphere(shape, type, nx, ny, nz, -(ny * y + nz * z));
+}
+
+void create_scene(struct Scene* scene, int characters, int chains, int joints) {
+    scene->bone_count = characters;
+    scene->bones = calloc(characters, sizeof(struct SceneBone));
+    scene->particle_count = 0;
+    scene->delta_time = 0;
+    scene->elapsed = 0;
+    scene->frame = 0;
+
+    for (int c = 0; c < characters; c++) {
+        struct SceneBone* bone = &scene->bones[c];
+        int end = c % 3 == 0;
+        bone->update_mode = c % 2 ? 0 : 3;
+        bone->update_rate = 60;
+        bone->damping = 0.1f;
+        bone->elasticity = 0.1f;
+        bone->stiffness = 0.1f;
+        bone->inert = 0.3f;
+        bone->friction = 0.2f;
+        bone->radius = 0.02f;
+        bone->weight = c % 5 == 2 ? 0.6f : 1;
+        bone->freeze_axis = c % 4 == 1 ? 1 : 0;
+        bone->gravity[1] = -0.002f;
+        bone->force[0] = 0.0005f;
+        bone->object_scale = 1;
+
+        int per_tree = joints + end;
+        bone->tree_count = chains;
+        bone->trees = calloc(chains, sizeof(struct SceneTree));
+        bone->particle_count = chains * per_tree;
+        bone->particles = calloc(bone->particle_count, sizeof(struct SceneParticle));
+        for (int k = 0; k < chains; k++) {
+            float angle = 6.2831853f * k / chains;
+            float ca = cosf(angle);
+            float sa = sinf(angle);
+            struct SceneTree* tree = &bone->trees[k];
+            tree->first = k * per_tree;
+            tree->count = per_tree;
+            for (int j = 0; j < per_tree; j++) {
+                struct SceneParticle* p = &bone->particles[tree->first + j];
+                p->parent = j ? tree->first + j - 1 : -1;
+                p->has_transform = j < joints;
+                if (j == 0) {
+                    p->local[0] = 0.1f * ca;
+                    p->local[1] = 1.75f;
+                    p->local[2] = 0.1f * sa;
+                } else {
+                    p->local[0] = 0.03f * ca;
+                    p->local[1] = -0.08f;
+                    p->local[2] = 0.03f * sa;
+                }
+                const float* parent = j ? bone->particles[p->parent].rest : NULL;
+                for (int a = 0; a < 3; a++) {
+                    p->rest[a] = (parent ? parent[a] : 0) + p->local[a];
+                }
+            }
+        }
+
+        // 三组碰撞体轮换, 覆盖每一种碰撞类型
+        switch (c % 3) {
+            case 0:
+                bone->shape_count = 3;
+                set_sphere(&bone->local_shapes[0], DB_OUTSIDE_SPHERE, 0, 1.72f, 0, 0.11f);
+                set_capsule(&bone->local_shapes[1], DB_OUTSIDE_CAPSULE2, 1.45f, 0.9f, 0.2f, 0.15f);
+                set_plane(&bone->local_shapes[2], DB_OUTSIDE_PLANE, 0, 1, 0, 1.3f, 0);
+                break;
+            case 1:
+                bone->shape_count = 3;
+                set_plane(&bone->local_shapes[0], DB_INSIDE_PLANE, 0, 0, 1, 0, 0.15f);
+                set_capsule(&bone->local_shapes[1], DB_OUTSIDE_CAPSULE, 1.6f, 0.9f, 0.25f, 0);
+                set_sphere(&bone->local_shapes[2], DB_INSIDE_SPHERE, 0, 1.6f, 0, 0.45f);
+                break;
+            default:
+                bone->shape_count = 3;
+                set_capsule(&bone->local_shapes[0], DB_INSIDE_CAPSULE2, 1.7f, 1.0f, 0.3f, 0.2f);
+                set_capsule(&bone->local_shapes[1], DB_INSIDE_CAPSULE, 1.7f, 1.0f, 0.25f, 0);
+                set_sphere(&bone->local_shapes[2], DB_OUTSIDE_SPHERE, 0, 1.72f, 0, 0.11f);
+                break;
+        }
+        scene->particle_count += bone->particle_count;
+    }
+}
+
+void destroy_scene(struct Scene* scene) {
+    for (int c = 0; c < scene->bone_count; c++) {
+        free(scene->bones[c].particles);
+        free(scene->bones[c].trees);
+    }
+    free(scene->bones);
+}
+
+static void rotate_y(float yaw, const float* v, float* out) {
+    float c = cosf(yaw);
+    float s = sinf(yaw);
+    float x = v[0] * c + v[2] * s;
+    float z = -v[0] * s + v[2] * c;
+    out[0] = x;
+    out[1] = v[1];
+    out[2] = z;
+}
+
+static void transform_shape(const struct SceneBone* bone, const struct DynamicBoneShape* local,
+                            struct DynamicBoneShape* out) {
+    *out = *local;
+    if (local->type == DB_OUTSIDE_PLANE || local->type == DB_INSIDE_PLANE) {
+        // 平面过的点 q 满足 n·q = -distance
+        float q[3] = {-local->radius * local->c0[0], -local->radius * local->c0[1], -local->radius * local->c0[2]};
+        rotate_y(bone->yaw, local->c0, out->c0);
+        rotate_y(bone->yaw, q, q);
+        out->radius = 0;
+        for (int a = 0; a < 3; a++) {
+            out->radius -= out->c0[a] * (q[a] + bone->position[a]);
+        }
+        return;
+    }
+    rotate_y(bone->yaw, local->c0, out->c0);
+    rotate_y(bone->yaw, local->c1, out->c1);
+    for (int a = 0; a < 3; a++) {
+        out->c0[a] += bone->position[a];
+        out->c1[a] += bone->position[a];
+    }
+}
+
+void update_scene(struct Scene* scene) {
+    // 帧间隔在 1/240 到 1/30 秒之间变化, 让 UpdateMode.Normal 的角色有 0 到 2 步
+    int frame = scene->frame++;
+    scene->delta_time = frame % 7 == 3 ? 1.0f / 30 : frame % 11 == 5 ? 1.0f / 240 : 1.0f / 60;
+    scene->elapsed += scene->delta_time;
+    float t = scene->elapsed;
+
+    for (int c = 0; c < scene->bone_count; c++) {
+        struct SceneBone* bone = &scene->bones[c];
+        float base[3] = {(c % CHARACTERS_PER_ROW) * 2.0f, 0, (c / CHARACTERS_PER_ROW) * 2.0f};
+        float position[3] = {base[0] + 0.3f * sinf(2 * t + c), 0.05f * sinf(5 * t + c),
+                             base[2] + 0.3f * cosf(1.4f * t + c)};
+        for (int a = 0; a < 3; a++) {
+            bone->object_move[a] = frame ? position[a] - bone->position[a] : 0;
+            bone->position[a] = position[a];
+        }
+        bone->yaw = 0.5f * sinf(0.9f * t + c);
+
+        float cy = cosf(bone->yaw);
+        float sy = sinf(bone->yaw);
+        for (int i = 0; i < bone->particle_count; i++) {
+            struct SceneParticle* p = &bone->particles[i];
+            rotate_y(bone->yaw, p->rest, p->transform_position);
+            for (int a = 0; a < 3; a++) {
+                p->transform_position[a] += position[a];
+            }
+            float* m = p->matrix;
+            memset(m, 0, sizeof(p->matrix));
+            m[0] = cy;
+            m[2] = -sy;
+            m[5] = 1;
+            m[8] = sy;
+            m[10] = cy;
+            m[12] = p->transform_position[0];
+            m[13] = p->transform_position[1];
+            m[14] = p->transform_position[2];
+            m[15] = 1;
+        }
+        for (int k = 0; k < bone->tree_count; k++) {
+            rotate_y(bone->yaw, bone->gravity, bone->trees[k].rest_gravity);
+        }
+        for (int j = 0; j < bone->shape_count; j++) {
+            transform_shape(bone, &bone->local_shapes[j], &bone->shapes[j]);
+        }
+    }
+}
+
+int get_loop_count(struct SceneBone* bone, float delta_time, float* time_var) {
+    int loop = 1;
+    *time_var = 1;
+    if (bone->update_mode == 3) {
+        if (bone->update_rate > 0) {
+            *time_var = delta_time * bone->update_rate;
+        }
+    } else if (bone->update_rate > 0) {
+        float frame_time = 1.0f / bone->update_rate;
+        bone->time += delta_time;
+        loop = 0;
+        while (bone->time >= frame_time) {
+            bone->time -= frame_time;
+            loop += 1;
+            if (loop >= 3) {
+                bone->time = 0;
+                break;
+            }
+        }
+    }
+    return loop;
+}
+
+void get_tree_force(const struct SceneBone* bone, const struct SceneTree* tree, float time_var, float* out) {
+    const float* g = bone->gravity;
+    float len = sqrtf(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+    float inv = len > 1e-6f ? 1 / len : 1;
+    float dir[3] = {g[0] * inv, g[1] * inv, g[2] * inv};
+    float scale = fmaxf(tree->rest_gravity[0] * dir[0] + tree->rest_gravity[1] * dir[1] +
+                            tree->rest_gravity[2] * dir[2],
+                        0);
+    float s = bone->object_scale * time_var;
+    for (int a = 0; a < 3; a++) {
+        out[a] = (g[a] - dir[a] * scale + bone->force[a]) * s;
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "../src/solver/dynamic_bone.h"
+
+/*
+ * Synthetic characters for the dynamic bone harness: every character carries one DynamicBone with a tree per hair
+ * chain, walks along its own loop and turns its head. It stands in for the engine, the transforms of a frame are
+ * computed here and read by both the object path and the solver.
+ */
+
+#define SCENE_MAX_SHAPES 4
+
+struct SceneParticle {
+    /* Index of the parent in the bone's particles, -1 for the root of a tree. */
+    int parent;
+    int has_transform;
+    /* Rest position in character space. */
+    float rest[3];
+    /* Local position of the transform, or the end offset. */
+    float local[3];
+
+    /* Frame inputs, as DynamicBone._prepare reads them from the transforms. */
+    float transform_position[3];
+    /* Column major world matrix of the transform. */
+    float matrix[16];
+};
+
+struct SceneTree {
+    int first;
+    int count;
+    float rest_gravity[3];
+};
+
+struct SceneBone {
+    /* UpdateMode: 3 for Default, 0 for Normal. */
+    int update_mode;
+    float update_rate;
+    float damping;
+    float elasticity;
+    float stiffness;
+    float inert;
+    float friction;
+    float radius;
+    float weight;
+    int freeze_axis;
+    float gravity[3];
+    float force[3];
+
+    int particle_count;
+    struct SceneParticle* particles;
+    int tree_count;
+    struct SceneTree* trees;
+    int shape_count;
+    /* Colliders in character space, and in world space for the current frame. */
+    struct DynamicBoneShape local_shapes[SCENE_MAX_SHAPES];
+    struct DynamicBoneShape shapes[SCENE_MAX_SHAPES];
+
+    /* Frame state of the character, as DynamicBone keeps it. */
+    float position[3];
+    float yaw;
+    float object_move[3];
+    float object_scale;
+    float time;
+};
+
+struct Scene {
+    int bone_count;
+    struct SceneBone* bones;
+    int particle_count;
+    float delta_time;
+    float elapsed;
+    int frame;
+};
+
+/*
+ * Build `characters` characters with `chains` hair chains of `joints` transforms each. Every third character
+ * also has an end particle past the last transform of each chain.
+ */
+void create_scene(struct Scene* scene, int characters, int chains, int joints);
+void destroy_scene(struct Scene* scene);
+
+/*
+ * Advance to the next frame: pick its delta time, move the characters and compute the transforms and colliders.
+ */
+void update_scene(struct Scene* scene);
+
+/*
+ * Steps of the frame and their time_var, as DynamicBone._updateParticles computes them.
+ */
+int get_loop_count(struct SceneBone* bone, float delta_time, float* time_var);
+
+/*
+ * The force of a tree for one step, as DynamicBone._updateSingleParticles1 computes it.
+ */
+void get_tree_force(const struct SceneBone* bone, const struct SceneTree* tree, float time_var, float* out);
+
+#endif
@@ -0,0 +1,86 @@
+/**
+ * Regression test for the dynamic bone solver.
+ *
+ * Characters of every collider set, update mode, freeze axis and end particle option are simulated for a few
+ * hundred frames by the object path (reference.c) and by step_dynamic_bones over all of them at once. Every
+ * particle must end up where the object path puts it, and every collider type must have been hit.
+ */
+#include <math.h>
+#include <stdio.h>
+
+#include "batch.h"
+#include "reference.h"
+
+#define CHARACTERS 12
+#define CHAINS 8
+#define JOINTS 6
+#define FRAMES 600
+/* Both sides run the same float operations in the same order, the tolerance only absorbs libm differences. */
+#define TOLERANCE 1e-5f
+
+static const char* SHAPE_NAMES[] = {"outside sphere",   "inside sphere",   "outside capsule", "inside capsule",
+                                    "outside capsule2", "inside capsule2", "outside plane",   "inside plane"};
+
+int main(void) {
+    struct Scene reference_scene, batch_scene;
+    create_scene(&reference_scene, CHARACTERS, CHAINS, JOINTS);
+    create_scene(&batch_scene, CHARACTERS, CHAINS, JOINTS);
+    update_scene(&reference_scene);
+    update_scene(&batch_scene);
+    struct ReferenceWorld* world = create_reference(&reference_scene);
+    struct Batch batch;
+    create_batch(&batch, &batch_scene);
+
+    int cases = 0;
+    int failed = 0;
+    float max_error = 0;
+    for (int frame = 1; frame <= FRAMES; frame++) {
+        update_scene(&reference_scene);
+        update_scene(&batch_scene);
+        update_reference(world, &reference_scene);
+        update_batch(&batch, &batch_scene);
+
+        for (int b = 0; b < CHARACTERS; b++) {
+            int mismatch = -1;
+            for (int i = 0; i < reference_scene.bones[b].particle_count && mismatch < 0; i++) {
+                const float* expected = get_reference_position(world, b, i);
+                float actual[3];
+                get_batch_position(&batch, b, i, actual);
+                for (int a = 0; a < 3; a++) {
+                    float error = fabsf(actual[a] - expected[a]) / (1 + fabsf(expected[a]));
+                    if (error > max_error) {
+                        max_error = error;
+                    }
+                    if (!(error <= TOLERANCE)) {
+                        mismatch = i;
+                    }
+                }
+            }
+            cases++;
+            if (mismatch >= 0) {
+                // 每个角色只报告第一次不一致
+                if (failed < 10) {
+                    fprintf(stderr, "frame %d character %d: particle %d differs from the object path\n", frame, b,
+                            mismatch);
+                }
+                failed++;
+            }
+        }
+    }
+
+    const long* hits = get_reference_hits(world);
+    for (int type = 0; type <= DB_INSIDE_PLANE; type++) {
+        cases++;
+        if (!hits[type]) {
+            fprintf(stderr, "no particle hit an %s\n", SHAPE_NAMES[type]);
+            failed++;
+        }
+    }
+
+    destroy_batch(&batch);
+    destroy_reference(world);
+    destroy_scene(&reference_scene);
+    destroy_scene(&batch_scene);
+    printf("%d cases, %d failed, max relative error %g\n", cases, failed, max_error);
+    return failed ? 1 : 0;
+}
@@ -1,6 +1,13 @@
 import { CollisionUtil, MathUtil, Matrix, Plane, Quaternion, Script, Transform, Vector3 } from "@galacean/engine";
 import { DynamicBoneColliderBase } from "./DynamicBoneColliderBase";
 import { MathCommon } from "./MathCommon";
+import {
+  DynamicBoneField,
+  DynamicBoneFlag,
+  DynamicBoneLink,
+  DynamicBoneRecord,
+  DynamicBoneSolver
+} from "./solver/DynamicBoneSolver";
 
 export enum UpdateMode {
   Normal,
@@ -20,12 +27,14 @@ export class DynamicBone extends Script {
   private static _tempVec1 = new Vector3();
   private static _tempVec2 = new Vector3();
   private static _tempVec3 = new Vector3();
+  private static _tempInertMove = new Vector3();
   private static _tempQuat = new Quaternion();
   private static _tempMatrix = new Matrix();
   private static _tempPlane = new Plane();
 
   private static _updateCount: number = 0;
   private static _prepareFrame: number = 0;
+  private static _shapeWarned = false;
 
   /// The roots of the transform hierarchy to apply physics.
   public root: Transform = null;
@@ -83,6 +92,14 @@ export class DynamicBone extends Script {
   public referenceObject: Transform = null;
   public distanceToObject: number = 20;
 
+  /// Simulate with DynamicBoneSolver if it is loaded when the bone starts, batched with the other bones.
+  public useSolver = true;
+
+  /** @internal */
+  _solverFirst: number = -1;
+  /** @internal */
+  _solverCount: number = 0;
+
   private _objectMove = new Vector3();
   private _objectPrevPosition = new Vector3();
   private _objectScale: number = 0;
@@ -97,6 +114,8 @@ export class DynamicBone extends Script {
   // prepare data
   private _deltaTime: number = 0;
   private _effectiveColliders: DynamicBoneColliderBase[] = [];
+  private _loop: number = 0;
+  private _timeVar: number = 1;
 
   public setWeight(w: number): void {
     if (this._weight != w) {
@@ -119,6 +138,7 @@ export class DynamicBone extends Script {
    */
   override onStart(): void {
     this._setupParticles();
+    this._addToSolver();
   }
 
   /**
@@ -126,6 +146,7 @@ export class DynamicBone extends Script {
    */
   override onEnable(): void {
     this._resetParticlesPosition();
+    this._solverFirst >= 0 && DynamicBoneSolver.get(this.engine).setEnabled(this, true);
   }
 
   /**
@@ -133,6 +154,17 @@ export class DynamicBone extends Script {
    */
   override onDisable(): void {
     this._initTransforms();
+    this._solverFirst >= 0 && DynamicBoneSolver.get(this.engine).setEnabled(this, false);
+  }
+
+  /**
+   * @internal
+   */
+  override onDestroy(): void {
+    if (this._solverFirst >= 0) {
+      DynamicBoneSolver.get(this.engine).remove(this);
+      this._solverFirst = -1;
+    }
   }
 
   /**
@@ -158,7 +190,9 @@ export class DynamicBone extends Script {
    * @internal
    */
   override onLateUpdate(deltaTime: number): void {
+    const useSolver = this._solverFirst >= 0;
     if (this._preUpdateCount == 0) {
+      useSolver && DynamicBoneSolver.get(this.engine).submit(this, false);
       return;
     }
 
@@ -170,12 +204,115 @@ export class DynamicBone extends Script {
     this.setWeight(this.blendWeight);
 
     this._checkDistance();
-    if (this._isNeedUpdate()) {
+    const needUpdate = this._isNeedUpdate();
+    if (needUpdate) {
       this._prepare();
-      this._updateParticles();
-      this._applyParticlesToTransforms();
+      if (useSolver) {
+        this._loop = this._getLoopCount();
+      } else {
+        this._updateParticles();
+        this._applyParticlesToTransforms();
+      }
     }
     this._preUpdateCount = 0;
+    // The solver steps the bones of the frame at once and applies them, see DynamicBoneSolver.submit.
+    useSolver && DynamicBoneSolver.get(this.engine).submit(this, needUpdate);
+  }
+
+  /**
+   * @internal
+   */
+  _getSolverTreeCount(): number {
+    return this._particleTrees.length;
+  }
+
+  /**
+   * @internal
+   */
+  _getSolverShapeCount(): number {
+    return this._effectiveColliders.length;
+  }
+
+  /**
+   * @internal
+   * Write the colliders of the frame from word `offset` on, returns the number written.
+   */
+  _writeSolverShapes(heap32: Float32Array, heapI32: Int32Array, offset: number): number {
+    let count = 0;
+    for (let i = 0; i < this._effectiveColliders.length; i++) {
+      if (this._effectiveColliders[i]._writeShape(heap32, heapI32, offset + count * DynamicBoneRecord.ShapeSize)) {
+        count++;
+      } else if (!DynamicBone._shapeWarned) {
+        DynamicBone._shapeWarned = true;
+        console.warn("DynamicBone: the solver skips colliders without a shape, set useSolver to false to use them.");
+      }
+    }
+    return count;
+  }
+
+  /**
+   * @internal
+   * Write a `struct DynamicBoneTree` per particle tree from word `offset` on, returns the word after them.
+   */
+  _writeSolverTrees(
+    heap32: Float32Array,
+    heapI32: Int32Array,
+    offset: number,
+    shapeFirst: number,
+    shapeCount: number
+  ): number {
+    const force = DynamicBone._tempVec1;
+    const objectMove = this._objectMove;
+    let slot = this._solverFirst;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      const pt = this._particleTrees[i];
+      const count = pt._particles.length;
+      this._getTreeForce(pt, this._timeVar, force);
+      heapI32[offset] = slot;
+      heapI32[offset + 1] = count;
+      heapI32[offset + 2] = this._loop;
+      heapI32[offset + 3] = this.freezeAxis;
+      heapI32[offset + 4] = shapeFirst;
+      heapI32[offset + 5] = shapeCount;
+      heap32[offset + 6] = this._timeVar;
+      heap32[offset + 7] = this._weight;
+      heap32[offset + 8] = this._objectScale;
+      heap32[offset + 9] = force.x;
+      heap32[offset + 10] = force.y;
+      heap32[offset + 11] = force.z;
+      heap32[offset + 12] = objectMove.x;
+      heap32[offset + 13] = objectMove.y;
+      heap32[offset + 14] = objectMove.z;
+      offset += DynamicBoneRecord.TreeSize;
+      slot += count;
+    }
+    return offset;
+  }
+
+  /**
+   * @internal
+   * Read the stepped particles back and apply them to the transforms.
+   */
+  _applySolverParticles(): void {
+    const { particles, capacity } = DynamicBoneSolver.get(this.engine);
+    let slot = this._solverFirst;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      const particleList = this._particleTrees[i]._particles;
+      for (let j = 0; j < particleList.length; j++, slot++) {
+        const p = particleList[j];
+        p._position.set(
+          particles[DynamicBoneField.X * capacity + slot],
+          particles[DynamicBoneField.Y * capacity + slot],
+          particles[DynamicBoneField.Z * capacity + slot]
+        );
+        p._prevPosition.set(
+          particles[DynamicBoneField.PrevX * capacity + slot],
+          particles[DynamicBoneField.PrevY * capacity + slot],
+          particles[DynamicBoneField.PrevZ * capacity + slot]
+        );
+      }
+    }
+    this._applyParticlesToTransforms();
   }
 
   private _prepare(): void {
@@ -190,6 +327,9 @@ export class DynamicBone extends Script {
       const pt = this._particleTrees[i];
       Vector3.transformToVec3(pt._localGravity, pt._root!.worldMatrix, pt._restGravity);
 
+      if (this._solverFirst >= 0) {
+        continue;
+      }
       for (let j = 0; j < pt._particles.length; j++) {
         const p = pt._particles[j];
         const transform = p._transform;
@@ -200,6 +340,7 @@ export class DynamicBone extends Script {
         }
       }
     }
+    this._solverFirst >= 0 && this._prepareSolver();
 
     this._effectiveColliders.length = 0;
 
@@ -218,11 +359,59 @@ export class DynamicBone extends Script {
     }
   }
 
+  private _prepareSolver(): void {
+    const { particles, capacity } = DynamicBoneSolver.get(this.engine);
+    let slot = this._solverFirst;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      const particleList = this._particleTrees[i]._particles;
+      for (let j = 0; j < particleList.length; j++, slot++) {
+        const transform = particleList[j]._transform;
+        if (transform == null) {
+          continue;
+        }
+        const worldPosition = transform.worldPosition;
+        const position = transform.position;
+        const e = transform.worldMatrix.elements;
+        particles[DynamicBoneField.TransformX * capacity + slot] = worldPosition.x;
+        particles[DynamicBoneField.TransformY * capacity + slot] = worldPosition.y;
+        particles[DynamicBoneField.TransformZ * capacity + slot] = worldPosition.z;
+        particles[DynamicBoneField.LocalX * capacity + slot] = position.x;
+        particles[DynamicBoneField.LocalY * capacity + slot] = position.y;
+        particles[DynamicBoneField.LocalZ * capacity + slot] = position.z;
+        const matrix = DynamicBoneField.Matrix * capacity + slot;
+        particles[matrix] = e[0];
+        particles[matrix + capacity] = e[1];
+        particles[matrix + 2 * capacity] = e[2];
+        particles[matrix + 3 * capacity] = e[4];
+        particles[matrix + 4 * capacity] = e[5];
+        particles[matrix + 5 * capacity] = e[6];
+        particles[matrix + 6 * capacity] = e[8];
+        particles[matrix + 7 * capacity] = e[9];
+        particles[matrix + 8 * capacity] = e[10];
+      }
+    }
+  }
+
   private _updateParticles(): void {
     if (this._particleTrees.length <= 0) {
       return;
     }
 
+    const loop = this._getLoopCount();
+    if (loop > 0) {
+      for (let i = 0; i < loop; i++) {
+        this._updateParticles1(this._timeVar, i);
+        this._updateParticles2(this._timeVar);
+      }
+    } else {
+      this._skipUpdateParticles();
+    }
+  }
+
+  /**
+   * The simulation steps of this frame, 0 to only follow the object, and their time scale in `_timeVar`.
+   */
+  private _getLoopCount(): number {
     let loop = 1;
     let timeVar: number = 1;
     const dt = this._deltaTime;
@@ -248,14 +437,8 @@ export class DynamicBone extends Script {
       }
     }
 
-    if (loop > 0) {
-      for (let i = 0; i < loop; i++) {
-        this._updateParticles1(timeVar, i);
-        this._updateParticles2(timeVar);
-      }
-    } else {
-      this._skipUpdateParticles();
-    }
+    this._timeVar = timeVar;
+    return loop;
   }
 
   private _setupParticles(): void {
@@ -320,6 +503,77 @@ export class DynamicBone extends Script {
     }
   }
 
+  private _addToSolver(): void {
+    const solver = DynamicBoneSolver.get(this.engine);
+    let count = 0;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      count += this._particleTrees[i]._particles.length;
+    }
+    if (!this.useSolver || !count) {
+      return;
+    }
+    if (!solver.loaded) {
+      // Keep the object path until the kernel is ready.
+      solver.load().then(
+        () => {
+          if (!this.destroyed && this._solverFirst < 0) {
+            this._addToSolver();
+            if (this._solverFirst >= 0 && !(this.enabled && this.entity.isActiveInHierarchy)) {
+              solver.setEnabled(this, false);
+            }
+          }
+        },
+        (error) => console.warn("DynamicBone: failed to load the solver, bones keep the object path.", error)
+      );
+      return;
+    }
+    this._solverCount = count;
+    this._solverFirst = solver.add(this, count);
+    const { particles, links, capacity } = solver;
+    let slot = this._solverFirst;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      const particleList = this._particleTrees[i]._particles;
+      const root = slot;
+      for (let j = 0; j < particleList.length; j++, slot++) {
+        const p = particleList[j];
+        links[DynamicBoneLink.Parent * capacity + slot] = p._parentIndex >= 0 ? root + p._parentIndex : -1;
+        links[DynamicBoneLink.Flags * capacity + slot] = p._transform ? DynamicBoneFlag.HasTransform : 0;
+        // Particles with a transform get their local position every frame.
+        particles[DynamicBoneField.LocalX * capacity + slot] = p._endOffset.x;
+        particles[DynamicBoneField.LocalY * capacity + slot] = p._endOffset.y;
+        particles[DynamicBoneField.LocalZ * capacity + slot] = p._endOffset.z;
+        particles[DynamicBoneField.Damping * capacity + slot] = p._damping;
+        particles[DynamicBoneField.Elasticity * capacity + slot] = p._elasticity;
+        particles[DynamicBoneField.Stiffness * capacity + slot] = p._stiffness;
+        particles[DynamicBoneField.Inert * capacity + slot] = p._inert;
+        particles[DynamicBoneField.Friction * capacity + slot] = p._friction;
+        particles[DynamicBoneField.Radius * capacity + slot] = p._radius;
+      }
+    }
+    this._writeSolverPositions();
+  }
+
+  /**
+   * Copy the particle positions to the solver, after a reset.
+   */
+  private _writeSolverPositions(): void {
+    const { particles, links, capacity } = DynamicBoneSolver.get(this.engine);
+    let slot = this._solverFirst;
+    for (let i = 0; i < this._particleTrees.length; i++) {
+      const particleList = this._particleTrees[i]._particles;
+      for (let j = 0; j < particleList.length; j++, slot++) {
+        const { _position: position, _prevPosition: prevPosition } = particleList[j];
+        particles[DynamicBoneField.X * capacity + slot] = position.x;
+        particles[DynamicBoneField.Y * capacity + slot] = position.y;
+        particles[DynamicBoneField.Z * capacity + slot] = position.z;
+        particles[DynamicBoneField.PrevX * capacity + slot] = prevPosition.x;
+        particles[DynamicBoneField.PrevY * capacity + slot] = prevPosition.y;
+        particles[DynamicBoneField.PrevZ * capacity + slot] = prevPosition.z;
+        links[DynamicBoneLink.Flags * capacity + slot] &= ~DynamicBoneFlag.Collide;
+      }
+    }
+  }
+
   private _appendParticleTree(root: Transform): void {
     const pt = new ParticleTree();
     pt._root = root;
@@ -457,6 +711,7 @@ export class DynamicBone extends Script {
       this._resetSingleParticlesPosition(this._particleTrees[i]);
     }
     this._objectPrevPosition.copyFrom(this.entity.transform.worldPosition);
+    this._solverFirst >= 0 && this._writeSolverPositions();
   }
 
   private _resetSingleParticlesPosition(pt: ParticleTree): void {
@@ -484,8 +739,7 @@ export class DynamicBone extends Script {
     }
   }
 
-  private _updateSingleParticles1(pt: ParticleTree, timeVar: number, loopIndex: number): void {
-    const force = DynamicBone._tempVec1;
+  private _getTreeForce(pt: ParticleTree, timeVar: number, force: Vector3): void {
     force.copyFrom(this.gravity);
     const fdir = DynamicBone._tempVec2;
     Vector3.normalize(this.gravity, fdir);
@@ -496,6 +750,11 @@ export class DynamicBone extends Script {
     force.subtract(pf); // remove projected gravity
     force.add(this.force);
     force.scale(this._objectScale * timeVar);
+  }
+
+  private _updateSingleParticles1(pt: ParticleTree, timeVar: number, loopIndex: number): void {
+    const force = DynamicBone._tempVec1;
+    this._getTreeForce(pt, timeVar, force);
 
     // only first loop consider object move
     const objectMove = DynamicBone._tempVec3;
@@ -511,8 +770,9 @@ export class DynamicBone extends Script {
         // verlet integration
         const v = DynamicBone._tempVec2;
         Vector3.subtract(p._position, p._prevPosition, v);
-        objectMove.scale(p._inert);
-        const rmove = objectMove;
+        // Scaled into its own vector, objectMove is shared by every particle of the loop.
+        const rmove = DynamicBone._tempInertMove;
+        Vector3.scale(objectMove, p._inert, rmove);
         Vector3.add(p._position, rmove, p._prevPosition);
         let damping = p._damping;
         if (p._isCollide) {
@@ -177,6 +177,24 @@ export class DynamicBoneCollider extends DynamicBoneColliderBase {
     }
   }
 
+  /**
+   * @internal
+   */
+  override _writeShape(heap32: Float32Array, heapI32: Int32Array, offset: number): boolean {
+    const { _c0: c0, _c1: c1 } = this;
+    heapI32[offset] = this._collideType;
+    heap32[offset + 1] = this._scaledRadius;
+    heap32[offset + 2] = this._scaledRadius2;
+    heap32[offset + 3] = this._c01Distance;
+    heap32[offset + 4] = c0.x;
+    heap32[offset + 5] = c0.y;
+    heap32[offset + 6] = c0.z;
+    heap32[offset + 7] = c1.x;
+    heap32[offset + 8] = c1.y;
+    heap32[offset + 9] = c1.z;
+    return true;
+  }
+
   static outsideSphere(
     particlePosition: Vector3,
     particleRadius: number,
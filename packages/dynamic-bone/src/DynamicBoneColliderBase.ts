@@ -28,4 +28,13 @@ export class DynamicBoneColliderBase extends Script {
   public collide(particlePosition: Vector3, particleRadius: number): boolean {
     return false;
   }
+
+  /**
+   * @internal
+   * Write the prepared collider as a `struct DynamicBoneShape` from word `offset` on, for DynamicBoneSolver.
+   * @returns False for colliders the solver has no shape for, they only collide on the object path
+   */
+  _writeShape(heap32: Float32Array, heapI32: Int32Array, offset: number): boolean {
+    return false;
+  }
 }
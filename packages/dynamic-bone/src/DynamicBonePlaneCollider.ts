@@ -1,5 +1,6 @@
 import { Bound, Direction, DynamicBoneColliderBase } from "./DynamicBoneColliderBase";
 import { CollisionUtil, Plane, Vector3 } from "@galacean/engine";
+import { DynamicBoneShapeType } from "./solver/DynamicBoneSolver";
 
 export class DynamicBonePlaneCollider extends DynamicBoneColliderBase {
   private static tempVec = new Vector3();
@@ -47,4 +48,19 @@ export class DynamicBonePlaneCollider extends DynamicBoneColliderBase {
     }
     return false;
   }
+
+  /**
+   * @internal
+   */
+  override _writeShape(heap32: Float32Array, heapI32: Int32Array, offset: number): boolean {
+    const { normal, distance } = this._plane;
+    // The normal goes in c0 and the distance in radius.
+    heapI32[offset] =
+      this.bound == Bound.Outside ? DynamicBoneShapeType.OutsidePlane : DynamicBoneShapeType.InsidePlane;
+    heap32[offset + 1] = distance;
+    heap32[offset + 4] = normal.x;
+    heap32[offset + 5] = normal.y;
+    heap32[offset + 6] = normal.z;
+    return true;
+  }
 }
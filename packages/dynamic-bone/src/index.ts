@@ -1,3 +1,4 @@
 export { DynamicBone, FreezeAxis, UpdateMode } from "./DynamicBone";
 export { DynamicBonePlaneCollider } from "./DynamicBonePlaneCollider";
 export { DynamicBoneCollider } from "./DynamicBoneCollider";
+export { DynamicBoneSolver } from "./solver/DynamicBoneSolver";
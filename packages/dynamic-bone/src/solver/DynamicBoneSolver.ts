@@ -0,0 +1,407 @@
+import type { Engine } from "@galacean/engine";
+import type { DynamicBone } from "../DynamicBone";
+import { atob as atobPolyfill } from "./atob";
+import wasmString from "./dynamic_bone.wasm";
+import simdWasmString from "./dynamic_bone_simd.wasm";
+
+/**
+ * @internal
+ * Particle fields, same order as `enum DynamicBoneField` in dynamic_bone.h. Field f of slot i is at
+ * `particles[f * capacity + i]`.
+ */
+export enum DynamicBoneField {
+  X,
+  Y,
+  Z,
+  PrevX,
+  PrevY,
+  PrevZ,
+  TransformX,
+  TransformY,
+  TransformZ,
+  LocalX,
+  LocalY,
+  LocalZ,
+  /** World matrix elements 0-2, 4-6 and 8-10 follow in that order. */
+  Matrix,
+  Damping = 21,
+  Elasticity,
+  Stiffness,
+  Inert,
+  Friction,
+  Radius,
+  Count
+}
+
+/**
+ * @internal
+ * Integer fields, same order as `enum DynamicBoneLink` in dynamic_bone.h.
+ */
+export enum DynamicBoneLink {
+  Parent,
+  Flags,
+  Count
+}
+
+/** @internal */
+export enum DynamicBoneFlag {
+  HasTransform = 1,
+  Collide = 2
+}
+
+/**
+ * @internal
+ * `DynamicBoneShape.type`, same values as the `DB_*` shape defines in dynamic_bone.h. The first six are
+ * `DynamicBoneCollider._collideType`.
+ */
+export enum DynamicBoneShapeType {
+  OutsideSphere,
+  InsideSphere,
+  OutsideCapsule,
+  InsideCapsule,
+  OutsideCapsule2,
+  InsideCapsule2,
+  OutsidePlane,
+  InsidePlane
+}
+
+/**
+ * @internal
+ * `struct DynamicBoneTree` and `struct DynamicBoneShape` as 32-bit words.
+ */
+export enum DynamicBoneRecord {
+  TreeSize = 16,
+  ShapeSize = 12
+}
+
+/**
+ * A block of wasm memory owned by the solver, reused across frames and only reallocated to grow.
+ */
+type HeapRegion = {
+  pointer: number;
+  byteLength: number;
+};
+
+/**
+ * A function returning i8x16.popcnt(i8x16.splat(0)), which only validates where wasm SIMD is supported.
+ */
+const simdProbe = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+function simdSupported(): boolean {
+  try {
+    return WebAssembly.validate(simdProbe);
+  } catch (e) {
+    return false;
+  }
+}
+
+/**
+ * Simulates the particles of every `DynamicBone` of an engine with the wasm kernel built from `dynamic_bone.c` by
+ * `compile.sh`, see `get`.
+ * @remarks The particle state lives in flat arrays, one per field, each bone taking a range of slots. Bones write
+ * their transforms and colliders in `onLateUpdate`, and once every enabled bone has done so the particles of all of
+ * them are stepped in one call and the results applied to the transforms.
+ *
+ * The first bone that starts with `DynamicBone.useSolver` on loads the embedded kernel and keeps the object path
+ * until it resolves. Call `load` with a binary before any bone starts to use it instead.
+ */
+export class DynamicBoneSolver {
+  private static _solvers = new Map<Engine, DynamicBoneSolver>();
+
+  /**
+   * The solver of `engine`, created on first use and dropped when the engine shuts down.
+   */
+  static get(engine: Engine): DynamicBoneSolver {
+    let solver = this._solvers.get(engine);
+    if (!solver) {
+      solver = new DynamicBoneSolver(engine);
+      this._solvers.set(engine, solver);
+      engine.once("shutdown", () => this._solvers.delete(engine));
+    }
+    return solver;
+  }
+
+  private _wasmModule;
+  private _wasmMemory: WebAssembly.Memory;
+  private _loadPromise: Promise<void> = null;
+  private _loaded = false;
+
+  private _capacity = 0;
+  private _slotCount = 0;
+  private _particlesRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _linksRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _treesRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _shapesRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _particles: Float32Array;
+  private _links: Int32Array;
+  private _heap32: Float32Array;
+  private _heapI32: Int32Array;
+
+  /** Bones with slots, in slot order. */
+  private _bones: DynamicBone[] = [];
+  private _enabled = new Set<DynamicBone>();
+  private _submitted = new Set<DynamicBone>();
+  private _pending: DynamicBone[] = [];
+  private _frameCount = -1;
+
+  private constructor(private _engine: Engine) {}
+
+  /**
+   * Whether the kernel is instantiated, see `load`.
+   */
+  get loaded(): boolean {
+    return this._loaded;
+  }
+
+  /**
+   * The particles simulated by the solver.
+   */
+  get particleCount(): number {
+    return this._slotCount;
+  }
+
+  /**
+   * Instantiate the kernel, only the first call has an effect.
+   * @param binary The wasm binary, `dynamic_bone.wasm` or `dynamic_bone_simd.wasm` as built by `compile.sh`. If
+   * omitted the embedded `dynamic_bone_simd.wasm` where wasm SIMD validates, else the embedded `dynamic_bone.wasm`
+   */
+  load(binary?: BufferSource): Promise<void> {
+    if (!this._loadPromise) {
+      if (!binary) {
+        const base64 = simdSupported() ? simdWasmString : wasmString;
+        binary = Uint8Array.from(typeof atob === "undefined" ? atobPolyfill(base64) : atob(base64), (c) =>
+          c.charCodeAt(0)
+        );
+      }
+      this._loadPromise = WebAssembly.instantiate(binary, {
+        env: {
+          emscripten_notify_memory_growth: () => {
+            this._updateViews();
+          }
+        }
+      }).then((result) => {
+        this._wasmModule = result.instance.exports;
+        this._wasmMemory = this._wasmModule.memory as WebAssembly.Memory;
+        this._updateViews();
+        this._loaded = true;
+      });
+    }
+    return this._loadPromise;
+  }
+
+  /**
+   * @internal
+   * The particle fields, see `DynamicBoneField`. Valid until the next `add`.
+   */
+  get particles(): Float32Array {
+    return this._particles;
+  }
+
+  /**
+   * @internal
+   * The integer fields, see `DynamicBoneLink`. Valid until the next `add`.
+   */
+  get links(): Int32Array {
+    return this._links;
+  }
+
+  /**
+   * @internal
+   * The slots per field.
+   */
+  get capacity(): number {
+    return this._capacity;
+  }
+
+  /**
+   * @internal
+   * Give `bone` `count` consecutive slots, returns the first. The bone's slots move when an earlier bone is removed,
+   * `bone._solverFirst` is kept up to date.
+   */
+  add(bone: DynamicBone, count: number): number {
+    this._reserveParticles(this._slotCount + count);
+    const first = this._slotCount;
+    this._slotCount += count;
+    this._bones.push(bone);
+    this._enabled.add(bone);
+    return first;
+  }
+
+  /**
+   * @internal
+   * Free the slots of `bone`, the slots after them move down.
+   */
+  remove(bone: DynamicBone): void {
+    const index = this._bones.indexOf(bone);
+    if (index < 0) {
+      return;
+    }
+    const pendingIndex = this._pending.indexOf(bone);
+    pendingIndex >= 0 && this._pending.splice(pendingIndex, 1);
+    this.setEnabled(bone, false);
+    this._bones.splice(index, 1);
+
+    const first = bone._solverFirst;
+    const count = bone._solverCount;
+    const end = this._slotCount;
+    const capacity = this._capacity;
+    const particles = this._particles;
+    const links = this._links;
+    for (let field = 0; field < DynamicBoneField.Count; field++) {
+      const start = field * capacity;
+      particles.copyWithin(start + first, start + first + count, start + end);
+    }
+    for (let field = 0; field < DynamicBoneLink.Count; field++) {
+      const start = field * capacity;
+      links.copyWithin(start + first, start + first + count, start + end);
+    }
+    // Parents of the moved particles moved with them, roots keep -1.
+    for (let i = first, n = end - count; i < n; i++) {
+      links[i] >= 0 && (links[i] -= count);
+    }
+    for (let i = index, n = this._bones.length; i < n; i++) {
+      this._bones[i]._solverFirst -= count;
+    }
+    this._slotCount -= count;
+  }
+
+  /**
+   * @internal
+   * Only enabled bones are waited for before a frame is stepped.
+   */
+  setEnabled(bone: DynamicBone, enabled: boolean): void {
+    if (enabled) {
+      this._enabled.add(bone);
+    } else {
+      this._enabled.delete(bone);
+      this._submitted.delete(bone);
+      this._submitted.size && this._submitted.size >= this._enabled.size && this._flush();
+    }
+  }
+
+  /**
+   * @internal
+   * Called by every enabled bone once a frame, after it wrote its particles. `step` is false for a bone that does
+   * not update this frame. The frame is stepped when the last enabled bone submits, or by the next frame's first
+   * submit if a bone never did.
+   */
+  submit(bone: DynamicBone, step: boolean): void {
+    const frameCount = this._engine.time.frameCount;
+    if (frameCount !== this._frameCount) {
+      this._flush();
+      this._frameCount = frameCount;
+    }
+    step && this._pending.push(bone);
+    this._submitted.add(bone);
+    this._submitted.size >= this._enabled.size && this._flush();
+  }
+
+  private _flush(): void {
+    this._submitted.clear();
+    const bones = this._pending;
+    if (!bones.length) {
+      return;
+    }
+    let treeCount = 0;
+    let shapeCount = 0;
+    for (let i = 0, n = bones.length; i < n; i++) {
+      treeCount += bones[i]._getSolverTreeCount();
+      shapeCount += bones[i]._getSolverShapeCount();
+    }
+    const treesStart = this._reserve(this._treesRegion, treeCount * DynamicBoneRecord.TreeSize * 4);
+    const shapesStart = this._reserve(this._shapesRegion, Math.max(shapeCount, 1) * DynamicBoneRecord.ShapeSize * 4);
+    const heap32 = this._heap32;
+    const heapI32 = this._heapI32;
+    let tree = treesStart >> 2;
+    let shapeFirst = 0;
+    for (let i = 0, n = bones.length; i < n; i++) {
+      const bone = bones[i];
+      const shapeStart = (shapesStart >> 2) + shapeFirst * DynamicBoneRecord.ShapeSize;
+      const count = bone._writeSolverShapes(heap32, heapI32, shapeStart);
+      tree = bone._writeSolverTrees(heap32, heapI32, tree, shapeFirst, count);
+      shapeFirst += count;
+    }
+
+    this._wasmModule.step_dynamic_bones(
+      this._particlesRegion.pointer,
+      this._linksRegion.pointer,
+      this._capacity,
+      treesStart,
+      treeCount,
+      shapesStart
+    );
+    for (let i = 0, n = bones.length; i < n; i++) {
+      bones[i]._applySolverParticles();
+    }
+    bones.length = 0;
+  }
+
+  /**
+   * Grow the particle arrays to hold `slotCount` slots, moving every field to its new start.
+   */
+  private _reserveParticles(slotCount: number): void {
+    const oldCapacity = this._capacity;
+    if (slotCount <= oldCapacity) {
+      return;
+    }
+    // A multiple of 4 slots keeps every field 16 byte aligned for the SIMD loads.
+    const capacity = (Math.max(slotCount, oldCapacity * 2, 64) + 3) & ~3;
+    const wasmModule = this._wasmModule;
+    const particlesPointer = wasmModule.malloc(capacity * DynamicBoneField.Count * 4);
+    const linksPointer = wasmModule.malloc(capacity * DynamicBoneLink.Count * 4);
+    this._updateViews();
+    const heap32 = this._heap32;
+    const heapI32 = this._heapI32;
+    if (oldCapacity) {
+      const oldParticles = this._particlesRegion.pointer >> 2;
+      const oldLinks = this._linksRegion.pointer >> 2;
+      for (let field = 0; field < DynamicBoneField.Count; field++) {
+        const start = oldParticles + field * oldCapacity;
+        heap32.copyWithin((particlesPointer >> 2) + field * capacity, start, start + this._slotCount);
+      }
+      for (let field = 0; field < DynamicBoneLink.Count; field++) {
+        const start = oldLinks + field * oldCapacity;
+        heapI32.copyWithin((linksPointer >> 2) + field * capacity, start, start + this._slotCount);
+      }
+      wasmModule.free(this._particlesRegion.pointer);
+      wasmModule.free(this._linksRegion.pointer);
+    }
+    this._capacity = capacity;
+    this._particlesRegion.pointer = particlesPointer;
+    this._particlesRegion.byteLength = capacity * DynamicBoneField.Count * 4;
+    this._linksRegion.pointer = linksPointer;
+    this._linksRegion.byteLength = capacity * DynamicBoneLink.Count * 4;
+    this._updateViews();
+  }
+
+  /**
+   * Reallocate a region if it is smaller than `byteLength`, returns its pointer.
+   */
+  private _reserve(region: HeapRegion, byteLength: number): number {
+    if (region.byteLength < byteLength) {
+      const wasmModule = this._wasmModule;
+      region.pointer && wasmModule.free(region.pointer);
+      region.byteLength = Math.max(byteLength, region.byteLength * 2);
+      region.pointer = wasmModule.malloc(region.byteLength);
+      this._updateViews();
+    }
+    return region.pointer;
+  }
+
+  private _updateViews(): void {
+    const buffer = this._wasmMemory.buffer;
+    if (!this._heap32 || this._heap32.buffer !== buffer) {
+      this._heap32 = new Float32Array(buffer);
+      this._heapI32 = new Int32Array(buffer);
+    }
+    const { pointer: particlesPointer } = this._particlesRegion;
+    const { pointer: linksPointer } = this._linksRegion;
+    if (particlesPointer) {
+      const capacity = this._capacity;
+      this._particles = new Float32Array(buffer, particlesPointer, capacity * DynamicBoneField.Count);
+      this._links = new Int32Array(buffer, linksPointer, capacity * DynamicBoneLink.Count);
+    }
+  }
+}
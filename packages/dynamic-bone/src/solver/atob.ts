@@ -0,0 +1,62 @@
+const chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=";
+
+function InvalidCharacterError(message) {
+  this.message = message;
+}
+
+InvalidCharacterError.prototype = new Error();
+InvalidCharacterError.prototype.name = "InvalidCharacterError";
+
+export function atob(input: string) {
+  let str = String(input).replace(/=+$/, "");
+  if (str.length % 4 === 1) {
+    throw new InvalidCharacterError("'atob' failed: The string to be decoded is not correctly encoded.");
+  }
+  let output = "";
+  for (
+    // initialize result and counters
+    let bc = 0, bs, buffer, idx = 0;
+    // get next character
+    (buffer = str.charAt(idx++));
+    // character found in table? initialize bit storage and add its ascii value;
+    ~buffer &&
+    ((bs = bc % 4 ? bs * 64 + buffer : buffer),
+    // and if not first of each 4 characters,
+    // convert the first 8 bits to one ascii character
+    bc++ % 4)
+      ? (output += String.fromCharCode(255 & (bs >> ((-2 * bc) & 6))))
+      : 0
+  ) {
+    // try to find character in table (0-63, not found => -1)
+    buffer = chars.indexOf(buffer);
+  }
+  return output;
+}
+
+export function btoa(string: string) {
+  string = String(string);
+  let bitmap,
+    a,
+    b,
+    c,
+    result = "",
+    i = 0,
+    rest = string.length % 3; // To determine the final padding
+
+  for (; i < string.length; ) {
+    if ((a = string.charCodeAt(i++)) > 255 || (b = string.charCodeAt(i++)) > 255 || (c = string.charCodeAt(i++)) > 255)
+      throw new TypeError(
+        "Failed to execute 'btoa' on 'Window': The string to be encoded contains characters outside of the Latin1 range."
+      );
+
+    bitmap = (a << 16) | (b << 8) | c;
+    result +=
+      chars.charAt((bitmap >> 18) & 63) +
+      chars.charAt((bitmap >> 12) & 63) +
+      chars.charAt((bitmap >> 6) & 63) +
+      chars.charAt(bitmap & 63);
+  }
+
+  // If there's need of padding, replace the last 'A's with equal signs
+  return rest ? result.slice(0, rest - 3) + "===".substring(rest) : result;
+}
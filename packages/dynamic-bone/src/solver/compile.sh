@@ -0,0 +1,11 @@
+# Builds dynamic_bone.wasm and dynamic_bone_simd.wasm with tools/wasmcc, see tools/wasmcc/build.sh for what it needs.
+set -e
+cd "$(dirname "$0")"
+wasmcc=../../../../tools/wasmcc/build.sh
+
+exported_funcs="step_dynamic_bones malloc free"
+
+$wasmcc ./dynamic_bone.wasm "$exported_funcs" ./dynamic_bone.c
+
+# Same module with the Verlet integration loop in simd128, for engines that validate SIMD instructions.
+$wasmcc ./dynamic_bone_simd.wasm "$exported_funcs" -msimd128 ./dynamic_bone.c
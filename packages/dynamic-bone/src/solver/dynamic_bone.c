@@ -0,0 +1,391 @@
+#include <math.h>
+#include "dynamic_bone.h"
+
+#ifdef __wasm_simd128__
+#include <wasm_simd128.h>
+#endif
+
+#define DB_ZERO_TOLERANCE 1e-6f
+
+static inline float length3(float x, float y, float z) { return sqrtf(x * x + y * y + z * z); }
+
+static inline float dot3(const float* a, const float* b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+
+static inline float clamp01(float v) { return v < 0 ? 0 : v > 1 ? 1 : v; }
+
+// 把粒子投影到以 center 为球心, 半径 r 的球面上
+static inline void project_sphere(float* p, const float* center, const float* d, float r, float dlen2) {
+    float s = r / sqrtf(dlen2);
+    p[0] = center[0] + d[0] * s;
+    p[1] = center[1] + d[1] * s;
+    p[2] = center[2] + d[2] * s;
+}
+
+static int collide_sphere(float* p, float particle_radius, const struct DynamicBoneShape* shape, int inside) {
+    float r = inside ? shape->radius - particle_radius : shape->radius + particle_radius;
+    float d[3] = {p[0] - shape->c0[0], p[1] - shape->c0[1], p[2] - shape->c0[2]};
+    float dlen2 = dot3(d, d);
+    if (inside ? dlen2 > r * r : dlen2 > 0 && dlen2 < r * r) {
+        project_sphere(p, shape->c0, d, r, dlen2);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Capsules of one radius (radius2 < 0) or of two radii, as DynamicBoneCollider.outsideCapsule / insideCapsule and
+ * their capsule2 versions.
+ */
+static int collide_capsule(float* p, float particle_radius, const struct DynamicBoneShape* shape, int inside,
+                           int two_radii) {
+    float sign = inside ? -1.0f : 1.0f;
+    float dir[3] = {shape->c1[0] - shape->c0[0], shape->c1[1] - shape->c0[1], shape->c1[2] - shape->c0[2]};
+    float d[3] = {p[0] - shape->c0[0], p[1] - shape->c0[1], p[2] - shape->c0[2]};
+    float t = dot3(d, dir);
+
+    if (t <= 0) {
+        // 第一个端点的球
+        float r = shape->radius + sign * particle_radius;
+        float dlen2 = dot3(d, d);
+        if (inside ? dlen2 > r * r : dlen2 > 0 && dlen2 < r * r) {
+            project_sphere(p, shape->c0, d, r, dlen2);
+            return 1;
+        }
+        return 0;
+    }
+    float dirlen = shape->c01_distance;
+    float dirlen2 = dirlen * dirlen;
+    if (t >= dirlen2) {
+        // 第二个端点的球
+        float r = (two_radii ? shape->radius2 : shape->radius) + sign * particle_radius;
+        float d1[3] = {p[0] - shape->c1[0], p[1] - shape->c1[1], p[2] - shape->c1[2]};
+        float dlen2 = dot3(d1, d1);
+        if (inside ? dlen2 > r * r : dlen2 > 0 && dlen2 < r * r) {
+            project_sphere(p, shape->c1, d1, r, dlen2);
+            return 1;
+        }
+        return 0;
+    }
+    // 圆柱部分
+    float s = t / dirlen2;
+    float q[3] = {d[0] - dir[0] * s, d[1] - dir[1] * s, d[2] - dir[2] * s};
+    float qlen2 = dot3(q, q);
+    float r = shape->radius;
+    if (two_radii) {
+        float inv = 1 / dirlen;
+        float axis[3] = {dir[0] * inv, dir[1] * inv, dir[2] * inv};
+        float klen = dot3(d, axis);
+        r += (shape->radius2 - shape->radius) * clamp01(klen / dirlen);
+    }
+    r += sign * particle_radius;
+    if (inside ? qlen2 > r * r : qlen2 > 0 && qlen2 < r * r) {
+        float qlen = sqrtf(qlen2);
+        float k = (r - qlen) / qlen;
+        p[0] += q[0] * k;
+        p[1] += q[1] * k;
+        p[2] += q[2] * k;
+        return 1;
+    }
+    return 0;
+}
+
+static int collide_plane(float* p, const struct DynamicBoneShape* shape, int inside) {
+    float d = dot3(shape->c0, p) + shape->radius;
+    if (inside ? d > 0 : d < 0) {
+        p[0] -= shape->c0[0] * d;
+        p[1] -= shape->c0[1] * d;
+        p[2] -= shape->c0[2] * d;
+        return 1;
+    }
+    return 0;
+}
+
+static int collide(float* p, float particle_radius, const struct DynamicBoneShape* shape) {
+    switch (shape->type) {
+        case DB_OUTSIDE_SPHERE:
+        case DB_INSIDE_SPHERE:
+            return collide_sphere(p, particle_radius, shape, shape->type == DB_INSIDE_SPHERE);
+        case DB_OUTSIDE_CAPSULE:
+        case DB_INSIDE_CAPSULE:
+            return collide_capsule(p, particle_radius, shape, shape->type == DB_INSIDE_CAPSULE, 0);
+        case DB_OUTSIDE_CAPSULE2:
+        case DB_INSIDE_CAPSULE2:
+            return collide_capsule(p, particle_radius, shape, shape->type == DB_INSIDE_CAPSULE2, 1);
+        case DB_OUTSIDE_PLANE:
+        case DB_INSIDE_PLANE:
+            return collide_plane(p, shape, shape->type == DB_INSIDE_PLANE);
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Verlet integration of the particles after the root, the root follows its transform. Every particle reads and
+ * writes only its own slots, so the loop runs over plain arrays and vectorizes.
+ */
+static void integrate(float* particles, int* links, int capacity, const struct DynamicBoneTree* tree, int first_loop) {
+    float* restrict x = particles + DB_X * capacity;
+    float* restrict y = particles + DB_Y * capacity;
+    float* restrict z = particles + DB_Z * capacity;
+    float* restrict px = particles + DB_PREV_X * capacity;
+    float* restrict py = particles + DB_PREV_Y * capacity;
+    float* restrict pz = particles + DB_PREV_Z * capacity;
+    const float* restrict damping = particles + DB_DAMPING * capacity;
+    const float* restrict friction = particles + DB_FRICTION * capacity;
+    const float* restrict inert = particles + DB_INERT * capacity;
+    int* restrict flags = links + DB_FLAGS * capacity;
+
+    int root = tree->first;
+    px[root] = x[root];
+    py[root] = y[root];
+    pz[root] = z[root];
+    x[root] = particles[DB_TRANSFORM_X * capacity + root];
+    y[root] = particles[DB_TRANSFORM_Y * capacity + root];
+    z[root] = particles[DB_TRANSFORM_Z * capacity + root];
+
+    // 只有第一步计入物体的移动
+    float mx = first_loop ? tree->object_move[0] : 0;
+    float my = first_loop ? tree->object_move[1] : 0;
+    float mz = first_loop ? tree->object_move[2] : 0;
+    float fx = tree->force[0];
+    float fy = tree->force[1];
+    float fz = tree->force[2];
+    int i = root + 1;
+    int end = tree->first + tree->count;
+#ifdef __wasm_simd128__
+    // 4 个粒子一组, 每个通道的运算顺序与下面的标量循环相同, 结果逐位一致
+    v128_t mx4 = wasm_f32x4_splat(mx), my4 = wasm_f32x4_splat(my), mz4 = wasm_f32x4_splat(mz);
+    v128_t fx4 = wasm_f32x4_splat(fx), fy4 = wasm_f32x4_splat(fy), fz4 = wasm_f32x4_splat(fz);
+    v128_t one = wasm_f32x4_splat(1);
+    v128_t collide = wasm_i32x4_splat(DB_COLLIDE), zero = wasm_i32x4_splat(0);
+    v128_t keep_flags = wasm_i32x4_splat(~DB_COLLIDE);
+    for (; i + 4 <= end; i += 4) {
+        v128_t inert4 = wasm_v128_load(inert + i);
+        v128_t rx = wasm_f32x4_mul(mx4, inert4);
+        v128_t ry = wasm_f32x4_mul(my4, inert4);
+        v128_t rz = wasm_f32x4_mul(mz4, inert4);
+        v128_t x4 = wasm_v128_load(x + i), y4 = wasm_v128_load(y + i), z4 = wasm_v128_load(z + i);
+        v128_t vx = wasm_f32x4_sub(x4, wasm_v128_load(px + i));
+        v128_t vy = wasm_f32x4_sub(y4, wasm_v128_load(py + i));
+        v128_t vz = wasm_f32x4_sub(z4, wasm_v128_load(pz + i));
+        v128_t flags4 = wasm_v128_load(flags + i);
+        v128_t damping4 = wasm_v128_load(damping + i);
+        v128_t collided = wasm_f32x4_min(wasm_f32x4_add(damping4, wasm_v128_load(friction + i)), one);
+        v128_t no_collide = wasm_i32x4_eq(wasm_v128_and(flags4, collide), zero);
+        v128_t keep = wasm_f32x4_sub(one, wasm_v128_bitselect(damping4, collided, no_collide));
+        wasm_v128_store(flags + i, wasm_v128_and(flags4, keep_flags));
+        wasm_v128_store(px + i, wasm_f32x4_add(x4, rx));
+        wasm_v128_store(py + i, wasm_f32x4_add(y4, ry));
+        wasm_v128_store(pz + i, wasm_f32x4_add(z4, rz));
+        wasm_v128_store(x + i, wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_add(x4, wasm_f32x4_mul(vx, keep)), fx4), rx));
+        wasm_v128_store(y + i, wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_add(y4, wasm_f32x4_mul(vy, keep)), fy4), ry));
+        wasm_v128_store(z + i, wasm_f32x4_add(wasm_f32x4_add(wasm_f32x4_add(z4, wasm_f32x4_mul(vz, keep)), fz4), rz));
+    }
+#endif
+    for (; i < end; i++) {
+        float rx = mx * inert[i];
+        float ry = my * inert[i];
+        float rz = mz * inert[i];
+        float vx = x[i] - px[i];
+        float vy = y[i] - py[i];
+        float vz = z[i] - pz[i];
+        float d = (flags[i] & DB_COLLIDE) ? fminf(damping[i] + friction[i], 1) : damping[i];
+        flags[i] &= ~DB_COLLIDE;
+        px[i] = x[i] + rx;
+        py[i] = y[i] + ry;
+        pz[i] = z[i] + rz;
+        x[i] = x[i] + vx * (1 - d) + fx + rx;
+        y[i] = y[i] + vy * (1 - d) + fy + ry;
+        z[i] = z[i] + vz * (1 - d) + fz + rz;
+    }
+}
+
+/*
+ * Rest position of particle i: its local position in the axes of the parent's transform, placed at the parent
+ * particle. With `translation` set the parent's transform position instead, which the rest length is measured from
+ * for particles past the last transform.
+ */
+static inline void rest_position(const float* particles, int capacity, int i, int parent, const float* origin,
+                                 float* out) {
+    const float* m = particles + DB_MATRIX_0 * capacity + parent;
+    float lx = particles[DB_LOCAL_X * capacity + i];
+    float ly = particles[DB_LOCAL_Y * capacity + i];
+    float lz = particles[DB_LOCAL_Z * capacity + i];
+    // m[k * capacity] 是父节点世界矩阵的第 k 个旋转缩放元素
+    out[0] = lx * m[0] + ly * m[3 * capacity] + lz * m[6 * capacity] + origin[0];
+    out[1] = lx * m[capacity] + ly * m[4 * capacity] + lz * m[7 * capacity] + origin[1];
+    out[2] = lx * m[2 * capacity] + ly * m[5 * capacity] + lz * m[8 * capacity] + origin[2];
+}
+
+static inline float rest_length(const float* particles, const int* links, int capacity, int i, int parent) {
+    const float* transform = particles + DB_TRANSFORM_X * capacity;
+    float parent_transform[3] = {transform[parent], transform[capacity + parent], transform[2 * capacity + parent]};
+    if (links[DB_FLAGS * capacity + i] & DB_HAS_TRANSFORM) {
+        return length3(parent_transform[0] - transform[i], parent_transform[1] - transform[capacity + i],
+                       parent_transform[2] - transform[2 * capacity + i]);
+    }
+    float offset[3];
+    rest_position(particles, capacity, i, parent, parent_transform, offset);
+    return length3(offset[0], offset[1], offset[2]);
+}
+
+// 沿父节点方向把粒子拉回静止长度
+static inline void keep_length(float* p, const float* p0, float rest_len) {
+    float dd[3] = {p0[0] - p[0], p0[1] - p[1], p0[2] - p[2]};
+    float len = length3(dd[0], dd[1], dd[2]);
+    if (len > 0) {
+        float k = (len - rest_len) / len;
+        p[0] += dd[0] * k;
+        p[1] += dd[1] * k;
+        p[2] += dd[2] * k;
+    }
+}
+
+/*
+ * Constraints of the particles after the root, in tree order: a child reads its parent's position of this step.
+ */
+static void constrain(float* particles, int* links, int capacity, const struct DynamicBoneTree* tree,
+                      const struct DynamicBoneShape* shapes) {
+    float* x = particles + DB_X * capacity;
+    float* y = particles + DB_Y * capacity;
+    float* z = particles + DB_Z * capacity;
+    const int* parents = links + DB_PARENT * capacity;
+    int* flags = links + DB_FLAGS * capacity;
+    float weight = clamp01(tree->weight);
+
+    for (int i = tree->first + 1, end = tree->first + tree->count; i < end; i++) {
+        int parent = parents[i];
+        float p0[3] = {x[parent], y[parent], z[parent]};
+        float p[3] = {x[i], y[i], z[i]};
+        float rest_len = rest_length(particles, links, capacity, i, parent);
+
+        // 保持形状
+        float elasticity = particles[DB_ELASTICITY * capacity + i];
+        float stiffness = 1 + (particles[DB_STIFFNESS * capacity + i] - 1) * weight;
+        if (stiffness > 0 || elasticity > 0) {
+            float rest[3];
+            rest_position(particles, capacity, i, parent, p0, rest);
+            float k = elasticity * tree->time_var;
+            p[0] += (rest[0] - p[0]) * k;
+            p[1] += (rest[1] - p[1]) * k;
+            p[2] += (rest[2] - p[2]) * k;
+            if (stiffness > 0) {
+                float d[3] = {rest[0] - p[0], rest[1] - p[1], rest[2] - p[2]};
+                float len = length3(d[0], d[1], d[2]);
+                float max_len = rest_len * (1 - stiffness) * 2;
+                if (len > max_len) {
+                    float s = (len - max_len) / len;
+                    p[0] += d[0] * s;
+                    p[1] += d[1] * s;
+                    p[2] += d[2] * s;
+                }
+            }
+        }
+
+        // 碰撞, 和 JS 路径一样碰到第一个碰撞体后不再检查后面的
+        if (tree->shape_count) {
+            float radius = particles[DB_RADIUS * capacity + i] * tree->object_scale;
+            int hit = flags[i] & DB_COLLIDE;
+            for (int j = 0; j < tree->shape_count && !hit; j++) {
+                hit = collide(p, radius, shapes + tree->shape_first + j);
+            }
+            if (hit) {
+                flags[i] |= DB_COLLIDE;
+            }
+        }
+
+        // 冻结轴: 投影到过父节点, 法线为父节点该轴的平面
+        if (tree->freeze_axis) {
+            const float* axis = particles + (DB_MATRIX_0 + (tree->freeze_axis - 1) * 3) * capacity + parent;
+            float n[3] = {axis[0], axis[capacity], axis[2 * capacity]};
+            float len = length3(n[0], n[1], n[2]);
+            if (len > DB_ZERO_TOLERANCE) {
+                float inv = 1 / len;
+                n[0] *= inv;
+                n[1] *= inv;
+                n[2] *= inv;
+            }
+            float distance = dot3(n, p) - dot3(n, p0);
+            p[0] -= n[0] * distance;
+            p[1] -= n[1] * distance;
+            p[2] -= n[2] * distance;
+        }
+
+        keep_length(p, p0, rest_len);
+        x[i] = p[0];
+        y[i] = p[1];
+        z[i] = p[2];
+    }
+}
+
+/*
+ * A frame without a simulation step: the particles follow the object and only stiffness and length are kept, as
+ * DynamicBone._skipUpdateParticles.
+ */
+static void follow(float* particles, int* links, int capacity, const struct DynamicBoneTree* tree) {
+    float* x = particles + DB_X * capacity;
+    float* y = particles + DB_Y * capacity;
+    float* z = particles + DB_Z * capacity;
+    float* px = particles + DB_PREV_X * capacity;
+    float* py = particles + DB_PREV_Y * capacity;
+    float* pz = particles + DB_PREV_Z * capacity;
+    const int* parents = links + DB_PARENT * capacity;
+    const float* move = tree->object_move;
+    float weight = clamp01(tree->weight);
+
+    int root = tree->first;
+    px[root] = x[root];
+    py[root] = y[root];
+    pz[root] = z[root];
+    x[root] = particles[DB_TRANSFORM_X * capacity + root];
+    y[root] = particles[DB_TRANSFORM_Y * capacity + root];
+    z[root] = particles[DB_TRANSFORM_Z * capacity + root];
+
+    for (int i = root + 1, end = tree->first + tree->count; i < end; i++) {
+        int parent = parents[i];
+        float p0[3] = {x[parent], y[parent], z[parent]};
+        float p[3] = {x[i] + move[0], y[i] + move[1], z[i] + move[2]};
+        px[i] += move[0];
+        py[i] += move[1];
+        pz[i] += move[2];
+        float rest_len = rest_length(particles, links, capacity, i, parent);
+
+        float stiffness = 1 + (particles[DB_STIFFNESS * capacity + i] - 1) * weight;
+        if (stiffness > 0) {
+            float rest[3];
+            rest_position(particles, capacity, i, parent, p0, rest);
+            float d[3] = {rest[0] - p[0], rest[1] - p[1], rest[2] - p[2]};
+            float len = length3(d[0], d[1], d[2]);
+            float max_len = rest_len * (1 - stiffness) * 2;
+            if (len > max_len) {
+                float s = (len - max_len) / len;
+                p[0] += d[0] * s;
+                p[1] += d[1] * s;
+                p[2] += d[2] * s;
+            }
+        }
+
+        keep_length(p, p0, rest_len);
+        x[i] = p[0];
+        y[i] = p[1];
+        z[i] = p[2];
+    }
+}
+
+void step_dynamic_bones(float* particles, int* links, int capacity, const struct DynamicBoneTree* trees,
+                        int tree_count, const struct DynamicBoneShape* shapes) {
+    for (int t = 0; t < tree_count; t++) {
+        const struct DynamicBoneTree* tree = trees + t;
+        if (tree->count <= 0) {
+            continue;
+        }
+        if (tree->loop <= 0) {
+            follow(particles, links, capacity, tree);
+            continue;
+        }
+        for (int i = 0; i < tree->loop; i++) {
+            integrate(particles, links, capacity, tree, i == 0);
+            constrain(particles, links, capacity, tree, shapes);
+        }
+    }
+}
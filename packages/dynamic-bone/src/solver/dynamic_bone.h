@@ -0,0 +1,111 @@
+#ifndef DYNAMIC_BONE_H
+#define DYNAMIC_BONE_H
+
+/*
+ * Structure-of-arrays state of every particle simulated by DynamicBoneSolver. Each field is an array of `capacity`
+ * floats starting at `particles + field * capacity`, so a pass over one field of many particles reads contiguous
+ * memory. A particle tree takes consecutive slots in the order DynamicBone appends them, its root first and every
+ * parent before its children.
+ */
+enum DynamicBoneField {
+    DB_X,
+    DB_Y,
+    DB_Z,
+    DB_PREV_X,
+    DB_PREV_Y,
+    DB_PREV_Z,
+    /* The world position of the particle's transform, written every frame. */
+    DB_TRANSFORM_X,
+    DB_TRANSFORM_Y,
+    DB_TRANSFORM_Z,
+    /* The local position of the transform, or the end offset of a particle generated past the last transform. */
+    DB_LOCAL_X,
+    DB_LOCAL_Y,
+    DB_LOCAL_Z,
+    /* Elements 0-2, 4-6 and 8-10 of the world matrix of the transform, the axes of its children's rest pose. */
+    DB_MATRIX_0,
+    DB_MATRIX_1,
+    DB_MATRIX_2,
+    DB_MATRIX_4,
+    DB_MATRIX_5,
+    DB_MATRIX_6,
+    DB_MATRIX_8,
+    DB_MATRIX_9,
+    DB_MATRIX_10,
+    DB_DAMPING,
+    DB_ELASTICITY,
+    DB_STIFFNESS,
+    DB_INERT,
+    DB_FRICTION,
+    DB_RADIUS,
+    DB_FIELD_COUNT
+};
+
+/* Integer state, each an array of `capacity` ints starting at `links + field * capacity`. */
+enum DynamicBoneLink {
+    /* The slot of the parent particle, -1 for the root of a tree. */
+    DB_PARENT,
+    DB_FLAGS,
+    DB_LINK_COUNT
+};
+
+/* Flags. */
+#define DB_HAS_TRANSFORM 1
+/* The particle hit a collider in the last step, its next step adds the friction to the damping. */
+#define DB_COLLIDE 2
+
+/* DynamicBoneShapeType in DynamicBoneSolver.ts: DynamicBoneCollider._collideType, then the two plane bounds. */
+#define DB_OUTSIDE_SPHERE 0
+#define DB_INSIDE_SPHERE 1
+#define DB_OUTSIDE_CAPSULE 2
+#define DB_INSIDE_CAPSULE 3
+#define DB_OUTSIDE_CAPSULE2 4
+#define DB_INSIDE_CAPSULE2 5
+#define DB_OUTSIDE_PLANE 6
+#define DB_INSIDE_PLANE 7
+
+/*
+ * A collider after prepare(), in world space. Spheres use c0 and radius, capsules c0, c1, radius, radius2 and the
+ * c01 distance as DynamicBoneCollider computes it. Planes keep their normal in c0 and their distance in radius.
+ */
+struct DynamicBoneShape {
+    int type;
+    float radius;
+    float radius2;
+    float c01_distance;
+    float c0[3];
+    float c1[3];
+    float padding[2];
+};
+
+/*
+ * One particle tree of a DynamicBone for one frame. `loop` is the number of simulation steps, 0 keeps the tree's
+ * shape while following the object without simulating. `force` is the gravity and force of the tree already scaled
+ * by the object scale and time_var.
+ */
+struct DynamicBoneTree {
+    int first;
+    int count;
+    int loop;
+    /* FreezeAxis, 0 for none. */
+    int freeze_axis;
+    /* The colliders of the tree, a range of the shapes passed to step_dynamic_bones. */
+    int shape_first;
+    int shape_count;
+    float time_var;
+    /* The blend weight, stiffness is lerped from 1 towards the particle's by it. */
+    float weight;
+    float object_scale;
+    float force[3];
+    float object_move[3];
+    float padding;
+};
+
+/*
+ * Step every tree of the frame: Verlet integration, then the elasticity, stiffness, collider, freeze axis and
+ * length constraints, `loop` times per tree, as DynamicBone._updateParticles does for one bone.
+ */
+void step_dynamic_bones(float* particles, int* links, int capacity, const struct DynamicBoneTree* trees,
+                        int tree_count, const struct DynamicBoneShape* shapes);
+
+#endif
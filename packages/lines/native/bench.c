@@ -0,0 +1,170 @@
+/**
+ * Throughput benchmark for the line tessellator.
+ *
+ * Usage: bench [-m max_points] [-k solid|dash|scalar|generic|dgeneric] [-s shape] [-t min_seconds] [-j threads]
+ *              [-p list|strip]
+ *
+ * Point counts go from 10 up to `max_points` (default 1e6, use 1e7 for the full
+ * sweep) in powers of ten, for every join/cap combination. `scalar` is the solid
+ * builder without the SIMD kernel, for comparison; it runs the kernel specialized for
+ * the join and cap, `generic` and `dgeneric` run the unspecialized solid and dash
+ * kernels to measure what the specialization gains. With `-j` solid and dash lines
+ * are built by build_*_line_parallel on that many threads. With `-p strip` every
+ * build is followed by convert_to_strip and the output counts the strip indices.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/line/vertexBuilder/line.h"
+#include "polyline.h"
+
+struct Options {
+    int max_points;
+    int kind; // -1: all, 0: solid, 1: dash, 2: scalar solid, 3: generic solid, 4: generic dash
+    int shape; // -1: all
+    double min_seconds;
+    int threads; // 0: single-threaded builders
+    int strip; // 1: convert the indices to a triangle strip after every build
+};
+
+static const char *KIND_NAMES[] = {"solid", "dash", "scalar", "generic", "dgeneric"};
+#define KIND_COUNT 5
+
+static void bench_case(const struct Options *options, int kind, enum Shape shape, int point_count, int join,
+                       int cap, const float *points, struct Vertex *vertices, unsigned short *indices,
+                       unsigned short *strip) {
+    int dash = kind == 1 || kind == 4;
+    int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                              : get_solid_vertex_count(point_count, join, cap);
+    int index_count = vertex_count * 3 - 6;
+    int output_count = index_count;
+
+    int iterations = 0;
+    double best = 1e30;
+    double start = now_seconds();
+    double elapsed = 0;
+    do {
+        double t0 = now_seconds();
+        if (dash && options->threads) {
+            build_dash_line_parallel((float *)points, point_count, join, cap, 0, -1, vertices, indices, INDEX_UINT16,
+                                     options->threads);
+        } else if (kind == 4) {
+            build_dash_line_range_generic((float *)points, point_count, 0, point_count - 1, join, cap, 0, -1, vertices,
+                                          indices, INDEX_UINT16);
+        } else if (dash) {
+            build_dash_line((float *)points, point_count, join, cap, 0, -1, vertices, indices);
+        } else if (kind == 3) {
+            build_solid_line_range_generic((float *)points, point_count, 0, point_count - 1, join, cap, -1, vertices,
+                                           indices, INDEX_UINT16);
+        } else if (kind == 2) {
+            build_solid_line_range_scalar((float *)points, point_count, 0, point_count - 1, join, cap, -1, vertices,
+                                          indices, INDEX_UINT16);
+        } else if (options->threads) {
+            build_solid_line_parallel((float *)points, point_count, join, cap, -1, vertices, indices, INDEX_UINT16,
+                                      options->threads);
+        } else {
+            build_solid_line((float *)points, point_count, join, cap, -1, vertices, indices);
+        }
+        if (options->strip) {
+            output_count = convert_to_strip(indices, index_count, INDEX_UINT16, strip);
+        }
+        double t = now_seconds() - t0;
+        if (t < best) {
+            best = t;
+        }
+        iterations++;
+        elapsed = now_seconds() - start;
+    } while (elapsed < options->min_seconds);
+    double bytes = (double)vertex_count * sizeof(struct Vertex) + (double)output_count * sizeof(unsigned short);
+
+    printf("%-8s %-8s %9d %-5s %-6s %6d %11.4f %10.2f %10.2f %10.2f\n", KIND_NAMES[kind], SHAPE_NAMES[shape],
+           point_count, JOIN_NAMES[join], CAP_NAMES[cap], iterations, best * 1e3, point_count / best * 1e-6,
+           vertex_count / best * 1e-6, bytes / (1024.0 * 1024.0));
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-m max_points] [-k solid|dash|scalar|generic|dgeneric] [-s straight|zigzag|hairpin|random] "
+            "[-t min_seconds] [-j threads] [-p list|strip]\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    struct Options options = {1000000, -1, -1, 0.2, 0, 0};
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "-m") == 0) {
+            options.max_points = (int)strtod(value, NULL);
+        } else if (strcmp(argv[i - 1], "-k") == 0) {
+            options.kind = 0;
+            for (int k = 0; k < KIND_COUNT; k++) {
+                if (strcmp(value, KIND_NAMES[k]) == 0) {
+                    options.kind = k;
+                }
+            }
+        } else if (strcmp(argv[i - 1], "-s") == 0) {
+            for (int s = 0; s < SHAPE_COUNT; s++) {
+                if (strcmp(value, SHAPE_NAMES[s]) == 0) {
+                    options.shape = s;
+                }
+            }
+        } else if (strcmp(argv[i - 1], "-t") == 0) {
+            options.min_seconds = strtod(value, NULL);
+        } else if (strcmp(argv[i - 1], "-j") == 0) {
+            options.threads = atoi(value);
+        } else if (strcmp(argv[i - 1], "-p") == 0) {
+            options.strip = strcmp(value, "strip") == 0;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    // Worst case is the dash builder, at 7 vertices per point with bevel joins or more with round ones.
+    int bevel_count = get_dash_vertex_count(options.max_points, 2, 2);
+    int round_count = get_dash_vertex_count(options.max_points, 1, 0);
+    size_t max_vertices = (size_t)(bevel_count > round_count ? bevel_count : round_count);
+    float *points = malloc((size_t)options.max_points * 2 * sizeof(float));
+    struct Vertex *vertices = malloc(max_vertices * sizeof(struct Vertex));
+    unsigned short *indices = malloc(max_vertices * 3 * sizeof(unsigned short));
+    unsigned short *strip = options.strip ? malloc((size_t)get_strip_index_capacity((int)max_vertices * 3) *
+                                                   sizeof(unsigned short))
+                                          : NULL;
+    if (!points || !vertices || !indices || (options.strip && !strip)) {
+        fprintf(stderr, "out of memory for %d points\n", options.max_points);
+        return 1;
+    }
+
+    printf("%-8s %-8s %9s %-5s %-6s %6s %11s %10s %10s %10s\n", "kind", "shape", "points", "join", "cap", "iters",
+           "best ms", "Mpoints/s", "Mverts/s", "MB out");
+    for (int kind = 0; kind < KIND_COUNT; kind++) {
+        if (options.kind != -1 && options.kind != kind) {
+            continue;
+        }
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            if (options.shape != -1 && options.shape != shape) {
+                continue;
+            }
+            for (int point_count = 10; point_count <= options.max_points; point_count *= 10) {
+                generate_polyline(shape, point_count, points);
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        bench_case(&options, kind, shape, point_count, join, cap, points, vertices, indices,
+                                   strip);
+                    }
+                }
+            }
+        }
+    }
+
+    free(points);
+    free(vertices);
+    free(indices);
+    free(strip);
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Checks the committed wasm binaries against compile.sh: every exported function is there, the imports are the ones
+// LineVertexBuilder provides and a build runs. Run by `make test`, rerun after compile.sh.
+const fs = require("fs");
+const path = require("path");
+
+const dir = path.join(__dirname, "../src/line/vertexBuilder");
+const compile = fs.readFileSync(path.join(dir, "compile.sh"), "utf8");
+const exported = compile.match(/exported_funcs="(.*)"/)[1].split(/\s+/);
+// The env functions of the loader in index.ts.
+const env = ["consoleLog", "segfault", "alignfault", "emscripten_notify_memory_growth", "emscripten_get_now"];
+
+let failed = 0;
+const outputs = [];
+for (const file of ["line.wasm", "line_simd.wasm"]) {
+  const module = new WebAssembly.Module(fs.readFileSync(path.join(dir, file)));
+  const exports = WebAssembly.Module.exports(module).map((e) => e.name);
+  const missing = exported.filter((name) => exports.indexOf(name) < 0);
+  if (exports.indexOf("memory") < 0) {
+    missing.push("memory");
+  }
+  if (missing.length) {
+    console.error(`${file}: missing exports ${missing.join(", ")}`);
+    failed++;
+    continue;
+  }
+  const imports = WebAssembly.Module.imports(module).filter((i) => i.module !== "env" || env.indexOf(i.name) < 0);
+  if (imports.length) {
+    console.error(`${file}: unresolved imports ${imports.map((i) => `${i.module}.${i.name}`).join(", ")}`);
+    failed++;
+    continue;
+  }
+
+  const noop = () => {};
+  const instance = new WebAssembly.Instance(module, {
+    env: {
+      consoleLog: noop,
+      segfault: noop,
+      alignfault: noop,
+      emscripten_notify_memory_growth: noop,
+      emscripten_get_now: () => performance.now()
+    }
+  });
+  const wasm = instance.exports;
+  // A round zigzag built the way Line does: round segments set first, indices from 0, malloc'd buffers.
+  wasm.set_round_segments(8);
+  const pointCount = 64;
+  const points = wasm.malloc(pointCount * 8);
+  const vertexCount = wasm.get_solid_range_vertex_count(pointCount, 0, pointCount - 1, 1, 1);
+  const vertices = wasm.malloc(vertexCount * 24);
+  const indices = wasm.malloc(vertexCount * 12);
+  const heap = new Float32Array(wasm.memory.buffer, points, pointCount * 2);
+  for (let i = 0; i < pointCount; i++) {
+    heap[i * 2] = i * 10;
+    heap[i * 2 + 1] = i & 1 ? 5 : -5;
+  }
+  wasm.set_line_profiling(1);
+  wasm.build_solid_line_range(points, pointCount, 0, pointCount - 1, 1, 1, -1, vertices, indices, 2);
+  wasm.set_line_profiling(0);
+  const counters = new Float64Array(wasm.memory.buffer, wasm.get_line_counters(), 5);
+  if (counters[0] !== 1 || counters[1] !== pointCount || counters[2] !== vertexCount || !(counters[4] >= 0)) {
+    console.error(`${file}: the profiled build counted ${Array.from(counters).join(", ")}`);
+    failed++;
+    continue;
+  }
+  if (wasm.malloc_heap_bytes() < vertexCount * 36) {
+    console.error(`${file}: malloc_heap_bytes is below what was allocated`);
+    failed++;
+    continue;
+  }
+  const triangles = new Uint32Array(wasm.memory.buffer, indices, vertexCount * 3 - 6);
+  if (vertexCount <= 0 || triangles.some((index) => index >= vertexCount)) {
+    console.error(`${file}: build_solid_line_range wrote indices out of range`);
+    failed++;
+    continue;
+  }
+  outputs.push(new Float32Array(wasm.memory.buffer, vertices, vertexCount * 6).slice());
+  wasm.free(indices);
+  wasm.free(vertices);
+  wasm.free(points);
+}
+if (outputs.length === 2 && outputs[0].some((value, i) => !Object.is(value, outputs[1][i]))) {
+  console.error("line_simd.wasm builds differ from line.wasm");
+  failed++;
+}
+console.log(`wasm binaries: ${failed} failed`);
+process.exit(failed ? 1 : 0);
@@ -0,0 +1,128 @@
+#include "line_geometry.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/line/vertexBuilder/line.h"
+
+_Static_assert(sizeof(struct LineGeometryHeader) == LINE_GEOMETRY_HEADER_SIZE, "header layout");
+_Static_assert(sizeof(struct LineGeometryChunk) == LINE_GEOMETRY_CHUNK_SIZE, "chunk layout");
+_Static_assert(sizeof(struct Vertex) == 24, "vertex layout");
+
+#define MAX_UINT16_VERTEX_COUNT 65536
+
+struct ChunkRange {
+    int line;
+    int first;
+    int last;
+};
+
+static int range_vertex_count(const struct LineGeometryOptions* options, int point_count, int first, int last) {
+    return options->dash ? get_dash_range_vertex_count(point_count, first, last, options->join, options->cap)
+                         : get_solid_range_vertex_count(point_count, first, last, options->join, options->cap);
+}
+
+// 把每条线切成块: 最多 chunk_segments 段, 16 位索引时再对半切到顶点数不超过 65536
+static int split_chunks(const int* point_offsets, int line_count, const struct LineGeometryOptions* options,
+                        struct ChunkRange** out) {
+    int capacity = 16;
+    int count = 0;
+    struct ChunkRange* ranges = malloc(capacity * sizeof(struct ChunkRange));
+    for (int line = 0; line < line_count; line++) {
+        int point_count = point_offsets[line + 1] - point_offsets[line];
+        int segment_count = point_count - 1;
+        for (int first = 0; first < segment_count;) {
+            int last = segment_count;
+            if (options->chunk_segments > 0 && first + options->chunk_segments < last) {
+                last = first + options->chunk_segments;
+            }
+            while (options->index_format == INDEX_UINT16 && last - first > 1 &&
+                   range_vertex_count(options, point_count, first, last) > MAX_UINT16_VERTEX_COUNT) {
+                last = first + (last - first) / 2;
+            }
+            if (count == capacity) {
+                capacity *= 2;
+                ranges = realloc(ranges, capacity * sizeof(struct ChunkRange));
+            }
+            ranges[count].line = line;
+            ranges[count].first = first;
+            ranges[count].last = last;
+            count++;
+            first = last;
+        }
+    }
+    *out = ranges;
+    return count;
+}
+
+static int write_padded(FILE* file, const void* data, size_t size) {
+    static const char zeros[4] = {0};
+    size_t padding = (4 - size % 4) % 4;
+    return fwrite(data, 1, size, file) == size && fwrite(zeros, 1, padding, file) == padding;
+}
+
+int write_line_geometry(FILE* file, const float* points, const int* point_offsets, int line_count,
+                        const struct LineGeometryOptions* options) {
+    set_round_segments(options->round_segments);
+    struct ChunkRange* ranges;
+    int chunk_count = split_chunks(point_offsets, line_count, options, &ranges);
+    struct LineGeometryChunk* chunks = calloc(chunk_count ? chunk_count : 1, sizeof(struct LineGeometryChunk));
+
+    struct LineGeometryHeader header;
+    memcpy(header.magic, LINE_GEOMETRY_MAGIC, 4);
+    header.version = LINE_GEOMETRY_VERSION;
+    header.flags = options->dash ? LINE_GEOMETRY_DASH : 0;
+    header.join = options->join;
+    header.cap = options->cap;
+    header.round_segments = get_round_segments();
+    header.index_format = options->index_format;
+    header.chunk_count = chunk_count;
+
+    // 先写表头和占位的块表, 写完数据后回来填块表
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(chunks, sizeof(struct LineGeometryChunk), chunk_count, file) == (size_t)chunk_count;
+    unsigned int offset = LINE_GEOMETRY_HEADER_SIZE + chunk_count * LINE_GEOMETRY_CHUNK_SIZE;
+    int index_size = options->index_format == INDEX_UINT32 ? 4 : 2;
+    float lengthsofar = 0;
+    for (int i = 0; i < chunk_count && ok; i++) {
+        const struct ChunkRange* range = &ranges[i];
+        const float* line_points = points + point_offsets[range->line] * 2;
+        int point_count = point_offsets[range->line + 1] - point_offsets[range->line];
+        int vertex_count = range_vertex_count(options, point_count, range->first, range->last);
+        int index_count = vertex_count * 3 - 6;
+        struct Vertex* vertices = malloc(vertex_count * sizeof(struct Vertex));
+        void* indices = malloc((size_t)index_count * index_size);
+        if (range->first == 0) {
+            lengthsofar = 0;
+        }
+        if (options->dash) {
+            lengthsofar = build_dash_line_range((float*)line_points, point_count, range->first, range->last,
+                                                options->join, options->cap, lengthsofar, -1, vertices, indices,
+                                                options->index_format);
+        } else {
+            build_solid_line_range((float*)line_points, point_count, range->first, range->last, options->join,
+                                   options->cap, -1, vertices, indices, options->index_format);
+        }
+
+        struct LineGeometryChunk* chunk = &chunks[i];
+        size_t vertex_bytes = vertex_count * sizeof(struct Vertex);
+        size_t index_bytes = (size_t)index_count * index_size;
+        chunk->vertex_offset = offset;
+        chunk->vertex_count = vertex_count;
+        chunk->index_offset = offset + vertex_bytes;
+        chunk->index_count = index_count;
+        get_vertex_bounds(vertices, vertex_count, chunk->bounds);
+        chunk->lengthsofar = options->dash ? lengthsofar : 0;
+        chunk->line = range->line;
+        ok = write_padded(file, vertices, vertex_bytes) && write_padded(file, indices, index_bytes);
+        offset += vertex_bytes + (index_bytes + 3) / 4 * 4;
+        free(vertices);
+        free(indices);
+    }
+    ok = ok && fseek(file, LINE_GEOMETRY_HEADER_SIZE, SEEK_SET) == 0 &&
+         fwrite(chunks, sizeof(struct LineGeometryChunk), chunk_count, file) == (size_t)chunk_count &&
+         fseek(file, 0, SEEK_END) == 0;
+    free(ranges);
+    free(chunks);
+    return ok ? chunk_count : -1;
+}
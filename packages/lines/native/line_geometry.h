@@ -0,0 +1,65 @@
+#ifndef LINE_GEOMETRY_H
+#define LINE_GEOMETRY_H
+
+#include <stdio.h>
+
+/*
+ * Pre-tessellated line geometry (.lgeo), written offline by `tessellate` and uploaded by Line.loadGeometry without
+ * tessellating. Little endian: a header, the chunk table, then the vertices and indices of every chunk, each
+ * starting on a 4 byte boundary so they can be viewed as typed arrays in place. The header and table come first so
+ * a loader can read them with one byte range request and then fetch the chunks it sees first.
+ * Vertices are struct Vertex, indices restart at 0 in every chunk. Bump LINE_GEOMETRY_VERSION on any layout change.
+ */
+#define LINE_GEOMETRY_MAGIC "LGEO"
+#define LINE_GEOMETRY_VERSION 1
+#define LINE_GEOMETRY_HEADER_SIZE 32
+#define LINE_GEOMETRY_CHUNK_SIZE 48
+
+/* Header flags. */
+#define LINE_GEOMETRY_DASH 1
+
+struct LineGeometryHeader {
+    char magic[4];
+    unsigned int version;
+    unsigned int flags;
+    int join;
+    int cap;
+    int round_segments;
+    /* INDEX_UINT16 or INDEX_UINT32. */
+    int index_format;
+    unsigned int chunk_count;
+};
+
+struct LineGeometryChunk {
+    /* Byte offsets from the start of the file. */
+    unsigned int vertex_offset;
+    unsigned int vertex_count;
+    unsigned int index_offset;
+    unsigned int index_count;
+    /* get_vertex_bounds of the vertices. */
+    float bounds[6];
+    /* The dash length at the end of the chunk, 0 for solid lines. */
+    float lengthsofar;
+    /* The polyline of the input the chunk is a part of. */
+    unsigned int line;
+};
+
+struct LineGeometryOptions {
+    int dash;
+    int join;
+    int cap;
+    int round_segments;
+    int index_format;
+    /* The max segments in a chunk, chunks are also split to stay under 65536 vertices with 16-bit indices. */
+    int chunk_segments;
+};
+
+/**
+ * Tessellate `line_count` polylines and write them as line geometry. Line i uses points [point_offsets[i],
+ * point_offsets[i + 1]) of `points`, lines with fewer than 2 points are skipped. `file` has to be seekable, the
+ * chunk table is written after the chunks. Returns the chunk count, -1 on a write error.
+ */
+int write_line_geometry(FILE* file, const float* points, const int* point_offsets, int line_count,
+                        const struct LineGeometryOptions* options);
+
+#endif
@@ -0,0 +1,66 @@
+#include "polyline.h"
+
+#include <time.h>
+
+const char *SHAPE_NAMES[SHAPE_COUNT] = {"straight", "zigzag", "hairpin", "random"};
+const char *JOIN_NAMES[3] = {"miter", "round", "bevel"};
+const char *CAP_NAMES[3] = {"round", "butt", "square"};
+
+static uint32_t lcg(uint32_t *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+void generate_polyline(enum Shape shape, int point_count, float *out) {
+    uint32_t seed = 0x2545f491u;
+    float x = 0, y = 0;
+    for (int i = 0; i < point_count; i++) {
+        switch (shape) {
+            case SHAPE_STRAIGHT:
+                x = (float)i;
+                y = 0;
+                break;
+            case SHAPE_ZIGZAG:
+                x = (float)i;
+                y = (i & 1) ? 1.0f : -1.0f;
+                break;
+            case SHAPE_HAIRPIN:
+                // Doubles back on itself with a tiny lateral drift, so consecutive
+                // segments are nearly anti-parallel and miters hit the clamp.
+                x = (i & 1) ? 10.0f : 0.0f;
+                y = (float)i * 1e-3f;
+                break;
+            case SHAPE_RANDOM:
+            default:
+                x += (float)(lcg(&seed) % 2001) / 1000.0f - 1.0f;
+                y += (float)(lcg(&seed) % 2001) / 1000.0f - 1.0f;
+                break;
+        }
+        out[i * 2] = x;
+        out[i * 2 + 1] = y;
+    }
+}
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_indices(uint64_t hash, const unsigned short *indices, int count) {
+    for (int i = 0; i < count; i++) {
+        uint32_t value = indices[i];
+        unsigned char bytes[4] = {value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24};
+        hash = fnv1a(hash, bytes, 4);
+    }
+    return hash;
+}
+
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
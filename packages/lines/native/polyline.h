@@ -0,0 +1,39 @@
+#ifndef POLYLINE_H
+#define POLYLINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum Shape {
+    SHAPE_STRAIGHT = 0,
+    SHAPE_ZIGZAG = 1,
+    SHAPE_HAIRPIN = 2,
+    SHAPE_RANDOM = 3,
+    SHAPE_COUNT = 4
+};
+
+extern const char *SHAPE_NAMES[SHAPE_COUNT];
+extern const char *JOIN_NAMES[3];
+extern const char *CAP_NAMES[3];
+
+/**
+ * Fill `out` with `point_count` interleaved x/y pairs of the given synthetic shape.
+ * The output only depends on the arguments, so it can be used for golden comparisons.
+ */
+void generate_polyline(enum Shape shape, int point_count, float *out);
+
+/**
+ * 64-bit FNV-1a over a byte range, chained through `hash`.
+ */
+uint64_t fnv1a(uint64_t hash, const void *data, size_t size);
+
+/**
+ * Hash index values widened to 32 bits, so the digest does not depend on the index format.
+ */
+uint64_t hash_indices(uint64_t hash, const unsigned short *indices, int count);
+
+double now_seconds(void);
+
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+
+#endif
@@ -0,0 +1,199 @@
+/**
+ * Tessellate a static line layer offline into line geometry (.lgeo) for Line.loadGeometry.
+ *
+ * Usage: tessellate [-d] [-j miter|round|bevel] [-c round|butt|square] [-r round_segments] [-s chunk_segments]
+ *                   [-i 16|32] input output
+ *
+ * The input holds the polylines as numbers, read as x, y pairs. A polyline ends at a line break outside brackets,
+ * so plain text takes one polyline per line, and at the `]` of an array of arrays or objects, so JSON such as
+ * [[{"x": 0, "y": 0}, {"x": 1, "y": 2}], [[3, 4], [5, 6]]] takes one polyline per array of points. Keys and other
+ * strings are skipped. `-d` writes a dashed line, `-s` caps the segments per chunk (default 1024), every chunk is
+ * culled and streamed on its own.
+ */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/line/vertexBuilder/line.h"
+#include "line_geometry.h"
+#include "polyline.h"
+
+struct Polylines {
+    float *points;
+    int point_capacity;
+    int number_count;
+    int *offsets;
+    int offset_capacity;
+    int line_count;
+};
+
+static void push_number(struct Polylines *lines, float value) {
+    if (lines->number_count == lines->point_capacity) {
+        lines->point_capacity *= 2;
+        lines->points = realloc(lines->points, lines->point_capacity * sizeof(float));
+    }
+    lines->points[lines->number_count++] = value;
+}
+
+// 结束当前的线, 丢掉落单的坐标, 空线不记录
+static void end_line(struct Polylines *lines) {
+    lines->number_count &= ~1;
+    int point_count = lines->number_count / 2;
+    if (point_count == lines->offsets[lines->line_count]) {
+        return;
+    }
+    if (lines->line_count + 2 > lines->offset_capacity) {
+        lines->offset_capacity *= 2;
+        lines->offsets = realloc(lines->offsets, lines->offset_capacity * sizeof(int));
+    }
+    lines->offsets[++lines->line_count] = point_count;
+}
+
+static int read_polylines(FILE *file, struct Polylines *lines) {
+    lines->point_capacity = 1024;
+    lines->points = malloc(lines->point_capacity * sizeof(float));
+    lines->number_count = 0;
+    lines->offset_capacity = 64;
+    lines->offsets = malloc(lines->offset_capacity * sizeof(int));
+    lines->offsets[0] = 0;
+    lines->line_count = 0;
+
+    // 每层数组是否直接包含数组或对象: 包含的是点, 这一层就是一条线
+    char has_points[64] = {0};
+    int depth = 0;
+    char number[64];
+    int length = 0;
+    int c;
+    do {
+        c = fgetc(file);
+        if (c != EOF && (isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+            if (length < (int)sizeof(number) - 1) {
+                number[length++] = (char)c;
+            }
+            continue;
+        }
+        if (length) {
+            number[length] = 0;
+            char *end;
+            float value = strtof(number, &end);
+            if (end == number) {
+                fprintf(stderr, "not a number: %s\n", number);
+                return 0;
+            }
+            push_number(lines, value);
+            length = 0;
+        }
+        if (c == '"') {
+            while ((c = fgetc(file)) != EOF && c != '"') {
+                if (c == '\\') {
+                    fgetc(file);
+                }
+            }
+        } else if (c == '[' || c == '{') {
+            if (depth > 0 && depth < (int)sizeof(has_points)) {
+                has_points[depth] = 1;
+            }
+            if (c == '[' && ++depth < (int)sizeof(has_points)) {
+                has_points[depth] = 0;
+            }
+        } else if (c == ']' && depth > 0) {
+            if (depth >= (int)sizeof(has_points) || has_points[depth]) {
+                end_line(lines);
+            }
+            depth--;
+        } else if (c == '\n' && depth <= 0) {
+            end_line(lines);
+        }
+    } while (c != EOF);
+    end_line(lines);
+    return 1;
+}
+
+static int find_name(const char *value, const char **names, int count) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(value, names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s [-d] [-j miter|round|bevel] [-c round|butt|square] [-r round_segments] [-s chunk_segments] "
+            "[-i 16|32] input output\n",
+            name);
+}
+
+int main(int argc, char **argv) {
+    struct LineGeometryOptions options = {0, 0, 1, ROUND_SEGMENTS_DEFAULT, INDEX_UINT32, 1024};
+    const char *paths[2];
+    int path_count = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0) {
+            options.dash = 1;
+            continue;
+        }
+        if (argv[i][0] != '-' || !argv[i][1]) {
+            if (path_count == 2) {
+                usage(argv[0]);
+                return 1;
+            }
+            paths[path_count++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *value = argv[++i];
+        if (strcmp(argv[i - 1], "-j") == 0) {
+            options.join = find_name(value, JOIN_NAMES, 3);
+        } else if (strcmp(argv[i - 1], "-c") == 0) {
+            options.cap = find_name(value, CAP_NAMES, 3);
+        } else if (strcmp(argv[i - 1], "-r") == 0) {
+            options.round_segments = atoi(value);
+        } else if (strcmp(argv[i - 1], "-s") == 0) {
+            options.chunk_segments = atoi(value);
+        } else if (strcmp(argv[i - 1], "-i") == 0) {
+            options.index_format = atoi(value) == 16 ? INDEX_UINT16 : INDEX_UINT32;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (path_count != 2 || options.join < 0 || options.cap < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *input = strcmp(paths[0], "-") == 0 ? stdin : fopen(paths[0], "r");
+    if (!input) {
+        perror(paths[0]);
+        return 1;
+    }
+    struct Polylines lines;
+    int ok = read_polylines(input, &lines);
+    if (input != stdin) {
+        fclose(input);
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    FILE *output = fopen(paths[1], "wb");
+    if (!output) {
+        perror(paths[1]);
+        return 1;
+    }
+    int chunk_count = write_line_geometry(output, lines.points, lines.offsets, lines.line_count, &options);
+    if (fclose(output) != 0 || chunk_count < 0) {
+        fprintf(stderr, "%s: write failed\n", paths[1]);
+        return 1;
+    }
+    printf("%d lines, %d points, %d chunks\n", lines.line_count, lines.offsets[lines.line_count], chunk_count);
+    free(lines.points);
+    free(lines.offsets);
+    return 0;
+}
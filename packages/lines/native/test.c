@@ -0,0 +1,1439 @@
+/**
+ * Golden-output regression test for the line tessellator.
+ *
+ * Every (kind, shape, size, join, cap) case is tessellated and its vertex and
+ * index buffers are reduced to FNV-1a digests, which must match `golden.txt`
+ * bit for bit. Run with `--update` to rewrite the golden file after an
+ * intentional output change.
+ */
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/line/vertexBuilder/line.h"
+#include "line_geometry.h"
+#include "polyline.h"
+
+#define CANARY 0xcd
+#define MAX_CASES 1024
+
+static const int SIZES[] = {2, 3, 10, 257, 4000};
+
+struct Case {
+    char key[96];
+    int vertex_count;
+    int index_count;
+    uint64_t vertex_hash;
+    uint64_t index_hash;
+};
+
+static int check_canary(const unsigned char *bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (bytes[i] != CANARY) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int run_case(int dash, enum Shape shape, int point_count, int join, int cap, struct Case *result) {
+    int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                              : get_solid_vertex_count(point_count, join, cap);
+    int index_count = vertex_count * 3 - 6;
+    size_t vertex_bytes = (size_t)vertex_count * sizeof(struct Vertex);
+    size_t index_bytes = (size_t)index_count * sizeof(unsigned short);
+    // One spare element past each buffer to catch writes beyond the advertised counts.
+    float *points = malloc((size_t)point_count * 2 * sizeof(float));
+    unsigned char *vertices = malloc(vertex_bytes + sizeof(struct Vertex));
+    unsigned char *indices = malloc(index_bytes + sizeof(unsigned short) * 3);
+    memset(vertices, CANARY, vertex_bytes + sizeof(struct Vertex));
+    memset(indices, CANARY, index_bytes + sizeof(unsigned short) * 3);
+
+    generate_polyline(shape, point_count, points);
+    if (dash) {
+        build_dash_line(points, point_count, join, cap, 0, -1, (struct Vertex *)vertices, (unsigned short *)indices);
+    } else {
+        build_solid_line(points, point_count, join, cap, -1, (struct Vertex *)vertices, (unsigned short *)indices);
+    }
+
+    snprintf(result->key, sizeof(result->key), "%s-%s-%d-%s-%s", dash ? "dash" : "solid", SHAPE_NAMES[shape],
+             point_count, JOIN_NAMES[join], CAP_NAMES[cap]);
+    result->vertex_count = vertex_count;
+    result->index_count = index_count;
+    result->vertex_hash = fnv1a(FNV_OFFSET, vertices, vertex_bytes);
+    result->index_hash = hash_indices(FNV_OFFSET, (unsigned short *)indices, index_count);
+
+    int ok = 1;
+    if (!check_canary(vertices + vertex_bytes, sizeof(struct Vertex)) ||
+        !check_canary(indices + index_bytes, sizeof(unsigned short) * 3)) {
+        fprintf(stderr, "%s: wrote past the advertised buffer size\n", result->key);
+        ok = 0;
+    }
+    const unsigned short *index_values = (const unsigned short *)indices;
+    for (int i = 0; i < index_count; i++) {
+        if (index_values[i] >= vertex_count) {
+            fprintf(stderr, "%s: index %d out of range (%d >= %d)\n", result->key, i, index_values[i], vertex_count);
+            ok = 0;
+            break;
+        }
+    }
+
+    free(points);
+    free(vertices);
+    free(indices);
+    return ok;
+}
+
+static int collect(struct Case *cases) {
+    int count = 0;
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        if (!run_case(dash, shape, SIZES[s], join, cap, &cases[count++])) {
+                            failed++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return failed ? -failed : count;
+}
+
+/**
+ * Digest of the triangle sequence by vertex content, so differently indexed
+ * buffers that draw the same triangles hash the same.
+ */
+static uint64_t hash_triangles(uint64_t hash, const struct Vertex *vertices, const void *indices, int index_count,
+                               int index_format) {
+    for (int i = 0; i < index_count; i++) {
+        uint32_t index = index_format == INDEX_UINT32 ? ((const uint32_t *)indices)[i]
+                                                      : ((const unsigned short *)indices)[i];
+        hash = fnv1a(hash, &vertices[index], sizeof(struct Vertex));
+    }
+    return hash;
+}
+
+static uint64_t build_ranges(int dash, const float *points, int point_count, int join, int cap, int range_size,
+                             int index_format, int *ok) {
+    uint64_t hash = FNV_OFFSET;
+    float lengthsofar = 0;
+    int segment_count = point_count - 1;
+    for (int first = 0; first < segment_count; first += range_size) {
+        int last = first + range_size < segment_count ? first + range_size : segment_count;
+        int vertex_count = dash ? get_dash_range_vertex_count(point_count, first, last, join, cap)
+                                : get_solid_range_vertex_count(point_count, first, last, join, cap);
+        int index_count = vertex_count * 3 - 6;
+        size_t index_size = index_format == INDEX_UINT32 ? 4 : 2;
+        size_t vertex_bytes = (size_t)vertex_count * sizeof(struct Vertex);
+        unsigned char *vertices = malloc(vertex_bytes + sizeof(struct Vertex));
+        unsigned char *indices = malloc(index_count * index_size + index_size * 3);
+        memset(vertices, CANARY, vertex_bytes + sizeof(struct Vertex));
+        memset(indices, CANARY, index_count * index_size + index_size * 3);
+        if (dash) {
+            lengthsofar = build_dash_line_range((float *)points, point_count, first, last, join, cap, lengthsofar, -1,
+                                                (struct Vertex *)vertices, indices, index_format);
+        } else {
+            build_solid_line_range((float *)points, point_count, first, last, join, cap, -1, (struct Vertex *)vertices,
+                                   indices, index_format);
+        }
+        if (!check_canary(vertices + vertex_bytes, sizeof(struct Vertex)) ||
+            !check_canary(indices + index_count * index_size, index_size * 3)) {
+            *ok = 0;
+        }
+        for (int i = 0; i < index_count; i++) {
+            uint32_t index = index_format == INDEX_UINT32 ? ((uint32_t *)indices)[i] : ((unsigned short *)indices)[i];
+            if (index >= (uint32_t)vertex_count) {
+                *ok = 0;
+                break;
+            }
+        }
+        hash = hash_triangles(hash, (struct Vertex *)vertices, indices, index_count, index_format);
+        free(vertices);
+        free(indices);
+    }
+    return hash;
+}
+
+static int check_ranges(void) {
+    // 20000 points overflow 16-bit indices for every join, so the uint16 run needs real chunking.
+    static const int POINT_COUNTS[] = {3, 257, 20000};
+    static const int RANGE_SIZES[] = {1, 2, 7, 64, 5000};
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        int ok = 1;
+                        uint64_t full = build_ranges(dash, points, point_count, join, cap, point_count, INDEX_UINT32, &ok);
+                        for (size_t r = 0; r < sizeof(RANGE_SIZES) / sizeof(RANGE_SIZES[0]); r++) {
+                            int range_size = RANGE_SIZES[r];
+                            if (range_size >= point_count - 1) {
+                                continue;
+                            }
+                            int index_format = point_count > 10000 ? INDEX_UINT16 : INDEX_UINT32;
+                            uint64_t ranges =
+                                build_ranges(dash, points, point_count, join, cap, range_size, index_format, &ok);
+                            if (ranges != full || !ok) {
+                                fprintf(stderr, "%s-%s-%d-%s-%s: range size %d differs from full build\n",
+                                        dash ? "dash" : "solid", SHAPE_NAMES[shape], point_count, JOIN_NAMES[join],
+                                        CAP_NAMES[cap], range_size);
+                                failed++;
+                                ok = 1;
+                            }
+                        }
+                    }
+                }
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * Batch lines of every shape/join/cap (plus a degenerate one-point line) and check that each line's
+ * index range draws the same triangles as building it alone, with its style baked into the vertices.
+ */
+/**
+ * Grow a line a few points at a time with the append entry points, writing each
+ * tail over the same buffers, and check the result matches a full build byte for byte.
+ */
+static int check_append(void) {
+    static const int POINT_COUNTS[] = {3, 40, 257};
+    static const int STEPS[] = {1, 2, 5};
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                                                : get_solid_vertex_count(point_count, join, cap);
+                        int index_count = vertex_count * 3 - 6;
+                        struct Vertex *expected_vertices = malloc(vertex_count * sizeof(struct Vertex));
+                        uint32_t *expected_indices = malloc(index_count * sizeof(uint32_t));
+                        struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+                        uint32_t *indices = malloc(index_count * sizeof(uint32_t));
+                        float expected_lengthsofar = 0, lengthsofar = 0;
+                        if (dash) {
+                            expected_lengthsofar =
+                                build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 0, -1,
+                                                      expected_vertices, expected_indices, INDEX_UINT32);
+                        } else {
+                            build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1,
+                                                   expected_vertices, expected_indices, INDEX_UINT32);
+                        }
+
+                        for (size_t s = 0; s < sizeof(STEPS) / sizeof(STEPS[0]); s++) {
+                            memset(vertices, CANARY, vertex_count * sizeof(struct Vertex));
+                            memset(indices, CANARY, index_count * sizeof(uint32_t));
+                            // start from a 2 point line, its end cap gets overwritten by the first append
+                            if (dash) {
+                                lengthsofar = build_dash_line_range(points, 2, 0, 1, join, cap, 0, -1, vertices,
+                                                                    indices, INDEX_UINT32);
+                            } else {
+                                build_solid_line_range(points, 2, 0, 1, join, cap, -1, vertices, indices,
+                                                       INDEX_UINT32);
+                            }
+                            for (int old_count = 2; old_count < point_count;) {
+                                int new_count = old_count + STEPS[s] < point_count ? old_count + STEPS[s] : point_count;
+                                int vertex_start = (dash ? get_dash_range_vertex_count(new_count, 0, old_count - 1, join, cap)
+                                                         : get_solid_range_vertex_count(new_count, 0, old_count - 1,
+                                                                                        join, cap)) -
+                                                   2;
+                                int data_offset = old_count - 2;
+                                if (dash) {
+                                    lengthsofar = append_dash_line(points + data_offset * 2, data_offset, new_count,
+                                                                   old_count, join, cap, lengthsofar,
+                                                                   vertices + vertex_start, indices + vertex_start * 3,
+                                                                   INDEX_UINT32);
+                                } else {
+                                    append_solid_line(points + data_offset * 2, data_offset, new_count, old_count, join,
+                                                      cap, vertices + vertex_start, indices + vertex_start * 3,
+                                                      INDEX_UINT32);
+                                }
+                                old_count = new_count;
+                            }
+                            if (memcmp(vertices, expected_vertices, vertex_count * sizeof(struct Vertex)) ||
+                                memcmp(indices, expected_indices, index_count * sizeof(uint32_t)) ||
+                                lengthsofar != expected_lengthsofar) {
+                                fprintf(stderr, "%s-%s-%d-%s-%s: appending %d points at a time differs\n",
+                                        dash ? "dash" : "solid", SHAPE_NAMES[shape], point_count, JOIN_NAMES[join],
+                                        CAP_NAMES[cap], STEPS[s]);
+                                failed++;
+                            }
+                        }
+                        free(expected_vertices);
+                        free(expected_indices);
+                        free(vertices);
+                        free(indices);
+                    }
+                }
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+
+#ifdef LINE_SIMD
+/**
+ * Compare the SIMD kernel with the scalar builder across SIMD block boundaries, partial
+ * ranges and degenerate input (repeated points, zero length segments, exact reversals).
+ */
+static int check_simd(void) {
+    static const int POINT_COUNTS[] = {2, 3, 5, 128, 129, 130, 131, 1000, 20000};
+    static const int RANGE_SIZES[] = {1, 7, 128, 200};
+    int failed = 0;
+    for (int degenerate = 0; degenerate < 2; degenerate++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                if (degenerate) {
+                    // every third point repeats the previous one, every seventh goes back to it
+                    for (int i = 1; i < point_count; i++) {
+                        if (i % 3 == 0 || (i % 7 == 0 && i >= 2)) {
+                            int from = i % 3 == 0 ? i - 1 : i - 2;
+                            points[i * 2] = points[from * 2];
+                            points[i * 2 + 1] = points[from * 2 + 1];
+                        }
+                    }
+                }
+                int vertex_capacity = get_solid_vertex_count(point_count, 1, 0) + 8;
+                struct Vertex *expected_vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                struct Vertex *vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                uint32_t *expected_indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                uint32_t *indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        for (size_t r = 0; r <= sizeof(RANGE_SIZES) / sizeof(RANGE_SIZES[0]); r++) {
+                            int range_size = r < sizeof(RANGE_SIZES) / sizeof(RANGE_SIZES[0]) ? RANGE_SIZES[r]
+                                                                                            : point_count - 1;
+                            for (int first = 0; first < point_count - 1; first += range_size) {
+                                int last = first + range_size < point_count - 1 ? first + range_size : point_count - 1;
+                                int vertex_count = get_solid_range_vertex_count(point_count, first, last, join, cap);
+                                size_t vertex_bytes = (size_t)vertex_count * sizeof(struct Vertex);
+                                size_t index_bytes = (size_t)(vertex_count * 3 - 6) * sizeof(uint32_t);
+                                memset(expected_vertices, CANARY, vertex_bytes);
+                                memset(vertices, CANARY, vertex_bytes + sizeof(struct Vertex));
+                                memset(indices, CANARY, index_bytes + sizeof(uint32_t) * 3);
+                                build_solid_line_range_scalar(points, point_count, first, last, join, cap, first,
+                                                              expected_vertices, expected_indices, INDEX_UINT32);
+                                build_solid_line_range_simd(points, point_count, first, last, join, cap, first,
+                                                            vertices, indices, INDEX_UINT32);
+                                if (memcmp(vertices, expected_vertices, vertex_bytes) ||
+                                    memcmp(indices, expected_indices, index_bytes) ||
+                                    !check_canary((unsigned char *)vertices + vertex_bytes, sizeof(struct Vertex)) ||
+                                    !check_canary((unsigned char *)indices + index_bytes, sizeof(uint32_t) * 3)) {
+                                    fprintf(stderr, "%s%s-%d-%s-%s [%d, %d): SIMD output differs from scalar\n",
+                                            degenerate ? "degenerate-" : "", SHAPE_NAMES[shape], point_count,
+                                            JOIN_NAMES[join], CAP_NAMES[cap], first, last);
+                                    failed++;
+                                }
+                            }
+                        }
+                    }
+                }
+                free(expected_vertices);
+                free(vertices);
+                free(expected_indices);
+                free(indices);
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+#endif
+
+/**
+ * The kernels specialized per join and cap must reproduce the generic build byte for byte, for solid and dash lines
+ * and for ranges starting and ending mid-line.
+ */
+static int check_specialized(void) {
+    static const int POINT_COUNTS[] = {2, 3, 257};
+    static const int RANGE_SIZES[] = {1, 7, 256};
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                int vertex_capacity = get_dash_vertex_count(point_count, 1, 0) + 8;
+                struct Vertex *expected_vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                struct Vertex *vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                uint32_t *expected_indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                uint32_t *indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        for (size_t r = 0; r < sizeof(RANGE_SIZES) / sizeof(RANGE_SIZES[0]); r++) {
+                            int range_size = RANGE_SIZES[r];
+                            float lengthsofar = 0, expected_lengthsofar = 0;
+                            for (int first = 0; first < point_count - 1; first += range_size) {
+                                int last = first + range_size < point_count - 1 ? first + range_size : point_count - 1;
+                                int vertex_count =
+                                    dash ? get_dash_range_vertex_count(point_count, first, last, join, cap)
+                                         : get_solid_range_vertex_count(point_count, first, last, join, cap);
+                                size_t vertex_bytes = (size_t)vertex_count * sizeof(struct Vertex);
+                                size_t index_bytes = (size_t)(vertex_count * 3 - 6) * sizeof(uint32_t);
+                                memset(vertices, CANARY, vertex_bytes + sizeof(struct Vertex));
+                                memset(indices, CANARY, index_bytes + sizeof(uint32_t) * 3);
+                                if (dash) {
+                                    expected_lengthsofar = build_dash_line_range_generic(
+                                        points, point_count, first, last, join, cap, expected_lengthsofar, first,
+                                        expected_vertices, expected_indices, INDEX_UINT32);
+                                    lengthsofar = build_dash_line_range(points, point_count, first, last, join, cap,
+                                                                        lengthsofar, first, vertices, indices,
+                                                                        INDEX_UINT32);
+                                } else {
+                                    build_solid_line_range_generic(points, point_count, first, last, join, cap, first,
+                                                                   expected_vertices, expected_indices, INDEX_UINT32);
+                                    build_solid_line_range_scalar(points, point_count, first, last, join, cap, first,
+                                                                  vertices, indices, INDEX_UINT32);
+                                }
+                                if (memcmp(vertices, expected_vertices, vertex_bytes) ||
+                                    memcmp(indices, expected_indices, index_bytes) ||
+                                    memcmp(&lengthsofar, &expected_lengthsofar, sizeof(float)) ||
+                                    !check_canary((unsigned char *)vertices + vertex_bytes, sizeof(struct Vertex)) ||
+                                    !check_canary((unsigned char *)indices + index_bytes, sizeof(uint32_t) * 3)) {
+                                    fprintf(stderr, "%s-%s-%d-%s-%s [%d, %d): specialized output differs\n",
+                                            dash ? "dash" : "solid", SHAPE_NAMES[shape], point_count,
+                                            JOIN_NAMES[join], CAP_NAMES[cap], first, last);
+                                    failed++;
+                                }
+                            }
+                        }
+                    }
+                }
+                free(expected_vertices);
+                free(vertices);
+                free(expected_indices);
+                free(indices);
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * The parallel builders must reproduce the single-threaded build byte for byte, including
+ * the returned dash length, for any thread count.
+ */
+static int check_parallel(void) {
+    static const int POINT_COUNTS[] = {2, 9000, 100000};
+    static const int THREAD_COUNTS[] = {1, 2, 3, 8};
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                // room for the canaries after the largest (dash bevel or round) build
+                int bevel_count = get_dash_vertex_count(point_count, 2, 2);
+                int round_count = get_dash_vertex_count(point_count, 1, 0);
+                int vertex_capacity = (bevel_count > round_count ? bevel_count : round_count) + 1;
+                struct Vertex *expected_vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                struct Vertex *vertices = malloc(vertex_capacity * sizeof(struct Vertex));
+                uint32_t *expected_indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                uint32_t *indices = malloc(vertex_capacity * 3 * sizeof(uint32_t));
+                for (int join = 0; join < 3; join++) {
+                    int cap = join;
+                    int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                                            : get_solid_vertex_count(point_count, join, cap);
+                    size_t vertex_bytes = (size_t)vertex_count * sizeof(struct Vertex);
+                    size_t index_bytes = (size_t)(vertex_count * 3 - 6) * sizeof(uint32_t);
+                    float expected_lengthsofar = 0;
+                    if (dash) {
+                        expected_lengthsofar =
+                            build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 1, -1,
+                                                  expected_vertices, expected_indices, INDEX_UINT32);
+                    } else {
+                        build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1,
+                                               expected_vertices, expected_indices, INDEX_UINT32);
+                    }
+                    for (size_t t = 0; t < sizeof(THREAD_COUNTS) / sizeof(THREAD_COUNTS[0]); t++) {
+                        float lengthsofar = 0;
+                        memset(vertices, CANARY, vertex_bytes + sizeof(struct Vertex));
+                        memset(indices, CANARY, index_bytes + sizeof(uint32_t) * 3);
+                        if (dash) {
+                            lengthsofar = build_dash_line_parallel(points, point_count, join, cap, 1, -1, vertices,
+                                                                   indices, INDEX_UINT32, THREAD_COUNTS[t]);
+                        } else {
+                            build_solid_line_parallel(points, point_count, join, cap, -1, vertices, indices,
+                                                      INDEX_UINT32, THREAD_COUNTS[t]);
+                        }
+                        if (memcmp(vertices, expected_vertices, vertex_bytes) ||
+                            memcmp(indices, expected_indices, index_bytes) || lengthsofar != expected_lengthsofar ||
+                            !check_canary((unsigned char *)vertices + vertex_bytes, sizeof(struct Vertex)) ||
+                            !check_canary((unsigned char *)indices + index_bytes, sizeof(uint32_t) * 3)) {
+                            fprintf(stderr, "%s-%s-%d-%s: %d threads differ from the single-threaded build\n",
+                                    dash ? "dash" : "solid", SHAPE_NAMES[shape], point_count, JOIN_NAMES[join],
+                                    THREAD_COUNTS[t]);
+                            failed++;
+                        }
+                    }
+                }
+                free(expected_vertices);
+                free(vertices);
+                free(expected_indices);
+                free(indices);
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * Pack built vertices and check every field decodes back within its quantization step.
+ */
+static int check_pack(void) {
+    static const int POINT_COUNTS[] = {1, 2, 257, 4000};
+    int failed = 0;
+    if (sizeof(struct PackedVertex) != 12) {
+        fprintf(stderr, "PackedVertex is %d bytes\n", (int)sizeof(struct PackedVertex));
+        return 1;
+    }
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+                int point_count = POINT_COUNTS[p];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                for (int join = 0; join < 3; join++) {
+                    int cap = 2 - join;
+                    int vertex_count = point_count < 2 ? 0
+                                       : dash      ? get_dash_vertex_count(point_count, join, cap)
+                                                   : get_solid_vertex_count(point_count, join, cap);
+                    struct Vertex *vertices = malloc((vertex_count + 1) * sizeof(struct Vertex));
+                    struct Vertex *expected = malloc((vertex_count + 1) * sizeof(struct Vertex));
+                    uint32_t *indices = malloc((vertex_count * 3 + 1) * sizeof(uint32_t));
+                    if (vertex_count) {
+                        if (dash) {
+                            build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 5, -1, vertices,
+                                                  indices, INDEX_UINT32);
+                        } else {
+                            build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1, vertices,
+                                                   indices, INDEX_UINT32);
+                        }
+                    }
+                    memcpy(expected, vertices, vertex_count * sizeof(struct Vertex));
+                    float pack[6];
+                    pack_vertices(vertices, vertex_count, pack);
+                    const struct PackedVertex *packed = (const struct PackedVertex *)vertices;
+                    int ok = pack[2] > 0 && pack[3] > 0 && pack[5] > 0;
+                    for (int i = 0; i < vertex_count && ok; i++) {
+                        const struct Vertex *v = &expected[i];
+                        const struct PackedVertex *q = &packed[i];
+                        float x = pack[0] + q->x / 32767.0f * pack[2];
+                        float y = pack[1] + q->y / 32767.0f * pack[3];
+                        float offset_x = q->offset_x / 32767.0f * PACK_OFFSET_SCALE;
+                        float offset_y = q->offset_y / 32767.0f * PACK_OFFSET_SCALE;
+                        float lengthsofar = pack[4] + q->lengthsofar / 65535.0f * pack[5];
+                        ok = fabsf(x - v->x) <= pack[2] * 2e-4f && fabsf(y - v->y) <= pack[3] * 2e-4f &&
+                             fabsf(offset_x - v->offset_x) <= 1e-3f && fabsf(offset_y - v->offset_y) <= 1e-3f &&
+                             fabsf(lengthsofar - v->lengthsofar) <= pack[5] * 2e-4f &&
+                             q->direction == v->direction + 1 && q->part == v->part;
+                    }
+                    if (!ok) {
+                        fprintf(stderr, "%s-%s-%d-%s: packed vertices do not decode to the built ones\n",
+                                dash ? "dash" : "solid", SHAPE_NAMES[shape], point_count, JOIN_NAMES[join]);
+                        failed++;
+                    }
+                    free(vertices);
+                    free(expected);
+                    free(indices);
+                }
+                free(points);
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * Check the culling bounds of every build contain its vertices at any width and touch them at zero width.
+ */
+static int check_bounds(void) {
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            int point_count = 257;
+            float points[257 * 2];
+            generate_polyline(shape, point_count, points);
+            for (int join = 0; join < 3; join++) {
+                int cap = 2 - join;
+                int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                                        : get_solid_vertex_count(point_count, join, cap);
+                struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+                uint32_t *indices = malloc(vertex_count * 3 * sizeof(uint32_t));
+                if (dash) {
+                    build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 0, -1, vertices,
+                                          indices, INDEX_UINT32);
+                } else {
+                    build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1, vertices, indices,
+                                           INDEX_UINT32);
+                }
+                float bounds[6];
+                get_vertex_bounds(vertices, vertex_count, bounds);
+                const float width = 0.5f;
+                int touches = 0;
+                int ok = 1;
+                for (int i = 0; i < vertex_count && ok; i++) {
+                    const struct Vertex *v = &vertices[i];
+                    float x = v->x + v->offset_x * width;
+                    float y = v->y + v->offset_y * width;
+                    ok = x >= bounds[0] - bounds[4] * width && x <= bounds[2] + bounds[4] * width &&
+                         y >= bounds[1] - bounds[5] * width && y <= bounds[3] + bounds[5] * width;
+                    touches |= v->x == bounds[0];
+                }
+                if (!ok || !touches) {
+                    fprintf(stderr, "%s-%s-%s: vertices outside their bounds\n", dash ? "dash" : "solid",
+                            SHAPE_NAMES[shape], JOIN_NAMES[join]);
+                    failed++;
+                }
+                free(vertices);
+                free(indices);
+            }
+        }
+    }
+    return failed;
+}
+
+/**
+ * Check the counters add up the range builds made while profiling is on and nothing while it is off.
+ */
+static int check_profile(void) {
+    int failed = 0;
+    int point_count = 257;
+    float points[257 * 2];
+    generate_polyline(SHAPE_ZIGZAG, point_count, points);
+    int solid_count = get_solid_range_vertex_count(point_count, 10, 100, 1, 0);
+    int dash_count = get_dash_vertex_count(point_count, 2, 1);
+    int vertex_count = solid_count > dash_count ? solid_count : dash_count;
+    struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+    uint32_t *indices = malloc(vertex_count * 3 * sizeof(uint32_t));
+    struct LineCounters *counters = get_line_counters();
+    memset(counters, 0, sizeof(*counters));
+    set_line_profiling(1);
+    build_solid_line_range(points, point_count, 10, 100, 1, 0, -1, vertices, indices, INDEX_UINT32);
+    build_dash_line_range(points, point_count, 0, point_count - 1, 2, 1, 0, -1, vertices, indices, INDEX_UINT32);
+    float pack[6];
+    pack_vertices(vertices, dash_count, pack);
+    set_line_profiling(0);
+    build_solid_line_range(points, point_count, 0, point_count - 1, 0, 2, -1, vertices, indices, INDEX_UINT32);
+    if (counters->calls != 2 || counters->points != 91 + point_count ||
+        counters->vertices != solid_count + dash_count || counters->indices != (solid_count + dash_count) * 3 - 12 ||
+        !(counters->milliseconds >= 0)) {
+        fprintf(stderr, "profile: %g calls, %g points, %g vertices, %g indices in %g ms\n", counters->calls,
+                counters->points, counters->vertices, counters->indices, counters->milliseconds);
+        failed++;
+    }
+    memset(counters, 0, sizeof(*counters));
+    free(vertices);
+    free(indices);
+    return failed;
+}
+
+static float segment_distance(const float *a, const float *b, float x, float y) {
+    float dx = b[0] - a[0], dy = b[1] - a[1];
+    float length_sq = dx * dx + dy * dy;
+    float t = length_sq > 0 ? ((x - a[0]) * dx + (y - a[1]) * dy) / length_sq : 0;
+    t = t < 0 ? 0 : t > 1 ? 1 : t;
+    return hypotf(x - a[0] - t * dx, y - a[1] - t * dy);
+}
+
+static int triangles_cover(const float *positions, const uint32_t *indices, int index_count, float x, float y) {
+    for (int i = 0; i < index_count; i += 3) {
+        const float *a = positions + indices[i] * 2;
+        const float *b = positions + indices[i + 1] * 2;
+        const float *c = positions + indices[i + 2] * 2;
+        if ((x < a[0] && x < b[0] && x < c[0]) || (x > a[0] && x > b[0] && x > c[0]) ||
+            (y < a[1] && y < b[1] && y < c[1]) || (y > a[1] && y > b[1] && y > c[1])) {
+            continue;
+        }
+        // degenerate triangles cover nothing, but would pass the sign test below
+        float area = (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+        if (fabsf(area) < 1e-9f) {
+            continue;
+        }
+        float d0 = (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+        float d1 = (c[0] - b[0]) * (y - b[1]) - (c[1] - b[1]) * (x - b[0]);
+        float d2 = (a[0] - c[0]) * (y - c[1]) - (a[1] - c[1]) * (x - c[0]);
+        const float eps = 1e-6f;
+        if ((d0 >= -eps && d1 >= -eps && d2 >= -eps) || (d0 <= eps && d1 <= eps && d2 <= eps)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Sample points around round-joined, round-capped lines: everything within the width, less the chord error of the
+ * arcs, has to be covered by triangles, and for solid lines nothing beyond the width may be. Dash lines are only
+ * sampled around their joins and caps.
+ */
+static int check_round(void) {
+    static const int SEGMENTS[] = {ROUND_SEGMENTS_MIN, ROUND_SEGMENTS_DEFAULT, 32};
+    const int point_count = 12, join = 1, cap = 0; // round join, round cap
+    const float width = 1, step = 0.05f, eps = 1e-3f;
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(SEGMENTS) / sizeof(SEGMENTS[0]); k++) {
+        set_round_segments(SEGMENTS[k]);
+        float inner = width * cosf(3.14159265f / (2 * SEGMENTS[k])) - eps;
+        for (int dash = 0; dash < 2; dash++) {
+            for (int shape = SHAPE_ZIGZAG; shape < SHAPE_COUNT; shape++) {
+                float points[12 * 2];
+                generate_polyline(shape, point_count, points);
+                int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                                        : get_solid_vertex_count(point_count, join, cap);
+                int index_count = vertex_count * 3 - 6;
+                struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+                uint32_t *indices = malloc(index_count * sizeof(uint32_t));
+                float *positions = malloc(vertex_count * 2 * sizeof(float));
+                if (dash) {
+                    build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 0, -1,
+                                          vertices, indices, INDEX_UINT32);
+                } else {
+                    build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1,
+                                           vertices, indices, INDEX_UINT32);
+                }
+                float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+                for (int i = 0; i < vertex_count; i++) {
+                    positions[i * 2] = vertices[i].x + vertices[i].offset_x * width;
+                    positions[i * 2 + 1] = vertices[i].y + vertices[i].offset_y * width;
+                }
+                for (int i = 0; i < point_count; i++) {
+                    min_x = fminf(min_x, points[i * 2]);
+                    min_y = fminf(min_y, points[i * 2 + 1]);
+                    max_x = fmaxf(max_x, points[i * 2]);
+                    max_y = fmaxf(max_y, points[i * 2 + 1]);
+                }
+                int uncovered = 0, overdrawn = 0;
+                for (float y = min_y - 2 * width; y <= max_y + 2 * width; y += step) {
+                    for (float x = min_x - 2 * width; x <= max_x + 2 * width; x += step) {
+                        float distance = FLT_MAX, point_distance = FLT_MAX;
+                        for (int i = 0; i + 1 < point_count; i++) {
+                            distance = fminf(distance, segment_distance(points + i * 2, points + i * 2 + 2, x, y));
+                        }
+                        for (int i = 0; i < point_count; i++) {
+                            point_distance = fminf(point_distance, hypotf(x - points[i * 2], y - points[i * 2 + 1]));
+                        }
+                        // dash segments on sharp turns are cut short by their miters, only the arcs are checked
+                        if (dash && point_distance > distance + 1e-5f) {
+                            continue;
+                        }
+                        if (distance < inner) {
+                            uncovered += !triangles_cover(positions, indices, index_count, x, y);
+                        } else if (!dash && distance > width + eps) {
+                            overdrawn += triangles_cover(positions, indices, index_count, x, y);
+                        }
+                    }
+                }
+                if (uncovered || overdrawn) {
+                    fprintf(stderr, "%s-%s-%d segments: %d points uncovered, %d points outside the width covered\n",
+                            dash ? "dash" : "solid", SHAPE_NAMES[shape], SEGMENTS[k], uncovered, overdrawn);
+                    failed++;
+                }
+                free(vertices);
+                free(indices);
+                free(positions);
+            }
+        }
+    }
+    set_round_segments(ROUND_SEGMENTS_DEFAULT);
+    return failed;
+}
+
+/**
+ * Compare nearest-segment and rectangle queries of the segment index with a scan over all segments.
+ */
+static int check_index(void) {
+    static const int POINT_COUNTS[] = {1, 2, 3, 9, 257, 4000};
+    int failed = 0;
+    uint32_t seed = 12345;
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+            int point_count = POINT_COUNTS[p];
+            int segment_count = point_count - 1;
+            float *points = malloc((size_t)point_count * 2 * sizeof(float));
+            generate_polyline(shape, point_count, points);
+            int node_count = get_line_index_node_count(point_count);
+            float *nodes = malloc(((size_t)node_count + 1) * 4 * sizeof(float));
+            int *found = malloc(((size_t)segment_count + 1) * sizeof(int));
+            build_line_index(points, point_count, nodes);
+            float min_x = points[0], min_y = points[1], max_x = points[0], max_y = points[1];
+            for (int i = 1; i < point_count; i++) {
+                min_x = fminf(min_x, points[i * 2]);
+                max_x = fmaxf(max_x, points[i * 2]);
+                min_y = fminf(min_y, points[i * 2 + 1]);
+                max_y = fmaxf(max_y, points[i * 2 + 1]);
+            }
+            int ok = 1;
+            for (int q = 0; q < 200 && ok; q++) {
+                float u[4];
+                for (int k = 0; k < 4; k++) {
+                    seed = seed * 1664525u + 1013904223u;
+                    u[k] = (seed >> 8) / 16777216.0f;
+                }
+                float x = min_x + (max_x - min_x + 2) * u[0] - 1;
+                float y = min_y + (max_y - min_y + 2) * u[1] - 1;
+                float max_distance = (max_x - min_x + max_y - min_y + 1) * u[2] * 0.1f;
+
+                int expected = -1;
+                float expected_sq = max_distance * max_distance;
+                for (int i = 0; i < segment_count; i++) {
+                    float x1 = points[i * 2], y1 = points[i * 2 + 1];
+                    float dx = points[i * 2 + 2] - x1, dy = points[i * 2 + 3] - y1;
+                    float length_sq = dx * dx + dy * dy;
+                    float t = 0;
+                    if (length_sq > 0) {
+                        t = ((x - x1) * dx + (y - y1) * dy) / length_sq;
+                        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+                    }
+                    float ox = x1 + t * dx - x, oy = y1 + t * dy - y;
+                    float distance_sq = ox * ox + oy * oy;
+                    if (distance_sq <= expected_sq && (expected < 0 || distance_sq < expected_sq)) {
+                        expected_sq = distance_sq;
+                        expected = i;
+                    }
+                }
+                float result[2];
+                int nearest = query_line_index_nearest(points, point_count, nodes, x, y, max_distance, result);
+                ok = nearest == expected && (nearest < 0 || result[0] == sqrtf(expected_sq));
+
+                float half = max_distance;
+                int count = query_line_index_rect(points, point_count, nodes, x - half, y - half, x + half, y + half,
+                                                  found, segment_count);
+                int expected_count = 0;
+                for (int i = 0; i < segment_count && ok; i++) {
+                    float x1 = points[i * 2], y1 = points[i * 2 + 1];
+                    float x2 = points[i * 2 + 2], y2 = points[i * 2 + 3];
+                    if (fminf(x1, x2) > x + half || fmaxf(x1, x2) < x - half || fminf(y1, y2) > y + half ||
+                        fmaxf(y1, y2) < y - half) {
+                        continue;
+                    }
+                    ok = expected_count < count && found[expected_count] == i;
+                    expected_count++;
+                }
+                ok = ok && count == expected_count;
+            }
+            if (!ok) {
+                fprintf(stderr, "%s-%d: segment index queries differ from a full scan\n", SHAPE_NAMES[shape],
+                        point_count);
+                failed++;
+            }
+            free(points);
+            free(nodes);
+            free(found);
+        }
+    }
+    return failed;
+}
+
+/**
+ * Keep the points above several tolerances and check every dropped point lies within the tolerance of the kept
+ * segment spanning it, and that the kept sets are nested.
+ */
+static int check_simplify(void) {
+    static const int POINT_COUNTS[] = {1, 2, 3, 257, 4000};
+    static const float TOLERANCES[] = {0.01f, 0.1f, 1, 10};
+    int failed = 0;
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        for (size_t p = 0; p < sizeof(POINT_COUNTS) / sizeof(POINT_COUNTS[0]); p++) {
+            int point_count = POINT_COUNTS[p];
+            float *points = malloc((size_t)point_count * 2 * sizeof(float));
+            float *importance = malloc((size_t)point_count * sizeof(float));
+            int *stack = malloc((size_t)point_count * 2 * sizeof(int));
+            generate_polyline(shape, point_count, points);
+            compute_line_importance(points, point_count, importance, stack);
+            int ok = importance[0] == FLT_MAX && importance[point_count - 1] == FLT_MAX;
+            int last_kept_count = point_count;
+            for (size_t t = 0; t < sizeof(TOLERANCES) / sizeof(TOLERANCES[0]) && ok; t++) {
+                float tolerance = TOLERANCES[t];
+                int kept_count = 0;
+                int previous = 0;
+                for (int i = 1; i < point_count && ok; i++) {
+                    if (importance[i] <= tolerance) {
+                        continue;
+                    }
+                    kept_count++;
+                    float x1 = points[previous * 2], y1 = points[previous * 2 + 1];
+                    float dx = points[i * 2] - x1, dy = points[i * 2 + 1] - y1;
+                    float length_sq = dx * dx + dy * dy;
+                    for (int j = previous + 1; j < i && ok; j++) {
+                        float u = length_sq > 0 ? ((points[j * 2] - x1) * dx + (points[j * 2 + 1] - y1) * dy) / length_sq
+                                                : 0;
+                        u = u < 0 ? 0 : (u > 1 ? 1 : u);
+                        float distance = hypotf(points[j * 2] - x1 - u * dx, points[j * 2 + 1] - y1 - u * dy);
+                        ok = distance <= tolerance * 1.0001f + 1e-5f;
+                    }
+                    previous = i;
+                }
+                ok = ok && kept_count <= last_kept_count;
+                last_kept_count = kept_count;
+            }
+            if (!ok) {
+                fprintf(stderr, "%s-%d: simplified line leaves the tolerance\n", SHAPE_NAMES[shape], point_count);
+                failed++;
+            }
+            free(points);
+            free(importance);
+            free(stack);
+        }
+    }
+    return failed;
+}
+
+/* Point of a curve piece at t, evaluated independently of line_curve.c. */
+static void curve_point(const float *controls, int control_length, int type, int piece, float t, float *out) {
+    for (int c = 0; c < 2; c++) {
+        if (type == CURVE_CATMULL_ROM) {
+            int i0 = piece > 0 ? piece - 1 : 0;
+            int i3 = piece + 2 < control_length ? piece + 2 : control_length - 1;
+            float p0 = controls[i0 * 2 + c], p1 = controls[piece * 2 + c];
+            float p2 = controls[piece * 2 + 2 + c], p3 = controls[i3 * 2 + c];
+            out[c] = 0.5f * (2 * p1 + (p2 - p0) * t + (2 * p0 - 5 * p1 + 4 * p2 - p3) * t * t +
+                             (3 * p1 - p0 - 3 * p2 + p3) * t * t * t);
+        } else if (type == CURVE_QUADRATIC) {
+            const float *p = controls + piece * 4 + c;
+            out[c] = (1 - t) * (1 - t) * p[0] + 2 * (1 - t) * t * p[2] + t * t * p[4];
+        } else {
+            const float *p = controls + piece * 6 + c;
+            float s = 1 - t;
+            out[c] = s * s * s * p[0] + 3 * s * s * t * p[2] + 3 * s * t * t * p[4] + t * t * t * p[6];
+        }
+    }
+}
+
+/**
+ * Flatten every curve type at several tolerances and check the polyline starts and ends on the curve, that dense
+ * samples of the curve lie within the tolerance of it and that tighter tolerances never use fewer points.
+ */
+static int check_curve(void) {
+    static const int CONTROL_COUNTS[] = {0, 1, 2, 3, 4, 5, 7, 31};
+    static const float TOLERANCES[] = {1, 0.1f, 0.01f, 0.001f};
+    static const char *TYPE_NAMES[] = {"quadratic", "cubic", "catmull-rom"};
+    enum { SAMPLES = 64 };
+    int failed = 0;
+    for (int type = CURVE_QUADRATIC; type <= CURVE_CATMULL_ROM; type++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t c = 0; c < sizeof(CONTROL_COUNTS) / sizeof(CONTROL_COUNTS[0]); c++) {
+                int control_count = CONTROL_COUNTS[c];
+                float controls[62];
+                generate_polyline(shape, control_count, controls);
+                int piece_count = get_curve_piece_count(control_count, type);
+                int last_length = 0;
+                for (size_t t = 0; t < sizeof(TOLERANCES) / sizeof(TOLERANCES[0]); t++) {
+                    float tolerance = TOLERANCES[t];
+                    int length = flatten_curve(controls, control_count, type, tolerance, NULL);
+                    float *points = malloc(((size_t)length * 2 + 2) * sizeof(float));
+                    memset(points, CANARY, ((size_t)length * 2 + 2) * sizeof(float));
+                    int ok = flatten_curve(controls, control_count, type, tolerance, points) == length &&
+                             check_canary((unsigned char *)(points + length * 2), 2 * sizeof(float)) &&
+                             length >= last_length && length == (control_count ? (piece_count ? length : 1) : 0);
+                    if (ok && length > 0) {
+                        ok = points[0] == controls[0] && points[1] == controls[1];
+                    }
+                    for (int piece = 0; piece < piece_count && ok; piece++) {
+                        float end[2];
+                        curve_point(controls, control_count, type, piece, 1, end);
+                        if (piece == piece_count - 1) {
+                            ok = hypotf(points[length * 2 - 2] - end[0], points[length * 2 - 1] - end[1]) <= 1e-5f;
+                        }
+                        for (int k = 0; k <= SAMPLES && ok; k++) {
+                            float sample[2];
+                            curve_point(controls, control_count, type, piece, (float)k / SAMPLES, sample);
+                            float distance = hypotf(sample[0] - points[0], sample[1] - points[1]);
+                            for (int i = 0; i + 1 < length; i++) {
+                                distance = fminf(distance,
+                                                 segment_distance(points + i * 2, points + i * 2 + 2, sample[0], sample[1]));
+                            }
+                            ok = distance <= tolerance * 1.001f + 1e-4f;
+                        }
+                    }
+                    if (!ok) {
+                        fprintf(stderr, "%s-%s-%d: curve flattened at %g leaves the tolerance\n", TYPE_NAMES[type],
+                                SHAPE_NAMES[shape], control_count, tolerance);
+                        failed++;
+                    }
+                    last_length = length;
+                    free(points);
+                }
+            }
+        }
+    }
+    return failed;
+}
+
+static int check_batch(void) {
+    enum { LINE_COUNT = SHAPE_COUNT * 9 + 1, MAX_POINTS = 50 };
+    static float points[LINE_COUNT * MAX_POINTS * 2];
+    int point_offsets[LINE_COUNT + 1], joins[LINE_COUNT], caps[LINE_COUNT], ranges[LINE_COUNT * 2];
+    float widths[LINE_COUNT];
+    int line = 0, point_start = 0, vertex_total = 0;
+    for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+        for (int style = 0; style < 9; style++, line++) {
+            int point_count = 2 + (line * 7) % (MAX_POINTS - 1);
+            point_offsets[line] = point_start;
+            joins[line] = style / 3;
+            caps[line] = style % 3;
+            widths[line] = 0.5f + line;
+            generate_polyline(shape, point_count, points + point_start * 2);
+            point_start += point_count;
+            vertex_total += get_solid_vertex_count(point_count, joins[line], caps[line]);
+        }
+    }
+    point_offsets[line] = point_start;
+    joins[line] = caps[line] = 0;
+    widths[line] = 1;
+    point_start += 1;
+    point_offsets[LINE_COUNT] = point_start;
+
+    struct Vertex *vertices = malloc(vertex_total * sizeof(struct Vertex));
+    uint32_t *indices = malloc(vertex_total * 3 * sizeof(uint32_t));
+    int index_total = build_solid_lines(points, LINE_COUNT, point_offsets, joins, caps, widths, vertices, indices,
+                                        INDEX_UINT32, ranges);
+    int failed = 0;
+    for (int i = 0; i < LINE_COUNT; i++) {
+        int point_count = point_offsets[i + 1] - point_offsets[i];
+        if (point_count < 2) {
+            failed += ranges[i * 2 + 1] != 0;
+            continue;
+        }
+        int ok = 1;
+        uint64_t alone = build_ranges(0, points + point_offsets[i] * 2, point_count, joins[i], caps[i], point_count,
+                                      INDEX_UINT32, &ok);
+        uint64_t batched = FNV_OFFSET;
+        for (int k = ranges[i * 2]; k < ranges[i * 2] + ranges[i * 2 + 1]; k++) {
+            struct Vertex vertex = vertices[indices[k]];
+            int style = vertex.part - vertex.part % BATCH_CAP_SHIFT;
+            if (style != caps[i] * BATCH_CAP_SHIFT + joins[i] * BATCH_JOIN_SHIFT || vertex.lengthsofar != widths[i]) {
+                ok = 0;
+            }
+            vertex.part -= style;
+            vertex.lengthsofar = 0;
+            batched = fnv1a(batched, &vertex, sizeof(vertex));
+        }
+        if (!ok || batched != alone) {
+            fprintf(stderr, "batch line %d differs from building it alone\n", i);
+            failed++;
+        }
+    }
+    if (index_total != ranges[(LINE_COUNT - 1) * 2]) {
+        fprintf(stderr, "batch index count %d does not match the ranges\n", index_total);
+        failed++;
+    }
+    free(vertices);
+    free(indices);
+    return failed;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// 排序后的三个顶点打包成一个键, 比较时不看三角形的绕序和先后
+static uint64_t triangle_key(uint32_t a, uint32_t b, uint32_t c) {
+    uint32_t t;
+    if (a > b) t = a, a = b, b = t;
+    if (b > c) t = b, b = c, c = t;
+    if (a > b) t = a, a = b, b = t;
+    return ((uint64_t)a << 42) | ((uint64_t)b << 21) | c;
+}
+
+/**
+ * Convert a triangle list to a strip in both index formats and check that the strip draws the same non-degenerate
+ * triangles, in any order and winding, within the capacity. Returns the strip length, -1 on failure.
+ */
+static int check_strip_of(const uint32_t *indices, int index_count, uint32_t vertex_count) {
+    int capacity = get_strip_index_capacity(index_count);
+    uint64_t *expected = malloc((index_count / 3 + 1) * sizeof(uint64_t));
+    uint64_t *actual = malloc((capacity + 1) * sizeof(uint64_t));
+    uint32_t *strip = malloc((capacity + 1) * sizeof(uint32_t));
+    int expected_count = 0;
+    for (int i = 0; i + 2 < index_count; i += 3) {
+        if (indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2]) {
+            expected[expected_count++] = triangle_key(indices[i], indices[i + 1], indices[i + 2]);
+        }
+    }
+    qsort(expected, expected_count, sizeof(uint64_t), compare_keys);
+
+    int length = -1;
+    for (int format = INDEX_UINT16; format <= INDEX_UINT32; format++) {
+        if (format == INDEX_UINT16 && vertex_count > 65536) {
+            continue;
+        }
+        size_t index_size = format == INDEX_UINT32 ? 4 : 2;
+        const void *input = indices;
+        unsigned short *narrow = NULL;
+        if (format == INDEX_UINT16) {
+            narrow = malloc((index_count + 1) * sizeof(unsigned short));
+            for (int i = 0; i < index_count; i++) {
+                narrow[i] = (unsigned short)indices[i];
+            }
+            input = narrow;
+        }
+        memset(strip, CANARY, (capacity + 1) * sizeof(uint32_t));
+        int strip_length = convert_to_strip((void *)input, index_count, format, strip);
+        free(narrow);
+        int ok = strip_length <= capacity && check_canary((unsigned char *)strip + capacity * index_size, index_size);
+        int actual_count = 0;
+        for (int k = 0; ok && k + 2 < strip_length; k++) {
+            uint32_t a, b, c;
+            if (format == INDEX_UINT32) {
+                a = strip[k], b = strip[k + 1], c = strip[k + 2];
+            } else {
+                const unsigned short *strip16 = (const unsigned short *)strip;
+                a = strip16[k], b = strip16[k + 1], c = strip16[k + 2];
+            }
+            if (a != b && b != c && a != c) {
+                actual[actual_count++] = triangle_key(a, b, c);
+            }
+        }
+        qsort(actual, actual_count, sizeof(uint64_t), compare_keys);
+        if (!ok || actual_count != expected_count || memcmp(actual, expected, expected_count * sizeof(uint64_t))) {
+            length = -1;
+            break;
+        }
+        length = strip_length;
+    }
+    free(expected);
+    free(actual);
+    free(strip);
+    return length;
+}
+
+/**
+ * Check strip conversion of every case and of a batch, and that strips of lines without round joins or caps take
+ * about a vertex per index, a third of the triangle list.
+ */
+static int check_strip(void) {
+    int failed = 0;
+    for (int dash = 0; dash < 2; dash++) {
+        for (int shape = 0; shape < SHAPE_COUNT; shape++) {
+            for (size_t s = 0; s < sizeof(SIZES) / sizeof(SIZES[0]); s++) {
+                int point_count = SIZES[s];
+                float *points = malloc((size_t)point_count * 2 * sizeof(float));
+                generate_polyline(shape, point_count, points);
+                for (int join = 0; join < 3; join++) {
+                    for (int cap = 0; cap < 3; cap++) {
+                        int vertex_count = dash ? get_dash_vertex_count(point_count, join, cap)
+                                                : get_solid_vertex_count(point_count, join, cap);
+                        int index_count = vertex_count * 3 - 6;
+                        struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+                        uint32_t *indices = malloc(index_count * sizeof(uint32_t));
+                        if (dash) {
+                            build_dash_line_range(points, point_count, 0, point_count - 1, join, cap, 0, -1,
+                                                  vertices, indices, INDEX_UINT32);
+                        } else {
+                            build_solid_line_range(points, point_count, 0, point_count - 1, join, cap, -1, vertices,
+                                                   indices, INDEX_UINT32);
+                        }
+                        int length = check_strip_of(indices, index_count, vertex_count);
+                        // 圆角和圆头是扇形, 在条带里每个三角形要多几个索引
+                        int compact = join != 1 && cap != 0 && length <= vertex_count + 2;
+                        if (length < 0 || (join != 1 && cap != 0 && !compact)) {
+                            fprintf(stderr, "%s-%s-%d-%s-%s: strip %s\n", dash ? "dash" : "solid",
+                                    SHAPE_NAMES[shape], point_count, JOIN_NAMES[join], CAP_NAMES[cap],
+                                    length < 0 ? "draws other triangles" : "longer than the vertex count");
+                            failed++;
+                        }
+                        free(vertices);
+                        free(indices);
+                    }
+                }
+                free(points);
+            }
+        }
+    }
+
+    // 两条线之间靠退化三角形接上
+    int point_offsets[3] = {0, 10, 20}, joins[2] = {0, 1}, caps[2] = {1, 0}, ranges[4];
+    float widths[2] = {1, 2}, points[40];
+    generate_polyline(SHAPE_ZIGZAG, 10, points);
+    generate_polyline(SHAPE_RANDOM, 10, points + 20);
+    int vertex_count = get_solid_vertex_count(10, 0, 1) + get_solid_vertex_count(10, 1, 0);
+    struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+    uint32_t *indices = malloc(vertex_count * 3 * sizeof(uint32_t));
+    int index_count = build_solid_lines(points, 2, point_offsets, joins, caps, widths, vertices, indices,
+                                        INDEX_UINT32, ranges);
+    if (check_strip_of(indices, index_count, vertex_count) < 0) {
+        fprintf(stderr, "batch strip draws other triangles\n");
+        failed++;
+    }
+    free(vertices);
+    free(indices);
+    return failed;
+}
+
+/**
+ * Write layers of several lines as line geometry and check every chunk holds the range build of its segments, with
+ * 16-bit chunks split under 65536 vertices and the data aligned for typed array views.
+ */
+static int check_geometry(void) {
+    int failed = 0;
+    static const int POINT_COUNTS[] = {2, 257, 1, 10000, 40};
+    const int line_count = 5;
+    int offsets[6] = {0};
+    for (int i = 0; i < line_count; i++) {
+        offsets[i + 1] = offsets[i] + POINT_COUNTS[i];
+    }
+    float *points = malloc(offsets[line_count] * 2 * sizeof(float));
+    for (int i = 0; i < line_count; i++) {
+        generate_polyline(i % SHAPE_COUNT, POINT_COUNTS[i], points + offsets[i] * 2);
+    }
+    for (int dash = 0; dash < 2; dash++) {
+        for (int index_format = INDEX_UINT16; index_format <= INDEX_UINT32; index_format++) {
+            for (int join = 0; join < 3; join++) {
+                struct LineGeometryOptions options = {dash, join, 2 - join, 8, index_format, join == 2 ? 100 : 0};
+                char key[64];
+                snprintf(key, sizeof(key), "geometry-%s-%d-%s", dash ? "dash" : "solid",
+                         index_format == INDEX_UINT32 ? 32 : 16, JOIN_NAMES[join]);
+                FILE *file = tmpfile();
+                int chunk_count = write_line_geometry(file, points, offsets, line_count, &options);
+                long size = ftell(file);
+                unsigned char *bytes = malloc(size);
+                rewind(file);
+                int ok = chunk_count > 0 && fread(bytes, 1, size, file) == (size_t)size;
+                fclose(file);
+                const struct LineGeometryHeader *header = (const struct LineGeometryHeader *)bytes;
+                ok = ok && memcmp(header->magic, LINE_GEOMETRY_MAGIC, 4) == 0 &&
+                     header->version == LINE_GEOMETRY_VERSION && header->chunk_count == (unsigned int)chunk_count &&
+                     header->flags == (dash ? LINE_GEOMETRY_DASH : 0u) && header->join == join &&
+                     header->index_format == index_format;
+                const struct LineGeometryChunk *chunks =
+                    (const struct LineGeometryChunk *)(bytes + LINE_GEOMETRY_HEADER_SIZE);
+                int index_size = index_format == INDEX_UINT32 ? 4 : 2;
+                int line = -1;
+                int first = 0;
+                float lengthsofar = 0;
+                for (int i = 0; i < chunk_count && ok; i++) {
+                    const struct LineGeometryChunk *chunk = &chunks[i];
+                    if ((int)chunk->line != line) {
+                        // 上一条线的块要正好拼满它的所有线段
+                        ok = line < 0 || first == POINT_COUNTS[line] - 1;
+                        line = chunk->line;
+                        first = 0;
+                        lengthsofar = 0;
+                    }
+                    int point_count = POINT_COUNTS[line];
+                    const float *line_points = points + offsets[line] * 2;
+                    // 块的段数不知道, 从 1 段起找顶点数相同的范围
+                    int last = first + 1;
+                    int vertex_count = 0;
+                    while (ok && last <= point_count - 1) {
+                        vertex_count = dash ? get_dash_range_vertex_count(point_count, first, last, join, 2 - join)
+                                            : get_solid_range_vertex_count(point_count, first, last, join, 2 - join);
+                        if (vertex_count >= (int)chunk->vertex_count) {
+                            break;
+                        }
+                        last++;
+                    }
+                    ok = ok && vertex_count == (int)chunk->vertex_count &&
+                         chunk->index_count == chunk->vertex_count * 3 - 6 && chunk->vertex_offset % 4 == 0 && chunk->index_offset % 4 == 0 &&
+                         chunk->index_offset + chunk->index_count * index_size <= (unsigned int)size &&
+                         (index_format == INDEX_UINT32 || vertex_count <= 65536) &&
+                         (options.chunk_segments == 0 || last - first <= options.chunk_segments);
+                    if (!ok) {
+                        break;
+                    }
+                    struct Vertex *vertices = malloc(vertex_count * sizeof(struct Vertex));
+                    void *indices = malloc((size_t)chunk->index_count * index_size);
+                    if (dash) {
+                        lengthsofar = build_dash_line_range((float *)line_points, point_count, first, last, join,
+                                                            2 - join, lengthsofar, -1, vertices, indices, index_format);
+                    } else {
+                        build_solid_line_range((float *)line_points, point_count, first, last, join, 2 - join, -1,
+                                               vertices, indices, index_format);
+                    }
+                    float bounds[6];
+                    get_vertex_bounds(vertices, vertex_count, bounds);
+                    ok = memcmp(bytes + chunk->vertex_offset, vertices, vertex_count * sizeof(struct Vertex)) == 0 &&
+                         memcmp(bytes + chunk->index_offset, indices, (size_t)chunk->index_count * index_size) == 0 &&
+                         memcmp(chunk->bounds, bounds, sizeof(bounds)) == 0 &&
+                         chunk->lengthsofar == (dash ? lengthsofar : 0);
+                    free(vertices);
+                    free(indices);
+                    first = last;
+                }
+                // 只有 1 个点的线没有块
+                if (!ok || line != line_count - 1 || first != POINT_COUNTS[line] - 1) {
+                    fprintf(stderr, "%s: chunks differ from the range builds\n", key);
+                    failed++;
+                }
+                free(bytes);
+            }
+        }
+    }
+    set_round_segments(ROUND_SEGMENTS_DEFAULT);
+    free(points);
+    return failed;
+}
+
+static int write_golden(const char *path, const struct Case *cases, int count) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s %d %d %016llx %016llx\n", cases[i].key, cases[i].vertex_count, cases[i].index_count,
+                (unsigned long long)cases[i].vertex_hash, (unsigned long long)cases[i].index_hash);
+    }
+    fclose(file);
+    printf("wrote %d cases to %s\n", count, path);
+    return 0;
+}
+
+static int compare_golden(const char *path, const struct Case *cases, int count) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    char key[96];
+    int vertex_count, index_count;
+    unsigned long long vertex_hash, index_hash;
+    int matched = 0, failed = 0;
+    while (fscanf(file, "%95s %d %d %llx %llx", key, &vertex_count, &index_count, &vertex_hash, &index_hash) == 5) {
+        const struct Case *found = NULL;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(cases[i].key, key) == 0) {
+                found = &cases[i];
+                break;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "%s: missing from this build\n", key);
+            failed++;
+            continue;
+        }
+        matched++;
+        if (found->vertex_count != vertex_count || found->index_count != index_count ||
+            found->vertex_hash != vertex_hash || found->index_hash != index_hash) {
+            fprintf(stderr, "%s: output differs from golden (vertices %d/%d, indices %d/%d)\n", key,
+                    found->vertex_count, vertex_count, found->index_count, index_count);
+            failed++;
+        }
+    }
+    fclose(file);
+    if (matched != count) {
+        fprintf(stderr, "golden file covers %d of %d cases\n", matched, count);
+        failed++;
+    }
+    printf("%d cases, %d failed\n", count, failed);
+    return failed ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = "golden.txt";
+    int update = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--update") == 0) {
+            update = 1;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    static struct Case cases[MAX_CASES];
+    int count = collect(cases);
+    if (count < 0) {
+        fprintf(stderr, "%d cases failed sanity checks\n", -count);
+        return 1;
+    }
+    int range_failures = check_ranges();
+    if (range_failures) {
+        fprintf(stderr, "%d range builds differ from the full build\n", range_failures);
+        return 1;
+    }
+    int append_failures = check_append();
+    if (append_failures) {
+        fprintf(stderr, "%d appended builds differ from the full build\n", append_failures);
+        return 1;
+    }
+#ifdef LINE_SIMD
+    int simd_failures = check_simd();
+    if (simd_failures) {
+        fprintf(stderr, "%d SIMD builds differ from the scalar build\n", simd_failures);
+        return 1;
+    }
+#endif
+    int specialized_failures = check_specialized();
+    if (specialized_failures) {
+        fprintf(stderr, "%d specialized builds differ from the generic build\n", specialized_failures);
+        return 1;
+    }
+    int parallel_failures = check_parallel();
+    if (parallel_failures) {
+        fprintf(stderr, "%d parallel builds differ from the single-threaded build\n", parallel_failures);
+        return 1;
+    }
+    int pack_failures = check_pack();
+    if (pack_failures) {
+        fprintf(stderr, "%d packed builds do not decode\n", pack_failures);
+        return 1;
+    }
+    int bounds_failures = check_bounds();
+    if (bounds_failures) {
+        fprintf(stderr, "%d builds exceed their bounds\n", bounds_failures);
+        return 1;
+    }
+    if (check_profile()) {
+        return 1;
+    }
+    int round_failures = check_round();
+    if (round_failures) {
+        fprintf(stderr, "%d round joins or caps are not round\n", round_failures);
+        return 1;
+    }
+    int index_failures = check_index();
+    if (index_failures) {
+        fprintf(stderr, "%d segment indices answer wrongly\n", index_failures);
+        return 1;
+    }
+    int simplify_failures = check_simplify();
+    if (simplify_failures) {
+        fprintf(stderr, "%d simplified lines are out of tolerance\n", simplify_failures);
+        return 1;
+    }
+    int curve_failures = check_curve();
+    if (curve_failures) {
+        fprintf(stderr, "%d flattened curves are out of tolerance\n", curve_failures);
+        return 1;
+    }
+    if (check_batch()) {
+        return 1;
+    }
+    int strip_failures = check_strip();
+    if (strip_failures) {
+        fprintf(stderr, "%d triangle strips differ from their triangle lists\n", strip_failures);
+        return 1;
+    }
+    int geometry_failures = check_geometry();
+    if (geometry_failures) {
+        fprintf(stderr, "%d line geometry files differ from their builds\n", geometry_failures);
+        return 1;
+    }
+    return update ? write_golden(path, cases, count) : compare_golden(path, cases, count);
+}
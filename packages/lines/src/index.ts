@@ -1,3 +1,12 @@
 export * from "./line/constants";
 export { DashLine } from "./line/DashLine";
 export { Line } from "./line/Line";
+export { LineBatch } from "./line/LineBatch";
+export { LineCache } from "./line/LineCache";
+export { LineGeometry } from "./line/LineGeometry";
+export { LineProfiler } from "./line/LineProfiler";
+export { LineScheduler } from "./line/LineScheduler";
+export type { LineBatchItem } from "./line/LineBatch";
+export type { LineGeometryChunk, LineGeometryHeader } from "./line/LineGeometry";
+export type { LineProfilerFrame } from "./line/LineProfiler";
+export type { LineSegmentHit } from "./line/vertexBuilder";
@@ -1,54 +1,144 @@
-import { Color, Vector2, Texture2D } from "@galacean/engine";
-import { DashMaterial } from "./material/DashMaterial";
+import { IndexFormat, ShaderData, Vector2, Vector3 } from "@galacean/engine";
+import { LineCap, LineJoin } from "./constants";
 import { Line } from "./Line";
-import { LineVertexBuilder } from "./vertexBuilder";
+import { LineDashAtlas, LineDashPattern } from "./LineDashAtlas";
+import { LineAppendResult, LineBuilderResult, LineVertexBuilder } from "./vertexBuilder";
 
 /**
  * Dash Line.
  */
 export class DashLine extends Line {
-  protected override _material: DashMaterial = null;
-  private _dash: Vector2;
+  protected override _dashed = true;
+  private _dash: Vector2 = null;
+  private _pattern: number[] = null;
+  private _dashOffset = 0;
+  private _dashPattern: LineDashPattern = null;
+  private _dashUniform = new Vector3();
 
   /**
-   * The dash sequence is a series of on/off lengths in points. e.g. [3, 1] would be 3pt long lines separated by 1pt spaces.
+   * The dash sequence as one on/off pair in points, e.g. (3, 1) would be 3pt long lines separated by 1pt spaces.
+   * @remarks Sets `pattern` to [x, y]. For a longer `pattern` this is its first pair.
    */
   get dash(): Vector2 {
     return this._dash;
   }
 
-  set dash(val: Vector2) {
-    this._dash = val;
-    this._renderer?.shaderData.setVector2("u_dash", val);
-    const texture = new Texture2D(this.engine, 1, Math.ceil((val.x + val.y) * 10));
-    texture.setPixelBuffer(this._generateDashTexture(val));
-    this._renderer?.shaderData.setTexture("u_texture", texture);
+  set dash(value: Vector2) {
+    this.pattern = value && [value.x, value.y];
+  }
+
+  /**
+   * The dash sequence as a series of on/off lengths in points, e.g. [4, 1, 1, 1] would be a dash-dot line. An odd
+   * number of lengths is repeated to an even one.
+   * @remarks Patterns are stored once per engine and shared by every line using them, along with one material.
+   */
+  get pattern(): number[] {
+    return this._pattern;
+  }
+
+  set pattern(value: number[]) {
+    const dash = value && LineDashAtlas.normalize(value);
+    if (value && !dash) {
+      console.warn(`DashLine: invalid dash pattern [${value}], it needs non-negative lengths with a positive sum.`);
+      return;
+    }
+    this._pattern = value && value.slice();
+    this._dash = dash && new Vector2(dash[0], dash[1]);
+    const atlas = LineDashAtlas.get(this.engine);
+    const lastPattern = this._dashPattern;
+    this._dashPattern = dash && atlas.acquire(dash);
+    lastPattern && atlas.release(lastPattern);
+    this._updateDashUniform();
+  }
+
+  /**
+   * The distance into the dash pattern the line starts at.
+   */
+  get dashOffset(): number {
+    return this._dashOffset;
+  }
+
+  set dashOffset(value: number) {
+    this._dashOffset = value;
+    this._updateDashUniform();
   }
 
   constructor(entity) {
     super(entity);
   }
 
-  protected override async _generateData() {
-    return await LineVertexBuilder.instance.dashLine(this._flattenPoints, this._join, this._cap, 0, -1);
+  protected override _generateData(
+    first: number,
+    last: number,
+    indexFormat: IndexFormat,
+    lengthsofar: number
+  ): LineBuilderResult {
+    return LineVertexBuilder.instance.buildDashLine(
+      this._renderPoints,
+      this._join,
+      this._cap,
+      lengthsofar,
+      -1,
+      indexFormat,
+      first,
+      last
+    );
+  }
+
+  protected override _generateAppendData(
+    oldPointCount: number,
+    indexFormat: IndexFormat,
+    lengthsofar: number
+  ): LineAppendResult {
+    return LineVertexBuilder.instance.appendDashLine(
+      this._renderPoints,
+      oldPointCount,
+      this._join,
+      this._cap,
+      lengthsofar,
+      indexFormat
+    );
+  }
+
+  protected override _getMaxChunkSegmentCount(): number {
+    const { _join: join, _roundSegments: roundSegments } = this;
+    const joinCount = join === LineJoin.Bevel ? 2 : join === LineJoin.Round ? roundSegments + 1 : 1;
+    const capCount = this._cap === LineCap.Round ? roundSegments - 1 : 2;
+    // Bevel segments after the first one start with an extra join vertex.
+    const segmentCount = 4 + joinCount + (join === LineJoin.Bevel ? 1 : 0);
+    return Math.floor((Line._maxUInt16VertexCount - capCount * 2 - 2 - joinCount) / segmentCount);
   }
 
   protected override _initMaterial() {
-    const material = new DashMaterial(this.engine);
-    this._renderer.setMaterial(material);
-    this._material = material;
-  }
-
-  private _generateDashTexture(dash) {
-    const pixels: number[] = [];
-    const length = Math.ceil((dash.x + dash.y) * 10);
-    for (let index = 0; index < length; index++) {
-      if (index < dash.x * 10) {
-        pixels.push(255, 255, 255, 255);
-      } else {
-        pixels.push(255, 255, 255, 0);
-      }
+    const atlas = LineDashAtlas.get(this.engine);
+    this._material = this.instanced ? atlas.instancedMaterial : atlas.material;
+  }
+
+  protected override _destroyMaterial() {
+    // The atlas owns the materials, shared by the engine's dashed lines.
+    this._material = null;
+  }
+
+  protected override _initShaderData(shaderData: ShaderData) {
+    super._initShaderData(shaderData);
+    shaderData.setVector3("u_dashPattern", this._dashUniform);
+  }
+
+  /**
+   * @internal
+   */
+  override onDestroy(): void {
+    super.onDestroy();
+    if (this._dashPattern) {
+      LineDashAtlas.get(this.engine).release(this._dashPattern);
+      this._dashPattern = null;
     }
-    return new Uint8Array(pixels);
+  }
+
+  private _updateDashUniform() {
+    const pattern = this._dashPattern;
+    // Without a pattern the line is drawn solid from row 0.
+    this._dashUniform.set(pattern ? pattern.period : 1, this._dashOffset, pattern ? pattern.row : 0);
+    this._forEachShaderData((shaderData) => shaderData.setVector3("u_dashPattern", this._dashUniform));
   }
 }
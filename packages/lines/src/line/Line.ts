@@ -1,49 +1,115 @@
 import {
-  Buffer,
-  BufferBindFlag,
-  BufferMesh,
-  BufferUsage,
+  BoundingBox,
+  BoundingFrustum,
+  Camera,
   Color,
+  GLCapabilityType,
   IndexFormat,
+  MathUtil,
+  Matrix,
   MeshRenderer,
   Script,
+  ShaderData,
   Vector2,
-  VertexElement,
-  VertexElementFormat
+  Vector3,
+  Vector4
 } from "@galacean/engine";
 import { LineMaterial } from "./material/LineMaterial";
-import { LineCap, LineJoin } from "./constants";
-import { LineVertexBuilder } from "./vertexBuilder";
+import { LineInstancedMaterial } from "./material/LineInstancedMaterial";
+import { LineCap, LineCurveType, LineJoin } from "./constants";
+import { LineCache, LineCacheEntry } from "./LineCache";
+import { LineGeometry, LineGeometryChunk } from "./LineGeometry";
+import { LineInstancedMesh } from "./LineInstancedMesh";
+import { LineMesh } from "./LineMesh";
+import { LineProfiler } from "./LineProfiler";
+import { LineScheduler } from "./LineScheduler";
+import {
+  LineAppendResult,
+  LineBuilderResult,
+  LineSegmentHit,
+  LineSegmentIndex,
+  LineVertexBuilder
+} from "./vertexBuilder";
+import { ILineWorkerChunk } from "./vertexBuilder/LineWorker";
+import { LineWorkerPool } from "./vertexBuilder/LineWorkerPool";
 
 /**
  * Solid Line.
  */
 export class Line extends Script {
+  /** The vertex count a chunk must stay under when only 16-bit indices are available. */
+  protected static _maxUInt16VertexCount = 65536;
+
   protected _points: Vector2[] = [];
   protected _cap = LineCap.Butt;
   protected _join = LineJoin.Miter;
   protected _renderer: MeshRenderer;
   protected _material: LineMaterial;
+  /** Whether the line is tessellated with the dash builder, on workers. */
+  protected _dashed = false;
+  /** The segments per half circle of round joins and caps the line is built with. */
+  protected _roundSegments = LineVertexBuilder.defaultRoundSegments;
   protected _flattenPoints: number[] = [];
+  /** The points tessellated by the last build, `_flattenPoints` or its simplification. */
+  protected _renderPoints: number[] = [];
   private _width: number = 0.1;
   private _color: Color = new Color(0, 0, 0, 1);
-  private _mesh: BufferMesh;
+  private _renderers: MeshRenderer[] = [];
+  private _meshes: LineMesh[] = [];
+  private _instancedMesh: LineInstancedMesh = null;
+  private _supportUint32Index = false;
+  private _compactVertices = false;
+  private _triangleStrip = false;
+  private _instanced = false;
+  private _cached = false;
+  /** The cache entry whose meshes the line draws, null if the meshes are its own. */
+  private _cacheEntry: LineCacheEntry = null;
   private _needUpdate = false;
+  private _appendPending = false;
+  /** Point count of the single chunk appends can continue, 0 if the line has to be rebuilt. */
+  private _builtPointCount = 0;
+  private _builtLengthsofar = 0;
+  /** Control points of the curve the points are flattened from, null if the points were set directly. */
+  private _curve: number[] = null;
+  private _curveType = LineCurveType.CubicBezier;
+  private _curveTolerance = 0.25;
+  /** The flattening tolerance in local units, snapped like the level of detail. */
+  private _curveThreshold = 0;
+  private _curveFlattened = false;
+  /** Whether the chunks were loaded by `loadGeometry`, the line has no points to build then. */
+  private _geometry = false;
+  private _simplifyTolerance = 0;
+  private _simplifyCamera: Camera = null;
+  /** Douglas-Peucker importance of `_flattenPoints`, null until the next simplified build needs it. */
+  private _importance: Float32Array = null;
+  private _lodThreshold = 0;
+  private _chunkSegmentCount = 0;
+  /** Segment index of `_flattenPoints` for picking, built by the first query after the points change. */
+  private _segmentIndex: LineSegmentIndex = null;
+  private _useWorker = false;
+  /** Incremented by every render, a render that resumes with an older generation was superseded and is dropped. */
+  private _generation = 0;
+  /** Generation of the build running on a worker, 0 if there is none. */
+  private _workerGeneration = 0;
 
   /**
-   * The points that make up the line.
+   * The points that make up the line, empty for a line set from a curve.
    */
   get points(): Vector2[] {
     return this._points;
   }
 
   set points(value: Vector2[]) {
+    const flattenPoints: number[] = [];
+    for (let i = 0, n = value.length; i < n; i++) {
+      flattenPoints.push(value[i].x, value[i].y);
+    }
     this._points = value;
-    this._flattenPoints = this._points
-      .map((point) => {
-        return [point.x, point.y];
-      })
-      .flat();
+    this._flattenPoints = flattenPoints;
+    this._curve = null;
+    this._geometry = false;
+    this._importance = null;
+    this._destroySegmentIndex();
     this._needUpdate = true;
   }
 
@@ -57,8 +123,11 @@ export class Line extends Script {
   set cap(value: LineCap) {
     if (value !== this._cap) {
       this._cap = value;
-      this._renderer?.shaderData.setInt("u_cap", value);
-      this._needUpdate = true;
+      this._forEachShaderData((shaderData) => shaderData.setInt("u_cap", value));
+      // The instanced shader applies it from the uniform alone.
+      if (!this._instanced) {
+        this._needUpdate = true;
+      }
     }
   }
 
@@ -72,8 +141,10 @@ export class Line extends Script {
   set join(value: LineJoin) {
     if (value !== this._join) {
       this._join = value;
-      this._renderer?.shaderData.setInt("u_join", value);
-      this._needUpdate = true;
+      this._forEachShaderData((shaderData) => shaderData.setInt("u_join", value));
+      if (!this._instanced) {
+        this._needUpdate = true;
+      }
     }
   }
 
@@ -86,7 +157,14 @@ export class Line extends Script {
 
   set width(value) {
     this._width = value;
-    this._renderer.shaderData.setFloat("u_width", value);
+    this._forEachShaderData((shaderData) => shaderData.setFloat("u_width", value));
+    // Cached meshes are shared with lines of the same width, look up the ones built for this width instead.
+    if (this._cacheEntry) {
+      this._needUpdate = true;
+    } else {
+      this._meshes.forEach((mesh) => mesh.updateBounds(value));
+    }
+    this._instancedMesh?.updateBounds(value);
   }
 
   /**
@@ -98,98 +176,999 @@ export class Line extends Script {
 
   set color(value: Color) {
     this._color = value;
-    this._renderer.shaderData.setColor("u_color", value);
+    this._forEachShaderData((shaderData) => shaderData.setColor("u_color", value));
+  }
+
+  /**
+   * Whether to upload the line in a compact 12 byte vertex layout instead of 24 bytes.
+   * @remarks Halves the vertex memory and upload bandwidth, with positions quantized to 16 bits over the bounds of
+   * each chunk. Appending points rebuilds the line in this mode.
+   */
+  get compactVertices(): boolean {
+    return this._compactVertices;
+  }
+
+  set compactVertices(value: boolean) {
+    if (value !== this._compactVertices) {
+      this._compactVertices = value;
+      this._forEachShaderData((shaderData) => this._setCompactMacro(shaderData));
+      this._replaceMeshes();
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * Whether to draw the line as a triangle strip instead of a triangle list.
+   * @remarks A strip takes about one index per vertex instead of three, cutting index memory and upload by about
+   * 3x for miter and bevel joins and by less around round joins and caps. Appending points rebuilds the line in
+   * this mode.
+   */
+  get triangleStrip(): boolean {
+    return this._triangleStrip;
+  }
+
+  set triangleStrip(value: boolean) {
+    if (value !== this._triangleStrip) {
+      this._triangleStrip = value;
+      this._replaceMeshes();
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * Whether to expand the line on the GPU, drawing one instance per segment instead of tessellating it on the CPU.
+   * @remarks Only the points are uploaded, 12 bytes each, and changing join, cap or width needs no rebuild.
+   * `compactVertices` does not apply in this mode.
+   */
+  get instanced(): boolean {
+    return this._instanced;
+  }
+
+  set instanced(value: boolean) {
+    if (value !== this._instanced) {
+      this._instanced = value;
+      if (this._renderers.length) {
+        this._removeChunks(0);
+        this._destroyMaterial();
+        this._initMaterial();
+        this._addChunk();
+        this._renderer = this._renderers[0];
+      }
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * Whether to share the tessellated meshes with other lines of the same points and style through `LineCache`.
+   * @remarks Lines with the same points, join, cap, width and vertex layout draw the same meshes, so rebuilding a
+   * repeated line costs a hash of its points. Color and dash pattern stay per line. Appending points and changing the
+   * width rebuild the line in this mode.
+   */
+  get cached(): boolean {
+    return this._cached;
+  }
+
+  set cached(value: boolean) {
+    if (value !== this._cached) {
+      this._cached = value;
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * The max distance in pixels between a curve set with `setCurve` and the line it is flattened to.
+   * @remarks Like `simplifyTolerance` it is measured in `simplifyCamera` and snapped to power of two levels, the
+   * curve is flattened again when zooming crosses one. Without `simplifyCamera` the tolerance is in local units.
+   */
+  get curveTolerance(): number {
+    return this._curveTolerance;
+  }
+
+  set curveTolerance(value: number) {
+    if (value !== this._curveTolerance) {
+      this._curveTolerance = value;
+      this._curveFlattened = false;
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * The max distance in pixels the line may be simplified by before tessellation, 0 to disable.
+   * @remarks The line is simplified at power of two levels of detail from an importance computed once per point set,
+   * so zooming only rebuilds when it crosses a level. Without `simplifyCamera` the tolerance is in local units.
+   * Appending points rebuilds the line while simplifying.
+   */
+  get simplifyTolerance(): number {
+    return this._simplifyTolerance;
+  }
+
+  set simplifyTolerance(value: number) {
+    if (value !== this._simplifyTolerance) {
+      this._simplifyTolerance = value;
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * The camera `simplifyTolerance` is measured in, its pixel size at the line is tracked every frame.
+   * @remarks Round joins and caps are also built with as many segments as their size in this camera needs, without
+   * it they use `LineVertexBuilder.defaultRoundSegments`.
+   */
+  get simplifyCamera(): Camera {
+    return this._simplifyCamera;
+  }
+
+  set simplifyCamera(value: Camera) {
+    if (value !== this._simplifyCamera) {
+      this._simplifyCamera = value;
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * The max number of segments in one chunk, 0 for no limit.
+   * @remarks Each chunk is a renderer with its own bounds, culled against the camera frustum on its own, so long
+   * lines only draw the chunks in view. Appending points to a line of several chunks rebuilds it.
+   */
+  get chunkSegmentCount(): number {
+    return this._chunkSegmentCount;
+  }
+
+  set chunkSegmentCount(value: number) {
+    if (value !== this._chunkSegmentCount) {
+      this._chunkSegmentCount = value;
+      this._needUpdate = true;
+    }
+  }
+
+  /**
+   * Whether to tessellate on a pool of Web Workers instead of the main thread.
+   * @remarks Builds of a line that are superseded before they finish are dropped, so only the latest points reach
+   * the GPU. Appending points stays on the main thread, it only tessellates the new segments.
+   */
+  get useWorker(): boolean {
+    return this._useWorker;
+  }
+
+  set useWorker(value: boolean) {
+    this._useWorker = value;
   }
 
   constructor(entity) {
     super(entity);
   }
 
+  /**
+   * Set the line from curve control points instead of `points`.
+   * @remarks The curve is flattened in wasm adaptively, finer where it bends and within `curveTolerance` of it,
+   * without building a `Vector2` per point. The flattened points are only available after the next build.
+   * @param controls The control points, flattened as x, y pairs, read at every flattening so keep them unchanged
+   * @param type How the control points describe the curve
+   */
+  setCurve(controls: number[], type: LineCurveType): void {
+    this._curve = controls;
+    this._curveType = type;
+    this._curveFlattened = false;
+    this._geometry = false;
+    this._points = [];
+    this._importance = null;
+    this._destroySegmentIndex();
+    this._needUpdate = true;
+  }
+
+  /**
+   * Append points to the end of the line.
+   * @remarks Unlike setting `points`, only the old end and the new segments are tessellated and uploaded, so the
+   * cost depends on the number of appended points rather than the length of the line.
+   * @param points The points to append
+   */
+  appendPoints(points: Vector2[]): void {
+    if (this._curve) {
+      console.warn("Line: points can not be appended to a curve, set the curve again instead.");
+      return;
+    }
+    if (this._geometry) {
+      console.warn("Line: points can not be appended to loaded geometry, set the points instead.");
+      return;
+    }
+    const { _points: linePoints, _flattenPoints: flattenPoints } = this;
+    for (let i = 0, n = points.length; i < n; i++) {
+      const point = points[i];
+      linePoints.push(point);
+      flattenPoints.push(point.x, point.y);
+    }
+    this._importance = null;
+    this._destroySegmentIndex();
+    this._appendPending = true;
+  }
+
+  /**
+   * Load the line from a geometry file written by the native `tessellate` tool, instead of tessellating points.
+   * @remarks The header and chunk table are read with the first byte range request, then the chunks are fetched
+   * by range, those in view of `LineScheduler.camera` first, and uploaded straight from the fetched bytes. Servers
+   * without range requests stream the file, chunks are uploaded as soon as their bytes are in. The line takes the
+   * join and cap of the file, a dashed file has to be loaded into a `DashLine`. The line has no points for `pick`
+   * and `querySegments`, setting points or a curve tessellates them again. Load again after turning on `instanced`,
+   * `compactVertices` or `triangleStrip`, the file holds triangle lists of the full vertex layout.
+   * @param url The file
+   * @returns Resolves once every chunk is uploaded or another load, points or curve replaced the geometry, rejects
+   * when the file does not fit the line or the device, e.g. 32-bit indices without `OES_element_index_uint`
+   */
+  async loadGeometry(url: string): Promise<void> {
+    if (this._instanced || this._compactVertices || this._triangleStrip) {
+      console.warn("Line: geometry can not be loaded with instanced, compactVertices or triangleStrip on.");
+      return;
+    }
+    const generation = ++this._generation;
+    this._geometry = true;
+    this._points = [];
+    this._flattenPoints = [];
+    this._renderPoints = [];
+    this._curve = null;
+    this._importance = null;
+    this._builtPointCount = 0;
+    this._destroySegmentIndex();
+    LineScheduler.get(this.engine).unschedule(this);
+    const current = () => this._geometry && generation === this._generation && !this.destroyed;
+    let chunks: LineGeometryChunk[] = null;
+    let indexFormat: IndexFormat;
+    await LineGeometry.load(
+      url,
+      (header) => {
+        if (!current()) {
+          return [];
+        }
+        if (header.dash !== this._dashed) {
+          const component = header.dash ? "DashLine" : "Line";
+          throw new Error(`Line: the dash of ${url} does not match the line, load it into a ${component}.`);
+        }
+        if (header.indexFormat === IndexFormat.UInt32 && !this._supportUint32Index) {
+          throw new Error(`Line: ${url} has 32-bit indices, which the device does not support.`);
+        }
+        chunks = header.chunks;
+        indexFormat = header.indexFormat;
+        this.join = header.join;
+        this.cap = header.cap;
+        this._prepareGeometryChunks(chunks.length);
+        return this._prioritizeGeometry(chunks);
+      },
+      (index, vertices, indices) => {
+        if (!current()) {
+          return false;
+        }
+        this._uploadChunk(index, vertices, indices, indexFormat, chunks[index].bounds.slice(), null);
+        return true;
+      }
+    );
+  }
+
+  /**
+   * Find the segment nearest to a point within the line width, on the CPU.
+   * @remarks Queries go through a bounding volume hierarchy over the segments, built on the first query after the
+   * points change, so hover and snap can run every frame on long lines.
+   * @param point The point, in the local space of the entity
+   * @param tolerance The distance beyond the line width that still hits
+   * @returns The hit segment, null if the point misses the line or the builder is not loaded yet
+   */
+  pick(point: Vector2, tolerance: number = 0): LineSegmentHit | null {
+    const index = this._getSegmentIndex();
+    if (!index) {
+      return null;
+    }
+    return LineVertexBuilder.instance.nearestSegment(index, point.x, point.y, this._width + tolerance);
+  }
+
+  /**
+   * Find the segments whose bounds intersect a rectangle, on the CPU.
+   * @param min The min corner of the rectangle, in the local space of the entity
+   * @param max The max corner of the rectangle
+   * @returns The segments in line order, segment i runs from point i to point i + 1
+   */
+  querySegments(min: Vector2, max: Vector2): Int32Array {
+    const index = this._getSegmentIndex();
+    if (!index) {
+      return new Int32Array(0);
+    }
+    return LineVertexBuilder.instance.segmentsInRect(index, min.x, min.y, max.x, max.y);
+  }
+
   /**
    * @internal
    */
   override onAwake(): void {
-    this._renderer = this.entity.addComponent(MeshRenderer);
-    this.color = this._color;
-    this.join = this._join;
-    this.cap = this._cap;
-    this.width = this._width;
+    // @ts-ignore
+    this._supportUint32Index = this.engine._hardwareRenderer.canIUse(GLCapabilityType.elementIndexUint);
     this._initMaterial();
-
-    this._mesh = new BufferMesh(this.engine, "LineGeometry");
-    // Add vertexElement
-    this._mesh.setVertexElements([
-      new VertexElement("a_pos", 0, VertexElementFormat.Vector2, 0),
-      new VertexElement("a_normal", 8, VertexElementFormat.Vector2, 0),
-      new VertexElement("a_data", 16, VertexElementFormat.Short2, 0),
-      new VertexElement("a_lengthsofar", 20, VertexElementFormat.Float, 0)
-    ]);
-
-    this._renderer.mesh = this._mesh;
+    this._addChunk();
+    this._renderer = this._renderers[0];
   }
 
   /**
    * @internal
    */
   override onUpdate(): void {
-    if (this._needUpdate) {
-      this._render();
-      this._needUpdate = false;
+    if (this._curve && this._getCurveThreshold() !== this._curveThreshold) {
+      this._curveFlattened = false;
+      this._needUpdate = true;
+    }
+    if (this._simplifyTolerance > 0) {
+      const threshold = this._getLodThreshold();
+      if (threshold !== this._lodThreshold) {
+        this._lodThreshold = threshold;
+        this._needUpdate = true;
+      }
+    }
+    if (!this._instanced && (this._join === LineJoin.Round || this._cap === LineCap.Round)) {
+      const roundSegments = this._getRoundSegments();
+      if (roundSegments !== this._roundSegments) {
+        this._roundSegments = roundSegments;
+        this._needUpdate = true;
+      }
+    }
+    if (this._needUpdate || this._appendPending) {
+      LineScheduler.get(this.engine).schedule(this);
     }
   }
 
+  /**
+   * @internal
+   */
+  override onLateUpdate(): void {
+    const { frameCount } = this.engine.time;
+    LineScheduler.get(this.engine).flush(frameCount);
+    // The first line of the frame closes it, after the rebuilds, see LineProfiler.
+    LineProfiler.instance.endFrame(frameCount);
+  }
+
   /**
    * @internal
    */
   override onEnable(): void {
-    this._renderer.enabled = true;
+    this._renderers.forEach((renderer) => (renderer.enabled = true));
   }
 
   /**
    * @internal
    */
   override onDisable(): void {
-    this._renderer.enabled = false;
+    this._renderers.forEach((renderer) => (renderer.enabled = false));
+    LineScheduler.get(this.engine).unschedule(this);
   }
 
   /**
    * @internal
    */
   override onDestroy() {
-    this._renderer.destroy();
+    LineScheduler.get(this.engine).unschedule(this);
+    this._removeChunks(0);
+    this._destroyMaterial();
+    this._destroySegmentIndex();
+  }
+
+  /**
+   * Tessellate segments [first, last) into wasm memory, the result is only valid until the next build.
+   */
+  protected _generateData(
+    first: number,
+    last: number,
+    indexFormat: IndexFormat,
+    lengthsofar: number
+  ): LineBuilderResult {
+    return LineVertexBuilder.instance.buildSolidLine(
+      this._renderPoints,
+      this._join,
+      this._cap,
+      -1,
+      indexFormat,
+      first,
+      last
+    );
   }
 
-  protected async _generateData() {
-    return await LineVertexBuilder.instance.solidLine(this._flattenPoints, this._join, this._cap, -1);
+  /**
+   * Tessellate the old end and the segments appended since the build of `oldPointCount` points into wasm memory.
+   */
+  protected _generateAppendData(
+    oldPointCount: number,
+    indexFormat: IndexFormat,
+    lengthsofar: number
+  ): LineAppendResult {
+    return LineVertexBuilder.instance.appendSolidLine(
+      this._renderPoints,
+      oldPointCount,
+      this._join,
+      this._cap,
+      indexFormat
+    );
   }
 
-  protected async _render() {
-    const { vertices, indices } = await this._generateData();
-    const vertexBuffer = new Buffer(this.engine, BufferBindFlag.VertexBuffer, vertices, BufferUsage.Static);
-    const indexBuffer = new Buffer(this.engine, BufferBindFlag.IndexBuffer, indices, BufferUsage.Static);
-    vertexBuffer.setData(vertices);
-    indexBuffer.setData(indices);
+  /**
+   * The max number of segments in one chunk when the line has to be split for 16-bit indices.
+   */
+  protected _getMaxChunkSegmentCount(): number {
+    const joinCount = this._join === LineJoin.Round ? this._roundSegments - 1 : 0;
+    const capCount = this._cap === LineCap.Round ? this._roundSegments - 1 : 2;
+    // Leave room for the caps and the join a chunk starts with.
+    return Math.floor((Line._maxUInt16VertexCount - capCount * 2 - 2 - joinCount) / (4 + joinCount));
+  }
 
-    // destroy old buffer
-    if (this._mesh) {
-      this._mesh.vertexBufferBindings.forEach((binding) => {
-        binding?.buffer?.destroy();
-      });
-      this._mesh.indexBufferBinding?.buffer?.destroy();
+  /**
+   * @internal
+   * Rebuild the line for the changes since the last rebuild, called by `LineScheduler` once the builder is loaded.
+   */
+  _rebuild(): void {
+    const append = !this._needUpdate;
+    this._needUpdate = false;
+    this._appendPending = false;
+    this._render(append);
+  }
+
+  /**
+   * @internal
+   * The world bounds of the built line, false if nothing was built yet.
+   */
+  _getBounds(out: BoundingBox): boolean {
+    const renderers = this._renderers;
+    if (!this._renderPoints.length || !renderers.length) {
+      return false;
     }
+    out.copyFrom(renderers[0].bounds);
+    for (let i = 1, n = renderers.length; i < n; i++) {
+      BoundingBox.merge(out, renderers[i].bounds, out);
+    }
+    return true;
+  }
 
-    this._mesh.setVertexBufferBinding(vertexBuffer, 24, 0);
-    this._mesh.setIndexBufferBinding(indexBuffer, IndexFormat.UInt16);
+  protected _render(append = false) {
+    // Loaded geometry has no points to build from.
+    if (this._geometry) {
+      return;
+    }
+    // Every render supersedes the builds still running on workers, and a full build invalidates what appends continue.
+    const generation = ++this._generation;
+    if (!append) {
+      this._builtPointCount = 0;
+    }
+    if (this._curve && !this._curveFlattened) {
+      this._flattenCurve();
+    }
+    if (this._simplifyTolerance > 0) {
+      this._renderPoints = this._simplifyPoints();
+      append = false;
+    } else {
+      this._renderPoints = this._flattenPoints;
+    }
+    if (this._instanced) {
+      this._renderInstanced(append);
+      return;
+    }
+    // Build and upload without yielding, the builder output lives in shared wasm memory. Appends continue the
+    // uploaded line, so they wait for a full build still running on a worker by joining it.
+    if (append && !this._workerGeneration && this._appendData()) {
+      return;
+    }
+    const segmentCount = this._renderPoints.length / 2 - 1;
+    const indexFormat = this._supportUint32Index ? IndexFormat.UInt32 : IndexFormat.UInt16;
+    const chunkSegmentCount = this._getChunkSegmentCount(segmentCount);
+    let cacheKey: string = null;
+    if (this._cached && segmentCount > 0) {
+      cacheKey = this._getCacheKey(indexFormat, chunkSegmentCount);
+      const entry = LineCache.get(this.engine).acquire(cacheKey, this._renderPoints);
+      if (entry) {
+        this._drawCacheEntry(entry);
+        return;
+      }
+    }
+    if (this._useWorker) {
+      this._renderInWorker(generation, cacheKey).catch((error) => {
+        // A worker that failed to start or to build leaves the line to the main thread, unless it changed since.
+        if (generation === this._generation && !this.destroyed) {
+          console.warn("Line: tessellation on a worker failed, building on the main thread.", error);
+          this._renderOnMainThread(segmentCount, indexFormat, chunkSegmentCount, cacheKey);
+        }
+      });
+      return;
+    }
+    this._renderOnMainThread(segmentCount, indexFormat, chunkSegmentCount, cacheKey);
+  }
 
-    this._mesh.clearSubMesh();
-    this._mesh.addSubMesh(0, indices.length);
+  /**
+   * Tessellate and upload the render points chunk by chunk, inserting the meshes into the cache under `cacheKey`.
+   */
+  private _renderOnMainThread(
+    segmentCount: number,
+    indexFormat: IndexFormat,
+    chunkSegmentCount: number,
+    cacheKey: string
+  ) {
+    const builder = LineVertexBuilder.instance;
+    builder.roundSegments = this._roundSegments;
+    // The meshes are written below, stop sharing them first.
+    if (this._cacheEntry) {
+      this._replaceMeshes();
+    }
+    const packs: (Float32Array | null)[] = [];
 
-    // @ts-ignore
-    this._mesh._enableVAO = false;
+    // Long lines are split into chunks, each starting with the join the previous one stopped before, so the pieces
+    // tile the line without gaps.
+    let chunkCount = 0;
+    let lengthsofar = 0;
+    for (let first = 0; first < segmentCount; first += chunkSegmentCount) {
+      const last = Math.min(first + chunkSegmentCount, segmentCount);
+      let result = this._generateData(first, last, indexFormat, lengthsofar);
+      if (this._triangleStrip) {
+        result = builder.toTriangleStrip(result, indexFormat);
+      }
+      lengthsofar = result.lengthsofar ?? 0;
+      const bounds = builder.getVertexBounds(result.vertices);
+      if (this._compactVertices) {
+        const packed = builder.packVertices(result.vertices);
+        this._uploadChunk(chunkCount++, packed.vertices, result.indices, indexFormat, bounds, packed.pack);
+        packs.push(packed.pack);
+      } else {
+        this._uploadChunk(chunkCount++, result.vertices, result.indices, indexFormat, bounds, null);
+        packs.push(null);
+      }
+    }
+    this._finishChunks(chunkCount, segmentCount + 1, lengthsofar);
+    if (cacheKey) {
+      this._insertCacheEntry(cacheKey, new Float32Array(this._renderPoints), packs, lengthsofar);
+    }
   }
 
   protected _initMaterial() {
-    this._material = new LineMaterial(this.engine);
-    this._renderer.setMaterial(this._material);
+    this._material = this._instanced ? new LineInstancedMaterial(this.engine) : new LineMaterial(this.engine);
+  }
+
+  /**
+   * Destroy the material of `_initMaterial`, after the renderers using it are removed.
+   */
+  protected _destroyMaterial() {
+    this._material?.destroy();
+    this._material = null;
+  }
+
+  /**
+   * Write the line's uniforms into the shader data of a chunk renderer.
+   */
+  protected _initShaderData(shaderData: ShaderData) {
+    shaderData.setColor("u_color", this._color);
+    shaderData.setInt("u_join", this._join);
+    shaderData.setInt("u_cap", this._cap);
+    shaderData.setFloat("u_width", this._width);
+    this._setCompactMacro(shaderData);
+  }
+
+  /**
+   * Run a callback on the shader data of every chunk renderer.
+   */
+  protected _forEachShaderData(callback: (shaderData: ShaderData) => void) {
+    this._renderers.forEach((renderer) => callback(renderer.shaderData));
+  }
+
+  /**
+   * The max number of segments in one chunk of a line of `segmentCount` segments.
+   */
+  private _getChunkSegmentCount(segmentCount: number): number {
+    const chunkSegmentCount = this._supportUint32Index ? segmentCount : this._getMaxChunkSegmentCount();
+    return this._chunkSegmentCount > 0 ? Math.min(chunkSegmentCount, this._chunkSegmentCount) : chunkSegmentCount;
+  }
+
+  /**
+   * Tessellate the line on a worker and upload it, unless a newer render has replaced it by the time it is done.
+   */
+  private async _renderInWorker(generation: number, cacheKey: string) {
+    const points = this._renderPoints;
+    const segmentCount = points.length / 2 - 1;
+    const indexFormat = this._supportUint32Index ? IndexFormat.UInt32 : IndexFormat.UInt16;
+    // The job's copy is transferred to the worker, and appends may change the points before it is done.
+    const cachePoints = cacheKey ? new Float32Array(points) : null;
+    this._workerGeneration = generation;
+    let chunks: ILineWorkerChunk[];
+    try {
+      chunks = await LineWorkerPool.instance.build(this, {
+        points: new Float32Array(points),
+        dash: this._dashed,
+        join: this._join,
+        cap: this._cap,
+        indexFormat,
+        chunkSegmentCount: this._getChunkSegmentCount(segmentCount),
+        roundSegments: this._roundSegments,
+        compact: this._compactVertices,
+        strip: this._triangleStrip
+      });
+    } finally {
+      if (this._workerGeneration === generation) {
+        this._workerGeneration = 0;
+      }
+    }
+    if (!chunks || generation !== this._generation || this.destroyed) {
+      return;
+    }
+    if (this._cacheEntry) {
+      this._replaceMeshes();
+    }
+    const profiler = LineProfiler.instance;
+    for (let i = 0, n = chunks.length; i < n; i++) {
+      const { vertices, indices, bounds, pack } = chunks[i];
+      this._uploadChunk(i, vertices, indices, indexFormat, bounds, pack);
+      // The worker's wasm time is not seen here, only what it built.
+      if (profiler.enabled) {
+        const vertexStride = pack ? LineMesh.compactVertexStride : LineMesh.vertexStride;
+        profiler.recordBuild(i === 0 ? segmentCount + 1 : 0, vertices.byteLength / vertexStride, indices.length);
+      }
+    }
+    const lengthsofar = chunks.length ? chunks[chunks.length - 1].lengthsofar : 0;
+    this._finishChunks(chunks.length, segmentCount + 1, lengthsofar);
+    if (cacheKey) {
+      const packs = chunks.map((chunk) => chunk.pack);
+      this._insertCacheEntry(cacheKey, cachePoints, packs, lengthsofar);
+    }
+  }
+
+  /**
+   * The cache key of a full build of the render points, their hash and everything else the meshes depend on. The
+   * dash length the build starts at is not part of it, a full build always starts at 0.
+   */
+  private _getCacheKey(indexFormat: IndexFormat, chunkSegmentCount: number): string {
+    const hash = LineCache.get(this.engine).hash(this._renderPoints);
+    const dashed = this._dashed ? 1 : 0;
+    const layout = (this._compactVertices ? 1 : 0) | (this._triangleStrip ? 2 : 0);
+    const style = `${this._join}|${this._cap}|${this._roundSegments}|${this._width}`;
+    return `${hash}|${dashed}|${style}|${layout}|${indexFormat}|${chunkSegmentCount}`;
+  }
+
+  /**
+   * Empty the chunk meshes and keep `chunkCount` of them, for the chunks of a geometry file to fill.
+   */
+  private _prepareGeometryChunks(chunkCount: number) {
+    if (this._cacheEntry) {
+      this._replaceMeshes();
+    }
+    const meshes = this._meshes;
+    for (let i = 0, n = meshes.length; i < n; i++) {
+      meshes[i].setIndexCount(0);
+    }
+    while (meshes.length < chunkCount) {
+      this._addChunk();
+    }
+    this._removeChunks(Math.max(chunkCount, 1));
+  }
+
+  /**
+   * The order to load geometry chunks in, those in view of `LineScheduler.camera` first, nearer ones first.
+   */
+  private _prioritizeGeometry(chunks: LineGeometryChunk[]): number[] {
+    const order = chunks.map((_, index) => index);
+    const { camera } = LineScheduler.get(this.engine);
+    if (!camera) {
+      return order;
+    }
+    const frustum = new BoundingFrustum();
+    const matrix = new Matrix();
+    Matrix.multiply(camera.projectionMatrix, camera.viewMatrix, matrix);
+    frustum.calculateFromMatrix(matrix);
+    const { worldMatrix } = this.entity.transform;
+    const cameraPosition = camera.entity.transform.worldPosition;
+    const box = new BoundingBox();
+    const center = new Vector3();
+    const width = this._width;
+    const visible: boolean[] = [];
+    const distances: number[] = [];
+    for (let i = 0, n = chunks.length; i < n; i++) {
+      const { bounds } = chunks[i];
+      box.min.set(bounds[0] - bounds[4] * width, bounds[1] - bounds[5] * width, 0);
+      box.max.set(bounds[2] + bounds[4] * width, bounds[3] + bounds[5] * width, 0);
+      BoundingBox.transform(box, worldMatrix, box);
+      box.getCenter(center);
+      visible.push(frustum.intersectsBox(box));
+      distances.push(Vector3.distance(cameraPosition, center));
+    }
+    // Chunks out of view rank behind every chunk in view.
+    return order.sort((a, b) => (visible[a] === visible[b] ? distances[a] - distances[b] : visible[a] ? -1 : 1));
+  }
+
+  /**
+   * Draw the meshes of a cache entry a reference was taken to, instead of the line's own.
+   */
+  private _drawCacheEntry(entry: LineCacheEntry) {
+    const { meshes, packs } = entry;
+    const lastEntry = this._cacheEntry;
+    this._removeChunks(meshes.length);
+    const { _renderers: renderers, _meshes: lineMeshes } = this;
+    for (let i = 0, n = meshes.length; i < n; i++) {
+      if (i === renderers.length) {
+        this._addChunk(meshes[i]);
+      } else {
+        renderers[i].mesh = meshes[i];
+        if (!lastEntry) {
+          lineMeshes[i].destroy();
+        }
+        lineMeshes[i] = meshes[i];
+      }
+      if (packs[i]) {
+        this._setPackUniforms(renderers[i].shaderData, packs[i]);
+      }
+    }
+    this._cacheEntry = entry;
+    if (lastEntry) {
+      LineCache.get(this.engine).release(lastEntry);
+    }
+    this._builtPointCount = 0;
+    this._builtLengthsofar = entry.lengthsofar;
+  }
+
+  /**
+   * Cache the meshes just built, the line keeps them to itself if another line cached the same build meanwhile.
+   */
+  private _insertCacheEntry(key: string, points: Float32Array, packs: (Float32Array | null)[], lengthsofar: number) {
+    const cache = LineCache.get(this.engine);
+    this._cacheEntry = cache.insert(key, points, this._meshes.slice(), packs, lengthsofar);
+  }
+
+  /**
+   * Upload a tessellated chunk into the chunk renderer `index`, adding it if needed.
+   */
+  private _uploadChunk(
+    index: number,
+    vertices: Float32Array | Uint8Array,
+    indices: Uint16Array | Uint32Array,
+    indexFormat: IndexFormat,
+    bounds: Float32Array,
+    pack: Float32Array | null
+  ) {
+    if (index === this._meshes.length) {
+      this._addChunk();
+    }
+    const mesh = this._meshes[index];
+    mesh.setVertexBounds(bounds, this._width);
+    if (pack) {
+      this._setPackUniforms(this._renderers[index].shaderData, pack);
+    }
+    mesh.setData(vertices, indices, indexFormat);
+  }
+
+  /**
+   * Remove the chunks a build did not use and record what appends can continue.
+   */
+  private _finishChunks(chunkCount: number, pointCount: number, lengthsofar: number) {
+    if (chunkCount === 0) {
+      this._meshes[0].setIndexCount(0);
+    }
+    this._removeChunks(Math.max(chunkCount, 1));
+    this._builtPointCount = chunkCount === 1 ? pointCount : 0;
+    this._builtLengthsofar = lengthsofar;
+  }
+
+  /**
+   * Continue the built line with the appended points, false if it has to be rebuilt instead: when it is split
+   * into chunks, outgrows 16-bit indices or outgrows its buffers. Buffers grow geometrically, so rebuilds get rare.
+   */
+  private _appendData(): boolean {
+    const oldPointCount = this._builtPointCount;
+    const pointCount = this._renderPoints.length / 2;
+    // Appended vertices could fall outside the quantization bounds of the built ones, a strip has no fixed number of
+    // indices per vertex to continue from, and cached meshes are shared.
+    if (oldPointCount < 2 || this._compactVertices || this._triangleStrip || this._cached) {
+      return false;
+    }
+    if (pointCount === oldPointCount) {
+      return true;
+    }
+    const indexFormat = this._supportUint32Index ? IndexFormat.UInt32 : IndexFormat.UInt16;
+    LineVertexBuilder.instance.roundSegments = this._roundSegments;
+    const result = this._generateAppendData(oldPointCount, indexFormat, this._builtLengthsofar);
+    const vertexCount = result.vertexStart + result.vertices.length / 6;
+    if (!this._supportUint32Index && vertexCount > Line._maxUInt16VertexCount) {
+      return false;
+    }
+    const mesh = this._meshes[0];
+    // Read the bounds first, a rebuild after a failed upload overwrites the builder output.
+    const vertexBounds = LineVertexBuilder.instance.getVertexBounds(result.vertices);
+    if (!mesh.setSubData(result.vertices, result.indices, indexFormat, result.vertexStart)) {
+      return false;
+    }
+    mesh.setVertexBounds(vertexBounds, this._width, true);
+    this._builtPointCount = pointCount;
+    this._builtLengthsofar = result.lengthsofar ?? 0;
+    return true;
+  }
+
+  private _getSegmentIndex(): LineSegmentIndex {
+    const builder = LineVertexBuilder.instance;
+    if (!this._segmentIndex && builder.loaded) {
+      this._segmentIndex = builder.buildSegmentIndex(this._flattenPoints);
+    }
+    return this._segmentIndex;
+  }
+
+  private _destroySegmentIndex() {
+    if (this._segmentIndex) {
+      LineVertexBuilder.instance.destroySegmentIndex(this._segmentIndex);
+      this._segmentIndex = null;
+    }
+  }
+
+  /**
+   * The size of a pixel of `simplifyCamera` in local units at the line, 1 without a camera.
+   */
+  private _getUnitsPerPixel(): number {
+    const camera = this._simplifyCamera;
+    let unitsPerPixel = 1;
+    if (camera) {
+      const { transform } = this.entity;
+      const height = camera.pixelViewport.height;
+      if (camera.isOrthographic) {
+        unitsPerPixel = (camera.orthographicSize * 2) / height;
+      } else {
+        const distance = Vector3.distance(camera.entity.transform.worldPosition, transform.worldPosition);
+        unitsPerPixel = (2 * distance * Math.tan(MathUtil.degreeToRadian(camera.fieldOfView) / 2)) / height;
+      }
+      const scale = transform.lossyWorldScale;
+      unitsPerPixel /= Math.max(Math.abs(scale.x), Math.abs(scale.y));
+    }
+    return unitsPerPixel;
+  }
+
+  /**
+   * The simplification tolerance in local units, snapped down to a power of two level of detail.
+   */
+  private _getLodThreshold(): number {
+    return this._snapTolerance(this._simplifyTolerance);
+  }
+
+  /**
+   * The curve flattening tolerance in local units, snapped like the level of detail.
+   */
+  private _getCurveThreshold(): number {
+    return this._snapTolerance(this._curveTolerance);
+  }
+
+  /**
+   * A tolerance in pixels as local units, snapped down to a power of two so zooming only changes it at levels.
+   */
+  private _snapTolerance(pixels: number): number {
+    const tolerance = pixels * this._getUnitsPerPixel();
+    return tolerance > 0 && isFinite(tolerance) ? Math.pow(2, Math.floor(Math.log2(tolerance))) : 0;
+  }
+
+  /**
+   * Flatten the curve into `_flattenPoints`, reusing the array.
+   */
+  private _flattenCurve() {
+    const threshold = this._getCurveThreshold();
+    this._curveThreshold = threshold;
+    this._curveFlattened = true;
+    const builder = LineVertexBuilder.instance;
+    this._flattenPoints = builder.flattenCurve(this._curve, this._curveType, threshold, this._flattenPoints);
+    this._importance = null;
+    this._destroySegmentIndex();
+  }
+
+  /**
+   * The segments per half circle that keep round joins and caps within a quarter pixel of a circle, snapped up to
+   * a power of two so zooming only rebuilds when it crosses one.
+   */
+  private _getRoundSegments(): number {
+    const { defaultRoundSegments, minRoundSegments, maxRoundSegments } = LineVertexBuilder;
+    if (!this._simplifyCamera) {
+      return defaultRoundSegments;
+    }
+    const radius = this._width / this._getUnitsPerPixel();
+    if (!(radius > 0) || !isFinite(radius)) {
+      return minRoundSegments;
+    }
+    // A half circle of n segments is off the circle by radius * (1 - cos(PI / 2n)) between two vertices.
+    const tolerance = 0.25;
+    const segments = radius <= tolerance ? 1 : Math.PI / (2 * Math.acos(1 - tolerance / radius));
+    const snapped = Math.pow(2, Math.ceil(Math.log2(segments)));
+    return Math.min(Math.max(snapped, minRoundSegments), maxRoundSegments);
+  }
+
+  /**
+   * Simplify the points at the current level of detail, computing their importance first if they changed.
+   */
+  private _simplifyPoints(): number[] {
+    const builder = LineVertexBuilder.instance;
+    const points = this._flattenPoints;
+    if (!this._importance) {
+      this._importance = builder.computeImportance(points);
+    }
+    return builder.simplifyPoints(points, this._importance, this._lodThreshold);
+  }
+
+  /**
+   * Upload the points for GPU expansion, appends only upload the new points and the old end.
+   */
+  private _renderInstanced(append: boolean) {
+    const fromPoint = append ? this._builtPointCount : 0;
+    this._instancedMesh.setPoints(this._renderPoints, fromPoint);
+    this._instancedMesh.updateBounds(this._width);
+    this._builtPointCount = this._renderPoints.length / 2;
+  }
+
+  private _setCompactMacro(shaderData: ShaderData) {
+    if (this._compactVertices) {
+      shaderData.enableMacro("LINE_COMPACT_VERTEX");
+    } else {
+      shaderData.disableMacro("LINE_COMPACT_VERTEX");
+    }
+  }
+
+  private _setPackUniforms(shaderData: ShaderData, pack: Float32Array) {
+    // Shader data keeps the vectors it is given, each renderer's are updated in place once set.
+    const vertexPack = shaderData.getVector4("u_vertexPack");
+    if (vertexPack) {
+      vertexPack.set(pack[0], pack[1], pack[2], pack[3]);
+    } else {
+      shaderData.setVector4("u_vertexPack", new Vector4(pack[0], pack[1], pack[2], pack[3]));
+    }
+    const lengthPack = shaderData.getVector2("u_lengthPack");
+    if (lengthPack) {
+      lengthPack.set(pack[4], pack[5]);
+    } else {
+      shaderData.setVector2("u_lengthPack", new Vector2(pack[4], pack[5]));
+    }
+  }
+
+  private _addChunk(mesh?: LineMesh) {
+    const renderer = this.entity.addComponent(MeshRenderer);
+    if (this._instanced) {
+      renderer.mesh = this._instancedMesh = new LineInstancedMesh(this.engine);
+    } else {
+      mesh = mesh ?? new LineMesh(this.engine, this._compactVertices, this._triangleStrip);
+      renderer.mesh = mesh;
+      this._meshes.push(mesh);
+    }
+    renderer.setMaterial(this._material);
+    renderer.enabled = this.enabled;
+    this._initShaderData(renderer.shaderData);
+
+    this._renderers.push(renderer);
+  }
+
+  /**
+   * Replace the chunk meshes with empty ones of the current layout and topology, for the next build to fill.
+   * Cached meshes are left to the cache.
+   */
+  private _replaceMeshes() {
+    const { _meshes: meshes, _renderers: renderers } = this;
+    const entry = this._cacheEntry;
+    for (let i = 0, n = meshes.length; i < n; i++) {
+      const mesh = new LineMesh(this.engine, this._compactVertices, this._triangleStrip);
+      renderers[i].mesh = mesh;
+      if (!entry) {
+        meshes[i].destroy();
+      }
+      meshes[i] = mesh;
+    }
+    if (entry) {
+      this._cacheEntry = null;
+      LineCache.get(this.engine).release(entry);
+    }
+  }
+
+  /**
+   * Remove the chunks from `from` on, removing all of them releases the cache entry they draw.
+   */
+  private _removeChunks(from: number) {
+    const { _renderers: renderers, _meshes: meshes } = this;
+    const entry = this._cacheEntry;
+    for (let i = from, n = renderers.length; i < n; i++) {
+      renderers[i].destroy();
+      if (!entry) {
+        meshes[i]?.destroy();
+      }
+    }
+    if (from === 0 && this._instancedMesh) {
+      this._instancedMesh.destroy();
+      this._instancedMesh = null;
+    }
+    if (from === 0 && entry) {
+      this._cacheEntry = null;
+      LineCache.get(this.engine).release(entry);
+    }
+    renderers.length = Math.min(renderers.length, from);
+    meshes.length = Math.min(meshes.length, from);
   }
 }
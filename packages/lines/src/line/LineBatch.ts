@@ -0,0 +1,225 @@
+import { Color, GLCapabilityType, IndexFormat, MeshRenderer, Script, Vector2 } from "@galacean/engine";
+import { LineCap, LineJoin } from "./constants";
+import { LineMesh } from "./LineMesh";
+import { LineBatchMaterial } from "./material/LineBatchMaterial";
+import { LineVertexBuilder } from "./vertexBuilder";
+
+/**
+ * A solid line in a line batch.
+ */
+export interface LineBatchItem {
+  /** The points that make up the line. */
+  points: Vector2[];
+  /** The thickness of line, defaults to 0.1. */
+  width?: number;
+  /** The shape used to join two line segments, defaults to `LineJoin.Miter`. */
+  join?: LineJoin;
+  /** The shape used to draw the end points, defaults to `LineCap.Butt`. */
+  cap?: LineCap;
+}
+
+/**
+ * Many solid lines of one color, tessellated in a single builder call and drawn in a single draw call.
+ * @remarks Without 32-bit index support the batch is split into as few meshes as needed to stay under
+ * 65536 vertices each.
+ */
+export class LineBatch extends Script {
+  private static _maxUInt16VertexCount = 65536;
+
+  private _lines: LineBatchItem[] = [];
+  private _color: Color = new Color(0, 0, 0, 1);
+  private _material: LineBatchMaterial;
+  private _renderers: MeshRenderer[] = [];
+  private _meshes: LineMesh[] = [];
+  private _ranges = new Int32Array(0);
+  private _supportUint32Index = false;
+  private _needUpdate = false;
+  private _generation = 0;
+
+  /**
+   * The lines of the batch. Reassign the array, or call `markDirty`, after changing it.
+   */
+  get lines(): LineBatchItem[] {
+    return this._lines;
+  }
+
+  set lines(value: LineBatchItem[]) {
+    this._lines = value;
+    this._needUpdate = true;
+  }
+
+  /**
+   * The color of all lines.
+   */
+  get color(): Color {
+    return this._color;
+  }
+
+  set color(value: Color) {
+    this._color = value;
+    this._renderers.forEach((renderer) => renderer.shaderData.setColor("u_color", value));
+  }
+
+  /**
+   * First index and index count of every line, in line order, within the mesh that draws it.
+   */
+  get ranges(): Int32Array {
+    return this._ranges;
+  }
+
+  /**
+   * Rebuild the batch on the next update.
+   */
+  markDirty(): void {
+    this._needUpdate = true;
+  }
+
+  /**
+   * @internal
+   */
+  override onAwake(): void {
+    // @ts-ignore
+    this._supportUint32Index = this.engine._hardwareRenderer.canIUse(GLCapabilityType.elementIndexUint);
+    this._material = new LineBatchMaterial(this.engine);
+    this._addChunk();
+  }
+
+  /**
+   * @internal
+   */
+  override onUpdate(): void {
+    if (this._needUpdate) {
+      this._render();
+      this._needUpdate = false;
+    }
+  }
+
+  /**
+   * @internal
+   */
+  override onEnable(): void {
+    this._renderers.forEach((renderer) => (renderer.enabled = true));
+  }
+
+  /**
+   * @internal
+   */
+  override onDisable(): void {
+    this._renderers.forEach((renderer) => (renderer.enabled = false));
+  }
+
+  /**
+   * @internal
+   */
+  override onDestroy(): void {
+    this._removeChunks(0);
+  }
+
+  private async _render() {
+    const builder = LineVertexBuilder.instance;
+    // A render started before the builder is ready is superseded by any render started after it.
+    const generation = ++this._generation;
+    await builder.ready;
+    if (this.destroyed || generation !== this._generation) {
+      return;
+    }
+
+    const lines = this._lines;
+    const lineCount = lines.length;
+    const maxVertexCount = this._supportUint32Index ? Infinity : LineBatch._maxUInt16VertexCount;
+    // Batched lines have no camera to fit their round joins and caps to.
+    builder.roundSegments = LineVertexBuilder.defaultRoundSegments;
+    const vertexCounts = new Int32Array(lineCount);
+    let pointCount = 0;
+    for (let i = 0; i < lineCount; i++) {
+      const { points, join = LineJoin.Miter, cap = LineCap.Butt } = lines[i];
+      const count = points.length > 1 ? builder.getSolidVertexCount(points.length, join, cap) : 0;
+      if (count > maxVertexCount) {
+        console.warn(`LineBatch: line ${i} needs ${count} vertices, more than one 16-bit indexed mesh can hold.`);
+        continue;
+      }
+      vertexCounts[i] = count;
+      pointCount += points.length;
+    }
+
+    const flattenPoints = new Float32Array(pointCount * 2);
+    const pointOffsets = new Int32Array(lineCount + 1);
+    const joins = new Int32Array(lineCount);
+    const caps = new Int32Array(lineCount);
+    const widths = new Float32Array(lineCount);
+    let offset = 0;
+    for (let i = 0; i < lineCount; i++) {
+      const { points, width = 0.1, join = LineJoin.Miter, cap = LineCap.Butt } = lines[i];
+      pointOffsets[i] = offset;
+      joins[i] = join;
+      caps[i] = cap;
+      widths[i] = width;
+      if (vertexCounts[i] > 0) {
+        for (let j = 0, n = points.length; j < n; j++) {
+          flattenPoints[(offset + j) * 2] = points[j].x;
+          flattenPoints[(offset + j) * 2 + 1] = points[j].y;
+        }
+        offset += points.length;
+      }
+    }
+    pointOffsets[lineCount] = offset;
+
+    // Consecutive lines share a mesh as long as it stays addressable by the index format.
+    const indexFormat = this._supportUint32Index ? IndexFormat.UInt32 : IndexFormat.UInt16;
+    const ranges = new Int32Array(lineCount * 2);
+    let chunkCount = 0;
+    let groupStart = 0;
+    let groupVertexCount = 0;
+    for (let i = 0; i <= lineCount; i++) {
+      const count = i < lineCount ? vertexCounts[i] : 0;
+      if (i === lineCount ? i > groupStart : groupVertexCount + count > maxVertexCount) {
+        // Only the group's points are copied into wasm memory, with its offsets rebased to them.
+        const groupPointStart = pointOffsets[groupStart];
+        const result = builder.buildSolidLines(
+          flattenPoints.subarray(groupPointStart * 2, pointOffsets[i] * 2),
+          pointOffsets.subarray(groupStart, i + 1).map((pointOffset) => pointOffset - groupPointStart),
+          joins.subarray(groupStart, i),
+          caps.subarray(groupStart, i),
+          widths.subarray(groupStart, i),
+          indexFormat
+        );
+        ranges.set(result.ranges, groupStart * 2);
+        if (chunkCount === this._meshes.length) {
+          this._addChunk();
+        }
+        this._meshes[chunkCount++].setData(result.vertices, result.indices, indexFormat);
+        groupStart = i;
+        groupVertexCount = 0;
+      }
+      groupVertexCount += count;
+    }
+
+    if (chunkCount === 0) {
+      this._meshes[0].setIndexCount(0);
+    }
+    this._removeChunks(Math.max(chunkCount, 1));
+    this._ranges = ranges;
+  }
+
+  private _addChunk() {
+    const renderer = this.entity.addComponent(MeshRenderer);
+    const mesh = new LineMesh(this.engine);
+    renderer.mesh = mesh;
+    renderer.setMaterial(this._material);
+    renderer.enabled = this.enabled;
+    renderer.shaderData.setColor("u_color", this._color);
+
+    this._renderers.push(renderer);
+    this._meshes.push(mesh);
+  }
+
+  private _removeChunks(from: number) {
+    const { _renderers: renderers, _meshes: meshes } = this;
+    for (let i = from, n = renderers.length; i < n; i++) {
+      renderers[i].destroy();
+      meshes[i].destroy();
+    }
+    renderers.length = Math.min(renderers.length, from);
+    meshes.length = Math.min(meshes.length, from);
+  }
+}
@@ -0,0 +1,241 @@
+import { Engine } from "@galacean/engine";
+import { LineMesh } from "./LineMesh";
+
+/**
+ * @internal
+ * The meshes of one tessellated line, shared by every line built from the same points and style.
+ */
+export type LineCacheEntry = {
+  key: string;
+  /** The points the meshes were built from, compared on lookup so a hash collision is a miss. */
+  points: Float32Array;
+  meshes: LineMesh[];
+  /** The compact vertex pack uniforms of each mesh, null without compact vertices. */
+  packs: (Float32Array | null)[];
+  /** The dash length at the end of the line. */
+  lengthsofar: number;
+  byteLength: number;
+  /** The number of lines drawing the meshes. */
+  refCount: number;
+  /** Whether the entry is still in the cache, an evicted entry is destroyed once no line draws it. */
+  cached: boolean;
+};
+
+/**
+ * Shares tessellated meshes between lines with identical points and style, keyed by a hash of the points.
+ * @remarks A line with `cached` set looks its build up here before tessellating, on a hit it draws the shared meshes
+ * instead of building and uploading its own. Meshes no line draws anymore stay cached until `maxBytes` is exceeded,
+ * then the least recently used ones are destroyed.
+ */
+export class LineCache {
+  private static _caches = new Map<Engine, LineCache>();
+
+  /**
+   * The cache of an engine, meshes are only shared within one engine.
+   */
+  static get(engine: Engine): LineCache {
+    let cache = this._caches.get(engine);
+    if (!cache) {
+      cache = new LineCache();
+      this._caches.set(engine, cache);
+      // The engine destroys the meshes with its resources, only the entry has to go.
+      engine.once("shutdown", () => this._caches.delete(engine));
+    }
+    return cache;
+  }
+
+  /** The bytes cached before meshes no line draws are evicted, meshes still drawn are kept even above it. */
+  maxBytes = 64 * 1024 * 1024;
+
+  private _entries = new Map<string, LineCacheEntry>();
+  private _byteLength = 0;
+  private _hitCount = 0;
+  private _missCount = 0;
+  private _evictionCount = 0;
+  private _hashPoints = new Float32Array(0);
+
+  /**
+   * The number of builds that reused cached meshes.
+   */
+  get hitCount(): number {
+    return this._hitCount;
+  }
+
+  /**
+   * The number of builds that found nothing to reuse and tessellated.
+   */
+  get missCount(): number {
+    return this._missCount;
+  }
+
+  /**
+   * The number of entries evicted to stay under `maxBytes`.
+   */
+  get evictionCount(): number {
+    return this._evictionCount;
+  }
+
+  /**
+   * The buffer bytes of all cached meshes, in use or not.
+   */
+  get byteLength(): number {
+    return this._byteLength;
+  }
+
+  /**
+   * The number of cached builds.
+   */
+  get entryCount(): number {
+    return this._entries.size;
+  }
+
+  /**
+   * @internal
+   * Hash the points as 32-bit floats, the precision they are tessellated at, into a key prefix.
+   */
+  hash(points: ArrayLike<number>): string {
+    const length = points.length;
+    if (this._hashPoints.length < length) {
+      this._hashPoints = new Float32Array(Math.max(length, this._hashPoints.length * 2));
+    }
+    const floats = this._hashPoints;
+    floats.set(points);
+    const words = new Uint32Array(floats.buffer, 0, length);
+    // Two independent 32-bit hashes, FNV-1a and a multiply-rotate one.
+    let h1 = 0x811c9dc5;
+    let h2 = length;
+    for (let i = 0; i < length; i++) {
+      const word = words[i];
+      h1 = Math.imul(h1 ^ word, 0x01000193);
+      h2 = Math.imul((h2 << 13) | (h2 >>> 19), 5) + 0xe6546b64 + Math.imul(word, 0xcc9e2d51);
+    }
+    return `${(h1 >>> 0).toString(36)}.${(h2 >>> 0).toString(36)}.${length}`;
+  }
+
+  /**
+   * @internal
+   * Take a reference to the meshes built for `key` from `points`, null on a miss.
+   */
+  acquire(key: string, points: ArrayLike<number>): LineCacheEntry | null {
+    const entry = this._entries.get(key);
+    if (!entry || !this._equals(entry.points, points)) {
+      this._missCount++;
+      return null;
+    }
+    // Reinsert as the most recently used.
+    this._entries.delete(key);
+    this._entries.set(key, entry);
+    entry.refCount++;
+    this._hitCount++;
+    return entry;
+  }
+
+  /**
+   * @internal
+   * Cache the meshes a line just built, the line holds the first reference. Null if another line cached the same
+   * build meanwhile, the line keeps its meshes to itself then.
+   * @param points A copy of the points the meshes were built from, kept by the entry
+   */
+  insert(
+    key: string,
+    points: Float32Array,
+    meshes: LineMesh[],
+    packs: (Float32Array | null)[],
+    lengthsofar: number
+  ): LineCacheEntry | null {
+    if (this._entries.has(key)) {
+      return null;
+    }
+    let byteLength = points.byteLength;
+    for (let i = 0, n = meshes.length; i < n; i++) {
+      byteLength += meshes[i].byteLength;
+    }
+    const entry: LineCacheEntry = {
+      key,
+      points,
+      meshes,
+      packs,
+      lengthsofar,
+      byteLength,
+      refCount: 1,
+      cached: true
+    };
+    this._entries.set(key, entry);
+    this._byteLength += byteLength;
+    this._evict();
+    return entry;
+  }
+
+  /**
+   * @internal
+   * Drop a reference taken by `acquire` or `insert`.
+   */
+  release(entry: LineCacheEntry): void {
+    if (--entry.refCount > 0) {
+      return;
+    }
+    if (entry.cached) {
+      this._evict();
+    } else {
+      this._destroy(entry);
+    }
+  }
+
+  /**
+   * Destroy every cached mesh no line draws.
+   */
+  clear(): void {
+    this._entries.forEach((entry) => {
+      if (entry.refCount === 0) {
+        this._remove(entry);
+      }
+    });
+  }
+
+  private _evict() {
+    if (this._byteLength <= this.maxBytes) {
+      return;
+    }
+    // Map iteration follows insertion order, least recently used first.
+    for (const entry of this._entries.values()) {
+      if (entry.refCount === 0) {
+        this._remove(entry);
+        this._evictionCount++;
+        if (this._byteLength <= this.maxBytes) {
+          break;
+        }
+      }
+    }
+  }
+
+  private _remove(entry: LineCacheEntry) {
+    this._entries.delete(entry.key);
+    this._byteLength -= entry.byteLength;
+    entry.cached = false;
+    if (entry.refCount === 0) {
+      this._destroy(entry);
+    }
+  }
+
+  private _destroy(entry: LineCacheEntry) {
+    const { meshes } = entry;
+    for (let i = 0, n = meshes.length; i < n; i++) {
+      meshes[i].destroy();
+    }
+    meshes.length = 0;
+  }
+
+  private _equals(cached: Float32Array, points: ArrayLike<number>): boolean {
+    const length = points.length;
+    if (cached.length !== length) {
+      return false;
+    }
+    for (let i = 0; i < length; i++) {
+      // Compare at the precision the points are hashed and tessellated at.
+      if (cached[i] !== Math.fround(points[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
@@ -0,0 +1,169 @@
+import { Engine, Texture2D, TextureFilterMode, TextureFormat, TextureWrapMode } from "@galacean/engine";
+import { DashMaterial } from "./material/DashMaterial";
+import { LineInstancedMaterial } from "./material/LineInstancedMaterial";
+
+/**
+ * @internal
+ * A dash pattern stored in one row of the atlas.
+ */
+export type LineDashPattern = {
+  key: string;
+  /** Total length of one repetition of the pattern. */
+  period: number;
+  row: number;
+  refCount: number;
+};
+
+/**
+ * @internal
+ * Stores the dash patterns of an engine's dashed lines in one texture, one row per distinct pattern, and owns the
+ * materials they are drawn with. Lines with the same pattern share a row, and all of them share the texture and
+ * material, so switching between dashed lines binds nothing new. Row 0 is solid, for lines without a pattern.
+ */
+export class LineDashAtlas {
+  /** Texels per row, one repetition of a pattern is stretched over the row. */
+  static readonly rowLength = 256;
+
+  private static _atlases = new Map<Engine, LineDashAtlas>();
+
+  static get(engine: Engine): LineDashAtlas {
+    let atlas = this._atlases.get(engine);
+    if (!atlas) {
+      atlas = new LineDashAtlas(engine);
+      this._atlases.set(engine, atlas);
+      // The engine destroys the texture and materials with its resources, only the entry has to go.
+      engine.once("shutdown", () => this._atlases.delete(engine));
+    }
+    return atlas;
+  }
+
+  /**
+   * The pattern repeated to an even number of entries, null if it has no positive length or a negative entry.
+   */
+  static normalize(dash: number[]): number[] {
+    let period = 0;
+    for (let i = 0, n = dash.length; i < n; i++) {
+      if (!(dash[i] >= 0) || !isFinite(dash[i])) {
+        return null;
+      }
+      period += dash[i];
+    }
+    if (!(period > 0)) {
+      return null;
+    }
+    // An odd number of entries alternates on and off across repetitions, as in canvas setLineDash.
+    return dash.length % 2 ? dash.concat(dash) : dash.slice();
+  }
+
+  readonly material: DashMaterial;
+  readonly instancedMaterial: LineInstancedMaterial;
+
+  private _engine: Engine;
+  private _texture: Texture2D = null;
+  private _pixels: Uint8Array = new Uint8Array(0);
+  private _rowCount = 0;
+  private _patterns = new Map<string, LineDashPattern>();
+  private _freeRows: number[] = [];
+  private _usedRowCount = 0;
+
+  private constructor(engine: Engine) {
+    this._engine = engine;
+    this.material = new DashMaterial(engine);
+    this.instancedMaterial = new LineInstancedMaterial(engine, true);
+    this._resize(16);
+    this._writeRow([1, 0], 1, 0);
+    this._usedRowCount = 1;
+  }
+
+  /**
+   * Take a reference to the row of a normalized pattern, writing it on first use.
+   */
+  acquire(dash: number[]): LineDashPattern {
+    const key = dash.join(",");
+    let pattern = this._patterns.get(key);
+    if (!pattern) {
+      let row = this._freeRows.pop();
+      if (row === undefined) {
+        if (this._usedRowCount === this._rowCount) {
+          this._resize(this._rowCount * 2);
+        }
+        row = this._usedRowCount++;
+      }
+      pattern = { key, period: dash.reduce((sum, length) => sum + length, 0), row, refCount: 0 };
+      this._patterns.set(key, pattern);
+      this._writeRow(dash, pattern.period, row);
+    }
+    pattern.refCount++;
+    return pattern;
+  }
+
+  /**
+   * Drop a reference taken with `acquire`, the row is reused once no line holds the pattern.
+   */
+  release(pattern: LineDashPattern): void {
+    if (--pattern.refCount === 0) {
+      this._patterns.delete(pattern.key);
+      this._freeRows.push(pattern.row);
+    }
+  }
+
+  private _writeRow(dash: number[], period: number, row: number) {
+    const { rowLength } = LineDashAtlas;
+    const pixels = this._pixels;
+    const rowStart = row * rowLength * 4;
+    // Positive entries after the current one, each needs a texel left.
+    let laterCount = 0;
+    for (let i = 0, n = dash.length; i < n; i++) {
+      dash[i] > 0 && laterCount++;
+    }
+    // An entry ends at the texel boundary nearest its end, so it covers the texels whose centers fall in it. Point
+    // sampling would drop an entry shorter than a texel, so every positive entry keeps at least one.
+    let texel = 0;
+    let position = 0;
+    let widened = false;
+    for (let entry = 0, n = dash.length; entry < n; entry++) {
+      const length = dash[entry];
+      position += length;
+      let end = entry === n - 1 ? rowLength : Math.round((position / period) * rowLength);
+      if (length > 0) {
+        laterCount--;
+        end = Math.max(end, texel + 1);
+        length < period / rowLength && (widened = true);
+      }
+      end = Math.max(texel, Math.min(end, rowLength - laterCount));
+      const alpha = entry % 2 === 0 ? 255 : 0;
+      for (; texel < end; texel++) {
+        const offset = rowStart + texel * 4;
+        pixels[offset] = pixels[offset + 1] = pixels[offset + 2] = 255;
+        pixels[offset + 3] = alpha;
+      }
+    }
+    widened &&
+      console.warn(
+        `DashLine: dash pattern [${dash}] has lengths under 1/${rowLength} of its period, they are drawn that long.`
+      );
+    this._texture.setPixelBuffer(pixels.subarray(rowStart, rowStart + rowLength * 4), 0, 0, row, rowLength, 1);
+  }
+
+  /**
+   * Grow the texture to `rowCount` rows, kept a power of two so the pattern repeats on WebGL1.
+   */
+  private _resize(rowCount: number) {
+    const { rowLength } = LineDashAtlas;
+    const pixels = new Uint8Array(rowLength * rowCount * 4);
+    pixels.set(this._pixels);
+    const texture = new Texture2D(this._engine, rowLength, rowCount, TextureFormat.R8G8B8A8, false);
+    texture.wrapModeU = TextureWrapMode.Repeat;
+    texture.wrapModeV = TextureWrapMode.Clamp;
+    texture.filterMode = TextureFilterMode.Point;
+    texture.setPixelBuffer(pixels);
+    for (const { shaderData } of [this.material, this.instancedMaterial]) {
+      shaderData.setTexture("u_texture", texture);
+      shaderData.setFloat("u_dashRowCount", rowCount);
+    }
+    this._texture?.destroy(true);
+    this._texture = texture;
+    this._pixels = pixels;
+    this._rowCount = rowCount;
+  }
+}
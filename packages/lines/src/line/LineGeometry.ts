@@ -0,0 +1,251 @@
+import { IndexFormat } from "@galacean/engine";
+import { LineCap, LineJoin } from "./constants";
+
+/**
+ * A chunk of pre-tessellated line geometry, a range of segments of one line of the layer.
+ */
+export type LineGeometryChunk = {
+  /** Byte offset of the vertices in the file. */
+  vertexOffset: number;
+  vertexCount: number;
+  /** Byte offset of the indices in the file, they restart at 0 in every chunk. */
+  indexOffset: number;
+  indexCount: number;
+  /** The bounds from `LineVertexBuilder.getVertexBounds`. */
+  bounds: Float32Array;
+  /** The dash length at the end of the chunk. */
+  lengthsofar: number;
+  /** The line of the layer the chunk is a part of. */
+  line: number;
+};
+
+/**
+ * The header and chunk table of a line geometry file.
+ */
+export type LineGeometryHeader = {
+  version: number;
+  dash: boolean;
+  join: LineJoin;
+  cap: LineCap;
+  roundSegments: number;
+  indexFormat: IndexFormat;
+  chunks: LineGeometryChunk[];
+};
+
+/**
+ * Reads the pre-tessellated line geometry files (.lgeo) written by the native `tessellate` tool, see
+ * `native/line_geometry.h` for the layout. Vertices and indices are stored as the builder outputs them, so chunks
+ * are uploaded from views into the fetched bytes without parsing or tessellating.
+ */
+export class LineGeometry {
+  static readonly version = 1;
+  static readonly headerSize = 32;
+  static readonly chunkSize = 48;
+  /** The bytes requested first, enough for the header and table of most layers and often their first chunks. */
+  static readonly initialRangeSize = 65536;
+  /** The chunk requests kept in flight. */
+  static readonly concurrency = 4;
+
+  private static _dashFlag = 1;
+
+  /**
+   * The byte length of the header and chunk table, read from the header.
+   */
+  static getTableByteLength(buffer: ArrayBuffer): number {
+    const view = new DataView(buffer);
+    LineGeometry._checkHeader(view);
+    return LineGeometry.headerSize + view.getUint32(28, true) * LineGeometry.chunkSize;
+  }
+
+  /**
+   * Parse the header and chunk table at the start of `buffer`.
+   */
+  static parse(buffer: ArrayBuffer): LineGeometryHeader {
+    const view = new DataView(buffer);
+    LineGeometry._checkHeader(view);
+    const chunkCount = view.getUint32(28, true);
+    const chunks: LineGeometryChunk[] = [];
+    for (let i = 0; i < chunkCount; i++) {
+      const offset = LineGeometry.headerSize + i * LineGeometry.chunkSize;
+      chunks.push({
+        vertexOffset: view.getUint32(offset, true),
+        vertexCount: view.getUint32(offset + 4, true),
+        indexOffset: view.getUint32(offset + 8, true),
+        indexCount: view.getUint32(offset + 12, true),
+        bounds: new Float32Array(buffer.slice(offset + 16, offset + 40)),
+        lengthsofar: view.getFloat32(offset + 40, true),
+        line: view.getUint32(offset + 44, true)
+      });
+    }
+    return {
+      version: view.getUint32(4, true),
+      dash: (view.getUint32(8, true) & LineGeometry._dashFlag) !== 0,
+      join: view.getInt32(12, true),
+      cap: view.getInt32(16, true),
+      roundSegments: view.getInt32(20, true),
+      indexFormat: view.getInt32(24, true),
+      chunks
+    };
+  }
+
+  /**
+   * The byte range of a chunk, its vertices followed by its indices.
+   */
+  static getChunkRange(header: LineGeometryHeader, chunk: LineGeometryChunk): [number, number] {
+    const indexSize = header.indexFormat === IndexFormat.UInt32 ? 4 : 2;
+    return [chunk.vertexOffset, chunk.indexOffset + chunk.indexCount * indexSize];
+  }
+
+  /**
+   * Fetch a file and pass its chunks to `upload` as they arrive.
+   * @remarks The header and table come with the first byte range request, then the chunks are requested in the
+   * order `prioritize` returns. A server that ignores ranges streams the whole file instead, chunks are uploaded in
+   * file order as soon as their bytes are in.
+   * @param url The file
+   * @param prioritize Called with the header, the chunk indices in the order they are wanted
+   * @param upload Called with every chunk, views valid during the call, returns false to stop loading
+   * @returns The header, once every chunk was passed to `upload` or loading was stopped
+   */
+  static async load(
+    url: string,
+    prioritize: (header: LineGeometryHeader) => number[],
+    upload: (index: number, vertices: Float32Array, indices: Uint16Array | Uint32Array) => boolean
+  ): Promise<LineGeometryHeader> {
+    const response = await fetch(url, { headers: { Range: `bytes=0-${LineGeometry.initialRangeSize - 1}` } });
+    if (!response.ok) {
+      throw new Error(`LineGeometry: failed to load ${url}, status ${response.status}.`);
+    }
+    if (response.status !== 206) {
+      return LineGeometry._loadStream(response, upload);
+    }
+
+    let buffer = await response.arrayBuffer();
+    const tableByteLength = LineGeometry.getTableByteLength(buffer);
+    if (buffer.byteLength < tableByteLength) {
+      buffer = await LineGeometry._fetchRange(url, 0, tableByteLength);
+    }
+    const header = LineGeometry.parse(buffer);
+    const order = prioritize(header);
+    let next = 0;
+    let stopped = false;
+    // Chunks already in the first response are uploaded from it, the others fetched by range.
+    const loadNext = async () => {
+      while (!stopped && next < order.length) {
+        const index = order[next++];
+        const [start, end] = LineGeometry.getChunkRange(header, header.chunks[index]);
+        const chunkBuffer = end <= buffer.byteLength ? buffer : await LineGeometry._fetchRange(url, start, end);
+        const base = chunkBuffer === buffer ? 0 : start;
+        if (!stopped && !LineGeometry._uploadChunk(header, index, chunkBuffer, base, upload)) {
+          stopped = true;
+        }
+      }
+    };
+    const workers: Promise<void>[] = [];
+    for (let i = 0; i < LineGeometry.concurrency; i++) {
+      workers.push(loadNext());
+    }
+    await Promise.all(workers);
+    return header;
+  }
+
+  private static _checkHeader(view: DataView) {
+    if (view.byteLength < LineGeometry.headerSize || view.getUint32(0, true) !== 0x4f45474c) {
+      throw new Error("LineGeometry: not a line geometry file.");
+    }
+    const version = view.getUint32(4, true);
+    if (version !== LineGeometry.version) {
+      throw new Error(`LineGeometry: unsupported version ${version}, expected ${LineGeometry.version}.`);
+    }
+  }
+
+  /**
+   * Fetch bytes [start, end), the returned buffer starts at `start`.
+   */
+  private static async _fetchRange(url: string, start: number, end: number): Promise<ArrayBuffer> {
+    const response = await fetch(url, { headers: { Range: `bytes=${start}-${end - 1}` } });
+    if (!response.ok) {
+      throw new Error(`LineGeometry: failed to load ${url}, status ${response.status}.`);
+    }
+    const buffer = await response.arrayBuffer();
+    // A server may answer a range with the whole file.
+    return response.status === 206 ? buffer : buffer.slice(start, end);
+  }
+
+  /**
+   * Read a response in file order, uploading every chunk whose bytes have all arrived.
+   */
+  private static async _loadStream(
+    response: Response,
+    upload: (index: number, vertices: Float32Array, indices: Uint16Array | Uint32Array) => boolean
+  ): Promise<LineGeometryHeader> {
+    if (!response.body) {
+      const buffer = await response.arrayBuffer();
+      const header = LineGeometry.parse(buffer);
+      for (let i = 0, n = header.chunks.length; i < n; i++) {
+        if (!LineGeometry._uploadChunk(header, i, buffer, 0, upload)) {
+          break;
+        }
+      }
+      return header;
+    }
+    const reader = response.body.getReader();
+    let bytes = new Uint8Array(Number(response.headers.get("Content-Length")) || LineGeometry.initialRangeSize);
+    let received = 0;
+    let header: LineGeometryHeader = null;
+    let next = 0;
+    for (;;) {
+      const { done, value } = await reader.read();
+      if (value) {
+        if (received + value.length > bytes.length) {
+          const grown = new Uint8Array(Math.max(received + value.length, bytes.length * 2));
+          grown.set(bytes.subarray(0, received));
+          bytes = grown;
+        }
+        bytes.set(value, received);
+        received += value.length;
+      }
+      if (!header && received >= LineGeometry.headerSize) {
+        const tableByteLength = LineGeometry.getTableByteLength(bytes.buffer);
+        if (received >= tableByteLength) {
+          header = LineGeometry.parse(bytes.buffer.slice(0, tableByteLength));
+        }
+      }
+      if (header) {
+        const { chunks } = header;
+        while (next < chunks.length && LineGeometry.getChunkRange(header, chunks[next])[1] <= received) {
+          if (!LineGeometry._uploadChunk(header, next++, bytes.buffer, 0, upload)) {
+            reader.cancel();
+            return header;
+          }
+        }
+      }
+      if (done) {
+        break;
+      }
+    }
+    if (!header || next < header.chunks.length) {
+      throw new Error("LineGeometry: the file is truncated.");
+    }
+    return header;
+  }
+
+  /**
+   * View a chunk in a buffer holding the file from byte `base` on and upload it.
+   */
+  private static _uploadChunk(
+    header: LineGeometryHeader,
+    index: number,
+    buffer: ArrayBuffer,
+    base: number,
+    upload: (index: number, vertices: Float32Array, indices: Uint16Array | Uint32Array) => boolean
+  ): boolean {
+    const chunk = header.chunks[index];
+    const vertices = new Float32Array(buffer, chunk.vertexOffset - base, chunk.vertexCount * 6);
+    const indexOffset = chunk.indexOffset - base;
+    const indices =
+      header.indexFormat === IndexFormat.UInt32
+        ? new Uint32Array(buffer, indexOffset, chunk.indexCount)
+        : new Uint16Array(buffer, indexOffset, chunk.indexCount);
+    return upload(index, vertices, indices);
+  }
+}
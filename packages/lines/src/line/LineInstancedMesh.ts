@@ -0,0 +1,182 @@
+import {
+  Buffer,
+  BufferBindFlag,
+  BufferMesh,
+  BufferUsage,
+  Engine,
+  IndexFormat,
+  VertexElement,
+  VertexElementFormat
+} from "@galacean/engine";
+
+/**
+ * @internal
+ * Mesh drawing one instance per line segment, expanded on the GPU from a fixed template by the `lineInstanced`
+ * shader. Only the points are uploaded, as x, y, lengthsofar and the cap flags of the segment they start, so width,
+ * join and cap changes need no upload.
+ */
+export class LineInstancedMesh extends BufferMesh {
+  /** Byte size of one point in the instance buffer. */
+  static readonly pointStride = 16;
+  /** Triangles per half circle of the round join and cap fans in the template. */
+  static readonly roundSegments = 8;
+
+  private static _templateVertices: Float32Array;
+  private static _templateIndices: Uint16Array;
+
+  /**
+   * The template as (x, y, part): the segment quad as (t, side, 0), the join at the segment end as (corner, 0, 1),
+   * the round join fan as (step, 0, 2) and the round cap fans as (step, end, 3), each fan led by its center at step
+   * -1. The shader collapses the parts the join and cap do not use to a point.
+   */
+  private static _createTemplate(): void {
+    const { roundSegments } = LineInstancedMesh;
+    const vertices = [0, -1, 0, 0, 1, 0, 1, -1, 0, 1, 1, 0, 0, 0, 1, 1, 0, 1, 2, 0, 1, 3, 0, 1];
+    const indices = [0, 1, 2, 2, 1, 3, 4, 5, 6, 4, 6, 7];
+    const addFan = (end: number, part: number) => {
+      const center = vertices.length / 3;
+      for (let step = -1; step <= roundSegments; step++) {
+        vertices.push(step, end, part);
+      }
+      for (let step = 0; step < roundSegments; step++) {
+        indices.push(center, center + step + 1, center + step + 2);
+      }
+    };
+    addFan(0, 2);
+    addFan(0, 3);
+    addFan(1, 3);
+    LineInstancedMesh._templateVertices = new Float32Array(vertices);
+    LineInstancedMesh._templateIndices = new Uint16Array(indices);
+  }
+
+  private _points: Float32Array;
+  private _pointCount = 0;
+  private _pointBounds = new Float32Array([Infinity, Infinity, -Infinity, -Infinity]);
+
+  constructor(engine: Engine) {
+    super(engine, "LineInstancedGeometry");
+    LineInstancedMesh._templateVertices || LineInstancedMesh._createTemplate();
+    const { _templateVertices: templateVertices, _templateIndices: templateIndices } = LineInstancedMesh;
+    // The instance buffer holds the points with the first and last repeated, the three points a segment needs are
+    // read from one binding at consecutive offsets.
+    const stride = LineInstancedMesh.pointStride;
+    this.setVertexElements([
+      new VertexElement("a_start", stride, VertexElementFormat.Vector4, 0, 1),
+      new VertexElement("a_end", stride * 2, VertexElementFormat.Vector4, 0, 1),
+      new VertexElement("a_next", stride * 3, VertexElementFormat.Vector4, 0, 1),
+      new VertexElement("a_corner", 0, VertexElementFormat.Vector3, 1)
+    ]);
+    const templateBuffer = new Buffer(engine, BufferBindFlag.VertexBuffer, templateVertices, BufferUsage.Static);
+    this.setVertexBufferBinding(templateBuffer, templateVertices.BYTES_PER_ELEMENT * 3, 1);
+    const indexBuffer = new Buffer(engine, BufferBindFlag.IndexBuffer, templateIndices, BufferUsage.Static);
+    this.setIndexBufferBinding(indexBuffer, IndexFormat.UInt16);
+    const instanceBuffer = new Buffer(engine, BufferBindFlag.VertexBuffer, 4 * stride, BufferUsage.Dynamic);
+    this.setVertexBufferBinding(instanceBuffer, stride, 0);
+    this._points = new Float32Array(instanceBuffer.byteLength / 4);
+    this.addSubMesh(0, 0);
+    // @ts-ignore
+    this._enableVAO = false;
+  }
+
+  /**
+   * Upload the points of the line, flattened as x, y pairs.
+   * @param points The points of the line
+   * @param fromPoint Points before this index are unchanged since the last upload and only appended to, their data
+   * is kept. Pass 0 to upload everything
+   */
+  setPoints(points: number[], fromPoint = 0): void {
+    const pointCount = points.length / 2;
+    const segmentCount = Math.max(pointCount - 1, 0);
+    // Without instances the template would be drawn once, so nothing is drawn instead.
+    this.subMesh.count = segmentCount > 0 ? LineInstancedMesh._templateIndices.length : 0;
+    this.instanceCount = segmentCount;
+    if (segmentCount === 0) {
+      this._pointCount = pointCount;
+      return;
+    }
+
+    // The last kept point is recomputed from its stored lengthsofar, it was repeated as the end before.
+    const first = fromPoint > 0 && fromPoint <= this._pointCount ? fromPoint - 1 : 0;
+    const floatLength = (pointCount + 2) * 4;
+    let buffer = this.vertexBufferBindings[0].buffer;
+    // The point before it starts the segment that ended the line before, its end cap flag is cleared.
+    let uploadStart = first * 4;
+    if (buffer.byteLength < floatLength * 4) {
+      // Grow by 1.5x, the new buffer is uploaded as a whole.
+      const newByteLength = Math.max(floatLength * 4, Math.ceil(buffer.byteLength * 0.375) * 4);
+      const data = new Float32Array(newByteLength / 4);
+      data.set(this._points);
+      this._points = data;
+      const lastBuffer = buffer;
+      buffer = new Buffer(this.engine, BufferBindFlag.VertexBuffer, newByteLength, BufferUsage.Dynamic);
+      // Rebind before destroying, a buffer still referenced by the mesh is not released.
+      this.setVertexBufferBinding(buffer, LineInstancedMesh.pointStride, 0);
+      lastBuffer.destroy();
+      uploadStart = 0;
+    }
+
+    // Entry i + 1 holds point i, entry 0 and entry pointCount + 1 repeat the first and last point. The flags of
+    // point i are those of segment i: 1 when it has the start cap, 2 when it has the end cap.
+    const data = this._points;
+    const pointBounds = this._pointBounds;
+    if (first === 0) {
+      pointBounds.set([Infinity, Infinity, -Infinity, -Infinity]);
+    }
+    let lengthsofar = first > 0 ? data[(first + 1) * 4 + 2] : 0;
+    if (first > 0) {
+      data[first * 4 + 3] = (first === 1 ? 1 : 0) + (first === segmentCount ? 2 : 0);
+    }
+    for (let i = first; i < pointCount; i++) {
+      const x = points[i * 2];
+      const y = points[i * 2 + 1];
+      if (i > first) {
+        lengthsofar += Math.hypot(x - points[i * 2 - 2], y - points[i * 2 - 1]);
+      }
+      const offset = (i + 1) * 4;
+      data[offset] = x;
+      data[offset + 1] = y;
+      data[offset + 2] = lengthsofar;
+      data[offset + 3] = (i === 0 ? 1 : 0) + (i === segmentCount - 1 ? 2 : 0);
+      pointBounds[0] = Math.min(pointBounds[0], x);
+      pointBounds[1] = Math.min(pointBounds[1], y);
+      pointBounds[2] = Math.max(pointBounds[2], x);
+      pointBounds[3] = Math.max(pointBounds[3], y);
+    }
+    data.copyWithin(0, 4, 8);
+    data.copyWithin((pointCount + 1) * 4, pointCount * 4, pointCount * 4 + 4);
+    this._pointCount = pointCount;
+    // Entry 0 changes along with the first point.
+    if (first === 0) {
+      uploadStart = 0;
+    }
+    buffer.setData(data, uploadStart * 4, uploadStart, floatLength - uploadStart);
+  }
+
+  /**
+   * Update the bounds the renderer is culled with, from the uploaded points inflated by the line width.
+   */
+  updateBounds(width: number): void {
+    if (this._pointCount < 2) {
+      return;
+    }
+    const pointBounds = this._pointBounds;
+    // Offsets reach at most 10 widths, at the miter cut-off of the shader.
+    const offset = width * 10;
+    const { bounds } = this;
+    bounds.min.set(pointBounds[0] - offset, pointBounds[1] - offset, 0);
+    bounds.max.set(pointBounds[2] + offset, pointBounds[3] + offset, 0);
+  }
+
+  /**
+   * Destroy the buffers along with the mesh.
+   */
+  protected override _onDestroy(): void {
+    const instanceBuffer = this.vertexBufferBindings[0]?.buffer;
+    const templateBuffer = this.vertexBufferBindings[1]?.buffer;
+    const indexBuffer = this.indexBufferBinding?.buffer;
+    super._onDestroy();
+    instanceBuffer?.destroy(true);
+    templateBuffer?.destroy(true);
+    indexBuffer?.destroy(true);
+  }
+}
@@ -0,0 +1,204 @@
+import {
+  Buffer,
+  BufferBindFlag,
+  BufferMesh,
+  BufferUsage,
+  Engine,
+  IndexFormat,
+  MeshTopology,
+  VertexElement,
+  VertexElementFormat
+} from "@galacean/engine";
+import { LineProfiler } from "./LineProfiler";
+
+/**
+ * @internal
+ * Mesh of line vertices built by `LineVertexBuilder`, keeping persistent dynamic buffers that are
+ * updated in place and only reallocated when they need to grow.
+ */
+export class LineMesh extends BufferMesh {
+  /** Byte size of one line vertex. */
+  static readonly vertexStride = 24;
+  /** Byte size of one vertex in the compact layout of `LineVertexBuilder.packVertices`. */
+  static readonly compactVertexStride = 12;
+
+  /** Whether the mesh uses the compact vertex layout, decoded by the `LINE_COMPACT_VERTEX` shader macro. */
+  readonly compact: boolean;
+  /** Whether the indices are a triangle strip from `LineVertexBuilder.toTriangleStrip`, not a triangle list. */
+  readonly strip: boolean;
+  private _vertexStride: number;
+  private _vertexBounds: Float32Array = null;
+
+  /**
+   * The bytes allocated for the vertex and index buffers.
+   */
+  get byteLength(): number {
+    return (this.vertexBufferBindings[0]?.buffer.byteLength ?? 0) + (this.indexBufferBinding?.buffer.byteLength ?? 0);
+  }
+
+  constructor(engine: Engine, compact = false, strip = false) {
+    super(engine, "LineGeometry");
+    this.compact = compact;
+    this.strip = strip;
+    // Add vertexElement
+    if (compact) {
+      this._vertexStride = LineMesh.compactVertexStride;
+      this.setVertexElements([
+        new VertexElement("a_pos", 0, VertexElementFormat.NormalizedShort2, 0),
+        new VertexElement("a_normal", 4, VertexElementFormat.NormalizedShort2, 0),
+        // direction + 1, part, lengthsofar low and high byte
+        new VertexElement("a_data", 8, VertexElementFormat.UByte4, 0)
+      ]);
+    } else {
+      this._vertexStride = LineMesh.vertexStride;
+      this.setVertexElements([
+        new VertexElement("a_pos", 0, VertexElementFormat.Vector2, 0),
+        new VertexElement("a_normal", 8, VertexElementFormat.Vector2, 0),
+        new VertexElement("a_data", 16, VertexElementFormat.Short2, 0),
+        new VertexElement("a_lengthsofar", 20, VertexElementFormat.Float, 0)
+      ]);
+    }
+    // @ts-ignore
+    this._enableVAO = false;
+  }
+
+  /**
+   * Upload builder output, which may be a view into wasm memory, over the used range of the buffers.
+   */
+  setData(vertices: Float32Array | Uint8Array, indices: Uint16Array | Uint32Array, indexFormat: IndexFormat): void {
+    const profiler = LineProfiler.instance;
+    const profileStart = profiler.enabled ? performance.now() : 0;
+    const lastVertexBuffer = this.vertexBufferBindings[0]?.buffer;
+    const lastIndexBuffer = this.indexBufferBinding?.buffer;
+    const vertexBuffer = this._reserveBuffer(lastVertexBuffer, vertices.byteLength, BufferBindFlag.VertexBuffer);
+    const indexBuffer = this._reserveBuffer(lastIndexBuffer, indices.byteLength, BufferBindFlag.IndexBuffer);
+    // Rebind before destroying, a buffer still referenced by the mesh is not released.
+    if (vertexBuffer !== lastVertexBuffer) {
+      this.setVertexBufferBinding(vertexBuffer, this._vertexStride, 0);
+      lastVertexBuffer?.destroy();
+    }
+    if (indexBuffer !== lastIndexBuffer || indexFormat !== this.indexBufferBinding.format) {
+      this.setIndexBufferBinding(indexBuffer, indexFormat);
+      if (indexBuffer !== lastIndexBuffer) {
+        lastIndexBuffer?.destroy();
+      }
+    }
+
+    vertexBuffer.setData(vertices);
+    indexBuffer.setData(indices);
+    this.setIndexCount(indices.length);
+    if (profileStart) {
+      profiler.addUploadTime(profileStart);
+    }
+  }
+
+  /**
+   * Overwrite the buffers from `vertexStart` on with the output of an append build, keeping the data before it.
+   * @returns False if the buffers are too small, use another index format or hold a strip, the whole line has to
+   * be uploaded with `setData` then.
+   */
+  setSubData(
+    vertices: Float32Array | Uint8Array,
+    indices: Uint16Array | Uint32Array,
+    indexFormat: IndexFormat,
+    vertexStart: number
+  ): boolean {
+    const vertexBuffer = this.vertexBufferBindings[0]?.buffer;
+    const indexBufferBinding = this.indexBufferBinding;
+    if (this.strip || !vertexBuffer || !indexBufferBinding || indexBufferBinding.format !== indexFormat) {
+      return false;
+    }
+    const indexStart = vertexStart * 3;
+    const vertexByteOffset = vertexStart * this._vertexStride;
+    const indexByteOffset = indexStart * indices.BYTES_PER_ELEMENT;
+    const indexBuffer = indexBufferBinding.buffer;
+    if (
+      vertexBuffer.byteLength < vertexByteOffset + vertices.byteLength ||
+      indexBuffer.byteLength < indexByteOffset + indices.byteLength
+    ) {
+      return false;
+    }
+
+    const profiler = LineProfiler.instance;
+    const profileStart = profiler.enabled ? performance.now() : 0;
+    vertexBuffer.setData(vertices, vertexByteOffset);
+    indexBuffer.setData(indices, indexByteOffset);
+    this.setIndexCount(indexStart + indices.length);
+    if (profileStart) {
+      profiler.addUploadTime(profileStart);
+    }
+    return true;
+  }
+
+  /**
+   * Set the bounds the renderer is culled with from the bounds of the built vertices.
+   * @param vertexBounds The bounds from `LineVertexBuilder.getVertexBounds`
+   * @param width The line width, which scales the vertex offsets
+   * @param merge Whether to grow the current bounds instead, for vertices uploaded with `setSubData`
+   */
+  setVertexBounds(vertexBounds: Float32Array, width: number, merge = false): void {
+    const lastBounds = this._vertexBounds;
+    if (merge && lastBounds) {
+      for (let i = 0; i < 6; i++) {
+        lastBounds[i] = i < 2 ? Math.min(lastBounds[i], vertexBounds[i]) : Math.max(lastBounds[i], vertexBounds[i]);
+      }
+    } else {
+      this._vertexBounds = vertexBounds;
+    }
+    this.updateBounds(width);
+  }
+
+  /**
+   * Inflate the bounds of the built vertices by a new line width.
+   */
+  updateBounds(width: number): void {
+    const vertexBounds = this._vertexBounds;
+    if (!vertexBounds) {
+      return;
+    }
+    const offsetX = vertexBounds[4] * width;
+    const offsetY = vertexBounds[5] * width;
+    const { bounds } = this;
+    bounds.min.set(vertexBounds[0] - offsetX, vertexBounds[1] - offsetY, 0);
+    bounds.max.set(vertexBounds[2] + offsetX, vertexBounds[3] + offsetY, 0);
+  }
+
+  /**
+   * Set how many indices are drawn, without touching the buffers.
+   */
+  setIndexCount(count: number): void {
+    const subMesh = this.subMesh;
+    if (subMesh) {
+      subMesh.count = count;
+    } else if (count > 0) {
+      this.addSubMesh(0, count, this.strip ? MeshTopology.TriangleStrip : MeshTopology.Triangles);
+    }
+  }
+
+  /**
+   * Destroy the buffers along with the mesh.
+   */
+  protected override _onDestroy(): void {
+    const vertexBuffer = this.vertexBufferBindings[0]?.buffer;
+    const indexBuffer = this.indexBufferBinding?.buffer;
+    super._onDestroy();
+    vertexBuffer?.destroy(true);
+    indexBuffer?.destroy(true);
+  }
+
+  /**
+   * Return the buffer if it can hold byteLength bytes, otherwise a new dynamic buffer grown geometrically.
+   */
+  private _reserveBuffer(buffer: Buffer, byteLength: number, type: BufferBindFlag): Buffer {
+    if (buffer && buffer.byteLength >= byteLength) {
+      return buffer;
+    }
+    // Grow by 1.5x, rounded up to a multiple of 4 bytes.
+    const newByteLength = Math.max(byteLength, Math.ceil((buffer?.byteLength ?? 0) * 0.375) * 4);
+    const profiler = LineProfiler.instance;
+    if (buffer && profiler.enabled) {
+      profiler.recordReallocation();
+    }
+    return new Buffer(this.engine, type, newByteLength, BufferUsage.Dynamic);
+  }
+}
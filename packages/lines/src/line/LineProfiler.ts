@@ -0,0 +1,247 @@
+/**
+ * The line work of one frame, recorded by `LineProfiler`.
+ */
+export type LineProfilerFrame = {
+  /** The engine frame count. */
+  frame: number;
+  /** The `performance.now()` the frame ended at, in milliseconds. */
+  time: number;
+  /** Runs of the tessellation kernel, on the main thread or on workers. A batch counts each of its lines. */
+  calls: number;
+  /** Points read by the tessellation calls. */
+  points: number;
+  vertices: number;
+  indices: number;
+  /** Milliseconds line.c spent building, packing and converting on the main thread, timed in wasm. */
+  wasmTime: number;
+  /** Milliseconds spent copying points into wasm memory. */
+  copyTime: number;
+  /** Milliseconds spent uploading vertices and indices to GPU buffers. */
+  uploadTime: number;
+  /** The bytes the main thread wasm malloc has taken from its memory, its high-water mark. */
+  heapBytes: number;
+  /** Wasm heap regions and GPU buffers reallocated to grow. */
+  reallocations: number;
+};
+
+const FRAME = 0;
+const TIME = 1;
+const CALLS = 2;
+const POINTS = 3;
+const VERTICES = 4;
+const INDICES = 5;
+const WASM_TIME = 6;
+const COPY_TIME = 7;
+const UPLOAD_TIME = 8;
+const HEAP_BYTES = 9;
+const REALLOCATIONS = 10;
+const FIELD_COUNT = 11;
+
+/**
+ * Records what line tessellation costs every frame into a ring buffer, for the stats panel or a trace.
+ * @remarks Disabled by default, then every probe is a single branch, in line.c too. A frame is closed by the first
+ * `Line.onLateUpdate` of the frame, after the queued rebuilds ran, so work finished by workers after it counts to
+ * the next frame. Frames without an enabled line are not recorded.
+ */
+export class LineProfiler {
+  private static _instance: LineProfiler;
+  static get instance(): LineProfiler {
+    if (!this._instance) {
+      this._instance = new LineProfiler();
+    }
+    return this._instance;
+  }
+
+  private _frames = new Float64Array(300 * FIELD_COUNT);
+  private _frameCapacity = 300;
+  /** Ring slot the next frame is written to. */
+  private _head = 0;
+  private _recordedFrameCount = 0;
+  private _current = new Float64Array(FIELD_COUNT);
+  private _frame = -1;
+  private _heapBytes = 0;
+  private _enabled = false;
+
+  /**
+   * Whether to record, turning it on starts recording at once, so the frame it is turned on in is recorded in part.
+   */
+  get enabled(): boolean {
+    return this._enabled;
+  }
+
+  set enabled(value: boolean) {
+    if (value !== this._enabled) {
+      this._enabled = value;
+      this._current.fill(0);
+      this._frame = -1;
+    }
+  }
+
+  /**
+   * The number of frames kept, the oldest are overwritten.
+   */
+  get frameCapacity(): number {
+    return this._frameCapacity;
+  }
+
+  set frameCapacity(value: number) {
+    value = Math.max(1, Math.floor(value));
+    if (value !== this._frameCapacity) {
+      this._frameCapacity = value;
+      this._frames = new Float64Array(value * FIELD_COUNT);
+      this.reset();
+    }
+  }
+
+  /**
+   * The number of frames recorded, up to `frameCapacity`.
+   */
+  get recordedFrameCount(): number {
+    return this._recordedFrameCount;
+  }
+
+  /**
+   * Read a recorded frame.
+   * @param ago 0 for the last closed frame, 1 for the one before...
+   * @param out The frame to write to
+   * @returns The frame, null if `ago` is beyond the recorded frames
+   */
+  getFrame(ago: number, out?: LineProfilerFrame): LineProfilerFrame | null {
+    if (!(ago >= 0 && ago < this._recordedFrameCount)) {
+      return null;
+    }
+    const capacity = this._frameCapacity;
+    const offset = ((this._head - 1 - ago + capacity) % capacity) * FIELD_COUNT;
+    const frames = this._frames;
+    out = out ?? ({} as LineProfilerFrame);
+    out.frame = frames[offset + FRAME];
+    out.time = frames[offset + TIME];
+    out.calls = frames[offset + CALLS];
+    out.points = frames[offset + POINTS];
+    out.vertices = frames[offset + VERTICES];
+    out.indices = frames[offset + INDICES];
+    out.wasmTime = frames[offset + WASM_TIME];
+    out.copyTime = frames[offset + COPY_TIME];
+    out.uploadTime = frames[offset + UPLOAD_TIME];
+    out.heapBytes = frames[offset + HEAP_BYTES];
+    out.reallocations = frames[offset + REALLOCATIONS];
+    return out;
+  }
+
+  /**
+   * Export the recorded frames as counter events of the Chrome trace event format, for chrome://tracing or
+   * Perfetto. Serialize the result with `JSON.stringify`.
+   */
+  exportTrace(): { traceEvents: object[] } {
+    const traceEvents: object[] = [];
+    const frame = {} as LineProfilerFrame;
+    for (let ago = this._recordedFrameCount - 1; ago >= 0; ago--) {
+      this.getFrame(ago, frame);
+      const ts = frame.time * 1000;
+      const { calls, points, vertices, indices } = frame;
+      traceEvents.push(
+        { name: "Line tessellation", ph: "C", ts, pid: 1, tid: 1, args: { calls, points, vertices, indices } },
+        {
+          name: "Line time (ms)",
+          ph: "C",
+          ts,
+          pid: 1,
+          tid: 1,
+          args: { wasm: frame.wasmTime, copy: frame.copyTime, upload: frame.uploadTime }
+        },
+        {
+          name: "Line memory",
+          ph: "C",
+          ts,
+          pid: 1,
+          tid: 1,
+          args: { heapBytes: frame.heapBytes, reallocations: frame.reallocations }
+        }
+      );
+    }
+    return { traceEvents };
+  }
+
+  /**
+   * Drop the recorded frames and the frame being recorded.
+   */
+  reset(): void {
+    this._head = 0;
+    this._recordedFrameCount = 0;
+    this._current.fill(0);
+    this._frame = -1;
+  }
+
+  /**
+   * @internal
+   * Count a tessellation call and its output.
+   */
+  recordBuild(pointCount: number, vertexCount: number, indexCount: number): void {
+    const current = this._current;
+    current[CALLS]++;
+    current[POINTS] += pointCount;
+    current[VERTICES] += vertexCount;
+    current[INDICES] += indexCount;
+  }
+
+  /**
+   * @internal
+   * Add what line.c counted, see `struct LineCounters`.
+   */
+  recordBuilds(calls: number, points: number, vertices: number, indices: number, wasmTime: number): void {
+    const current = this._current;
+    current[CALLS] += calls;
+    current[POINTS] += points;
+    current[VERTICES] += vertices;
+    current[INDICES] += indices;
+    current[WASM_TIME] += wasmTime;
+  }
+
+  /**
+   * @internal
+   */
+  addCopyTime(start: number): void {
+    this._current[COPY_TIME] += performance.now() - start;
+  }
+
+  /**
+   * @internal
+   */
+  addUploadTime(start: number): void {
+    this._current[UPLOAD_TIME] += performance.now() - start;
+  }
+
+  /**
+   * @internal
+   */
+  recordReallocation(): void {
+    this._current[REALLOCATIONS]++;
+  }
+
+  /**
+   * @internal
+   * Set the malloc high-water mark, see `heapBytes`.
+   */
+  recordHeap(byteLength: number): void {
+    this._heapBytes = Math.max(this._heapBytes, byteLength);
+  }
+
+  /**
+   * @internal
+   * Close the frame being recorded as frame `frameCount`, once per frame.
+   */
+  endFrame(frameCount: number): void {
+    if (!this._enabled || frameCount === this._frame) {
+      return;
+    }
+    const current = this._current;
+    current[FRAME] = frameCount;
+    current[TIME] = performance.now();
+    current[HEAP_BYTES] = this._heapBytes;
+    this._frames.set(current, this._head * FIELD_COUNT);
+    this._head = (this._head + 1) % this._frameCapacity;
+    this._recordedFrameCount = Math.min(this._recordedFrameCount + 1, this._frameCapacity);
+    current.fill(0);
+    this._frame = frameCount;
+  }
+}
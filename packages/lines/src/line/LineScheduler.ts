@@ -0,0 +1,170 @@
+import { BoundingBox, BoundingFrustum, Camera, Engine, MathUtil, Matrix, Vector3 } from "@galacean/engine";
+import { Line } from "./Line";
+import { LineVertexBuilder } from "./vertexBuilder";
+
+/**
+ * Rebuilds the lines of an engine changed in a frame from one queue, within a time budget per frame.
+ * @remarks A line changed several times before its rebuild is rebuilt once. Lines in view of `camera` are rebuilt
+ * first, larger ones on screen before smaller ones, so large updates spread over frames starting with what is seen.
+ */
+export class LineScheduler {
+  private static _schedulers = new Map<Engine, LineScheduler>();
+
+  /**
+   * The scheduler of `engine`, created on first use and dropped when the engine shuts down.
+   */
+  static get(engine: Engine): LineScheduler {
+    let scheduler = this._schedulers.get(engine);
+    if (!scheduler) {
+      scheduler = new LineScheduler();
+      this._schedulers.set(engine, scheduler);
+      engine.once("shutdown", () => this._schedulers.delete(engine));
+    }
+    return scheduler;
+  }
+
+  /** The time in milliseconds rebuilds may take per frame, 0 for no limit. At least one line is rebuilt a frame. */
+  frameBudget = 0;
+  /** The camera rebuilds are prioritized for, without it lines are ordered by their size in world space. */
+  camera: Camera = null;
+
+  private _queue = new Set<Line>();
+  private _frameCount = -1;
+  private _lastFrameTime = 0;
+  private _lastRebuildCount = 0;
+  private _overrunCount = 0;
+  private _frustum = new BoundingFrustum();
+  private _matrix = new Matrix();
+  private _bounds = new BoundingBox();
+  private _center = new Vector3();
+  // Reused by every flush.
+  private _lines: Line[] = [];
+  private _priorities = new Map<Line, number>();
+  private _comparePriority = (a: Line, b: Line) => this._priorities.get(b) - this._priorities.get(a);
+
+  /**
+   * The number of lines waiting for a rebuild.
+   */
+  get queueDepth(): number {
+    return this._queue.size;
+  }
+
+  /**
+   * The time in milliseconds spent rebuilding in the last frame that rebuilt lines.
+   */
+  get lastFrameTime(): number {
+    return this._lastFrameTime;
+  }
+
+  /**
+   * The number of lines rebuilt in the last frame that rebuilt lines.
+   */
+  get lastRebuildCount(): number {
+    return this._lastRebuildCount;
+  }
+
+  /**
+   * The number of frames whose rebuilds took longer than `frameBudget`, a single line over budget overruns it.
+   */
+  get overrunCount(): number {
+    return this._overrunCount;
+  }
+
+  /**
+   * @internal
+   * Queue a line for a rebuild, a line already queued stays queued once.
+   */
+  schedule(line: Line): void {
+    this._queue.add(line);
+  }
+
+  /**
+   * @internal
+   */
+  unschedule(line: Line): void {
+    this._queue.delete(line);
+  }
+
+  /**
+   * @internal
+   * Rebuild queued lines in priority order until the budget runs out, once per frame.
+   */
+  flush(frameCount: number): void {
+    const queue = this._queue;
+    if (frameCount === this._frameCount || !queue.size || !LineVertexBuilder.instance.loaded) {
+      return;
+    }
+    this._frameCount = frameCount;
+
+    const lines = this._lines;
+    const priorities = this._priorities;
+    // Left filled if a rebuild threw.
+    lines.length = 0;
+    priorities.clear();
+    this._updateFrustum();
+    for (const line of queue) {
+      lines.push(line);
+      priorities.set(line, this._getPriority(line));
+    }
+    lines.sort(this._comparePriority);
+
+    const { frameBudget } = this;
+    const start = performance.now();
+    let elapsed = 0;
+    let count = 0;
+    for (let i = 0, n = lines.length; i < n; i++) {
+      if (frameBudget > 0 && count > 0 && elapsed >= frameBudget) {
+        break;
+      }
+      const line = lines[i];
+      queue.delete(line);
+      line._rebuild();
+      count++;
+      elapsed = performance.now() - start;
+    }
+    lines.length = 0;
+    priorities.clear();
+    this._lastFrameTime = elapsed;
+    this._lastRebuildCount = count;
+    if (frameBudget > 0 && elapsed > frameBudget) {
+      this._overrunCount++;
+    }
+  }
+
+  private _updateFrustum() {
+    const { camera } = this;
+    if (camera) {
+      Matrix.multiply(camera.projectionMatrix, camera.viewMatrix, this._matrix);
+      this._frustum.calculateFromMatrix(this._matrix);
+    }
+  }
+
+  /**
+   * Lines in view rank above lines out of view, within each group larger lines rank higher. Lines never built have
+   * no bounds yet and rank first.
+   */
+  private _getPriority(line: Line): number {
+    const bounds = this._bounds;
+    if (!line._getBounds(bounds)) {
+      return 2;
+    }
+    const { camera } = this;
+    const diagonal = Vector3.distance(bounds.min, bounds.max);
+    let size = diagonal;
+    let visible = true;
+    if (camera) {
+      visible = this._frustum.intersectsBox(bounds);
+      if (camera.isOrthographic) {
+        size = diagonal / (camera.orthographicSize * 2);
+      } else {
+        bounds.getCenter(this._center);
+        const distance = Vector3.distance(camera.entity.transform.worldPosition, this._center);
+        const tanHalfFov = Math.tan(MathUtil.degreeToRadian(camera.fieldOfView) / 2);
+        size = diagonal / (2 * Math.max(distance, camera.nearClipPlane) * tanHalfFov);
+      }
+    }
+    // Maps size to [0, 1) so the groups never overlap.
+    const rank = 1 - 1 / (1 + size);
+    return visible ? 1 + rank : rank;
+  }
+}
@@ -9,3 +9,15 @@ export enum LineJoin {
   Round = 1,
   Bevel = 2
 }
+
+/**
+ * The layout of the control points passed to `Line.setCurve`.
+ */
+export enum LineCurveType {
+  /** Quadratic Bézier pieces sharing their end points: start, control, end, control, end... */
+  QuadraticBezier = 0,
+  /** Cubic Bézier pieces sharing their end points: start, control, control, end, control, control, end... */
+  CubicBezier = 1,
+  /** A uniform Catmull-Rom spline passing through every point. */
+  CatmullRom = 2
+}
@@ -0,0 +1,10 @@
+import { Shader, Engine } from "@galacean/engine";
+import { LineMaterial } from "./LineMaterial";
+import "./lineBatchShader";
+
+export class LineBatchMaterial extends LineMaterial {
+  constructor(engine: Engine) {
+    super(engine);
+    this.shader = Shader.find("lineBatch");
+  }
+}
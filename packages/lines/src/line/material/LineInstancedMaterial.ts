@@ -0,0 +1,13 @@
+import { Shader, Engine } from "@galacean/engine";
+import { LineMaterial } from "./LineMaterial";
+import "./lineInstancedShader";
+
+export class LineInstancedMaterial extends LineMaterial {
+  constructor(engine: Engine, dash = false) {
+    super(engine);
+    this.shader = Shader.find("lineInstanced");
+    if (dash) {
+      this.shaderData.enableMacro("LINE_DASH");
+    }
+  }
+}
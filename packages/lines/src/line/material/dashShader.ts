@@ -4,37 +4,35 @@ import { Shader } from "@galacean/engine";
 const vertexSource = `
 attribute vec2 a_pos;
 attribute vec2 a_normal;
+#ifdef LINE_COMPACT_VERTEX
+attribute vec4 a_data;
+uniform vec4 u_vertexPack;
+uniform vec2 u_lengthPack;
+#else
 attribute vec2 a_data;
 attribute float a_lengthsofar;
+#endif
 
 uniform mat4 renderer_MVPMat;
 uniform float u_width;
-uniform vec2 u_dash;
+// 周期, 偏移, 图集中的行
+uniform vec3 u_dashPattern;
+uniform float u_dashRowCount;
 
-varying vec2 v_origin;
-varying vec2 v_position;
-varying float v_direction;
-varying float v_part;
 varying vec2 v_tex;
 
 void main() {
-    v_direction = a_data.x;
-    v_part = a_data.y;
-    float layer_index = 1.0;
-
-
-    v_origin = a_pos;
-
-    float texcoord_y = 0.0;
-
-    texcoord_y = a_lengthsofar / (u_dash.x + u_dash.y);
-    if (v_direction == 1.0) {
-        v_tex = vec2(1.0, texcoord_y);
-    } else {
-        v_tex = vec2(0.0, texcoord_y);
-    }
-    vec2 position = a_pos + a_normal * u_width;
-    v_position = position;
+#ifdef LINE_COMPACT_VERTEX
+    vec2 pos = u_vertexPack.xy + a_pos * u_vertexPack.zw;
+    vec2 normal = a_normal * 16.0;
+    float lengthsofar = u_lengthPack.x + (a_data.z + a_data.w * 256.0) / 65535.0 * u_lengthPack.y;
+#else
+    vec2 pos = a_pos;
+    vec2 normal = a_normal;
+    float lengthsofar = a_lengthsofar;
+#endif
+    v_tex = vec2((lengthsofar + u_dashPattern.y) / u_dashPattern.x, (u_dashPattern.z + 0.5) / u_dashRowCount);
+    vec2 position = pos + normal * u_width;
     gl_Position = renderer_MVPMat * vec4(position, 0.0, 1);
 }
   `;
@@ -43,31 +41,11 @@ const fragmentSource = `
 precision highp float;
 
 uniform vec4 u_color;
-uniform int u_join;
-uniform int u_cap;
-uniform float u_width;
 uniform sampler2D u_texture;
 
-varying vec2 v_origin;
-varying vec2 v_position;
-varying float v_direction;
-varying float v_part;
 varying vec2 v_tex;
 
-float IS_CAP = 0.0;
-
 void main() {
-    vec4 finalColor;
-    if (u_cap == 0 && v_part == IS_CAP) {
-      if (distance(v_position, v_origin) > u_width) {
-        discard;
-      }
-    }
-    if (u_join == 1 && v_part > 1.5) {
-      if (distance(v_position, v_origin) > u_width) {
-        discard;
-      }
-    }
     vec4 textureColor = texture2D(u_texture, v_tex);
     if (textureColor.a <= 0.5) {
       gl_FragColor = vec4(u_color.rgb, 0.0);
@@ -0,0 +1,31 @@
+import { Shader } from "@galacean/engine";
+
+//-- Shader 代码
+// 合批的线: 线宽存在 a_lengthsofar. cap 和 join 已经体现在三角形里 (圆角和圆头都已三角化), 着色器只需要按线宽展开,
+// 不读 a_data. a_data.y 高位的 cap 和 join 编码 (见 line.h 的 BATCH_CAP_SHIFT) 是给读回顶点的代码用的
+const vertexSource = `
+attribute vec2 a_pos;
+attribute vec2 a_normal;
+attribute vec2 a_data;
+attribute float a_lengthsofar;
+
+uniform mat4 renderer_MVPMat;
+
+void main() {
+    vec2 position = a_pos + a_normal * a_lengthsofar;
+    gl_Position = renderer_MVPMat * vec4(position, 0.0, 1);
+}
+  `;
+
+const fragmentSource = `
+precision highp float;
+
+uniform vec4 u_color;
+
+void main() {
+    gl_FragColor = u_color;
+}
+
+  `;
+
+Shader.create("lineBatch", vertexSource, fragmentSource);
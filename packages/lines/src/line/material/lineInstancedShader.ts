@@ -0,0 +1,131 @@
+import { Shader } from "@galacean/engine";
+import { LineInstancedMesh } from "../LineInstancedMesh";
+
+//-- Shader 代码
+// 实例化的线: 每个实例是一段线段, 顶点着色器把固定模板展开成线段的矩形, 末端的拐角和圆形的拐角, 线帽
+// a_corner: 矩形 (t, side, 0), 拐角 (顶点序号, 0, 1), 圆角扇形 (步数, 0, 2), 圆帽扇形 (步数, 是否末端, 3),
+// 扇形的圆心步数为 -1; 实例属性 xy 为点坐标, z 为 lengthsofar, w 为起点所在线段的线帽标记
+const vertexSource = `
+#define PI 3.14159265359
+#define ROUND_SEGMENTS ${LineInstancedMesh.roundSegments}.0
+
+attribute vec3 a_corner;
+attribute vec4 a_start;
+attribute vec4 a_end;
+attribute vec4 a_next;
+
+uniform mat4 renderer_MVPMat;
+uniform float u_width;
+uniform int u_join;
+uniform int u_cap;
+#ifdef LINE_DASH
+// 周期, 偏移, 图集中的行
+uniform vec3 u_dashPattern;
+uniform float u_dashRowCount;
+varying vec2 v_tex;
+#endif
+
+vec2 direction(vec2 from, vec2 to, vec2 fallback) {
+    vec2 delta = to - from;
+    float len = length(delta);
+    return len > 0.0 ? delta / len : fallback;
+}
+
+void main() {
+    vec2 start = a_start.xy;
+    vec2 end = a_end.xy;
+    float len = distance(start, end);
+    vec2 dir = direction(start, end, vec2(1.0, 0.0));
+    vec2 normal = vec2(-dir.y, dir.x);
+    // 线帽标记: 1 为首段带起点线帽, 2 为末段带终点线帽
+    float capStart = mod(a_start.w, 2.0);
+    float capEnd = step(1.5, a_start.w);
+    float part = a_corner.z;
+
+    vec2 position;
+    float lengthsofar;
+    if (part < 0.5) {
+        // square 线帽向外延伸半个线宽, round 线帽由扇形补上
+        float extend = u_cap == 2 ? u_width : 0.0;
+        float along = a_corner.x < 0.5 ? -capStart * extend : len + capEnd * extend;
+        position = start + dir * along + normal * a_corner.y * u_width;
+        lengthsofar = a_start.z + along;
+    } else if (part < 2.5) {
+        // 拐角在外侧补一个 miter 形状的四边形, bevel 截掉尖角, round 改用扇形, 不用的部分收缩成一个点
+        vec2 nextDir = direction(end, a_next.xy, dir);
+        float outer = dir.x * nextDir.y - dir.y * nextDir.x > 0.0 ? -1.0 : 1.0;
+        vec2 n0 = normal * outer;
+        vec2 n1 = vec2(-nextDir.y, nextDir.x) * outer;
+        vec2 offset = vec2(0.0);
+        if (part > 1.5) {
+            if (u_join == 1 && a_corner.x > -0.5) {
+                // 从 n0 沿外侧转到 n1
+                float angle = acos(clamp(dot(n0, n1), -1.0, 1.0)) * a_corner.x / ROUND_SEGMENTS;
+                float turn = n0.x * n1.y - n0.y * n1.x < 0.0 ? -1.0 : 1.0;
+                offset = n0 * cos(angle) + vec2(-n0.y, n0.x) * (turn * sin(angle));
+            }
+        } else if (u_join != 1) {
+            if (a_corner.x > 2.5) {
+                offset = n1;
+            } else if (a_corner.x > 1.5) {
+                vec2 miter = n0 + n1;
+                float miterLength = length(miter);
+                miter = miterLength > 0.0 ? miter / miterLength : n0;
+                float cosHalf = dot(miter, n0);
+                // 与 calc_offset2 相同, 夹角太小时 miter 过长, 截断处理
+                if (u_join == 2 || (u_join == 0 && cosHalf < 0.1)) {
+                    offset = (n0 + n1) * 0.5;
+                } else {
+                    offset = miter / max(cosHalf, 0.1);
+                }
+            } else if (a_corner.x > 0.5) {
+                offset = n0;
+            }
+        }
+        offset *= u_width * (1.0 - capEnd);
+        position = end + offset;
+        lengthsofar = a_end.z;
+    } else {
+        // 圆形线帽是从法线经过线段外侧转到反向法线的半圆
+        float atEnd = a_corner.y;
+        vec2 offset = vec2(0.0);
+        if (u_cap == 0 && a_corner.x > -0.5) {
+            float angle = PI * a_corner.x / ROUND_SEGMENTS;
+            offset = normal * cos(angle) + dir * (sin(angle) * (atEnd > 0.5 ? 1.0 : -1.0));
+        }
+        offset *= u_width * (atEnd > 0.5 ? capEnd : capStart);
+        position = (atEnd > 0.5 ? end : start) + offset;
+        lengthsofar = (atEnd > 0.5 ? a_end.z : a_start.z) + dot(offset, dir);
+    }
+
+#ifdef LINE_DASH
+    v_tex = vec2((lengthsofar + u_dashPattern.y) / u_dashPattern.x, (u_dashPattern.z + 0.5) / u_dashRowCount);
+#endif
+    gl_Position = renderer_MVPMat * vec4(position, 0.0, 1);
+}
+  `;
+
+const fragmentSource = `
+precision highp float;
+
+uniform vec4 u_color;
+#ifdef LINE_DASH
+uniform sampler2D u_texture;
+varying vec2 v_tex;
+#endif
+
+void main() {
+#ifdef LINE_DASH
+    vec4 textureColor = texture2D(u_texture, v_tex);
+    if (textureColor.a <= 0.5) {
+      gl_FragColor = vec4(u_color.rgb, 0.0);
+    } else {
+      gl_FragColor = u_color;
+    }
+#else
+    gl_FragColor = u_color;
+#endif
+}
+`;
+
+Shader.create("lineInstanced", vertexSource, fragmentSource);
@@ -8,20 +8,21 @@ attribute vec2 a_data;
 
 uniform mat4 renderer_MVPMat;
 uniform float u_width;
-
-varying vec2 v_origin;
-varying vec2 v_position;
-varying float v_direction;
-varying float v_part;
+#ifdef LINE_COMPACT_VERTEX
+uniform vec4 u_vertexPack;
+#endif
 
 void main() {
-    v_direction = a_data.x;
-    v_part = a_data.y;
+#ifdef LINE_COMPACT_VERTEX
+    vec2 pos = u_vertexPack.xy + a_pos * u_vertexPack.zw;
+    vec2 normal = a_normal * 16.0;
+#else
+    vec2 pos = a_pos;
+    vec2 normal = a_normal;
+#endif
     float layer_index = 1.0;
 
-    v_origin = a_pos;
-    vec2 position = a_pos + a_normal * u_width;
-    v_position = position;
+    vec2 position = pos + normal * u_width;
     gl_Position = renderer_MVPMat * vec4(position, 0.0, 1);
 }
   `;
@@ -30,30 +31,8 @@ const fragmentSource = `
 precision highp float;
 
 uniform vec4 u_color;
-uniform int u_join;
-uniform int u_cap;
-uniform float u_width;
-
-varying vec2 v_origin;
-varying vec2 v_position;
-varying float v_direction;
-varying float v_part;
-
-float IS_CAP = 0.0;
 
 void main() {
-    vec4 finalColor;
-    if (u_cap == 0 && v_part == IS_CAP) {
-      if (distance(v_position, v_origin) > u_width) {
-        discard;
-      }
-    }
-    if (u_join == 1 && v_part > 1.0) {
-      if (distance(v_position, v_origin) > u_width) {
-        discard;
-      }
-    }
-
     gl_FragColor = u_color;
 }
 
@@ -0,0 +1,86 @@
+import { Logger } from "@galacean/engine";
+
+/**
+ * A line to tessellate on a worker, with the same chunking as `Line` on the main thread.
+ */
+export interface ILineWorkerJob {
+  /** The points, flattened as x, y pairs. The buffer is transferred to the worker. */
+  points: Float32Array;
+  dash: boolean;
+  join: number;
+  cap: number;
+  indexFormat: number;
+  chunkSegmentCount: number;
+  /** The segments per half circle of round joins and caps, see `LineVertexBuilder.roundSegments`. */
+  roundSegments: number;
+  /** Whether to pack the vertices to the 12 byte compact layout. */
+  compact: boolean;
+  /** Whether to convert the indices to a triangle strip, see `LineVertexBuilder.toTriangleStrip`. */
+  strip: boolean;
+}
+
+/**
+ * A chunk tessellated by a worker, in buffers transferred back to the main thread.
+ */
+export interface ILineWorkerChunk {
+  vertices: Float32Array | Uint8Array;
+  indices: Uint16Array | Uint32Array;
+  /** The culling bounds, see `LineVertexBuilder.getVertexBounds`. */
+  bounds: Float32Array;
+  /** The decode parameters of compact vertices, see `LineVertexBuilder.packVertices`. */
+  pack: Float32Array | null;
+  lengthsofar: number;
+}
+
+export class LineWorker {
+  // Worker instance.
+  private _worker: Worker;
+  private _callbacks: { [taskId: number]: IResolveReject } = {};
+  private _busy = false;
+
+  /**
+   * Whether the worker is running a job, jobs are given to idle workers only so queued jobs can still be dropped.
+   */
+  get busy(): boolean {
+    return this._busy;
+  }
+
+  constructor(workerSourceURL: string, module: WebAssembly.Module) {
+    this._worker = new Worker(workerSourceURL);
+    this._worker.onmessage = (e) => {
+      const message = e.data;
+      const callback = this._callbacks[message.id];
+      delete this._callbacks[message.id];
+      this._busy = false;
+      switch (message.type) {
+        case "build":
+          callback.resolve(message.chunks);
+          break;
+
+        case "error":
+          callback.reject(new Error(message.error));
+          break;
+        default:
+          Logger.error('LineWorker: Unexpected message, "' + message.type + '"');
+      }
+    };
+    this._worker.postMessage({ type: "init", module });
+  }
+
+  build(taskId: number, job: ILineWorkerJob): Promise<ILineWorkerChunk[]> {
+    this._busy = true;
+    return new Promise((resolve, reject) => {
+      this._callbacks[taskId] = { resolve, reject };
+      this._worker.postMessage({ type: "build", id: taskId, job }, [job.points.buffer]);
+    });
+  }
+
+  terminate(): void {
+    this._worker.terminate();
+  }
+}
+
+interface IResolveReject {
+  resolve: (any) => void;
+  reject: (any) => void;
+}
@@ -0,0 +1,105 @@
+import { decodeLineWasm } from "./index";
+import { ILineWorkerChunk, ILineWorkerJob, LineWorker } from "./LineWorker";
+import workerString from "./worker/worker.js";
+
+interface ILineWorkerTask {
+  owner: object;
+  job: ILineWorkerJob;
+  resolve: (chunks: ILineWorkerChunk[] | null) => void;
+  reject: (reason: any) => void;
+}
+
+/**
+ * Tessellates lines on a pool of Web Workers, each running its own instance of the line wasm module.
+ */
+export class LineWorkerPool {
+  private static _instance: LineWorkerPool;
+  static get instance(): LineWorkerPool {
+    if (!this._instance) {
+      this._instance = new LineWorkerPool();
+    }
+    return this._instance;
+  }
+
+  /** The max number of workers. */
+  workerLimit = Math.min(navigator.hardwareConcurrency || 4, 4);
+
+  private _workers: LineWorker[] = [];
+  private _queue: ILineWorkerTask[] = [];
+  private _currentTaskId = 1;
+  private _workerSourceURL: string;
+  private _module: WebAssembly.Module;
+  private _modulePromise: Promise<void>;
+
+  constructor() {
+    this._modulePromise = WebAssembly.compile(decodeLineWasm()).then((module) => {
+      this._module = module;
+      this._workerSourceURL = URL.createObjectURL(new Blob([workerString]));
+    });
+  }
+
+  /**
+   * Tessellate a line on a worker.
+   * @remarks Jobs wait in a queue until a worker is idle. A queued job of the same owner is superseded by the new
+   * one and resolves null without being run.
+   * @param owner The line the job is for
+   * @param job The line to tessellate
+   * @returns The chunks, or null if the job was superseded
+   */
+  build(owner: object, job: ILineWorkerJob): Promise<ILineWorkerChunk[] | null> {
+    const queue = this._queue;
+    for (let i = queue.length - 1; i >= 0; i--) {
+      if (queue[i].owner === owner) {
+        queue[i].resolve(null);
+        queue.splice(i, 1);
+      }
+    }
+    return new Promise((resolve, reject) => {
+      queue.push({ owner, job, resolve, reject });
+      this._modulePromise.then(() => this._dispatch(), reject);
+    });
+  }
+
+  /**
+   * Terminate the workers, queued jobs resolve null.
+   */
+  destroy(): void {
+    this._queue.forEach((task) => task.resolve(null));
+    this._queue.length = 0;
+    this._workers.forEach((worker) => worker.terminate());
+    this._workers.length = 0;
+    if (LineWorkerPool._instance === this) {
+      LineWorkerPool._instance = null;
+    }
+  }
+
+  private _dispatch(): void {
+    const queue = this._queue;
+    while (queue.length) {
+      const worker = this._getIdleWorker();
+      if (!worker) {
+        return;
+      }
+      const task = queue.shift();
+      worker
+        .build(this._currentTaskId++, task.job)
+        .then(task.resolve, task.reject)
+        .finally(() => this._dispatch());
+    }
+  }
+
+  private _getIdleWorker(): LineWorker | null {
+    const workers = this._workers;
+    for (let i = 0, n = workers.length; i < n; i++) {
+      if (!workers[i].busy) {
+        return workers[i];
+      }
+    }
+    if (workers.length < this.workerLimit) {
+      const worker = new LineWorker(this._workerSourceURL, this._module);
+      workers.push(worker);
+      return worker;
+    }
+    return null;
+  }
+}
@@ -1,9 +1,12 @@
-exported_funcs="['_build_solid_line','_build_dash_line']"
+# Builds line.wasm and line_simd.wasm with tools/wasmcc, see tools/wasmcc/build.sh for what it needs.
+set -e
+cd "$(dirname "$0")"
+wasmcc=../../../../../tools/wasmcc/build.sh
 
-emcc -Os --no-entry\
- -s ERROR_ON_UNDEFINED_SYMBOLS=0\
- -s STANDALONE_WASM=1\
- -s STACK_OVERFLOW_CHECK=1\
- -s EXPORTED_FUNCTIONS="$exported_funcs"\
- ./line.c -o ./line.wasm
+exported_funcs="build_solid_line build_dash_line get_solid_range_vertex_count get_dash_range_vertex_count set_round_segments build_solid_line_range build_dash_line_range build_solid_lines append_solid_line append_dash_line pack_vertices get_vertex_bounds compute_line_importance get_line_index_node_count build_line_index query_line_index_nearest query_line_index_rect get_strip_index_capacity convert_to_strip flatten_curve set_line_profiling get_line_counters malloc_heap_bytes malloc free"
+sources="./line.c ./line_simd.c ./line_simplify.c ./line_index.c ./line_strip.c ./line_curve.c"
 
+$wasmcc ./line.wasm "$exported_funcs" $sources
+
+# Same module with the simd128 kernel, for engines that validate SIMD instructions.
+$wasmcc ./line_simd.wasm "$exported_funcs" -msimd128 $sources
@@ -2,16 +2,102 @@
  * @file 构建线三角形
  */
 
-import { LineCap, LineJoin } from "../constants";
+import { IndexFormat } from "@galacean/engine";
+import { LineCap, LineCurveType, LineJoin } from "../constants";
+import { LineProfiler } from "../LineProfiler";
 import wasmString from "./line.wasm";
+import simdWasmString from "./line_simd.wasm";
 import { atob as atobPolyfill } from "./atob";
 
-type LineBuilderResult = {
+export type LineBuilderResult = {
   vertices: Float32Array;
-  indices: Uint16Array;
+  indices: Uint16Array | Uint32Array;
+  lengthsofar?: number;
 };
 
+export type LineAppendResult = LineBuilderResult & {
+  /** The first vertex of the built line the output replaces, its first index is `vertexStart * 3`. */
+  vertexStart: number;
+};
+
+export type LinePackedVertices = {
+  /** Vertices in the 12 byte compact layout, see `LineMesh`. */
+  vertices: Uint8Array;
+  /** Position origin x, y and half extent x, y, then lengthsofar start and span. */
+  pack: Float32Array;
+};
+
+export type LineBatchBuilderResult = {
+  vertices: Float32Array;
+  indices: Uint16Array | Uint32Array;
+  /** First index and index count of every line. */
+  ranges: Int32Array;
+};
+
+/**
+ * Segment index of a line for CPU hit testing, built by `LineVertexBuilder.buildSegmentIndex`. It keeps a copy of
+ * the points in wasm memory until `destroySegmentIndex`.
+ */
+export type LineSegmentIndex = {
+  pointer: number;
+  pointCount: number;
+  nodeCount: number;
+};
+
+export type LineSegmentHit = {
+  /** The segment, which runs from point `segment` to point `segment + 1`. */
+  segment: number;
+  /** The parametric position of the nearest point on the segment, 0 at its start and 1 at its end. */
+  t: number;
+  /** The distance to the segment. */
+  distance: number;
+};
+
+/**
+ * A block of wasm memory owned by the builder, reused across builds and only reallocated to grow.
+ */
+type HeapRegion = {
+  pointer: number;
+  byteLength: number;
+};
+
+/**
+ * A function returning i8x16.popcnt(i8x16.splat(0)), which only validates where wasm SIMD is supported.
+ */
+const simdProbe = new Uint8Array([
+  0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11
+]);
+
+let simdSupported: boolean;
+
+/**
+ * Whether the engine runs wasm SIMD, in which case `decodeLineWasm` returns the build with the simd128 kernel.
+ */
+export function lineWasmSimdSupported(): boolean {
+  if (simdSupported === undefined) {
+    try {
+      simdSupported = WebAssembly.validate(simdProbe);
+    } catch (e) {
+      simdSupported = false;
+    }
+  }
+  return simdSupported;
+}
+
+/**
+ * Decode the embedded line wasm binary, the simd128 build where it validates and the scalar one otherwise.
+ */
+export function decodeLineWasm(): Uint8Array {
+  const base64 = lineWasmSimdSupported() ? simdWasmString : wasmString;
+  return Uint8Array.from(typeof atob === "undefined" ? atobPolyfill(base64) : atob(base64), (c) => c.charCodeAt(0));
+}
+
 class LineVertexBuilder {
+  /** The segments per half circle of round joins and caps when none is set, see `roundSegments`. */
+  static readonly defaultRoundSegments = 8;
+  static readonly minRoundSegments = 3;
+  static readonly maxRoundSegments = 64;
+
   private static _instance: LineVertexBuilder;
   static get instance(): LineVertexBuilder {
     if (!this._instance) {
@@ -20,17 +106,31 @@ class LineVertexBuilder {
     return this._instance;
   }
 
+  private _wasmMemory: WebAssembly.Memory;
   private _memory: ArrayBuffer;
   private _heap32: Float32Array;
-  private _heap16: Int16Array;
+  private _heapI32: Int32Array;
+  private _pointsRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _verticesRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _indicesRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _batchRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _packRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _simplifyRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _boundsRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _queryRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _stripRegion: HeapRegion = { pointer: 0, byteLength: 0 };
+  private _curveRegion: HeapRegion = { pointer: 0, byteLength: 0 };
 
   private _wasmModule;
   private _wasmInitPromise;
+  private _countersPointer = 0;
+  private _counters: Float64Array;
+  private _profiling = false;
+  private _loaded = false;
+  private _roundSegments = LineVertexBuilder.defaultRoundSegments;
 
   constructor() {
-    const wasmBuffer = Uint8Array.from(typeof atob === "undefined" ? atobPolyfill(wasmString) : atob(wasmString), (c) =>
-      c.charCodeAt(0)
-    );
+    const wasmBuffer = decodeLineWasm();
 
     this._wasmInitPromise = new Promise<void>((resolve) => {
       WebAssembly.instantiate(wasmBuffer, {
@@ -43,40 +143,84 @@ class LineVertexBuilder {
           },
           alignfault: (a, b, c) => {
             console.log(a, b, c);
-          }
+          },
+          emscripten_notify_memory_growth: () => {
+            this._updateViews();
+          },
+          emscripten_get_now: () => performance.now()
         }
       }).then((result) => {
-        this._memory = (result.instance.exports.memory as WebAssembly.Memory).buffer;
-        this._heap32 = new Float32Array(this._memory);
-        this._heap16 = new Int16Array(this._memory);
+        this._wasmMemory = result.instance.exports.memory as WebAssembly.Memory;
         this._wasmModule = result.instance.exports;
+        this._countersPointer = this._wasmModule.get_line_counters();
+        this._updateViews();
+        // Reserve the fixed-size outputs up front, so reading them never grows memory under a build's output.
+        this._reserve(this._packRegion, 6 * Float32Array.BYTES_PER_ELEMENT);
+        this._reserve(this._boundsRegion, 6 * Float32Array.BYTES_PER_ELEMENT);
+        this._reserve(this._queryRegion, 64);
+        this._wasmModule.set_round_segments(this._roundSegments);
+        this._loaded = true;
         resolve();
       });
     });
   }
 
+  /**
+   * Resolves once the wasm module is instantiated; the synchronous build methods can be used after that.
+   */
+  get ready(): Promise<void> {
+    return this._wasmInitPromise;
+  }
+
+  /**
+   * Whether the wasm module is instantiated, see `ready`.
+   */
+  get loaded(): boolean {
+    return this._loaded;
+  }
+
+  /**
+   * The number of triangles per half circle of round joins and caps in the following builds, clamped to
+   * [`minRoundSegments`, `maxRoundSegments`].
+   * @remarks Changing it changes the vertex counts of lines with round joins or caps, so appends have to continue
+   * a build made with the same value.
+   */
+  get roundSegments(): number {
+    return this._roundSegments;
+  }
+
+  set roundSegments(value: number) {
+    const { minRoundSegments, maxRoundSegments } = LineVertexBuilder;
+    value = Math.min(Math.max(Math.round(value), minRoundSegments), maxRoundSegments);
+    if (value !== this._roundSegments) {
+      this._roundSegments = value;
+      this._loaded && this._wasmModule.set_round_segments(value);
+    }
+  }
+
   /**
    * Parse the solid line
    * @param points The points array
    * @param join Line's join property
    * @param cap Line's cap property
    * @param start The start index of the output vertex.
+   * @param indexFormat The format of the output indices, UInt16 or UInt32.
+   * @param first The first segment to build, segment i runs from point i to point i + 1.
+   * @param last The segment after the last one to build.
    * @returns The vertex buffer and index buffer.
    */
-  public async solidLine(points: number[], join: LineJoin, cap: LineCap, start: number): Promise<LineBuilderResult> {
+  public async solidLine(
+    points: number[],
+    join: LineJoin,
+    cap: LineCap,
+    start: number,
+    indexFormat: IndexFormat = IndexFormat.UInt16,
+    first: number = 0,
+    last: number = points.length / 2 - 1
+  ): Promise<LineBuilderResult> {
     await this._wasmInitPromise;
-    this._heap32.set(points, 0);
-    const vertexCount = this._getSolidVertexCount(points.length / 2, join);
-    const indexCount = vertexCount * 3 - 6;
-    const verticesStart = points.length * Float32Array.BYTES_PER_ELEMENT;
-    const indicesStart = verticesStart + vertexCount * 24;
-    const indicesEnd = indicesStart + indexCount * Uint16Array.BYTES_PER_ELEMENT;
-    this._wasmModule.build_solid_line(0, points.length / 2, join, cap, start, verticesStart, indicesStart);
-
-    return {
-      vertices: new Float32Array(this._memory.slice(verticesStart, indicesStart)),
-      indices: new Uint16Array(this._memory.slice(indicesStart, indicesEnd))
-    };
+    const { vertices, indices } = this.buildSolidLine(points, join, cap, start, indexFormat, first, last);
+    return { vertices: vertices.slice(), indices: indices.slice() };
   }
 
   /**
@@ -86,44 +230,643 @@ class LineVertexBuilder {
    * @param cap Line's cap property
    * @param lengthsofar Length of all previous lines.
    * @param start The start index of the output vertex.
-   * @returns The vertex buffer and index buffer.
+   * @param indexFormat The format of the output indices, UInt16 or UInt32.
+   * @param first The first segment to build, segment i runs from point i to point i + 1.
+   * @param last The segment after the last one to build.
+   * @returns The vertex buffer, index buffer and the length so far at the end of the last segment.
    */
   public async dashLine(
     points: number[],
     join: LineJoin,
     cap: LineCap,
     lengthsofar: number,
-    start: number
+    start: number,
+    indexFormat: IndexFormat = IndexFormat.UInt16,
+    first: number = 0,
+    last: number = points.length / 2 - 1
   ): Promise<LineBuilderResult> {
     await this._wasmInitPromise;
-    this._heap32.set(points, 0);
-    const vertexCount = this._getDashVertexCount(points.length / 2, join);
+    const result = this.buildDashLine(points, join, cap, lengthsofar, start, indexFormat, first, last);
+    return { vertices: result.vertices.slice(), indices: result.indices.slice(), lengthsofar: result.lengthsofar };
+  }
+
+  /**
+   * Build the solid line without copying the output out of wasm memory.
+   * @remarks Only callable after `ready` resolves. The returned arrays are views into wasm memory that stay
+   * valid until the next build, so upload them before building again.
+   * @see solidLine
+   */
+  public buildSolidLine(
+    points: number[],
+    join: LineJoin,
+    cap: LineCap,
+    start: number,
+    indexFormat: IndexFormat = IndexFormat.UInt16,
+    first: number = 0,
+    last: number = points.length / 2 - 1
+  ): LineBuilderResult {
+    const pointCount = points.length / 2;
+    const vertexCount = this.getSolidVertexCount(pointCount, join, cap, first, last);
+    const indexCount = vertexCount * 3 - 6;
+    const { pointsStart, verticesStart, indicesStart } = this._prepareHeap(
+      points,
+      vertexCount,
+      indexCount,
+      indexFormat
+    );
+    this._syncProfiling();
+    this._wasmModule.build_solid_line_range(
+      pointsStart,
+      pointCount,
+      first,
+      last,
+      join,
+      cap,
+      start,
+      verticesStart,
+      indicesStart,
+      indexFormat
+    );
+    this._collectProfile();
+
+    return {
+      vertices: new Float32Array(this._memory, verticesStart, vertexCount * 6),
+      indices: this._indicesView(indicesStart, indexCount, indexFormat)
+    };
+  }
+
+  /**
+   * Build the dash line without copying the output out of wasm memory.
+   * @remarks Only callable after `ready` resolves. The returned arrays are views into wasm memory that stay
+   * valid until the next build, so upload them before building again.
+   * @see dashLine
+   */
+  public buildDashLine(
+    points: number[],
+    join: LineJoin,
+    cap: LineCap,
+    lengthsofar: number,
+    start: number,
+    indexFormat: IndexFormat = IndexFormat.UInt16,
+    first: number = 0,
+    last: number = points.length / 2 - 1
+  ): LineBuilderResult {
+    const pointCount = points.length / 2;
+    const vertexCount = this.getDashVertexCount(pointCount, join, cap, first, last);
+    const indexCount = vertexCount * 3 - 6;
+    const { pointsStart, verticesStart, indicesStart } = this._prepareHeap(
+      points,
+      vertexCount,
+      indexCount,
+      indexFormat
+    );
+    this._syncProfiling();
+    const endLengthsofar = this._wasmModule.build_dash_line_range(
+      pointsStart,
+      pointCount,
+      first,
+      last,
+      join,
+      cap,
+      lengthsofar,
+      start,
+      verticesStart,
+      indicesStart,
+      indexFormat
+    );
+    this._collectProfile();
+
+    return {
+      vertices: new Float32Array(this._memory, verticesStart, vertexCount * 6),
+      indices: this._indicesView(indicesStart, indexCount, indexFormat),
+      lengthsofar: endLengthsofar
+    };
+  }
+
+  /**
+   * Continue a solid line after points were appended to it, instead of building it again.
+   * @remarks Only the old end cap, which becomes a join, and the new segments are built, so the cost depends on
+   * the number of appended points rather than the length of the line. The output replaces the previous build
+   * from `vertexStart` on and its indices are already offset. Only callable after `ready` resolves; the returned
+   * arrays are views into wasm memory valid until the next build.
+   * @param points The points array of the whole line
+   * @param oldPointCount The point count of the previous build, at least 2
+   * @param join Line's join property
+   * @param cap Line's cap property
+   * @param indexFormat The format of the output indices, must match the previous build.
+   */
+  public appendSolidLine(
+    points: number[],
+    oldPointCount: number,
+    join: LineJoin,
+    cap: LineCap,
+    indexFormat: IndexFormat = IndexFormat.UInt16
+  ): LineAppendResult {
+    const pointCount = points.length / 2;
+    const first = oldPointCount - 1;
+    const vertexStart = this.getSolidVertexCount(pointCount, join, cap, 0, first) - 2;
+    const vertexCount = this.getSolidVertexCount(pointCount, join, cap, first);
     const indexCount = vertexCount * 3 - 6;
-    const verticesStart = points.length * Float32Array.BYTES_PER_ELEMENT;
-    const indicesStart = verticesStart + vertexCount * 24;
-    const indicesEnd = indicesStart + indexCount * Uint16Array.BYTES_PER_ELEMENT;
-    this._wasmModule.build_dash_line(0, points.length / 2, join, cap, lengthsofar, start, verticesStart, indicesStart);
+    // the resumed range only reads from the point before the old last one
+    const pointOffset = oldPointCount - 2;
+    const { pointsStart, verticesStart, indicesStart } = this._prepareHeap(
+      points,
+      vertexCount,
+      indexCount,
+      indexFormat,
+      pointOffset
+    );
+    this._syncProfiling();
+    this._wasmModule.append_solid_line(
+      pointsStart,
+      pointOffset,
+      pointCount,
+      oldPointCount,
+      join,
+      cap,
+      verticesStart,
+      indicesStart,
+      indexFormat
+    );
+    this._collectProfile();
 
     return {
-      vertices: new Float32Array(this._memory.slice(verticesStart, indicesStart)),
-      indices: new Uint16Array(this._memory.slice(indicesStart, indicesEnd))
+      vertices: new Float32Array(this._memory, verticesStart, vertexCount * 6),
+      indices: this._indicesView(indicesStart, indexCount, indexFormat),
+      vertexStart
     };
   }
 
-  private _getSolidVertexCount(pointCount: number, join: LineJoin) {
-    if (join === LineJoin.Round) {
-      return pointCount * 5 - 2;
+  /**
+   * Continue a dash line after points were appended to it, instead of building it again.
+   * @param lengthsofar The length so far at the end of the previous build
+   * @see appendSolidLine
+   */
+  public appendDashLine(
+    points: number[],
+    oldPointCount: number,
+    join: LineJoin,
+    cap: LineCap,
+    lengthsofar: number,
+    indexFormat: IndexFormat = IndexFormat.UInt16
+  ): LineAppendResult {
+    const pointCount = points.length / 2;
+    const first = oldPointCount - 1;
+    const vertexStart = this.getDashVertexCount(pointCount, join, cap, 0, first) - 2;
+    const vertexCount = this.getDashVertexCount(pointCount, join, cap, first);
+    const indexCount = vertexCount * 3 - 6;
+    const pointOffset = oldPointCount - 2;
+    const { pointsStart, verticesStart, indicesStart } = this._prepareHeap(
+      points,
+      vertexCount,
+      indexCount,
+      indexFormat,
+      pointOffset
+    );
+    this._syncProfiling();
+    const endLengthsofar = this._wasmModule.append_dash_line(
+      pointsStart,
+      pointOffset,
+      pointCount,
+      oldPointCount,
+      join,
+      cap,
+      lengthsofar,
+      verticesStart,
+      indicesStart,
+      indexFormat
+    );
+    this._collectProfile();
+
+    return {
+      vertices: new Float32Array(this._memory, verticesStart, vertexCount * 6),
+      indices: this._indicesView(indicesStart, indexCount, indexFormat),
+      lengthsofar: endLengthsofar,
+      vertexStart
+    };
+  }
+
+  /**
+   * Build many solid lines into one vertex and index buffer with a single wasm call.
+   * @remarks Indices address the shared vertex buffer. The cap, join and width of every line are baked into
+   * its vertices (see `lineBatch` shader), so all lines can be drawn in one draw call. Only callable after
+   * `ready` resolves; the returned arrays are views into wasm memory valid until the next build.
+   * @param points The points of all lines, flattened and concatenated
+   * @param pointOffsets Index of the first point of every line, followed by the total point count
+   * @param joins Join of every line
+   * @param caps Cap of every line
+   * @param widths Width of every line
+   * @param indexFormat The format of the output indices, UInt16 or UInt32.
+   */
+  public buildSolidLines(
+    points: ArrayLike<number>,
+    pointOffsets: ArrayLike<number>,
+    joins: ArrayLike<LineJoin>,
+    caps: ArrayLike<LineCap>,
+    widths: ArrayLike<number>,
+    indexFormat: IndexFormat = IndexFormat.UInt16
+  ): LineBatchBuilderResult {
+    const lineCount = pointOffsets.length - 1;
+    let vertexCount = 0;
+    let indexCount = 0;
+    for (let i = 0; i < lineCount; i++) {
+      const pointCount = pointOffsets[i + 1] - pointOffsets[i];
+      if (pointCount > 1) {
+        const count = this.getSolidVertexCount(pointCount, joins[i], caps[i]);
+        vertexCount += count;
+        indexCount += count * 3 - 6;
+      }
+    }
+
+    // offsets, joins, caps, widths and the output ranges share one region
+    const batchStart = this._reserve(this._batchRegion, (lineCount * 6 + 1) * 4);
+    const { pointsStart, verticesStart, indicesStart } = this._prepareHeap(
+      points,
+      vertexCount,
+      indexCount,
+      indexFormat
+    );
+    const offsetsStart = batchStart;
+    const joinsStart = offsetsStart + (lineCount + 1) * 4;
+    const capsStart = joinsStart + lineCount * 4;
+    const widthsStart = capsStart + lineCount * 4;
+    const rangesStart = widthsStart + lineCount * 4;
+    const heapI32 = this._heapI32;
+    heapI32.set(pointOffsets, offsetsStart >> 2);
+    heapI32.set(joins, joinsStart >> 2);
+    heapI32.set(caps, capsStart >> 2);
+    this._heap32.set(widths, widthsStart >> 2);
+
+    this._syncProfiling();
+    this._wasmModule.build_solid_lines(
+      pointsStart,
+      lineCount,
+      offsetsStart,
+      joinsStart,
+      capsStart,
+      widthsStart,
+      verticesStart,
+      indicesStart,
+      indexFormat,
+      rangesStart
+    );
+    this._collectProfile();
+
+    return {
+      vertices: new Float32Array(this._memory, verticesStart, vertexCount * 6),
+      indices: this._indicesView(indicesStart, indexCount, indexFormat),
+      ranges: new Int32Array(this._memory, rangesStart, lineCount * 2)
+    };
+  }
+
+  /**
+   * Rewrite the triangle list of a build as a triangle strip, for a mesh drawn with `MeshTopology.TriangleStrip`.
+   * @remarks Triangles sharing an edge take one index instead of three, a line without round joins or caps needs
+   * about one index per vertex. Other triangles are stitched on with degenerate ones. Reserving the strip may grow
+   * wasm memory, so the build is returned with its vertices viewed again, valid until the next build.
+   * @param result The output of one of the build methods
+   * @param indexFormat The format of its indices, the strip has the same format
+   */
+  public toTriangleStrip<T extends LineBuilderResult>(result: T, indexFormat: IndexFormat): T {
+    const wasmModule = this._wasmModule;
+    const { vertices, indices } = result;
+    const verticesStart = vertices.byteOffset;
+    const vertexLength = vertices.length;
+    const indicesStart = indices.byteOffset;
+    const indexCount = indices.length;
+    const indexSize = indexFormat === IndexFormat.UInt32 ? 4 : 2;
+    const stripStart = this._reserve(this._stripRegion, wasmModule.get_strip_index_capacity(indexCount) * indexSize);
+    this._syncProfiling();
+    const length = wasmModule.convert_to_strip(indicesStart, indexCount, indexFormat, stripStart);
+    this._collectProfile();
+    return {
+      ...result,
+      vertices: new Float32Array(this._memory, verticesStart, vertexLength),
+      indices: this._indicesView(stripStart, length, indexFormat)
+    };
+  }
+
+  /**
+   * Convert built vertices in place to the 12 byte compact layout.
+   * @remarks Halves the upload at snorm16 precision relative to the bounds of the vertices. The returned vertices
+   * are a view over the same wasm memory, valid until the next build.
+   * @param vertices The vertices of a build, as returned by one of the build methods
+   */
+  public packVertices(vertices: Float32Array): LinePackedVertices {
+    const vertexCount = vertices.length / 6;
+    const packStart = this._reserve(this._packRegion, 6 * Float32Array.BYTES_PER_ELEMENT);
+    this._syncProfiling();
+    this._wasmModule.pack_vertices(vertices.byteOffset, vertexCount, packStart);
+    this._collectProfile();
+    return {
+      vertices: new Uint8Array(this._memory, vertices.byteOffset, vertexCount * 12),
+      pack: this._heap32.slice(packStart >> 2, (packStart >> 2) + 6)
+    };
+  }
+
+  /**
+   * Get the culling bounds of built vertices, before they are packed.
+   * @returns Min x, min y, max x, max y of the positions, then the max absolute x and y of the offsets, which are
+   * scaled by the line width
+   */
+  public getVertexBounds(vertices: Float32Array): Float32Array {
+    const boundsStart = this._reserve(this._boundsRegion, 6 * Float32Array.BYTES_PER_ELEMENT);
+    this._syncProfiling();
+    this._wasmModule.get_vertex_bounds(vertices.byteOffset, vertices.length / 6, boundsStart);
+    this._collectProfile();
+    return this._heap32.slice(boundsStart >> 2, (boundsStart >> 2) + 6);
+  }
+
+  /**
+   * Build a bounding volume hierarchy over the segments of a line, for hit testing on the CPU.
+   * @param points The points of the line, flattened as x, y pairs
+   */
+  public buildSegmentIndex(points: ArrayLike<number>): LineSegmentIndex {
+    const wasmModule = this._wasmModule;
+    const pointCount = points.length / 2;
+    const nodeCount = wasmModule.get_line_index_node_count(pointCount);
+    const byteLength = (points.length + nodeCount * 4) * Float32Array.BYTES_PER_ELEMENT;
+    const pointer = wasmModule.malloc(Math.max(byteLength, 4));
+    if (!pointer) {
+      throw new Error(`LineVertexBuilder: out of wasm memory reserving ${byteLength} bytes.`);
+    }
+    // malloc may have grown the memory, which detaches the old views
+    this._updateViews();
+    this._heap32.set(points, pointer >> 2);
+    wasmModule.build_line_index(pointer, pointCount, pointer + points.length * Float32Array.BYTES_PER_ELEMENT);
+    return { pointer, pointCount, nodeCount };
+  }
+
+  /**
+   * Free the wasm memory of a segment index.
+   */
+  public destroySegmentIndex(index: LineSegmentIndex): void {
+    this._wasmModule.free(index.pointer);
+    index.pointer = 0;
+  }
+
+  /**
+   * Find the segment nearest to a point.
+   * @param index The segment index of the line
+   * @param x The x of the point, in the space of the line's points
+   * @param y The y of the point
+   * @param maxDistance Only segments within this distance are found, e.g. the line width
+   * @returns The nearest segment, null if no segment is within `maxDistance`
+   */
+  public nearestSegment(index: LineSegmentIndex, x: number, y: number, maxDistance: number): LineSegmentHit | null {
+    const { pointer, pointCount } = index;
+    const resultStart = this._queryRegion.pointer;
+    const segment = this._wasmModule.query_line_index_nearest(
+      pointer,
+      pointCount,
+      pointer + pointCount * 2 * Float32Array.BYTES_PER_ELEMENT,
+      x,
+      y,
+      maxDistance,
+      resultStart
+    );
+    if (segment < 0) {
+      return null;
+    }
+    const heap32 = this._heap32;
+    return { segment, t: heap32[(resultStart >> 2) + 1], distance: heap32[resultStart >> 2] };
+  }
+
+  /**
+   * Find the segments whose bounds intersect a rectangle.
+   * @param index The segment index of the line
+   * @returns The segments in line order
+   */
+  public segmentsInRect(index: LineSegmentIndex, minX: number, minY: number, maxX: number, maxY: number): Int32Array {
+    const { pointer, pointCount } = index;
+    const nodesStart = pointer + pointCount * 2 * Float32Array.BYTES_PER_ELEMENT;
+    const wasmModule = this._wasmModule;
+    const region = this._queryRegion;
+    const query = (out: number, capacity: number): number =>
+      wasmModule.query_line_index_rect(pointer, pointCount, nodesStart, minX, minY, maxX, maxY, out, capacity);
+    // Query again with room for all segments if the output region was too small.
+    let count = query(region.pointer, region.byteLength >> 2);
+    if (count > region.byteLength >> 2) {
+      count = query(this._reserve(region, count * Int32Array.BYTES_PER_ELEMENT), count);
+    }
+    return this._heapI32.slice(region.pointer >> 2, (region.pointer >> 2) + count);
+  }
+
+  /**
+   * Compute the Douglas-Peucker importance of every point, once per point set.
+   * @remarks Pass the result to `simplifyPoints` with any tolerance, the simplifications of larger tolerances are
+   * subsets of smaller ones, so changing the level of detail does not simplify again.
+   * @param points The points of the line, flattened as x, y pairs
+   */
+  public computeImportance(points: ArrayLike<number>): Float32Array {
+    const pointCount = points.length / 2;
+    // Importance as floats, followed by the scratch stack of two ints per point.
+    const importanceStart = this._reserve(this._simplifyRegion, pointCount * 12);
+    const { pointsStart } = this._prepareHeap(points, 0, 0, IndexFormat.UInt16);
+    const stackStart = importanceStart + pointCount * Float32Array.BYTES_PER_ELEMENT;
+    this._wasmModule.compute_line_importance(pointsStart, pointCount, importanceStart, stackStart);
+    const base = importanceStart >> 2;
+    return this._heap32.slice(base, base + pointCount);
+  }
+
+  /**
+   * Keep the points whose importance is greater than the tolerance, the result stays within the tolerance of the
+   * line. The end points are always kept.
+   * @param points The points of the line, flattened as x, y pairs
+   * @param importance The importance of the points, from `computeImportance`
+   * @param tolerance The max distance of the simplified line to the original one
+   */
+  public simplifyPoints(points: ArrayLike<number>, importance: Float32Array, tolerance: number): number[] {
+    const result: number[] = [];
+    for (let i = 0, n = importance.length; i < n; i++) {
+      if (importance[i] > tolerance) {
+        result.push(points[i * 2], points[i * 2 + 1]);
+      }
+    }
+    return result;
+  }
+
+  /**
+   * Flatten curve control points into the points of a line, split adaptively so it stays within `tolerance` of
+   * the curve.
+   * @remarks The curve is counted and flattened in wasm, the points are only copied out once, into `out`.
+   * @param controls The control points, flattened as x, y pairs, laid out as `type` describes
+   * @param type The curve type
+   * @param tolerance The max distance of the line to the curve
+   * @param out The array to write the points to, flattened as x, y pairs, resized to fit
+   */
+  public flattenCurve(
+    controls: ArrayLike<number>,
+    type: LineCurveType,
+    tolerance: number,
+    out: number[] = []
+  ): number[] {
+    const wasmModule = this._wasmModule;
+    const controlCount = controls.length / 2;
+    const { pointsStart } = this._prepareHeap(controls, 0, 0, IndexFormat.UInt16);
+    const pointCount = wasmModule.flatten_curve(pointsStart, controlCount, type, tolerance, 0);
+    const curveStart = this._reserve(this._curveRegion, pointCount * 2 * Float32Array.BYTES_PER_ELEMENT);
+    wasmModule.flatten_curve(pointsStart, controlCount, type, tolerance, curveStart);
+    const heap32 = this._heap32;
+    const base = curveStart >> 2;
+    const length = pointCount * 2;
+    out.length = length;
+    for (let i = 0; i < length; i++) {
+      out[i] = heap32[base + i];
+    }
+    return out;
+  }
+
+  /**
+   * Reserve the input, vertex and index regions for a build and copy the points in, skipping the first
+   * `pointOffset` points.
+   */
+  private _prepareHeap(
+    points: ArrayLike<number>,
+    vertexCount: number,
+    indexCount: number,
+    indexFormat: IndexFormat,
+    pointOffset: number = 0
+  ) {
+    const indexSize = indexFormat === IndexFormat.UInt32 ? 4 : 2;
+    const skipped = pointOffset * 2;
+    const pointsStart = this._reserve(this._pointsRegion, (points.length - skipped) * Float32Array.BYTES_PER_ELEMENT);
+    const verticesStart = this._reserve(this._verticesRegion, vertexCount * 24);
+    const indicesStart = this._reserve(this._indicesRegion, indexCount * indexSize);
+    const profileStart = this._profileStart();
+    const heap32 = this._heap32;
+    const base = pointsStart / Float32Array.BYTES_PER_ELEMENT;
+    if (skipped === 0) {
+      heap32.set(points, base);
     } else {
-      return pointCount * 4;
+      for (let i = skipped, n = points.length; i < n; i++) {
+        heap32[base + i - skipped] = points[i];
+      }
+    }
+    if (profileStart) {
+      LineProfiler.instance.addCopyTime(profileStart);
+    }
+    return { pointsStart, verticesStart, indicesStart };
+  }
+
+  /**
+   * Make sure the region can hold byteLength bytes, growing it geometrically so repeated builds of similar
+   * size do not reallocate.
+   */
+  private _reserve(region: HeapRegion, byteLength: number): number {
+    if (byteLength > region.byteLength) {
+      const wasmModule = this._wasmModule;
+      const newByteLength = Math.max(byteLength, Math.ceil(region.byteLength * 1.5));
+      if (region.pointer) {
+        wasmModule.free(region.pointer);
+      }
+      region.pointer = wasmModule.malloc(newByteLength);
+      if (!region.pointer) {
+        region.byteLength = 0;
+        throw new Error(`LineVertexBuilder: out of wasm memory reserving ${newByteLength} bytes.`);
+      }
+      region.byteLength = newByteLength;
+      // malloc may have grown the memory, which detaches the old views
+      this._updateViews();
+      const profiler = LineProfiler.instance;
+      if (profiler.enabled) {
+        profiler.recordReallocation();
+      }
+    }
+    return region.pointer;
+  }
+
+  private _updateViews(): void {
+    const buffer = this._wasmMemory.buffer;
+    if (buffer !== this._memory) {
+      this._memory = buffer;
+      this._heap32 = new Float32Array(buffer);
+      this._heapI32 = new Int32Array(buffer);
+      // struct LineCounters, five doubles.
+      this._counters = new Float64Array(buffer, this._countersPointer, 5);
+    }
+  }
+
+  /**
+   * The `performance.now()` a profiled step starts at, 0 when `LineProfiler` is not recording.
+   */
+  private _profileStart(): number {
+    return LineProfiler.instance.enabled ? performance.now() : 0;
+  }
+
+  /**
+   * Turn the counters of line.c on or off with `LineProfiler`, before a profiled wasm call.
+   */
+  private _syncProfiling(): void {
+    const { enabled } = LineProfiler.instance;
+    if (enabled !== this._profiling) {
+      this._profiling = enabled;
+      this._wasmModule.set_line_profiling(enabled ? 1 : 0);
+    }
+  }
+
+  /**
+   * Move what line.c counted in the last call to `LineProfiler`, with the malloc high-water mark.
+   */
+  private _collectProfile(): void {
+    if (this._profiling) {
+      const counters = this._counters;
+      const profiler = LineProfiler.instance;
+      profiler.recordBuilds(counters[0], counters[1], counters[2], counters[3], counters[4]);
+      profiler.recordHeap(this._wasmModule.malloc_heap_bytes());
+      counters.fill(0);
     }
   }
 
-  private _getDashVertexCount(pointCount: number, join: LineJoin) {
-    if (join === LineJoin.Bevel) {
-      return pointCount * 7 - 6;
+  private _indicesView(indicesStart: number, indexCount: number, indexFormat: IndexFormat): Uint16Array | Uint32Array {
+    if (indexFormat === IndexFormat.UInt32) {
+      return new Uint32Array(this._memory, indicesStart, indexCount);
     } else {
-      return pointCount * 5 - 2;
+      return new Uint16Array(this._memory, indicesStart, indexCount);
+    }
+  }
+
+  /**
+   * The vertex count of a solid line build, the index count is always `vertexCount * 3 - 6`. Needs `loaded`.
+   * @param pointCount The point count of the whole line
+   * @param join Line's join property
+   * @param cap Line's cap property
+   * @param first The first segment to build
+   * @param last The segment after the last one to build
+   */
+  public getSolidVertexCount(
+    pointCount: number,
+    join: LineJoin,
+    cap: LineCap,
+    first = 0,
+    last = pointCount - 1
+  ): number {
+    return this._wasmModule.get_solid_range_vertex_count(pointCount, first, last, join, cap);
+  }
+    return count;
+  }
+
+  /**
+   * The vertex count of a dash line build, the index count is always `vertexCount * 3 - 6`. Needs `loaded`.
+   * @param pointCount The point count of the whole line
+   * @param join Line's join property
+   * @param cap Line's cap property
+   * @param first The first segment to build
+   * @param last The segment after the last one to build
+   */
+  public getDashVertexCount(
+    pointCount: number,
+    join: LineJoin,
+    cap: LineCap,
+    first = 0,
+    last = pointCount - 1
+  ): number {
+    return this._wasmModule.get_dash_range_vertex_count(pointCount, first, last, join, cap);
+  }
+    if (last === pointCount - 1) {
+      count += capCount;
     }
+    return count;
   }
 }
 
@@ -1,14 +1,10 @@
 #include <math.h>
+#include <string.h>
+#include "line.h"
 
-struct Vertex {
-    float x;
-    float y;
-    float offset_x;
-    float offset_y;
-    short direction;
-    short part;
-    float lengthsofar;
-};
+#ifndef __wasm__
+#include <time.h>
+#endif
 
 const static int CAP_ROUND = 0;
 const static int CAP_BUTT = 1;
@@ -22,31 +18,75 @@ const static char IS_CAP = 0;
 const static char IS_JOIN = 2;
 const static char IS_LINE = 1;
 
+const static float PI = 3.14159265358979f;
+
+/*
+ * 每种 join 各生成一个实线和虚线的版本 (见 LINE_KERNEL). flatten 让调用到的函数全部内联, join 和每个调用点的
+ * 顶点序号都成为常量, 逐顶点的分支在编译时就确定了. cap 只在线的两端用到, 圆头和圆角每个只生成一次, 都不值得
+ * 为它们再复制一份代码, 所以 cap 仍是参数, 圆头和圆角不内联
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define LINE_SPECIALIZED __attribute__((flatten))
+#define LINE_NOINLINE __attribute__((noinline))
+#else
+#define LINE_SPECIALIZED
+#define LINE_NOINLINE
+#endif
+
 extern void consoleLog(int arg);
 
+/* 圆头和圆角每半圆的段数, 见 set_round_segments */
+static int round_segments = ROUND_SEGMENTS_DEFAULT;
+
+/* 见 struct LineCounters, 关闭时每次构建只多一个分支 */
+static int profiling = 0;
+static struct LineCounters counters;
+
+#ifdef __wasm__
+extern double emscripten_get_now(void);
+#else
+static double emscripten_get_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+#endif
+
+void set_line_profiling(int enabled) {
+    profiling = enabled;
+}
+
+struct LineCounters* get_line_counters(void) {
+    return &counters;
+}
+
+double line_profile_start(void) {
+    return profiling ? emscripten_get_now() : 0;
+}
+
+void line_profile_end(double start, int calls, int points, int vertices, int indices) {
+    if (profiling) {
+        counters.calls += calls;
+        counters.points += points;
+        counters.vertices += vertices;
+        counters.indices += indices;
+        counters.milliseconds += emscripten_get_now() - start;
+    }
+}
+
 void scaleAndAdd(float x1, float y1, float x2, float y2, float scale, float *out);
 void reflect(float x1, float y1, float x2, float y2, float *out);
-void normalize(float *vector);
 float dot(float x1, float y1, float x2, float y2);
-float length(float x, float y);
 int use_normal(float tangent_x, float tangent_y, float normal_x, float normal_y, int join, int index);
 void calc_normal(float x, float y, int index, float *out);
 void calc_cap(float vx, float vy, int index, int cap, float *out);
-void calc_offset(float x1, float y1, float x2, float y2, int index, float *out);
 void calc_offset2(float x1, float y1, float x2, float y2, int index, int join, char part, float *out);
-void generate_vertex(float x, float y, float* vector, int cap, int join, char index,
-                 float *other_vector, char part, struct Vertex *result, int v_index);
-void build_solid_line(float* data, int point_length, int join, int cap, int count, struct Vertex* vertices, unsigned short* indices);
-void store_vertex(float x, float y, float offset_x, float offset_y,
-           char direction, char part, float lengthsofar, struct Vertex *result, int index);
 
 void calc_offset8(float x1, float y1, float x2, float y2, int index, int join, float *out);
 void calc_offset_dash(float x1, float y1, float x2, float y2, int index, char part, float *out);
 void calc_offset_other(float x1, float y1, float x2, float y2, float index, float *out);
 void generate_dash_vertex(float x, float y, float vx, float vy, int cap, int join, char index,
                       float lengthsofar, float ovx, float ovy, char part, struct Vertex *result, int v_index);
-void build_dash_line(float *data, int point_length, int join, int cap, float lengthsofar, int count, struct Vertex* vertices, unsigned short* indices);
-void store_index(int index, int inner_count, short is_counter_clockwise, unsigned short *out, int i_index);
 
 void scaleAndAdd(float x1, float y1, float x2, float y2, float scale, float *out) {
     out[0] = x1  + x2 * scale;
@@ -127,31 +167,6 @@ void calc_cap(float vx, float vy, int index, int cap, float *out) {
     }
 }
 
-void calc_offset(float x1, float y1, float x2, float y2, int index, float *out) {
-    float normal[2] = {0};
-    calc_normal(x1, y1, index, normal);
-
-    float tangent[2] = {x1 + x2, y1 + y2};
-    normalize(tangent);
-    
-    float cos = dot(normal[0], normal[1], -tangent[1], tangent[0]);
-    // 锐角角度太小，miter过长，截断处理
-    if (fabsf(cos) < 0.1) {
-        cos = 1;
-    }
-    float miter = 1 / cos;
-    float offset_x = -tangent[1] * miter;
-    float offset_y = tangent[0] * miter;
-    cos = dot(x1, y1, offset_x, offset_y);
-    if (cos < 0) {
-        offset_x = -offset_x;
-        offset_y = -offset_y;
-    }
-    out[0] = offset_x;
-    out[1] = offset_y;
-    out[2] = cos;
-}
-
 void calc_offset2(float x1, float y1, float x2, float y2, int index, int join, char part, float *out) {
     float normal[2] = {0};
     calc_normal(x1, y1, index, normal);
@@ -197,12 +212,6 @@ void generate_vertex(float x, float y, float *vector, int cap, int join, char in
         calc_cap(vector[0], vector[1], index, cap, res);
     } else if (index == 0 || index == 1 || index == 2 || index == 3) {
         calc_offset2(vector[0], vector[1], other_vector[0], other_vector[1], index, join, part, res);
-    } else if (index == 8) {
-        calc_offset(vector[0], vector[1], other_vector[0], other_vector[1], index, res);
-        float cos = res[2];
-        if (cos < 0) {
-            direction = -direction;
-        }
     }
 
     store_vertex(x, y, res[0], res[1], direction, part, 0, result, v_index);
@@ -221,40 +230,231 @@ void store_vertex(float x, float y, float offset_x, float offset_y,
     result[index] = vertex;
 }
 
-int get_solid_vertex_count(int point_length, int join) {
-    if (join == JOIN_ROUND) {
-        return point_length * 5 - 2;
+static void store_triangle(int first, int second, int third, void *out, int i_index, int index_format) {
+    if (index_format == INDEX_UINT32) {
+        unsigned int *out32 = (unsigned int *)out;
+        out32[i_index++] = first;
+        out32[i_index++] = second;
+        out32[i_index++] = third;
     } else {
-        return point_length * 4;
+        unsigned short *out16 = (unsigned short *)out;
+        out16[i_index++] = first;
+        out16[i_index++] = second;
+        out16[i_index++] = third;
     }
 }
-int get_dash_vertex_count(int point_length, int join) {
-    if (join == JOIN_MITER) {
-        return point_length * 7 - 6;
-    } else {
-        return point_length * 5 - 2;
+
+/* 把法线转过 step 对应的角度, cos_step 和 sin_step 每段圆弧只算一次 */
+static void rotate_normal(float* normal_x, float* normal_y, float cos_step, float sin_step) {
+    float x = *normal_x;
+    *normal_x = x * cos_step - *normal_y * sin_step;
+    *normal_y = x * sin_step + *normal_y * cos_step;
+}
+
+LINE_NOINLINE void generate_round_cap(float x, float y, float* vector, int end, float lengthsofar, int* count, int* inner_count,
+                        short is_counter_clockwise, struct Vertex* vertices, int* index, void* indices, int* i_index,
+                        int index_format) {
+    int arc_count = round_segments - 1;
+    // 从左法线 (顶点 0/2 一侧) 转半圈到右法线: 起点向后经过 -vector, 终点向前经过 vector
+    float normal_x = -vector[1];
+    float normal_y = vector[0];
+    float step = (end ? -PI : PI) / round_segments;
+    float cos_step = cosf(step);
+    float sin_step = sinf(step);
+    // 扇形的中心: 起点为紧随圆弧的顶点 0, 终点为之前的顶点 3
+    int center = end ? *count : *count + arc_count + 1;
+    for (int j = 1; j <= arc_count; j++) {
+        char direction = j * 2 <= round_segments ? 1 : -1;
+        rotate_normal(&normal_x, &normal_y, cos_step, sin_step);
+        store_vertex(x, y, normal_x, normal_y, direction, IS_CAP, lengthsofar, vertices, (*index)++);
+        if (j <= 2) {
+            // 前两个顶点在原来 4/5 或 6/7 的位置, 接在三角带里
+            ++*count;
+            ++*inner_count;
+            if (end) {
+                store_index(*count, *inner_count, is_counter_clockwise, indices, *i_index, index_format);
+                *i_index += 3;
+            }
+        } else {
+            ++*count;
+            if (end) {
+                store_triangle(center, *count - 1, *count, indices, *i_index, index_format);
+            } else {
+                store_triangle(center, *count - 2, *count - 1, indices, *i_index, index_format);
+            }
+            *i_index += 3;
+        }
+    }
+}
+
+LINE_NOINLINE void generate_round_join(float x, float y, float* vector, float* vector_next, float lengthsofar, short dash,
+                         int* count, struct Vertex* vertices, int* index, void* indices, int* i_index,
+                         int index_format) {
+    // 虚线的线段止于角平分线, 圆弧要包含两端的法线
+    int arc_first = dash ? 0 : 1;
+    int arc_last = dash ? round_segments : round_segments - 1;
+    int arc_count = arc_last - arc_first + 1;
+    float turn = atan2f(vector[0] * vector_next[1] - vector[1] * vector_next[0],
+                        dot(vector[0], vector[1], vector_next[0], vector_next[1]));
+    // 左转时外侧为右边 (顶点 3/1), 右转时为左边 (顶点 2/0); 掉头时 turn 为 π, 圆弧从前方绕过
+    int outer_right = turn >= 0;
+    int inner = outer_right ? *count - 1 : *count;
+    int previous = outer_right ? *count : *count - 1;
+    int next_outer = *count + arc_count + (outer_right ? 2 : 1);
+    float normal_x = outer_right ? vector[1] : -vector[1];
+    float normal_y = outer_right ? -vector[0] : vector[0];
+    float step = turn / round_segments;
+    float cos_step = cosf(step);
+    float sin_step = sinf(step);
+    char direction = outer_right ? -1 : 1;
+    for (int j = arc_first; j <= arc_last; j++) {
+        if (j > 0) {
+            rotate_normal(&normal_x, &normal_y, cos_step, sin_step);
+        }
+        store_vertex(x, y, normal_x, normal_y, direction, IS_JOIN, lengthsofar, vertices, (*index)++);
+        ++*count;
+        store_triangle(inner, previous, *count, indices, *i_index, index_format);
+        *i_index += 3;
+        previous = *count;
+    }
+    // 下一段顶点 0/1 的两个三角形: 圆弧的最后一段, 和一个退化三角形
+    store_triangle(inner, previous, next_outer, indices, *i_index, index_format);
+    *i_index += 3;
+    store_triangle(next_outer, next_outer, next_outer, indices, *i_index, index_format);
+    *i_index += 3;
+}
+
+void set_round_segments(int segments) {
+    if (segments < ROUND_SEGMENTS_MIN) {
+        segments = ROUND_SEGMENTS_MIN;
+    } else if (segments > ROUND_SEGMENTS_MAX) {
+        segments = ROUND_SEGMENTS_MAX;
+    }
+    round_segments = segments;
+}
+
+int get_round_segments(void) {
+    return round_segments;
+}
+
+int get_solid_vertex_count(int point_length, int join, int cap) {
+    return get_solid_range_vertex_count(point_length, 0, point_length - 1, join, cap);
+}
+int get_dash_vertex_count(int point_length, int join, int cap) {
+    return get_dash_range_vertex_count(point_length, 0, point_length - 1, join, cap);
+}
+
+int get_solid_range_vertex_count(int point_length, int first, int last, int join, int cap) {
+    int join_count = join == JOIN_ROUND ? round_segments - 1 : 0;
+    int cap_count = cap == CAP_ROUND ? round_segments - 1 : 2;
+    int segment_count = last - first;
+    // start cap, or the resumed tail of the previous segment and its join
+    int count = first == 0 ? cap_count : 2 + join_count;
+    count += segment_count * 4 + (segment_count - 1) * join_count;
+    if (last == point_length - 1) {
+        count += cap_count;
     }
+    return count;
+}
+
+int get_dash_range_vertex_count(int point_length, int first, int last, int join, int cap) {
+    int join_count = join == JOIN_BEVEL ? 2 : join == JOIN_ROUND ? round_segments + 1 : 1;
+    int cap_count = cap == CAP_ROUND ? round_segments - 1 : 2;
+    int segment_count = last - first;
+    int count = first == 0 ? cap_count : 2 + join_count;
+    count += segment_count * 4 + (segment_count - 1) * join_count;
+    if (join == JOIN_BEVEL) {
+        // bevel segments after the first one start with an extra join vertex
+        count += first == 0 ? segment_count - 1 : segment_count;
+    }
+    if (last == point_length - 1) {
+        count += cap_count;
+    }
+    return count;
 }
 
 void build_solid_line(float* data, int point_length, int join, int cap, int count, struct Vertex* vertices, unsigned short* indices) {
-    float vector[2] = {data[2] - data[0], data[3] - data[1]};
+    build_solid_line_range(data, point_length, 0, point_length - 1, join, cap, count, vertices, indices, INDEX_UINT16);
+}
+
+void build_solid_line_range(float* data, int point_length, int first, int last, int join, int cap, int count,
+                            struct Vertex* vertices, void* indices, int index_format) {
+    double start = line_profile_start();
+#ifdef LINE_SIMD
+    if (line_simd_supported()) {
+        build_solid_line_range_simd(data, point_length, first, last, join, cap, count, vertices, indices, index_format);
+    } else {
+        build_solid_line_range_scalar(data, point_length, first, last, join, cap, count, vertices, indices,
+                                      index_format);
+    }
+#else
+    build_solid_line_range_scalar(data, point_length, first, last, join, cap, count, vertices, indices, index_format);
+#endif
+    if (profiling) {
+        int vertex_count = get_solid_range_vertex_count(point_length, first, last, join, cap);
+        line_profile_end(start, 1, last - first + 1, vertex_count, vertex_count * 3 - 6);
+    }
+}
+
+/*
+ * 实线的生成过程, join 和 cap 作为参数. 下面的特化版本用常量 join 调用并展开全部内联, 编译器据此去掉
+ * 每个顶点上对 join 和顶点序号的分支
+ */
+static inline void solid_line_range_kernel(float* data, int point_length, int first, int last, int join, int cap,
+                                           int count, struct Vertex* vertices, void* indices, int index_format) {
+    float vector[2] = {0, 0};
     float other_vector[2] = {0, 0};
     int inner_count = -1;
     short is_counter_clockwise = 1;
-    normalize(vector);
     int index = 0;
     int i_index = 0;
-    count++;
-    inner_count++;
-    generate_vertex(data[0], data[1], vector, cap, join, 4,
-                other_vector, IS_CAP, vertices, index++);
+    if (first == 0) {
+        vector[0] = data[2] - data[0];
+        vector[1] = data[3] - data[1];
+        normalize(vector);
+        if (cap == CAP_ROUND) {
+            generate_round_cap(data[0], data[1], vector, 0, 0, &count, &inner_count, is_counter_clockwise, vertices,
+                               &index, indices, &i_index, index_format);
+        } else {
+            count++;
+            inner_count++;
+            generate_vertex(data[0], data[1], vector, cap, join, 4,
+                        other_vector, IS_CAP, vertices, index++);
+
+            count++;
+            inner_count++;
+            generate_vertex(data[0], data[1], vector, cap, join, 5,
+                    other_vector, IS_CAP, vertices, index++);
+        }
+    } else {
+        // 从中间续接: 重新生成上一段的末端顶点和拐角, 绕序与整条线一次生成时保持一致
+        // 每段 4 个顶点, 圆角之后三角带的奇偶重新开始, 所以续接处的奇偶总是相同
+        inner_count = 1;
+        int i = first - 1;
 
-    count++;
-    inner_count++;
-    generate_vertex(data[0], data[1], vector, cap, join, 5,
-            other_vector, IS_CAP, vertices, index++);
+        float xi_next = data[i * 2 + 2];
+        float yi_next = data[i * 2 + 3];
+        vector[0] = xi_next - data[i * 2];
+        vector[1] = yi_next - data[i * 2 + 1];
+        normalize(vector);
+        float vector_next[2] = {data[i * 2 + 4] - xi_next, data[i * 2 + 5] - yi_next};
+        normalize(vector_next);
 
-    for (int i = 0; i < point_length - 1; i++) {
+        count++;
+        inner_count++;
+        generate_vertex(xi_next, yi_next, vector, cap, join, 2, vector_next, IS_LINE, vertices, index++);
+
+        count++;
+        inner_count++;
+        generate_vertex(xi_next, yi_next, vector, cap, join, 3, vector_next, IS_LINE, vertices, index++);
+
+        if (join == JOIN_ROUND) {
+            generate_round_join(xi_next, yi_next, vector, vector_next, 0, 0, &count, vertices, &index, indices,
+                                &i_index, index_format);
+        }
+    }
+
+    for (int i = first; i < last; i++) {
         float xi = data[i * 2];
         float yi = data[i * 2 + 1];
         float xi_next = data[i * 2 + 2];
@@ -279,33 +479,46 @@ void build_solid_line(float* data, int point_length, int join, int cap, int coun
             normalize(vector_next);
         }
 
+        // 圆角已经写入了顶点 0/1 的三角形, 三角带从顶点 2 重新接上, 奇偶与第一段相同
+        int after_round_join = join == JOIN_ROUND && i != 0;
         generate_vertex(xi, yi, vector, cap, join, 0, vector_prev, i == 0 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
-        i_index += 3;
+        if (after_round_join) {
+            count++;
+        } else {
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+            i_index += 3;
+        }
 
         generate_vertex(xi, yi, vector, cap, join, 1, vector_prev, i == 0 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
-        i_index += 3;
+        if (after_round_join) {
+            count++;
+            inner_count = 3;
+        } else {
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+            i_index += 3;
+        }
 
         generate_vertex(xi_next, yi_next, vector, cap, join, 2,
                     vector_next, i == point_length - 2 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
         i_index += 3;
 
         generate_vertex(xi_next, yi_next, vector, cap, join, 3,
                     vector_next, i == point_length - 2 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
         i_index += 3;
 
-        if (join == JOIN_ROUND && i != point_length - 2) {
-            generate_vertex(xi_next, yi_next, vector, cap, join, 8,
-                        vector_next, IS_JOIN, vertices, index++);
-            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
-            i_index += 3;
-            is_counter_clockwise = is_counter_clockwise ? 0 : 1;
+        // 范围内最后一段的拐角留给下一个范围生成
+        if (join == JOIN_ROUND && i != last - 1) {
+            generate_round_join(xi_next, yi_next, vector, vector_next, 0, 0, &count, vertices, &index, indices,
+                                &i_index, index_format);
         }
     }
 
+    if (last != point_length - 1) {
+        return;
+    }
+
     vector[0] = data[point_length * 2 - 2] - data[point_length * 2 - 4];
     vector[1] = data[point_length * 2 - 1] - data[point_length * 2 - 3];
 
@@ -314,17 +527,158 @@ void build_solid_line(float* data, int point_length, int join, int cap, int coun
     other_vector[0] = 0;
     other_vector[1] = 0;
 
+    if (cap == CAP_ROUND) {
+        generate_round_cap(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, 1, 0, &count, &inner_count,
+                           is_counter_clockwise, vertices, &index, indices, &i_index, index_format);
+        return;
+    }
+
     generate_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, cap, join, 6,
                 other_vector, IS_CAP, vertices, index++);
-    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
     i_index += 3;
 
     generate_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, cap, join, 7,
                 other_vector, IS_CAP, vertices, index++);
-    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
     i_index += 3;
 }
 
+void append_solid_line(float* data, int data_offset, int point_length, int old_point_length, int join, int cap,
+                       struct Vertex* vertices, void* indices, int index_format) {
+    // 从旧的最后一个点续接: 重新生成旧的末端 (原来的 cap 变成拐角) 和新增的线段
+    int first = old_point_length - 1;
+    int vertex_start = get_solid_range_vertex_count(point_length, 0, first, join, cap) - 2;
+    build_solid_line_range(data, point_length - data_offset, first - data_offset, point_length - 1 - data_offset,
+                           join, cap, vertex_start - 1, vertices, indices, index_format);
+}
+
+float append_dash_line(float* data, int data_offset, int point_length, int old_point_length, int join, int cap,
+                       float lengthsofar, struct Vertex* vertices, void* indices, int index_format) {
+    int first = old_point_length - 1;
+    int vertex_start = get_dash_range_vertex_count(point_length, 0, first, join, cap) - 2;
+    return build_dash_line_range(data, point_length - data_offset, first - data_offset, point_length - 1 - data_offset,
+                                 join, cap, lengthsofar, vertex_start - 1, vertices, indices, index_format);
+}
+
+int build_solid_lines(float* data, int line_count, int* point_offsets, int* joins, int* caps, float* widths,
+                      struct Vertex* vertices, void* indices, int index_format, int* ranges) {
+    int index_size = index_format == INDEX_UINT32 ? 4 : 2;
+    int vertex_start = 0;
+    int index_start = 0;
+    for (int i = 0; i < line_count; i++) {
+        int point_start = point_offsets[i];
+        int point_length = point_offsets[i + 1] - point_start;
+        ranges[i * 2] = index_start;
+        ranges[i * 2 + 1] = 0;
+        if (point_length < 2) {
+            continue;
+        }
+        int join = joins[i];
+        int cap = caps[i];
+        int vertex_count = get_solid_vertex_count(point_length, join, cap);
+        int index_count = vertex_count * 3 - 6;
+        struct Vertex* line_vertices = vertices + vertex_start;
+        build_solid_line_range(data + point_start * 2, point_length, 0, point_length - 1, join, cap,
+                               vertex_start - 1, line_vertices, (char*)indices + index_start * index_size,
+                               index_format);
+        // 合批后线宽不能再用 uniform, 逐顶点写入 lengthsofar. part 的高位存 cap 和 join, 着色器不读, 留给读回顶点的代码
+        short style = (short)(cap * BATCH_CAP_SHIFT + join * BATCH_JOIN_SHIFT);
+        float width = widths[i];
+        for (int v = 0; v < vertex_count; v++) {
+            line_vertices[v].part += style;
+            line_vertices[v].lengthsofar = width;
+        }
+        ranges[i * 2 + 1] = index_count;
+        vertex_start += vertex_count;
+        index_start += index_count;
+    }
+    return index_start;
+}
+
+void get_vertex_bounds(struct Vertex* vertices, int vertex_count, float* bounds) {
+    double start = line_profile_start();
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    float offset_x = 0, offset_y = 0;
+    for (int i = 0; i < vertex_count; i++) {
+        struct Vertex *vertex = &vertices[i];
+        min_x = fminf(min_x, vertex->x);
+        max_x = fmaxf(max_x, vertex->x);
+        min_y = fminf(min_y, vertex->y);
+        max_y = fmaxf(max_y, vertex->y);
+        offset_x = fmaxf(offset_x, fabsf(vertex->offset_x));
+        offset_y = fmaxf(offset_y, fabsf(vertex->offset_y));
+    }
+    if (vertex_count == 0) {
+        min_x = max_x = min_y = max_y = 0;
+    }
+    bounds[0] = min_x;
+    bounds[1] = min_y;
+    bounds[2] = max_x;
+    bounds[3] = max_y;
+    bounds[4] = offset_x;
+    bounds[5] = offset_y;
+    line_profile_end(start, 0, 0, 0, 0);
+}
+
+static short snorm16(float value) {
+    if (value > 1) {
+        value = 1;
+    } else if (!(value >= -1)) {
+        value = -1;
+    }
+    return (short)(value * 32767 + (value < 0 ? -0.5f : 0.5f));
+}
+
+void pack_vertices(struct Vertex* vertices, int vertex_count, float* pack) {
+    double start = line_profile_start();
+    float min_x = INFINITY, min_y = INFINITY, min_length = INFINITY;
+    float max_x = -INFINITY, max_y = -INFINITY, max_length = -INFINITY;
+    for (int i = 0; i < vertex_count; i++) {
+        struct Vertex *vertex = &vertices[i];
+        min_x = fminf(min_x, vertex->x);
+        max_x = fmaxf(max_x, vertex->x);
+        min_y = fminf(min_y, vertex->y);
+        max_y = fmaxf(max_y, vertex->y);
+        min_length = fminf(min_length, vertex->lengthsofar);
+        max_length = fmaxf(max_length, vertex->lengthsofar);
+    }
+    if (vertex_count == 0) {
+        min_x = max_x = min_y = max_y = min_length = max_length = 0;
+    }
+    float origin_x = (min_x + max_x) * 0.5f;
+    float origin_y = (min_y + max_y) * 0.5f;
+    float extent_x = (max_x - min_x) * 0.5f;
+    float extent_y = (max_y - min_y) * 0.5f;
+    float length_span = max_length - min_length;
+    // 范围为 0 时任意值都能解码回原值, 用 1 避免除 0
+    extent_x = extent_x > 0 ? extent_x : 1;
+    extent_y = extent_y > 0 ? extent_y : 1;
+    length_span = length_span > 0 ? length_span : 1;
+    pack[0] = origin_x;
+    pack[1] = origin_y;
+    pack[2] = extent_x;
+    pack[3] = extent_y;
+    pack[4] = min_length;
+    pack[5] = length_span;
+
+    // 紧凑顶点是原顶点的一半大小, 从前往后原地转换时只会覆盖已经读过的顶点
+    char *out = (char *)vertices;
+    for (int i = 0; i < vertex_count; i++) {
+        struct Vertex vertex = vertices[i];
+        struct PackedVertex packed;
+        packed.x = snorm16((vertex.x - origin_x) / extent_x);
+        packed.y = snorm16((vertex.y - origin_y) / extent_y);
+        packed.offset_x = snorm16(vertex.offset_x / PACK_OFFSET_SCALE);
+        packed.offset_y = snorm16(vertex.offset_y / PACK_OFFSET_SCALE);
+        packed.direction = (unsigned char)(vertex.direction + 1);
+        packed.part = (unsigned char)vertex.part;
+        packed.lengthsofar = (unsigned short)((vertex.lengthsofar - min_length) / length_span * 65535 + 0.5f);
+        memcpy(out + (size_t)i * sizeof(struct PackedVertex), &packed, sizeof(struct PackedVertex));
+    }
+    line_profile_end(start, 0, 0, 0, 0);
+}
+
 void calc_offset_dash(float x1, float y1, float x2, float y2, int index, char part, float *out) {
     float normal[2] = {0};
     calc_normal(x1, y1, index, normal);
@@ -482,27 +836,86 @@ void generate_dash_vertex(float x, float y, float vx, float vy, int cap, int joi
 }
 
 void build_dash_line(float *data, int point_length, int join, int cap, float lengthsofar, int count, struct Vertex* vertices, unsigned short* indices) {
+    build_dash_line_range(data, point_length, 0, point_length - 1, join, cap, lengthsofar, count, vertices, indices, INDEX_UINT16);
+}
+
+/* 虚线的生成过程, 与 solid_line_range_kernel 一样按 join 特化 */
+static inline float dash_line_range_kernel(float *data, int point_length, int first, int last, int join, int cap,
+                                           float lengthsofar, int count, struct Vertex* vertices, void* indices,
+                                           int index_format) {
     int index = 0;
     int i_index = 0;
-    float vector_x = data[2] - data[0];
-    float vector_y = data[3] - data[1];
+    float vector_x = 0;
+    float vector_y = 0;
     int inner_count = -1;
     short is_counter_clockwise = 1;
-    float vector[2] = {vector_x, vector_y};
-    normalize(vector);
-    vector_x = vector[0];
-    vector_y = vector[1];
-    count++;
-    inner_count++;
-    generate_dash_vertex(data[0], data[1], vector_x, vector_y, cap, join, 4, lengthsofar,
-                     0, 0, IS_CAP, vertices, index++);
+    if (first == 0) {
+        float vector[2] = {data[2] - data[0], data[3] - data[1]};
+        normalize(vector);
+        vector_x = vector[0];
+        vector_y = vector[1];
+        if (cap == CAP_ROUND) {
+            generate_round_cap(data[0], data[1], vector, 0, lengthsofar, &count, &inner_count, is_counter_clockwise,
+                               vertices, &index, indices, &i_index, index_format);
+        } else {
+            count++;
+            inner_count++;
+            generate_dash_vertex(data[0], data[1], vector_x, vector_y, cap, join, 4, lengthsofar,
+                             0, 0, IS_CAP, vertices, index++);
+
+            count++;
+            inner_count++;
+            generate_dash_vertex(data[0], data[1], vector_x, vector_y, cap, join, 5, lengthsofar,
+                             0, 0, IS_CAP, vertices, index++);
+        }
+    } else {
+        // 从中间续接: 重新生成上一段的末端顶点和拐角, lengthsofar 为第 first 个点处的累计长度
+        int i = first - 1;
+        int flips = join == JOIN_BEVEL ? i * 3 : i;
+        inner_count = ((join == JOIN_BEVEL ? i * 7 : i * 5) + 3) & 1;
+        is_counter_clockwise = flips % 2 == 0;
 
-    count++;
-    inner_count++;
-    generate_dash_vertex(data[0], data[1], vector_x, vector_y, cap, join, 5, lengthsofar,
-                     0, 0, IS_CAP, vertices, index++);
+        float xi_next = data[i * 2 + 2];
+        float yi_next = data[i * 2 + 3];
+        float vector[2] = {xi_next - data[i * 2], yi_next - data[i * 2 + 1]};
+        normalize(vector);
+        vector_x = vector[0];
+        vector_y = vector[1];
+        float vector_next[2] = {data[i * 2 + 4] - xi_next, data[i * 2 + 5] - yi_next};
+        normalize(vector_next);
+        float vector_x_next = vector_next[0];
+        float vector_y_next = vector_next[1];
+
+        count++;
+        inner_count++;
+        generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 2, lengthsofar,
+                         vector_x_next, vector_y_next, IS_LINE, vertices, index++);
 
-    for (int i = 0; i < point_length - 1; i++) {
+        count++;
+        inner_count++;
+        generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 3, lengthsofar,
+                         vector_x_next, vector_y_next, IS_LINE, vertices, index++);
+
+        if (join == JOIN_ROUND) {
+            generate_round_join(xi_next, yi_next, vector, vector_next, lengthsofar, 1, &count, vertices, &index,
+                                indices, &i_index, index_format);
+        } else {
+            if (join == JOIN_BEVEL) {
+                generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 9, lengthsofar,
+                                 vector_x_next, vector_y_next, IS_JOIN, vertices, index++);
+                store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+                i_index += 3;
+                is_counter_clockwise = is_counter_clockwise ? 0 : 1;
+            }
+            generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 8, lengthsofar,
+                             vector_x_next, vector_y_next, IS_JOIN, vertices, index++);
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+            i_index += 3;
+            is_counter_clockwise = is_counter_clockwise ? 0 : 1;
+        }
+    }
+
+    for (int i = first; i < last; i++) {
         float xi = data[i * 2];
         float yi = data[i * 2 + 1];
         float xi_next = data[i * 2 + 2];
@@ -542,49 +955,70 @@ void build_dash_line(float *data, int point_length, int join, int cap, float len
         if (i != 0 && join == JOIN_BEVEL) {
             generate_dash_vertex(xi, yi, vector_x, vector_y, cap, join, 10, lengthsofar,
                             vector_x_prev, vector_y_prev, IS_JOIN, vertices, index++);
-            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
             is_counter_clockwise = is_counter_clockwise ? 0 : 1;
         }
 
+        // 圆角已经写入了顶点 0/1 的三角形, 三角带从顶点 2 重新接上, 奇偶和绕序与第一段相同
+        int after_round_join = join == JOIN_ROUND && i != 0;
         generate_dash_vertex(xi, yi, vector_x, vector_y, cap, join, 0, lengthsofar, vector_x_prev,
                          vector_y_prev, i == 0 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        if (after_round_join) {
+            count++;
+        } else {
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
+        }
 
         generate_dash_vertex(xi, yi, vector_x, vector_y, cap, join, 1, lengthsofar, vector_x_prev,
                          vector_y_prev, i == 0 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        if (after_round_join) {
+            count++;
+            inner_count = 3;
+            is_counter_clockwise = 1;
+        } else {
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
+        }
 
         lengthsofar += length(orig_vector_x, orig_vector_y);
 
         generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 2, lengthsofar,
                          vector_x_next, vector_y_next, i == point_length - 2 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
 
         generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 3, lengthsofar,
                          vector_x_next, vector_y_next, i == point_length - 2 ? IS_CAP : IS_LINE, vertices, index++);
-        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+        store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
 
-        if (i != point_length - 2) {
+        // 范围内最后一段的拐角留给下一个范围生成
+        if (join == JOIN_ROUND && i != last - 1) {
+            float vector[2] = {vector_x, vector_y};
+            float vector_next[2] = {vector_x_next, vector_y_next};
+            generate_round_join(xi_next, yi_next, vector, vector_next, lengthsofar, 1, &count, vertices, &index,
+                                indices, &i_index, index_format);
+        } else if (i != last - 1) {
             if (join == JOIN_BEVEL) {
                 generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 9, lengthsofar,
                                  vector_x_next, vector_y_next, IS_JOIN, vertices, index++);
-                store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+                store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
                 i_index += 3;
                 is_counter_clockwise = is_counter_clockwise ? 0 : 1;
             }
             generate_dash_vertex(xi_next, yi_next, vector_x, vector_y, cap, join, 8, lengthsofar,
                              vector_x_next, vector_y_next, IS_JOIN, vertices, index++);
-            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
             is_counter_clockwise = is_counter_clockwise ? 0 : 1;
         }
     }
 
+    if (last != point_length - 1) {
+        return lengthsofar;
+    }
 
     vector_x = data[point_length * 2 - 2] - data[point_length * 2 - 4];
     vector_y = data[point_length * 2 - 1] - data[point_length * 2 - 3];
@@ -593,37 +1027,97 @@ void build_dash_line(float *data, int point_length, int join, int cap, float len
     vector_x = vector3[0];
     vector_y = vector3[1];
 
+    if (cap == CAP_ROUND) {
+        generate_round_cap(data[point_length * 2 - 2], data[point_length * 2 - 1], vector3, 1, lengthsofar, &count,
+                           &inner_count, is_counter_clockwise, vertices, &index, indices, &i_index, index_format);
+        return lengthsofar;
+    }
+
     generate_dash_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector_x, vector_y, cap, join, 6, lengthsofar,
                      0, 0, IS_CAP, vertices, index++);
-    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
             i_index += 3;
 
     generate_dash_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector_x, vector_y, cap, join, 7, lengthsofar,
                      0, 0, IS_CAP, vertices, index++);
-    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
                 i_index += 3;
+    return lengthsofar;
 }
 
-void store_index(int index, int inner_count, short is_counter_clockwise, unsigned short *out, int i_index) {
-    if (inner_count % 2 == 0) {
-        if (is_counter_clockwise) {
-            out[i_index++] = index - 2;
-            out[i_index++] = index - 1;
-            out[i_index++] = index;
-        } else {
-            out[i_index++] = index - 1;
-            out[i_index++] = index - 2;
-            out[i_index++] = index;
-        }
+
+typedef void (*SolidLineKernel)(float* data, int point_length, int first, int last, int cap, int count,
+                                struct Vertex* vertices, void* indices, int index_format);
+typedef float (*DashLineKernel)(float* data, int point_length, int first, int last, int cap, float lengthsofar,
+                                int count, struct Vertex* vertices, void* indices, int index_format);
+
+#define LINE_KERNEL(name, join)                                                                                  \
+    static LINE_SPECIALIZED void build_solid_##name(float* data, int point_length, int first, int last, int cap, \
+                                                    int count, struct Vertex* vertices, void* indices,          \
+                                                    int index_format) {                                         \
+        solid_line_range_kernel(data, point_length, first, last, join, cap, count, vertices, indices,           \
+                                index_format);                                                                  \
+    }                                                                                                           \
+    static LINE_SPECIALIZED float build_dash_##name(float* data, int point_length, int first, int last, int cap, \
+                                                    float lengthsofar, int count, struct Vertex* vertices,      \
+                                                    void* indices, int index_format) {                          \
+        return dash_line_range_kernel(data, point_length, first, last, join, cap, lengthsofar, count,           \
+                                      vertices, indices, index_format);                                         \
+    }
+
+LINE_KERNEL(miter, 0)
+LINE_KERNEL(round, 1)
+LINE_KERNEL(bevel, 2)
+
+// 按 JOIN_* 的取值排列
+static const SolidLineKernel SOLID_KERNELS[3] = {build_solid_miter, build_solid_round, build_solid_bevel};
+static const DashLineKernel DASH_KERNELS[3] = {build_dash_miter, build_dash_round, build_dash_bevel};
+
+void build_solid_line_range_scalar(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                   struct Vertex* vertices, void* indices, int index_format) {
+    if (join >= JOIN_MITER && join <= JOIN_BEVEL) {
+        SOLID_KERNELS[join](data, point_length, first, last, cap, count, vertices, indices, index_format);
+        return;
+    }
+    solid_line_range_kernel(data, point_length, first, last, join, cap, count, vertices, indices, index_format);
+}
+
+void build_solid_line_range_generic(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                    struct Vertex* vertices, void* indices, int index_format) {
+    solid_line_range_kernel(data, point_length, first, last, join, cap, count, vertices, indices, index_format);
+}
+
+float build_dash_line_range(float *data, int point_length, int first, int last, int join, int cap, float lengthsofar,
+                            int count, struct Vertex* vertices, void* indices, int index_format) {
+    double start = line_profile_start();
+    float end_lengthsofar;
+    if (join >= JOIN_MITER && join <= JOIN_BEVEL) {
+        end_lengthsofar = DASH_KERNELS[join](data, point_length, first, last, cap, lengthsofar, count, vertices,
+                                             indices, index_format);
     } else {
-        if (is_counter_clockwise) {
-            out[i_index++] = index - 1;
-            out[i_index++] = index - 2;
-            out[i_index++] = index;
-        } else {
-            out[i_index++] = index - 2;
-            out[i_index++] = index - 1;
-            out[i_index++] = index;
-        }
+        end_lengthsofar = dash_line_range_kernel(data, point_length, first, last, join, cap, lengthsofar, count,
+                                                 vertices, indices, index_format);
+    }
+    if (profiling) {
+        int vertex_count = get_dash_range_vertex_count(point_length, first, last, join, cap);
+        line_profile_end(start, 1, last - first + 1, vertex_count, vertex_count * 3 - 6);
+    }
+    return end_lengthsofar;
+}
+
+float build_dash_line_range_generic(float *data, int point_length, int first, int last, int join, int cap,
+                                    float lengthsofar, int count, struct Vertex* vertices, void* indices,
+                                    int index_format) {
+    return dash_line_range_kernel(data, point_length, first, last, join, cap, lengthsofar, count, vertices, indices,
+                                  index_format);
+}
+
+void store_index(int index, int inner_count, short is_counter_clockwise, void *out, int i_index, int index_format) {
+    int first = index - 2;
+    int second = index - 1;
+    if ((inner_count % 2 == 0) != (is_counter_clockwise != 0)) {
+        first = index - 1;
+        second = index - 2;
     }
+    store_triangle(first, second, index, out, i_index, index_format);
 }
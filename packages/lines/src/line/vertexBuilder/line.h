@@ -0,0 +1,269 @@
+#ifndef LINE_H
+#define LINE_H
+
+struct Vertex {
+    float x;
+    float y;
+    float offset_x;
+    float offset_y;
+    short direction;
+    short part;
+    float lengthsofar;
+};
+
+/**
+ * Compact 12 byte layout of a vertex produced by pack_vertices: positions as snorm16 relative to the mesh bounds,
+ * offsets as snorm16 divided by PACK_OFFSET_SCALE, direction + 1 and part as bytes and lengthsofar as unorm16
+ * relative to the mesh's length range.
+ */
+struct PackedVertex {
+    short x;
+    short y;
+    short offset_x;
+    short offset_y;
+    unsigned char direction;
+    unsigned char part;
+    unsigned short lengthsofar;
+};
+
+/* Offsets reach 10 at the miter limit, so they are scaled down into the snorm16 range. */
+#define PACK_OFFSET_SCALE 16
+
+/* Same values as IndexFormat in @galacean/engine. */
+#define INDEX_UINT16 1
+#define INDEX_UINT32 2
+
+/*
+ * Round caps and joins are triangle fans. A half circle is split into round_segments arcs, so a cap or a join has
+ * round_segments - 1 vertices between the two ends of its arc. The count applies to every following count and
+ * build until it is set again; the caller picks it from the width of the line on screen.
+ */
+#define ROUND_SEGMENTS_MIN 3
+#define ROUND_SEGMENTS_MAX 64
+#define ROUND_SEGMENTS_DEFAULT 8
+
+void set_round_segments(int segments);
+int get_round_segments(void);
+
+int get_solid_vertex_count(int point_length, int join, int cap);
+int get_dash_vertex_count(int point_length, int join, int cap);
+int get_solid_range_vertex_count(int point_length, int first, int last, int join, int cap);
+int get_dash_range_vertex_count(int point_length, int first, int last, int join, int cap);
+
+void build_solid_line(float* data, int point_length, int join, int cap, int count, struct Vertex* vertices, unsigned short* indices);
+void build_dash_line(float *data, int point_length, int join, int cap, float lengthsofar, int count, struct Vertex* vertices, unsigned short* indices);
+
+/**
+ * Tessellate segments [first, last) of the polyline, segment i running from point i to point i + 1.
+ * Ranges that do not start at the first point begin with the join at point `first`, ranges that do not
+ * end at the last point stop before the join at point `last`, so consecutive ranges tile the line
+ * seamlessly. Vertex indices restart at `count + 1` for every range; triangles keep the winding they
+ * would have in a single full build. `index_format` is INDEX_UINT16 or INDEX_UINT32.
+ */
+void build_solid_line_range(float* data, int point_length, int first, int last, int join, int cap, int count,
+                            struct Vertex* vertices, void* indices, int index_format);
+/*
+ * The one-segment-at-a-time implementation build_solid_line_range falls back to without SIMD. It dispatches once
+ * per call to a kernel specialized for the join, compiled with it as a constant so no vertex branches on the join
+ * or on its role in the segment. The cap stays a parameter, it is only used at the two ends.
+ */
+void build_solid_line_range_scalar(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                   struct Vertex* vertices, void* indices, int index_format);
+/* The same build without specialization, the same output bit for bit, kept to measure the specialized kernels. */
+void build_solid_line_range_generic(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                    struct Vertex* vertices, void* indices, int index_format);
+
+/* Targets with 128-bit float vectors also get the SIMD kernel in line_simd.c. */
+#if defined(__wasm_simd128__) || defined(__SSE2__) || (defined(__ARM_NEON) && defined(__aarch64__))
+#define LINE_SIMD 1
+#endif
+
+/* Whether build_solid_line_range can use build_solid_line_range_simd on this machine. */
+int line_simd_supported(void);
+#ifdef LINE_SIMD
+/**
+ * Same output as build_solid_line_range_scalar, bit for bit. Segment directions and join offsets are
+ * computed four at a time into structure-of-arrays blocks first, then vertices and indices are emitted.
+ */
+void build_solid_line_range_simd(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                 struct Vertex* vertices, void* indices, int index_format);
+#endif
+/**
+ * Dash variant of build_solid_line_range. `lengthsofar` is the accumulated length at point `first`;
+ * the accumulated length at point `last` is returned so the next range can continue from it.
+ * Dispatches to a kernel specialized for the join like build_solid_line_range_scalar.
+ */
+float build_dash_line_range(float *data, int point_length, int first, int last, int join, int cap, float lengthsofar,
+                            int count, struct Vertex* vertices, void* indices, int index_format);
+float build_dash_line_range_generic(float *data, int point_length, int first, int last, int join, int cap,
+                                    float lengthsofar, int count, struct Vertex* vertices, void* indices,
+                                    int index_format);
+
+/**
+ * Continue a line of `old_point_length` points that now has `point_length` points, without rebuilding it.
+ * Only the old end (whose cap becomes a join) and the new segments are generated. The output starts at
+ * vertex `get_solid_range_vertex_count(point_length, 0, old_point_length - 1, join) - 2` and index
+ * `3 * vertex_start` of the full build, with indices already offset, so it can be written over the tail
+ * of the existing buffers. Requires old_point_length >= 2.
+ * `data` holds the points from `data_offset` on, which must be at most old_point_length - 2, so only the
+ * tail of a long line has to be passed in.
+ */
+void append_solid_line(float* data, int data_offset, int point_length, int old_point_length, int join, int cap,
+                       struct Vertex* vertices, void* indices, int index_format);
+/**
+ * Dash variant of append_solid_line. `lengthsofar` is the accumulated length at the old last point, the
+ * accumulated length at the new last point is returned.
+ */
+float append_dash_line(float* data, int data_offset, int point_length, int old_point_length, int join, int cap,
+                       float lengthsofar, struct Vertex* vertices, void* indices, int index_format);
+
+/**
+ * Convert `vertex_count` built vertices in place to PackedVertex, halving their size. `pack` receives the six
+ * decode parameters: origin x, y and half extent x, y of the positions (position = origin + snorm * extent), then
+ * the start and span of lengthsofar (lengthsofar = start + unorm * span).
+ */
+void pack_vertices(struct Vertex* vertices, int vertex_count, float* pack);
+
+/**
+ * Bounds of built vertices for culling: min x, min y, max x, max y of the positions, then the max absolute x and y
+ * of the offsets, which the shader scales by the line width.
+ */
+void get_vertex_bounds(struct Vertex* vertices, int vertex_count, float* bounds);
+
+/*
+ * What the builds cost while set_line_profiling is on, summed until the caller clears them: every run of
+ * build_solid_line_range or build_dash_line_range counts one call with the points, vertices and indices of its range,
+ * and milliseconds adds the time spent in those runs and in pack_vertices, get_vertex_bounds and convert_to_strip.
+ * The clock is performance.now, imported as env.emscripten_get_now in wasm, and CLOCK_MONOTONIC natively.
+ */
+struct LineCounters {
+    double calls;
+    double points;
+    double vertices;
+    double indices;
+    double milliseconds;
+};
+
+void set_line_profiling(int enabled);
+struct LineCounters* get_line_counters(void);
+/* Bracket a profiled step: line_profile_start returns the clock while profiling, line_profile_end adds to counters. */
+double line_profile_start(void);
+void line_profile_end(double start, int calls, int points, int vertices, int indices);
+
+/*
+ * Per-vertex style encoding of batched lines: part + cap * BATCH_CAP_SHIFT + join * BATCH_JOIN_SHIFT. Not read by
+ * the lineBatch shader, see build_solid_lines.
+ */
+#define BATCH_CAP_SHIFT 4
+#define BATCH_JOIN_SHIFT 16
+
+/**
+ * Tessellate several solid polylines into one vertex and index buffer.
+ * Line i uses points [point_offsets[i], point_offsets[i + 1]) of `data`, so `point_offsets` holds
+ * line_count + 1 entries. Indices address the shared vertex buffer. Because a batch is drawn with one
+ * material, the per-line style is baked into the vertices: `lengthsofar` carries the width, which the lineBatch
+ * shader applies. The cap and join are already in the triangles, the shader does not need them; `part` still
+ * carries them (see BATCH_CAP_SHIFT) for code reading the vertices back. For each line `ranges` receives its first
+ * index and index count; lines with fewer than two points get an empty range. Returns the total index count.
+ */
+int build_solid_lines(float* data, int line_count, int* point_offsets, int* joins, int* caps, float* widths,
+                      struct Vertex* vertices, void* indices, int index_format, int* ranges);
+
+/**
+ * Build the whole line with up to `thread_count` threads, with the same output as a single build_solid_line_range
+ * over all segments. The segments are split into ranges tessellated concurrently into their place in the output,
+ * short lines are built on the calling thread. Threads are only used when compiled with LINE_THREADS, so this is
+ * native only: the wasm modules neither build nor export it.
+ */
+void build_solid_line_parallel(float* data, int point_length, int join, int cap, int count, struct Vertex* vertices,
+                               void* indices, int index_format, int thread_count);
+/**
+ * Dash variant of build_solid_line_parallel, returns the accumulated length at the last point.
+ */
+float build_dash_line_parallel(float* data, int point_length, int join, int cap, float lengthsofar, int count,
+                               struct Vertex* vertices, void* indices, int index_format, int thread_count);
+
+/**
+ * Douglas-Peucker importance of every point, computed once per point set before tessellation: keeping the points
+ * whose importance is greater than a tolerance gives a simplification within that tolerance of the original line,
+ * and the kept sets of larger tolerances are subsets of smaller ones, so changing the level of detail only needs a
+ * new threshold. The end points get FLT_MAX. `stack` is scratch space for 2 * point_length ints.
+ */
+void compute_line_importance(float* data, int point_length, float* importance, int* stack);
+
+/*
+ * Segment index for CPU hit testing: a packed bounding volume hierarchy over the segments of a line in input order,
+ * which keeps neighbouring segments together. Leaves bound LINE_INDEX_NODE_SIZE consecutive segments, every level
+ * above bounds LINE_INDEX_NODE_SIZE nodes of the one below, up to the root. `nodes` holds min x, min y, max x,
+ * max y of every node, level by level from the leaves.
+ */
+#define LINE_INDEX_NODE_SIZE 8
+
+/** Node count of the index of a line, 0 for lines without segments. */
+int get_line_index_node_count(int point_length);
+void build_line_index(float* data, int point_length, float* nodes);
+/**
+ * Find the segment nearest to (x, y) within max_distance. Returns its index, or -1 if there is none, and writes the
+ * distance and the parametric position on the segment (0 at its start point, 1 at its end) to `result`.
+ */
+int query_line_index_nearest(float* data, int point_length, float* nodes, float x, float y, float max_distance,
+                             float* result);
+/**
+ * Collect the segments whose bounds intersect the rectangle, in input order. Returns the total count, only the
+ * first `capacity` are written to `out`.
+ */
+int query_line_index_rect(float* data, int point_length, float* nodes, float min_x, float min_y, float max_x,
+                          float max_y, int* out, int capacity);
+
+/*
+ * Triangle strip output: rewrite the triangle list of a build as a single strip, for drawing with
+ * MeshTopology.TriangleStrip. A triangle sharing an edge with the end of the strip adds one index, one sharing a
+ * vertex adds three and any other one is stitched on with degenerate triangles, which also chains the lines of a
+ * batch. Degenerate triangles of the list are dropped. Lines are drawn without face culling, so the winding of the
+ * strip is not kept. Returns the strip length, at most get_strip_index_capacity(index_count), `out` may not
+ * overlap `indices`.
+ */
+int get_strip_index_capacity(int index_count);
+int convert_to_strip(void* indices, int index_count, int index_format, void* out);
+
+/*
+ * Curve flattening: turn curve control points into the polyline the builds take, split adaptively so the polyline
+ * stays within `tolerance` of the curve. CURVE_QUADRATIC takes quadratic Bézier pieces sharing their end points
+ * (1 + 2n points), CURVE_CUBIC cubic ones (1 + 3n points) and CURVE_CATMULL_ROM a uniform Catmull-Rom spline
+ * through every point; extra control points are ignored. Each piece is cut into the uniform parameter steps Wang's
+ * formula bounds by the tolerance, at most 1024. Returns the point count, only counting when `out` is null.
+ */
+#define CURVE_QUADRATIC 0
+#define CURVE_CUBIC 1
+#define CURVE_CATMULL_ROM 2
+
+int get_curve_piece_count(int control_length, int type);
+int flatten_curve(float* controls, int control_length, int type, float tolerance, float* out);
+
+/* Helpers shared by line.c, line_simd.c and line_parallel.c. */
+float length(float x, float y);
+void normalize(float *vector);
+void generate_vertex(float x, float y, float* vector, int cap, int join, char index,
+                 float *other_vector, char part, struct Vertex *result, int v_index);
+void store_vertex(float x, float y, float offset_x, float offset_y,
+           char direction, char part, float lengthsofar, struct Vertex *result, int index);
+void store_index(int index, int inner_count, short is_counter_clockwise, void *out, int i_index, int index_format);
+/*
+ * Arc vertices of a round cap. At the start they take the place of vertices 4 and 5 and are fanned around the
+ * following vertex 0, at the end of vertices 6 and 7, fanned around the preceding vertex 3. The first two continue
+ * the triangle strip, the rest add one triangle each.
+ */
+void generate_round_cap(float x, float y, float* vector, int end, float lengthsofar, int* count, int* inner_count,
+                        short is_counter_clockwise, struct Vertex* vertices, int* index, void* indices, int* i_index,
+                        int index_format);
+/*
+ * Arc vertices of a round join at (x, y), after vertices 2 and 3 of the segment along `vector`, fanned around the
+ * inner one. Also writes the triangles of vertices 0 and 1 of the next segment, which therefore do not continue
+ * the strip. Dash segments end on the bisector of the join instead of at the normals, `dash` adds the two normals
+ * to the arc so the fan reaches them.
+ */
+void generate_round_join(float x, float y, float* vector, float* vector_next, float lengthsofar, short dash,
+                         int* count, struct Vertex* vertices, int* index, void* indices, int* i_index,
+                         int index_format);
+
+#endif
@@ -0,0 +1,102 @@
+#include <math.h>
+#include "line.h"
+
+// 每段曲线最多分成的段数, 容差极小或为 0 时的上限
+const static int CURVE_MAX_STEPS = 1024;
+
+// 一段曲线的控制点个数, 相邻两段共用端点
+static int curve_piece_stride(int type) {
+    return type == CURVE_QUADRATIC ? 2 : 3;
+}
+
+// Wang 公式: degree 次 Bézier 按参数均匀分成 n 段时, 折线与曲线的距离不超过
+// degree * (degree - 1) / 8 * max|P[i] - 2P[i+1] + P[i+2]| / n^2
+static int curve_steps(const float* p, int degree, float tolerance) {
+    float max_sq = 0;
+    for (int i = 0; i + 2 <= degree; i++) {
+        float dx = p[i * 2] - 2 * p[i * 2 + 2] + p[i * 2 + 4];
+        float dy = p[i * 2 + 1] - 2 * p[i * 2 + 3] + p[i * 2 + 5];
+        float sq = dx * dx + dy * dy;
+        max_sq = sq > max_sq ? sq : max_sq;
+    }
+    if (!(tolerance > 0)) {
+        return max_sq > 0 ? CURVE_MAX_STEPS : 1;
+    }
+    float steps = ceilf(sqrtf(degree * (degree - 1) / 8.0f * sqrtf(max_sq) / tolerance));
+    return steps < 1 ? 1 : (steps > CURVE_MAX_STEPS ? CURVE_MAX_STEPS : (int)steps);
+}
+
+// 第 piece 段三次 Catmull-Rom 换成 Bézier 控制点, 两端重复端点
+static void catmull_rom_piece(const float* controls, int control_length, int piece, float* out) {
+    int i0 = piece > 0 ? piece - 1 : 0;
+    int i3 = piece + 2 < control_length ? piece + 2 : control_length - 1;
+    const float* p0 = controls + i0 * 2;
+    const float* p1 = controls + piece * 2;
+    const float* p2 = controls + piece * 2 + 2;
+    const float* p3 = controls + i3 * 2;
+    out[0] = p1[0];
+    out[1] = p1[1];
+    out[2] = p1[0] + (p2[0] - p0[0]) / 6;
+    out[3] = p1[1] + (p2[1] - p0[1]) / 6;
+    out[4] = p2[0] - (p3[0] - p1[0]) / 6;
+    out[5] = p2[1] - (p3[1] - p1[1]) / 6;
+    out[6] = p2[0];
+    out[7] = p2[1];
+}
+
+int get_curve_piece_count(int control_length, int type) {
+    if (control_length < 2) {
+        return 0;
+    }
+    return type == CURVE_CATMULL_ROM ? control_length - 1 : (control_length - 1) / curve_piece_stride(type);
+}
+
+int flatten_curve(float* controls, int control_length, int type, float tolerance, float* out) {
+    if (control_length <= 0) {
+        return 0;
+    }
+    // 不够一段曲线时只有起点
+    if (out) {
+        out[0] = controls[0];
+        out[1] = controls[1];
+    }
+    int piece_count = get_curve_piece_count(control_length, type);
+    int degree = type == CURVE_QUADRATIC ? 2 : 3;
+    int length = 1;
+    float bezier[8];
+    for (int piece = 0; piece < piece_count; piece++) {
+        const float* p;
+        if (type == CURVE_CATMULL_ROM) {
+            catmull_rom_piece(controls, control_length, piece, bezier);
+            p = bezier;
+        } else {
+            p = controls + piece * curve_piece_stride(type) * 2;
+        }
+        int steps = curve_steps(p, degree, tolerance);
+        if (!out) {
+            length += steps;
+            continue;
+        }
+        // 直接按 Bernstein 基求值, 段末取控制点本身, 保证首尾相接
+        for (int k = 1; k < steps; k++) {
+            float t = (float)k / steps;
+            float s = 1 - t;
+            float x, y;
+            if (degree == 2) {
+                x = s * s * p[0] + 2 * s * t * p[2] + t * t * p[4];
+                y = s * s * p[1] + 2 * s * t * p[3] + t * t * p[5];
+            } else {
+                float b0 = s * s * s, b1 = 3 * s * s * t, b2 = 3 * s * t * t, b3 = t * t * t;
+                x = b0 * p[0] + b1 * p[2] + b2 * p[4] + b3 * p[6];
+                y = b0 * p[1] + b1 * p[3] + b2 * p[5] + b3 * p[7];
+            }
+            out[length * 2] = x;
+            out[length * 2 + 1] = y;
+            length++;
+        }
+        out[length * 2] = p[degree * 2];
+        out[length * 2 + 1] = p[degree * 2 + 1];
+        length++;
+    }
+    return length;
+}
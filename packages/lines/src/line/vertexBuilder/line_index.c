@@ -0,0 +1,207 @@
+#include <float.h>
+#include <math.h>
+#include "line.h"
+
+/*
+ * 线段的层次包围盒: 按输入顺序把相邻线段分组, 折线上相邻的线段在空间上也相邻, 不需要额外排序.
+ * 每层节点连续存放, 叶子层在前, 根节点在最后.
+ */
+
+// 遍历栈的大小, 每层最多压入 LINE_INDEX_NODE_SIZE 个节点, 32 层足够任何 int 范围的线段数
+#define INDEX_STACK_SIZE (LINE_INDEX_NODE_SIZE * 32)
+
+static int level_size(int count) {
+    return (count + LINE_INDEX_NODE_SIZE - 1) / LINE_INDEX_NODE_SIZE;
+}
+
+int get_line_index_node_count(int point_length) {
+    int count = point_length - 1;
+    if (count <= 0) {
+        return 0;
+    }
+    int node_count = 0;
+    do {
+        count = level_size(count);
+        node_count += count;
+    } while (count > 1);
+    return node_count;
+}
+
+void build_line_index(float* data, int point_length, float* nodes) {
+    int segment_count = point_length - 1;
+    if (segment_count <= 0) {
+        return;
+    }
+    int leaf_count = level_size(segment_count);
+    for (int node = 0; node < leaf_count; node++) {
+        float min_x = FLT_MAX, min_y = FLT_MAX, max_x = -FLT_MAX, max_y = -FLT_MAX;
+        int last = (node + 1) * LINE_INDEX_NODE_SIZE;
+        last = last < segment_count ? last : segment_count;
+        // 线段 i 的两个端点是点 i 和 i + 1
+        for (int i = node * LINE_INDEX_NODE_SIZE; i <= last; i++) {
+            float x = data[i * 2], y = data[i * 2 + 1];
+            min_x = x < min_x ? x : min_x;
+            min_y = y < min_y ? y : min_y;
+            max_x = x > max_x ? x : max_x;
+            max_y = y > max_y ? y : max_y;
+        }
+        float *box = &nodes[node * 4];
+        box[0] = min_x;
+        box[1] = min_y;
+        box[2] = max_x;
+        box[3] = max_y;
+    }
+
+    int level_start = 0;
+    int count = leaf_count;
+    while (count > 1) {
+        int parent_start = level_start + count;
+        int parent_count = level_size(count);
+        for (int node = 0; node < parent_count; node++) {
+            float *box = &nodes[(parent_start + node) * 4];
+            box[0] = box[1] = FLT_MAX;
+            box[2] = box[3] = -FLT_MAX;
+            int last = (node + 1) * LINE_INDEX_NODE_SIZE;
+            last = last < count ? last : count;
+            for (int child = node * LINE_INDEX_NODE_SIZE; child < last; child++) {
+                float *child_box = &nodes[(level_start + child) * 4];
+                box[0] = child_box[0] < box[0] ? child_box[0] : box[0];
+                box[1] = child_box[1] < box[1] ? child_box[1] : box[1];
+                box[2] = child_box[2] > box[2] ? child_box[2] : box[2];
+                box[3] = child_box[3] > box[3] ? child_box[3] : box[3];
+            }
+        }
+        level_start = parent_start;
+        count = parent_count;
+    }
+}
+
+// 记录每层的起点和节点数, 返回层数
+static int get_levels(int segment_count, int *starts, int *counts) {
+    int level_count = 0;
+    int start = 0;
+    int count = segment_count;
+    do {
+        count = level_size(count);
+        starts[level_count] = start;
+        counts[level_count++] = count;
+        start += count;
+    } while (count > 1);
+    return level_count;
+}
+
+static float box_distance_sq(const float *box, float x, float y) {
+    float dx = x < box[0] ? box[0] - x : (x > box[2] ? x - box[2] : 0);
+    float dy = y < box[1] ? box[1] - y : (y > box[3] ? y - box[3] : 0);
+    return dx * dx + dy * dy;
+}
+
+int query_line_index_nearest(float* data, int point_length, float* nodes, float x, float y, float max_distance,
+                             float* result) {
+    int segment_count = point_length - 1;
+    if (segment_count <= 0) {
+        return -1;
+    }
+    int starts[32], counts[32];
+    int level_count = get_levels(segment_count, starts, counts);
+
+    // 栈中每项为 (层, 层内序号), 从根节点开始, 只进入比当前最近距离更近的包围盒
+    int stack[INDEX_STACK_SIZE * 2];
+    int top = 0;
+    stack[top++] = level_count - 1;
+    stack[top++] = 0;
+    float best_sq = max_distance * max_distance;
+    int best = -1;
+    float best_t = 0;
+    while (top > 0) {
+        int node = stack[--top];
+        int level = stack[--top];
+        if (box_distance_sq(&nodes[(starts[level] + node) * 4], x, y) > best_sq) {
+            continue;
+        }
+        int first = node * LINE_INDEX_NODE_SIZE;
+        if (level == 0) {
+            int last = first + LINE_INDEX_NODE_SIZE;
+            last = last < segment_count ? last : segment_count;
+            for (int i = first; i < last; i++) {
+                float x1 = data[i * 2], y1 = data[i * 2 + 1];
+                float dx = data[i * 2 + 2] - x1, dy = data[i * 2 + 3] - y1;
+                float length_sq = dx * dx + dy * dy;
+                float t = 0;
+                if (length_sq > 0) {
+                    t = ((x - x1) * dx + (y - y1) * dy) / length_sq;
+                    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+                }
+                float ox = x1 + t * dx - x, oy = y1 + t * dy - y;
+                float distance_sq = ox * ox + oy * oy;
+                if (distance_sq <= best_sq && (best < 0 || distance_sq < best_sq)) {
+                    best_sq = distance_sq;
+                    best = i;
+                    best_t = t;
+                }
+            }
+        } else {
+            // 逆序压栈, 靠前的子节点先出栈
+            int last = first + LINE_INDEX_NODE_SIZE;
+            last = last < counts[level - 1] ? last : counts[level - 1];
+            for (int child = last - 1; child >= first; child--) {
+                stack[top++] = level - 1;
+                stack[top++] = child;
+            }
+        }
+    }
+    if (best >= 0) {
+        result[0] = sqrtf(best_sq);
+        result[1] = best_t;
+    }
+    return best;
+}
+
+int query_line_index_rect(float* data, int point_length, float* nodes, float min_x, float min_y, float max_x,
+                          float max_y, int* out, int capacity) {
+    int segment_count = point_length - 1;
+    if (segment_count <= 0) {
+        return 0;
+    }
+    int starts[32], counts[32];
+    int level_count = get_levels(segment_count, starts, counts);
+
+    int stack[INDEX_STACK_SIZE * 2];
+    int top = 0;
+    stack[top++] = level_count - 1;
+    stack[top++] = 0;
+    int found = 0;
+    while (top > 0) {
+        int node = stack[--top];
+        int level = stack[--top];
+        float *box = &nodes[(starts[level] + node) * 4];
+        if (box[0] > max_x || box[2] < min_x || box[1] > max_y || box[3] < min_y) {
+            continue;
+        }
+        int first = node * LINE_INDEX_NODE_SIZE;
+        if (level == 0) {
+            int last = first + LINE_INDEX_NODE_SIZE;
+            last = last < segment_count ? last : segment_count;
+            for (int i = first; i < last; i++) {
+                float x1 = data[i * 2], y1 = data[i * 2 + 1];
+                float x2 = data[i * 2 + 2], y2 = data[i * 2 + 3];
+                if ((x1 < x2 ? x1 : x2) > max_x || (x1 > x2 ? x1 : x2) < min_x ||
+                    (y1 < y2 ? y1 : y2) > max_y || (y1 > y2 ? y1 : y2) < min_y) {
+                    continue;
+                }
+                if (found < capacity) {
+                    out[found] = i;
+                }
+                found++;
+            }
+        } else {
+            int last = first + LINE_INDEX_NODE_SIZE;
+            last = last < counts[level - 1] ? last : counts[level - 1];
+            for (int child = last - 1; child >= first; child--) {
+                stack[top++] = level - 1;
+                stack[top++] = child;
+            }
+        }
+    }
+    return found;
+}
@@ -0,0 +1,141 @@
+#include <stddef.h>
+#include "line.h"
+
+#ifdef LINE_THREADS
+#include <pthread.h>
+#endif
+
+/*
+ * 多线程构建整条线: 线段按范围切分, 每个范围用 build_*_line_range 直接写到完整输出中的位置.
+ * 相邻范围会重复写上一段末端的两个顶点 (内容相同), 所以偶数和奇数范围分两轮执行, 同一轮内写入互不重叠.
+ */
+
+// 每个范围至少的线段数, 再小线程开销就比构建本身大了
+const static int MIN_RANGE_SEGMENTS = 4096;
+#define MAX_RANGES 256
+
+struct RangeJob {
+    float* data;
+    int point_length;
+    int first;
+    int last;
+    int join;
+    int cap;
+    int dash;
+    float lengthsofar;
+    int count;
+    struct Vertex* vertices;
+    void* indices;
+    int index_format;
+};
+
+static void *run_range(void *arg) {
+    struct RangeJob *job = (struct RangeJob *)arg;
+    if (job->dash) {
+        build_dash_line_range(job->data, job->point_length, job->first, job->last, job->join, job->cap,
+                              job->lengthsofar, job->count, job->vertices, job->indices, job->index_format);
+    } else {
+        build_solid_line_range(job->data, job->point_length, job->first, job->last, job->join, job->cap,
+                               job->count, job->vertices, job->indices, job->index_format);
+    }
+    return 0;
+}
+
+// 执行第 phase, phase + 2, phase + 4 ... 个范围, 当前线程也负责其中一个
+static void run_phase(struct RangeJob *jobs, int range_count, int phase) {
+#ifdef LINE_THREADS
+    pthread_t threads[MAX_RANGES / 2];
+    int started[MAX_RANGES / 2];
+    int thread_count = 0;
+    for (int k = phase + 2; k < range_count; k += 2) {
+        started[thread_count] = pthread_create(&threads[thread_count], 0, run_range, &jobs[k]) == 0;
+        if (!started[thread_count]) {
+            run_range(&jobs[k]);
+        }
+        thread_count++;
+    }
+    if (phase < range_count) {
+        run_range(&jobs[phase]);
+    }
+    for (int t = 0; t < thread_count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], 0);
+        }
+    }
+#else
+    for (int k = phase; k < range_count; k += 2) {
+        run_range(&jobs[k]);
+    }
+#endif
+}
+
+static float build_line_parallel(float* data, int point_length, int join, int cap, int dash, float lengthsofar,
+                                 int count, struct Vertex* vertices, void* indices, int index_format,
+                                 int thread_count) {
+    int segment_count = point_length - 1;
+    int range_count = thread_count * 2;
+    if (range_count > segment_count / MIN_RANGE_SEGMENTS) {
+        range_count = segment_count / MIN_RANGE_SEGMENTS;
+    }
+    if (range_count > MAX_RANGES) {
+        range_count = MAX_RANGES;
+    }
+    if (thread_count < 2 || range_count < 2) {
+        if (dash) {
+            return build_dash_line_range(data, point_length, 0, segment_count, join, cap, lengthsofar, count,
+                                         vertices, indices, index_format);
+        }
+        build_solid_line_range(data, point_length, 0, segment_count, join, cap, count, vertices, indices,
+                               index_format);
+        return lengthsofar;
+    }
+
+    struct RangeJob jobs[MAX_RANGES];
+    for (int k = 0; k < range_count; k++) {
+        struct RangeJob *job = &jobs[k];
+        job->data = data;
+        job->point_length = point_length;
+        job->first = (int)((long long)segment_count * k / range_count);
+        job->last = (int)((long long)segment_count * (k + 1) / range_count);
+        job->join = join;
+        job->cap = cap;
+        job->dash = dash;
+        // 续接的范围从上一段的末端顶点开始, 正好落在完整构建中的对应位置
+        int vertex_start = 0;
+        if (k > 0) {
+            vertex_start = (dash ? get_dash_range_vertex_count(point_length, 0, job->first, join, cap)
+                                 : get_solid_range_vertex_count(point_length, 0, job->first, join, cap)) - 2;
+        }
+        job->count = count + vertex_start;
+        job->vertices = vertices + vertex_start;
+        job->indices = (char *)indices + (size_t)vertex_start * 3 * (index_format == INDEX_UINT32 ? 4 : 2);
+        job->index_format = index_format;
+    }
+
+    // 各范围起点的 lengthsofar 按单线程构建的顺序累加, 浮点结果才能一致; 只有一次开方和加法, 远小于构建本身
+    float end_lengthsofar = lengthsofar;
+    if (dash) {
+        int k = 0;
+        for (int i = 0; i < segment_count; i++) {
+            if (k < range_count && i == jobs[k].first) {
+                jobs[k++].lengthsofar = end_lengthsofar;
+            }
+            end_lengthsofar += length(data[i * 2 + 2] - data[i * 2], data[i * 2 + 3] - data[i * 2 + 1]);
+        }
+    }
+
+    run_phase(jobs, range_count, 0);
+    run_phase(jobs, range_count, 1);
+    return end_lengthsofar;
+}
+
+void build_solid_line_parallel(float* data, int point_length, int join, int cap, int count, struct Vertex* vertices,
+                               void* indices, int index_format, int thread_count) {
+    build_line_parallel(data, point_length, join, cap, 0, 0, count, vertices, indices, index_format, thread_count);
+}
+
+float build_dash_line_parallel(float* data, int point_length, int join, int cap, float lengthsofar, int count,
+                               struct Vertex* vertices, void* indices, int index_format, int thread_count) {
+    return build_line_parallel(data, point_length, join, cap, 1, lengthsofar, count, vertices, indices,
+                               index_format, thread_count);
+}
@@ -0,0 +1,350 @@
+#include <math.h>
+#include "line.h"
+
+int line_simd_supported(void) {
+#if defined(LINE_SIMD) && defined(__SSE2__) && !defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    // 32 位 x86 编译时打开了 SSE2, 运行的机器不一定支持
+    return __builtin_cpu_supports("sse2");
+#elif defined(LINE_SIMD)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+#ifdef LINE_SIMD
+
+const static int CAP_ROUND = 0;
+
+const static int JOIN_MITER = 0;
+const static int JOIN_ROUND = 1;
+
+const static char IS_CAP = 0;
+const static char IS_LINE = 1;
+
+/*
+ * 4 路 float 向量. 只用到 IEEE 精确舍入的运算, 和标量路径逐位一致;
+ * normalize 在标量路径里经过 double 的 1 / sqrt, 这里同样用 2 路 double 计算.
+ */
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+
+typedef v128_t f32x4;
+typedef v128_t mask4;
+
+static inline f32x4 f4_load(const float *p) { return wasm_v128_load(p); }
+static inline void f4_store(float *p, f32x4 v) { wasm_v128_store(p, v); }
+static inline f32x4 f4_splat(float v) { return wasm_f32x4_splat(v); }
+static inline f32x4 f4_add(f32x4 a, f32x4 b) { return wasm_f32x4_add(a, b); }
+static inline f32x4 f4_sub(f32x4 a, f32x4 b) { return wasm_f32x4_sub(a, b); }
+static inline f32x4 f4_mul(f32x4 a, f32x4 b) { return wasm_f32x4_mul(a, b); }
+static inline f32x4 f4_div(f32x4 a, f32x4 b) { return wasm_f32x4_div(a, b); }
+static inline f32x4 f4_abs(f32x4 a) { return wasm_f32x4_abs(a); }
+static inline mask4 f4_lt(f32x4 a, f32x4 b) { return wasm_f32x4_lt(a, b); }
+static inline mask4 f4_gt(f32x4 a, f32x4 b) { return wasm_f32x4_gt(a, b); }
+static inline mask4 m4_or(mask4 a, mask4 b) { return wasm_v128_or(a, b); }
+static inline f32x4 f4_select(mask4 m, f32x4 a, f32x4 b) { return wasm_v128_bitselect(a, b, m); }
+static inline f32x4 f4_inv_sqrt(f32x4 x) {
+    v128_t one = wasm_f64x2_splat(1.0);
+    v128_t lo = wasm_f64x2_div(one, wasm_f64x2_sqrt(wasm_f64x2_promote_low_f32x4(x)));
+    v128_t high = wasm_i32x4_shuffle(x, x, 2, 3, 0, 1);
+    v128_t hi = wasm_f64x2_div(one, wasm_f64x2_sqrt(wasm_f64x2_promote_low_f32x4(high)));
+    return wasm_i32x4_shuffle(wasm_f32x4_demote_f64x2_zero(lo), wasm_f32x4_demote_f64x2_zero(hi), 0, 1, 4, 5);
+}
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+typedef __m128 f32x4;
+typedef __m128 mask4;
+
+static inline f32x4 f4_load(const float *p) { return _mm_loadu_ps(p); }
+static inline void f4_store(float *p, f32x4 v) { _mm_storeu_ps(p, v); }
+static inline f32x4 f4_splat(float v) { return _mm_set1_ps(v); }
+static inline f32x4 f4_add(f32x4 a, f32x4 b) { return _mm_add_ps(a, b); }
+static inline f32x4 f4_sub(f32x4 a, f32x4 b) { return _mm_sub_ps(a, b); }
+static inline f32x4 f4_mul(f32x4 a, f32x4 b) { return _mm_mul_ps(a, b); }
+static inline f32x4 f4_div(f32x4 a, f32x4 b) { return _mm_div_ps(a, b); }
+static inline f32x4 f4_abs(f32x4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline mask4 f4_lt(f32x4 a, f32x4 b) { return _mm_cmplt_ps(a, b); }
+static inline mask4 f4_gt(f32x4 a, f32x4 b) { return _mm_cmpgt_ps(a, b); }
+static inline mask4 m4_or(mask4 a, mask4 b) { return _mm_or_ps(a, b); }
+static inline f32x4 f4_select(mask4 m, f32x4 a, f32x4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+static inline f32x4 f4_inv_sqrt(f32x4 x) {
+    __m128d one = _mm_set1_pd(1.0);
+    __m128d lo = _mm_div_pd(one, _mm_sqrt_pd(_mm_cvtps_pd(x)));
+    __m128d hi = _mm_div_pd(one, _mm_sqrt_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x))));
+    return _mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi));
+}
+
+#else
+#include <arm_neon.h>
+
+typedef float32x4_t f32x4;
+typedef uint32x4_t mask4;
+
+static inline f32x4 f4_load(const float *p) { return vld1q_f32(p); }
+static inline void f4_store(float *p, f32x4 v) { vst1q_f32(p, v); }
+static inline f32x4 f4_splat(float v) { return vdupq_n_f32(v); }
+static inline f32x4 f4_add(f32x4 a, f32x4 b) { return vaddq_f32(a, b); }
+static inline f32x4 f4_sub(f32x4 a, f32x4 b) { return vsubq_f32(a, b); }
+static inline f32x4 f4_mul(f32x4 a, f32x4 b) { return vmulq_f32(a, b); }
+static inline f32x4 f4_div(f32x4 a, f32x4 b) { return vdivq_f32(a, b); }
+static inline f32x4 f4_abs(f32x4 a) { return vabsq_f32(a); }
+static inline mask4 f4_lt(f32x4 a, f32x4 b) { return vcltq_f32(a, b); }
+static inline mask4 f4_gt(f32x4 a, f32x4 b) { return vcgtq_f32(a, b); }
+static inline mask4 m4_or(mask4 a, mask4 b) { return vorrq_u32(a, b); }
+static inline f32x4 f4_select(mask4 m, f32x4 a, f32x4 b) { return vbslq_f32(m, a, b); }
+static inline f32x4 f4_inv_sqrt(f32x4 x) {
+    float64x2_t one = vdupq_n_f64(1.0);
+    float64x2_t lo = vdivq_f64(one, vsqrtq_f64(vcvt_f64_f32(vget_low_f32(x))));
+    float64x2_t hi = vdivq_f64(one, vsqrtq_f64(vcvt_high_f64_f32(x)));
+    return vcvt_high_f32_f64(vcvt_f32_f64(lo), hi);
+}
+
+#endif
+
+static inline f32x4 f4_neg(f32x4 a) {
+    return f4_mul(a, f4_splat(-1));
+}
+
+// 同 normalize: 长度为 0 的向量保持为 0
+static inline void f4_normalize(f32x4 *x, f32x4 *y) {
+    f32x4 zero = f4_splat(0);
+    f32x4 len = f4_add(f4_mul(*x, *x), f4_mul(*y, *y));
+    mask4 positive = f4_gt(len, zero);
+    f32x4 inv = f4_inv_sqrt(len);
+    *x = f4_select(positive, f4_mul(*x, inv), zero);
+    *y = f4_select(positive, f4_mul(*y, inv), zero);
+}
+
+// 同 calc_offset2/calc_offset 的斜接偏移, ntx 为 -ty
+static inline void f4_miter(f32x4 nx, f32x4 ny, f32x4 tx, f32x4 ntx, f32x4 *ox, f32x4 *oy) {
+    f32x4 cos = f4_add(f4_mul(nx, ntx), f4_mul(ny, tx));
+    // 锐角角度太小，miter过长，截断处理
+    cos = f4_select(f4_lt(f4_abs(cos), f4_splat(0.1f)), f4_splat(1), cos);
+    f32x4 miter = f4_div(f4_splat(1), cos);
+    *ox = f4_mul(ntx, miter);
+    *oy = f4_mul(tx, miter);
+}
+
+// 同 calc_offset2 的非 cap 部分, use_normal 的分支换成逐通道选择; start 表示顶点 0/1
+static inline void f4_join_offset(f32x4 nx, f32x4 ny, f32x4 tx, f32x4 ty, f32x4 ntx, int join, int start,
+                                  float *out_x, float *out_y) {
+    f32x4 zero = f4_splat(0);
+    f32x4 cos = f4_add(f4_mul(tx, nx), f4_mul(ty, ny));
+    mask4 negative = f4_lt(cos, zero);
+    mask4 positive = f4_gt(cos, zero);
+    mask4 use_normal = join == JOIN_MITER ? (start ? negative : positive) : m4_or(negative, positive);
+    f32x4 mx, my;
+    f4_miter(nx, ny, tx, ntx, &mx, &my);
+    f4_store(out_x, f4_select(use_normal, nx, mx));
+    f4_store(out_y, f4_select(use_normal, ny, my));
+}
+
+// 每块处理的线段数, 必须是 4 的倍数
+#define BLOCK_SEGMENTS 128
+#define BLOCK_SIZE (BLOCK_SEGMENTS + 12)
+
+/*
+ * 一块线段 [s0, s1) 的结构数组. 下标 q 对应点 s0 + q 处的拐角:
+ * out 为线段 s0 + q 的顶点 0/1, in 为线段 s0 + q - 1 的顶点 2/3. 圆角的圆弧由 generate_round_join 逐个生成.
+ */
+struct JoinBlock {
+    float px[BLOCK_SIZE];
+    float py[BLOCK_SIZE];
+    // 线段 s0 - 1 + m 的单位方向
+    float dx[BLOCK_SIZE];
+    float dy[BLOCK_SIZE];
+    float out_x[2][BLOCK_SIZE];
+    float out_y[2][BLOCK_SIZE];
+    float in_x[2][BLOCK_SIZE];
+    float in_y[2][BLOCK_SIZE];
+};
+
+static void compute_block(const float *data, int point_length, int s0, int s1, int join, struct JoinBlock *b) {
+    int join_count = (s1 - s0 + 1 + 3) & ~3;
+    int direction_count = join_count + 4;
+
+    // 点 s0 - 1 .. 超出线段两端的用端点补齐, 这些方向不会被用到
+    for (int k = 0; k <= direction_count; k++) {
+        int point = s0 - 1 + k;
+        point = point < 0 ? 0 : point > point_length - 1 ? point_length - 1 : point;
+        b->px[k] = data[point * 2];
+        b->py[k] = data[point * 2 + 1];
+    }
+
+    for (int m = 0; m < direction_count; m += 4) {
+        f32x4 x = f4_sub(f4_load(b->px + m + 1), f4_load(b->px + m));
+        f32x4 y = f4_sub(f4_load(b->py + m + 1), f4_load(b->py + m));
+        f4_normalize(&x, &y);
+        f4_store(b->dx + m, x);
+        f4_store(b->dy + m, y);
+    }
+
+    for (int q = 0; q < join_count; q += 4) {
+        f32x4 in_x = f4_load(b->dx + q);
+        f32x4 in_y = f4_load(b->dy + q);
+        f32x4 out_x = f4_load(b->dx + q + 1);
+        f32x4 out_y = f4_load(b->dy + q + 1);
+        f32x4 tx = f4_add(in_x, out_x);
+        f32x4 ty = f4_add(in_y, out_y);
+        f4_normalize(&tx, &ty);
+        f32x4 ntx = f4_neg(ty);
+
+        // 偶数顶点的法线为 (-y, x), 奇数顶点为 (y, -x)
+        f4_join_offset(f4_neg(out_y), out_x, tx, ty, ntx, join, 1, b->out_x[0] + q, b->out_y[0] + q);
+        f4_join_offset(out_y, f4_neg(out_x), tx, ty, ntx, join, 1, b->out_x[1] + q, b->out_y[1] + q);
+        f4_join_offset(f4_neg(in_y), in_x, tx, ty, ntx, join, 0, b->in_x[0] + q, b->in_y[0] + q);
+        f4_join_offset(in_y, f4_neg(in_x), tx, ty, ntx, join, 0, b->in_x[1] + q, b->in_y[1] + q);
+    }
+}
+
+void build_solid_line_range_simd(float* data, int point_length, int first, int last, int join, int cap, int count,
+                                 struct Vertex* vertices, void* indices, int index_format) {
+    float vector[2] = {0, 0};
+    float other_vector[2] = {0, 0};
+    int inner_count = -1;
+    short is_counter_clockwise = 1;
+    int index = 0;
+    int i_index = 0;
+    struct JoinBlock block;
+
+    int s0 = first;
+    int s1 = last - first > BLOCK_SEGMENTS ? first + BLOCK_SEGMENTS : last;
+    compute_block(data, point_length, s0, s1, join, &block);
+
+    if (first == 0) {
+        vector[0] = block.dx[1];
+        vector[1] = block.dy[1];
+        if (cap == CAP_ROUND) {
+            generate_round_cap(data[0], data[1], vector, 0, 0, &count, &inner_count, is_counter_clockwise, vertices,
+                               &index, indices, &i_index, index_format);
+        } else {
+            count++;
+            inner_count++;
+            generate_vertex(data[0], data[1], vector, cap, join, 4, other_vector, IS_CAP, vertices, index++);
+
+            count++;
+            inner_count++;
+            generate_vertex(data[0], data[1], vector, cap, join, 5, other_vector, IS_CAP, vertices, index++);
+        }
+    } else {
+        // 从中间续接, 同 build_solid_line_range_scalar
+        int i = first - 1;
+        inner_count = 1;
+
+        float xi_next = data[i * 2 + 2];
+        float yi_next = data[i * 2 + 3];
+        count++;
+        inner_count++;
+        store_vertex(xi_next, yi_next, block.in_x[0][0], block.in_y[0][0], 1, IS_LINE, 0, vertices, index++);
+
+        count++;
+        inner_count++;
+        store_vertex(xi_next, yi_next, block.in_x[1][0], block.in_y[1][0], -1, IS_LINE, 0, vertices, index++);
+
+        if (join == JOIN_ROUND) {
+            float vector_in[2] = {block.dx[0], block.dy[0]};
+            float vector_out[2] = {block.dx[1], block.dy[1]};
+            generate_round_join(xi_next, yi_next, vector_in, vector_out, 0, 0, &count, vertices, &index, indices,
+                                &i_index, index_format);
+        }
+    }
+
+    while (s0 < last) {
+        for (int i = s0; i < s1; i++) {
+            int q = i - s0;
+            float xi = data[i * 2];
+            float yi = data[i * 2 + 1];
+            float xi_next = data[i * 2 + 2];
+            float yi_next = data[i * 2 + 3];
+            vector[0] = block.dx[q + 1];
+            vector[1] = block.dy[q + 1];
+
+            // 圆角已经写入了顶点 0/1 的三角形, 同 build_solid_line_range_scalar
+            int after_round_join = join == JOIN_ROUND && i != 0;
+            if (i == 0) {
+                generate_vertex(xi, yi, vector, cap, join, 0, other_vector, IS_CAP, vertices, index++);
+            } else {
+                store_vertex(xi, yi, block.out_x[0][q], block.out_y[0][q], 1, IS_LINE, 0, vertices, index++);
+            }
+            if (after_round_join) {
+                count++;
+            } else {
+                store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+                i_index += 3;
+            }
+
+            if (i == 0) {
+                generate_vertex(xi, yi, vector, cap, join, 1, other_vector, IS_CAP, vertices, index++);
+            } else {
+                store_vertex(xi, yi, block.out_x[1][q], block.out_y[1][q], -1, IS_LINE, 0, vertices, index++);
+            }
+            if (after_round_join) {
+                count++;
+                inner_count = 3;
+            } else {
+                store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+                i_index += 3;
+            }
+
+            if (i == point_length - 2) {
+                generate_vertex(xi_next, yi_next, vector, cap, join, 2, other_vector, IS_CAP, vertices, index++);
+            } else {
+                store_vertex(xi_next, yi_next, block.in_x[0][q + 1], block.in_y[0][q + 1], 1, IS_LINE, 0, vertices,
+                             index++);
+            }
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+            i_index += 3;
+
+            if (i == point_length - 2) {
+                generate_vertex(xi_next, yi_next, vector, cap, join, 3, other_vector, IS_CAP, vertices, index++);
+            } else {
+                store_vertex(xi_next, yi_next, block.in_x[1][q + 1], block.in_y[1][q + 1], -1, IS_LINE, 0, vertices,
+                             index++);
+            }
+            store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+            i_index += 3;
+
+            // 范围内最后一段的拐角留给下一个范围生成
+            if (join == JOIN_ROUND && i != last - 1) {
+                float vector_next[2] = {block.dx[q + 2], block.dy[q + 2]};
+                generate_round_join(xi_next, yi_next, vector, vector_next, 0, 0, &count, vertices, &index, indices,
+                                    &i_index, index_format);
+            }
+        }
+
+        s0 = s1;
+        if (s0 < last) {
+            s1 = last - s0 > BLOCK_SEGMENTS ? s0 + BLOCK_SEGMENTS : last;
+            compute_block(data, point_length, s0, s1, join, &block);
+        }
+    }
+
+    if (last != point_length - 1) {
+        return;
+    }
+
+    vector[0] = data[point_length * 2 - 2] - data[point_length * 2 - 4];
+    vector[1] = data[point_length * 2 - 1] - data[point_length * 2 - 3];
+    normalize(vector);
+
+    if (cap == CAP_ROUND) {
+        generate_round_cap(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, 1, 0, &count, &inner_count,
+                           is_counter_clockwise, vertices, &index, indices, &i_index, index_format);
+        return;
+    }
+
+    generate_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, cap, join, 6,
+                other_vector, IS_CAP, vertices, index++);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+    i_index += 3;
+
+    generate_vertex(data[point_length * 2 - 2], data[point_length * 2 - 1], vector, cap, join, 7,
+                other_vector, IS_CAP, vertices, index++);
+    store_index(++count, ++inner_count, is_counter_clockwise, indices, i_index, index_format);
+    i_index += 3;
+}
+
+#endif
@@ -0,0 +1,57 @@
+#include <float.h>
+#include "line.h"
+
+// 点到线段 (x1, y1) - (x2, y2) 的距离, 线段退化为点时 (闭合线的首尾) 取到端点的距离
+static float segment_distance(float x, float y, float x1, float y1, float x2, float y2) {
+    float dx = x2 - x1;
+    float dy = y2 - y1;
+    float length_sq = dx * dx + dy * dy;
+    float t = 0;
+    if (length_sq > 0) {
+        t = ((x - x1) * dx + (y - y1) * dy) / length_sq;
+        t = t < 0 ? 0 : (t > 1 ? 1 : t);
+    }
+    return length(x - x1 - t * dx, y - y1 - t * dy);
+}
+
+void compute_line_importance(float* data, int point_length, float* importance, int* stack) {
+    if (point_length <= 0) {
+        return;
+    }
+    importance[0] = FLT_MAX;
+    importance[point_length - 1] = FLT_MAX;
+    if (point_length < 3) {
+        return;
+    }
+
+    // 用栈代替递归, 每项是一个区间 [first, last], 区间内的点都不超过父节点的重要度
+    int top = 0;
+    stack[top++] = 0;
+    stack[top++] = point_length - 1;
+    while (top > 0) {
+        int last = stack[--top];
+        int first = stack[--top];
+        float x1 = data[first * 2], y1 = data[first * 2 + 1];
+        float x2 = data[last * 2], y2 = data[last * 2 + 1];
+        int split = first + 1;
+        float max_distance = -1;
+        for (int i = first + 1; i < last; i++) {
+            float distance = segment_distance(data[i * 2], data[i * 2 + 1], x1, y1, x2, y2);
+            if (distance > max_distance) {
+                max_distance = distance;
+                split = i;
+            }
+        }
+        // 截断到父节点的重要度, 这样任何阈值保留下来的点集都是嵌套的
+        float parent = importance[first] < importance[last] ? importance[first] : importance[last];
+        importance[split] = max_distance < parent ? max_distance : parent;
+        if (split - first > 1) {
+            stack[top++] = first;
+            stack[top++] = split;
+        }
+        if (last - split > 1) {
+            stack[top++] = split;
+            stack[top++] = last;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#include "line.h"
+
+static unsigned int read_index(const void* indices, int i, int index_format) {
+    return index_format == INDEX_UINT32 ? ((const unsigned int*)indices)[i] : ((const unsigned short*)indices)[i];
+}
+
+static void write_index(void* out, int i, unsigned int value, int index_format) {
+    if (index_format == INDEX_UINT32) {
+        ((unsigned int*)out)[i] = value;
+    } else {
+        ((unsigned short*)out)[i] = (unsigned short)value;
+    }
+}
+
+static int has_vertex(const unsigned int* triangle, unsigned int vertex) {
+    return triangle[0] == vertex || triangle[1] == vertex || triangle[2] == vertex;
+}
+
+// 把三角形 t 中除 first 以外的两个顶点排好, 与下一个三角形共有的顶点放在最后, 让下一个三角形能接着条带
+static void order_rest(const unsigned int* t, unsigned int first, const unsigned int* next, unsigned int* rest) {
+    int n = 0;
+    for (int i = 0; i < 3; i++) {
+        if (t[i] != first) {
+            rest[n++] = t[i];
+        }
+    }
+    if (next && has_vertex(next, rest[0]) && !has_vertex(next, rest[1])) {
+        unsigned int swap = rest[0];
+        rest[0] = rest[1];
+        rest[1] = swap;
+    }
+}
+
+int get_strip_index_capacity(int index_count) {
+    // 最坏情况每个三角形都和条带末尾不共顶点: 2 个衔接索引加 3 个顶点
+    return index_count / 3 * 5;
+}
+
+int convert_to_strip(void* indices, int index_count, int index_format, void* out) {
+    double start = line_profile_start();
+    int length = 0;
+    // 条带最后两个索引
+    unsigned int p = 0, q = 0;
+    unsigned int t[3], next[3], rest[2];
+    int pending = 0;
+    int i = 0;
+    // t 是待写入的三角形, next 是跳过退化三角形后的下一个, 用来决定 t 的顶点顺序
+    for (;;) {
+        int found = 0;
+        while (i + 2 < index_count) {
+            unsigned int a = read_index(indices, i, index_format);
+            unsigned int b = read_index(indices, i + 1, index_format);
+            unsigned int c = read_index(indices, i + 2, index_format);
+            i += 3;
+            if (a != b && b != c && a != c) {
+                next[0] = a;
+                next[1] = b;
+                next[2] = c;
+                found = 1;
+                break;
+            }
+        }
+        if (pending) {
+            const unsigned int* lookahead = found ? next : 0;
+            if (length == 0) {
+                // 第一个三角形: 把和下一个三角形共有的边放在最后
+                unsigned int first = t[0];
+                if (lookahead && has_vertex(lookahead, t[0])) {
+                    first = !has_vertex(lookahead, t[1]) ? t[1] : t[2];
+                }
+                order_rest(t, first, lookahead, rest);
+                write_index(out, length++, first, index_format);
+                write_index(out, length++, rest[0], index_format);
+                write_index(out, length++, rest[1], index_format);
+            } else if (has_vertex(t, p) && has_vertex(t, q)) {
+                // 共享条带末尾的边: 只加第三个顶点
+                unsigned int third = t[0] != p && t[0] != q ? t[0] : t[1] != p && t[1] != q ? t[1] : t[2];
+                write_index(out, length++, third, index_format);
+                rest[0] = q;
+                rest[1] = third;
+            } else if (has_vertex(t, q)) {
+                // 只共享末尾的顶点 q: 重复 q 得到退化的 (p, q, q), (q, q, r), 然后是 (q, r, s)
+                order_rest(t, q, lookahead, rest);
+                write_index(out, length++, q, index_format);
+                write_index(out, length++, rest[0], index_format);
+                write_index(out, length++, rest[1], index_format);
+            } else {
+                // 不相连: 重复 q 和新三角形的第一个顶点, 中间都是退化三角形. 批量构建的多条线也这样接成一条
+                unsigned int first = t[0];
+                if (lookahead && has_vertex(lookahead, t[0])) {
+                    first = !has_vertex(lookahead, t[1]) ? t[1] : t[2];
+                }
+                order_rest(t, first, lookahead, rest);
+                write_index(out, length++, q, index_format);
+                write_index(out, length++, first, index_format);
+                write_index(out, length++, first, index_format);
+                write_index(out, length++, rest[0], index_format);
+                write_index(out, length++, rest[1], index_format);
+            }
+            p = rest[0];
+            q = rest[1];
+        }
+        if (!found) {
+            break;
+        }
+        t[0] = next[0];
+        t[1] = next[1];
+        t[2] = next[2];
+        pending = 1;
+    }
+    line_profile_end(start, 0, 0, 0, 0);
+    return length;
+}
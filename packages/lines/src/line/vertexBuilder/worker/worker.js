@@ -0,0 +1,132 @@
+export default `let wasm;
+let ready;
+
+onmessage = function(e) {
+  const message = e.data;
+
+  switch (message.type) {
+    case "init":
+      // The module is compiled once on the main thread and instantiated in every worker.
+      ready = WebAssembly.instantiate(message.module, {
+        env: {
+          consoleLog: function() {},
+          segfault: function(a, b, c) {
+            console.log(a, b, c);
+          },
+          alignfault: function(a, b, c) {
+            console.log(a, b, c);
+          },
+          emscripten_notify_memory_growth: function() {},
+          // Only read by the profiling counters of line.c, which the workers leave off.
+          emscripten_get_now: function() {
+            return performance.now();
+          }
+        }
+      }).then(function(instance) {
+        wasm = instance.exports;
+      });
+      break;
+
+    case "build":
+      ready.then(
+        function() {
+          try {
+            const result = buildLine(message.job);
+            self.postMessage({ type: "build", id: message.id, chunks: result.chunks }, result.transfer);
+          } catch (error) {
+            console.error(error);
+            self.postMessage({ type: "error", id: message.id, error: error.message });
+          }
+        },
+        function(error) {
+          // The module failed to instantiate, every job on this worker fails with it.
+          self.postMessage({ type: "error", id: message.id, error: "LineWorker: " + (error && error.message) });
+        }
+      );
+      break;
+  }
+};
+
+function malloc(byteLength) {
+  const pointer = wasm.malloc(Math.max(byteLength, 4));
+  if (!pointer) {
+    throw new Error("LineWorker: out of wasm memory reserving " + byteLength + " bytes.");
+  }
+  return pointer;
+}
+
+// Tessellate the line chunk by chunk like Line does on the main thread, copying every chunk out of wasm memory
+// into buffers that are transferred back.
+function buildLine(job) {
+  const points = job.points;
+  const pointCount = points.length / 2;
+  const segmentCount = pointCount - 1;
+  const chunkSegmentCount = Math.max(job.chunkSegmentCount, 1);
+  const indexSize = job.indexFormat === 2 ? 4 : 2;
+  const chunks = [];
+  const transfer = [];
+  const pointsStart = malloc(points.byteLength);
+  // Bounds, then the pack parameters of compact vertices.
+  const outStart = malloc(48);
+  new Float32Array(wasm.memory.buffer, pointsStart, points.length).set(points);
+  wasm.set_round_segments(job.roundSegments);
+
+  let lengthsofar = 0;
+  for (let first = 0; first < segmentCount; first += chunkSegmentCount) {
+    const last = Math.min(first + chunkSegmentCount, segmentCount);
+    const vertexCount = job.dash
+      ? wasm.get_dash_range_vertex_count(pointCount, first, last, job.join, job.cap)
+      : wasm.get_solid_range_vertex_count(pointCount, first, last, job.join, job.cap);
+    const indexCount = vertexCount * 3 - 6;
+    const verticesStart = malloc(vertexCount * 24);
+    const indicesStart = malloc(indexCount * indexSize);
+    let endLengthsofar = lengthsofar;
+    if (job.dash) {
+      endLengthsofar = wasm.build_dash_line_range(pointsStart, pointCount, first, last, job.join, job.cap,
+        lengthsofar, -1, verticesStart, indicesStart, job.indexFormat);
+    } else {
+      wasm.build_solid_line_range(pointsStart, pointCount, first, last, job.join, job.cap, -1, verticesStart,
+        indicesStart, job.indexFormat);
+    }
+    let stripStart = 0;
+    let stripCount = indexCount;
+    if (job.strip) {
+      stripStart = malloc(wasm.get_strip_index_capacity(indexCount) * indexSize);
+      stripCount = wasm.convert_to_strip(indicesStart, indexCount, job.indexFormat, stripStart);
+    }
+    wasm.get_vertex_bounds(verticesStart, vertexCount, outStart);
+    let pack = null;
+    let vertices;
+    if (job.compact) {
+      wasm.pack_vertices(verticesStart, vertexCount, outStart + 24);
+      pack = new Float32Array(wasm.memory.buffer, outStart + 24, 6).slice();
+      vertices = new Uint8Array(wasm.memory.buffer, verticesStart, vertexCount * 12).slice();
+    } else {
+      vertices = new Float32Array(wasm.memory.buffer, verticesStart, vertexCount * 6).slice();
+    }
+    const heap = wasm.memory.buffer;
+    const bounds = new Float32Array(heap, outStart, 6).slice();
+    const outIndicesStart = job.strip ? stripStart : indicesStart;
+    const indices = (indexSize === 4
+      ? new Uint32Array(heap, outIndicesStart, stripCount)
+      : new Uint16Array(heap, outIndicesStart, stripCount)
+    ).slice();
+    wasm.free(verticesStart);
+    wasm.free(indicesStart);
+    if (stripStart) {
+      wasm.free(stripStart);
+    }
+
+    chunks.push({ vertices: vertices, indices: indices, bounds: bounds, pack: pack, lengthsofar: endLengthsofar });
+    transfer.push(vertices.buffer, indices.buffer, bounds.buffer);
+    if (pack) {
+      transfer.push(pack.buffer);
+    }
+    lengthsofar = endLengthsofar;
+  }
+
+  wasm.free(pointsStart);
+  wasm.free(outStart);
+  return { chunks: chunks, transfer: transfer };
+}
+`;
@@ -1,4 +1,5 @@
 import DrawCallHook from "./hooks/DrawCallHook";
+import { LineHook } from "./hooks/LineHook";
 import { RequestHook } from "./hooks/RequestHook";
 import ShaderHook from "./hooks/ShaderHook";
 import TextureHook from "./hooks/TextureHook";
@@ -18,6 +19,7 @@ export class Core {
   private textureHook: TextureHook;
   private shaderHook: ShaderHook;
   private requestHook: RequestHook;
+  private lineHook: LineHook;
   private samplingFrames: number = 60;
   private samplingIndex: number = 0;
   private updateCounter: number = 0;
@@ -33,6 +35,7 @@ export class Core {
     this.textureHook = new TextureHook(gl);
     this.shaderHook = new ShaderHook(gl);
     this.requestHook = new RequestHook();
+    this.lineHook = new LineHook();
   }
 
   /**
@@ -40,6 +43,7 @@ export class Core {
    */
   public reset(): void {
     this.drawCallHook && this.drawCallHook.reset();
+    this.lineHook && this.lineHook.reset();
   }
 
   /**
@@ -68,6 +72,7 @@ export class Core {
     }
 
     this.samplingIndex = 0;
+    this.lineHook.update();
 
     let data: PerformanceData = {
       fps: Math.round((this.updateCounter * 1000) / (now - this.updateTime)),
@@ -79,6 +84,11 @@ export class Core {
       textures: this.textureHook.textures,
       size: this.requestHook.size,
       shaders: this.shaderHook.shaders,
+      lineCalls: this.lineHook.calls,
+      lineVertices: this.lineHook.vertices,
+      lineTime: this.lineHook.time.toFixed(2),
+      lineHeap: (this.lineHook.heapBytes / 1048576).toFixed(1),
+      lineReallocations: this.lineHook.reallocations,
       webglContext:
         window.hasOwnProperty("WebGL2RenderingContext") && this.gl instanceof WebGL2RenderingContext ? "2.0" : "1.0"
     };
@@ -102,5 +112,10 @@ interface PerformanceData {
   textures: number;
   shaders: number;
   size: string;
+  lineCalls: number;
+  lineVertices: number;
+  lineTime: string;
+  lineHeap: string;
+  lineReallocations: number;
   webglContext: string;
 }
@@ -1,4 +1,5 @@
 import { Core } from "./Core";
+import { isLinesHooked } from "./hooks/LineHook";
 
 let tpl = `
   <dl>
@@ -20,6 +21,20 @@ let tpl = `
     <dd></dd>
   </dl>
 `;
+let lineTpl = `
+  <dl>
+    <dt>Line Builds</dt>
+    <dd>0</dd>
+    <dt>Line Vertices</dt>
+    <dd>0</dd>
+    <dt>Line Time <span class="unit">(ms)</span></dt>
+    <dd>0</dd>
+    <dt>Line Heap <span class="unit">(MB)</span></dt>
+    <dd>0</dd>
+    <dt>Line Reallocations</dt>
+    <dd>0</dd>
+  </dl>
+`;
 let css = `
   .gl-perf {
     pointer-events: none;
@@ -65,6 +80,9 @@ export default class Monitor {
     this.core = new Core(gl);
     this.items = [];
     this.items = ["fps", "memory", "drawCall", "triangles", "textures", "shaders", "size", "webglContext"];
+    if (isLinesHooked()) {
+      this.items.push("lineCalls", "lineVertices", "lineTime", "lineHeap", "lineReallocations");
+    }
     this.createContainer();
     this.update = this.update.bind(this);
   }
@@ -72,7 +90,7 @@ export default class Monitor {
   private createContainer(): void {
     let container = document.createElement("div");
     container.classList.add("gl-perf");
-    container.innerHTML = tpl;
+    container.innerHTML = isLinesHooked() ? tpl + lineTpl : tpl;
 
     container.appendChild(this.createStyle());
 
@@ -1,4 +1,5 @@
 import { Script, Camera } from "@galacean/engine";
+import { hookLines, ILineProfiler } from "./hooks/LineHook";
 import { hookRequest } from "./hooks/RequestHook";
 import Monitor from "./Monitor";
 
@@ -13,6 +14,13 @@ export class Stats extends Script {
     hookRequest();
   }
 
+  /**
+   * Show line tessellation counters, pass `LineProfiler.instance` of `@galacean/engine-toolkit-lines`.
+   */
+  static hookLines(profiler: ILineProfiler) {
+    hookLines(profiler);
+  }
+
   override set enabled(value: boolean) {
     value ? this._setupMonitor() : this.monitor.destroy();
   }
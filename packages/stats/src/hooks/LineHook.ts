@@ -0,0 +1,105 @@
+import { log } from "../log";
+
+/**
+ * The frame counters of `LineProfiler` in `@galacean/engine-toolkit-lines`, read without depending on the package.
+ */
+export interface ILineProfilerFrame {
+  frame: number;
+  calls: number;
+  points: number;
+  vertices: number;
+  indices: number;
+  wasmTime: number;
+  copyTime: number;
+  uploadTime: number;
+  heapBytes: number;
+  reallocations: number;
+}
+
+/**
+ * The recording side of `LineProfiler`.
+ */
+export interface ILineProfiler {
+  enabled: boolean;
+  readonly recordedFrameCount: number;
+  getFrame(ago: number, out?: ILineProfilerFrame): ILineProfilerFrame | null;
+}
+
+let lineProfiler: ILineProfiler = null;
+
+export function hookLines(profiler: ILineProfiler) {
+  profiler.enabled = true;
+  lineProfiler = profiler;
+
+  log(`Lines are hooked.`);
+}
+
+export function isLinesHooked(): boolean {
+  return !!lineProfiler;
+}
+
+/**
+ * @class LineHook
+ * Sums the frames `LineProfiler` recorded since the last reset.
+ */
+export class LineHook {
+  public calls: number = 0;
+  public points: number = 0;
+  public vertices: number = 0;
+  public indices: number = 0;
+  public wasmTime: number = 0;
+  public copyTime: number = 0;
+  public uploadTime: number = 0;
+  public heapBytes: number = 0;
+  public reallocations: number = 0;
+  private lastFrame: number = -1;
+  private readonly frame = {} as ILineProfilerFrame;
+
+  /**
+   * The milliseconds spent on lines, in wasm, copying and uploading.
+   */
+  get time(): number {
+    return this.wasmTime + this.copyTime + this.uploadTime;
+  }
+
+  /**
+   * Add the frames recorded since the last update.
+   */
+  public update(): void {
+    const profiler = lineProfiler;
+    if (!profiler) {
+      return;
+    }
+    const { frame } = this;
+    let ago = 0;
+    // Walk back to the first new frame, the ring buffer may have wrapped since.
+    while (ago < profiler.recordedFrameCount && profiler.getFrame(ago, frame).frame > this.lastFrame) {
+      ago++;
+    }
+    for (ago--; ago >= 0; ago--) {
+      profiler.getFrame(ago, frame);
+      this.calls += frame.calls;
+      this.points += frame.points;
+      this.vertices += frame.vertices;
+      this.indices += frame.indices;
+      this.wasmTime += frame.wasmTime;
+      this.copyTime += frame.copyTime;
+      this.uploadTime += frame.uploadTime;
+      this.heapBytes = frame.heapBytes;
+      this.reallocations += frame.reallocations;
+      this.lastFrame = frame.frame;
+    }
+  }
+
+  public reset(): void {
+    this.update();
+    this.calls = 0;
+    this.points = 0;
+    this.vertices = 0;
+    this.indices = 0;
+    this.wasmTime = 0;
+    this.copyTime = 0;
+    this.uploadTime = 0;
+    this.reallocations = 0;
+  }
+}
@@ -1,2 +1,3 @@
 export { Stats } from "./Stats";
 export { Core } from "./Core";
+export type { ILineProfiler } from "./hooks/LineHook";
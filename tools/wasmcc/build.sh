@@ -0,0 +1,60 @@
+#!/bin/bash
+# Builds a standalone wasm module from C sources without emscripten or a clang binary, for the wasm kernels of the
+# toolkit. Each source is preprocessed with gcc against include/, lowered to LLVM IR by ccw.py (python3 with the
+# libclang bindings), assembled by llvm-as (LLVM 14 or later) and linked with runtime.c by an LLD wasm linker
+# (LLVM 15 or later) with LTO. Set WASM_LD to the linker, wasm-ld and rust-lld are found otherwise.
+#
+# usage: build.sh out.wasm "export1 export2 ..." [-msimd128] [-Dname[=value]] [-Idir] file.c...
+#
+# The module exports memory and the listed functions, imports env.emscripten_notify_memory_growth like an
+# emscripten ALLOW_MEMORY_GROWTH build, and leaves other undefined functions as env imports.
+set -e
+HERE=$(cd "$(dirname "$0")" && pwd)
+OUT=$1
+shift
+EXPORTS=$1
+shift
+SIMD=0
+DEFS=()
+FILES=()
+for a in "$@"; do
+  case $a in
+    -msimd128) SIMD=1 ;;
+    -D* | -I*) DEFS+=("$a") ;;
+    *) FILES+=("$a") ;;
+  esac
+done
+
+LD=${WASM_LD:-$(command -v wasm-ld || ls ~/.rustup/toolchains/*/lib/rustlib/*/bin/rust-lld 2>/dev/null | head -1)}
+if [ -z "$LD" ]; then
+  echo "build.sh: no wasm linker found, set WASM_LD" >&2
+  exit 1
+fi
+case $(basename "$LD") in
+  rust-lld*) LD_FLAVOR=(-flavor wasm) ;;
+  *) LD_FLAVOR=() ;;
+esac
+
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+PPDEFS=(-D__wasm__ -D__wasm32__ -D__clang__=1 -D__GNUC__=4 "${DEFS[@]}")
+CCWFLAGS=()
+if [ $SIMD = 1 ]; then
+  PPDEFS+=(-D__wasm_simd128__)
+  CCWFLAGS+=(-mattr=+simd128)
+fi
+OBJS=()
+for f in "${FILES[@]}" "$HERE/runtime.c"; do
+  b=$(basename "$f" .c)
+  gcc -E -P -undef -nostdinc -I"$HERE/include" -I"$(dirname "$f")" "${PPDEFS[@]}" "$f" -o "$TMP/$b.i"
+  python3 "$HERE/ccw.py" "$TMP/$b.i" "${CCWFLAGS[@]}" -o "$TMP/$b.ll"
+  # LLVM 14's optimizer is not safe with opaque pointers, only assemble here, the linker's LTO optimizes.
+  llvm-as -opaque-pointers "$TMP/$b.ll" -o "$TMP/$b.bc"
+  OBJS+=("$TMP/$b.bc")
+done
+EXP=()
+for e in $EXPORTS; do
+  EXP+=("--export=$e")
+done
+"$LD" "${LD_FLAVOR[@]}" --no-entry --allow-undefined -O2 --lto-O2 -z stack-size=65536 --strip-all "${EXP[@]}" \
+  "${OBJS[@]}" -o "$OUT"
@@ -0,0 +1,1377 @@
+#!/usr/bin/env python3
+"""
+Minimal C to LLVM IR frontend on top of libclang, for building the toolkit's wasm kernels where no clang binary
+is available. libclang parses and type-checks the (already preprocessed) source for wasm32, this walks the AST and
+emits unoptimized IR with opaque pointers, every local in an alloca; the linker's LTO optimizes and generates
+code.
+
+Supports the subset of C99 the kernels use: scalar, pointer, struct, array and wasm_simd128 vector types, all
+statements but goto, the usual expressions, file and function static variables with constant initializers and
+function pointers.
+"""
+import ctypes
+import struct
+import sys
+
+import clang.cindex as ci
+
+K = ci.CursorKind
+T = ci.TypeKind
+lib = ci.conf.lib
+
+lib.clang_getCursorBinaryOperatorKind.argtypes = [ci.Cursor]
+lib.clang_getCursorBinaryOperatorKind.restype = ctypes.c_int
+lib.clang_getBinaryOperatorKindSpelling.argtypes = [ctypes.c_int]
+lib.clang_getBinaryOperatorKindSpelling.restype = ci._CXString
+lib.clang_getBinaryOperatorKindSpelling.errcheck = ci._CXString.from_result
+lib.clang_getCursorUnaryOperatorKind.argtypes = [ci.Cursor]
+lib.clang_getCursorUnaryOperatorKind.restype = ctypes.c_int
+lib.clang_Cursor_Evaluate.argtypes = [ci.Cursor]
+lib.clang_Cursor_Evaluate.restype = ctypes.c_void_p
+lib.clang_EvalResult_getKind.argtypes = [ctypes.c_void_p]
+lib.clang_EvalResult_getKind.restype = ctypes.c_int
+lib.clang_EvalResult_getAsLongLong.argtypes = [ctypes.c_void_p]
+lib.clang_EvalResult_getAsLongLong.restype = ctypes.c_longlong
+lib.clang_EvalResult_getAsDouble.argtypes = [ctypes.c_void_p]
+lib.clang_EvalResult_getAsDouble.restype = ctypes.c_double
+lib.clang_EvalResult_dispose.argtypes = [ctypes.c_void_p]
+lib.clang_Cursor_isFunctionInlined.argtypes = [ci.Cursor]
+lib.clang_Cursor_isFunctionInlined.restype = ctypes.c_uint
+
+UO_POSTINC, UO_POSTDEC, UO_PREINC, UO_PREDEC, UO_ADDROF, UO_DEREF, UO_PLUS, UO_MINUS, UO_NOT, UO_LNOT = range(1, 11)
+
+
+class CompileError(Exception):
+    pass
+
+
+def fail(cursor, message):
+    loc = cursor.location if cursor is not None else None
+    where = "%s:%d:%d: " % (loc.file, loc.line, loc.column) if loc and loc.file else ""
+    raise CompileError(where + message)
+
+
+def evaluate(cursor):
+    """Constant value of an expression, int or float, or None."""
+    result = lib.clang_Cursor_Evaluate(cursor)
+    if not result:
+        return None
+    try:
+        kind = lib.clang_EvalResult_getKind(result)
+        if kind == 1:
+            return lib.clang_EvalResult_getAsLongLong(result)
+        if kind == 2:
+            return lib.clang_EvalResult_getAsDouble(result)
+        return None
+    finally:
+        lib.clang_EvalResult_dispose(result)
+
+
+def canon(t):
+    return t.get_canonical()
+
+
+INT_BITS = {
+    T.BOOL: 8,
+    T.CHAR_S: 8,
+    T.SCHAR: 8,
+    T.CHAR_U: 8,
+    T.UCHAR: 8,
+    T.SHORT: 16,
+    T.USHORT: 16,
+    T.INT: 32,
+    T.UINT: 32,
+    T.LONG: 32,
+    T.ULONG: 32,
+    T.LONGLONG: 64,
+    T.ULONGLONG: 64,
+    T.ENUM: 32,
+}
+UNSIGNED = {T.BOOL, T.CHAR_U, T.UCHAR, T.USHORT, T.UINT, T.ULONG, T.ULONGLONG}
+
+
+def is_int(t):
+    return canon(t).kind in INT_BITS
+
+
+def is_signed(t):
+    t = canon(t)
+    if t.kind == T.ENUM:
+        return True
+    return t.kind not in UNSIGNED
+
+
+def is_float(t):
+    return canon(t).kind in (T.FLOAT, T.DOUBLE)
+
+
+def is_ptr(t):
+    return canon(t).kind == T.POINTER
+
+
+def is_vector(t):
+    return canon(t).kind == T.VECTOR
+
+
+def is_array(t):
+    return canon(t).kind in (T.CONSTANTARRAY, T.INCOMPLETEARRAY)
+
+
+def is_record(t):
+    return canon(t).kind == T.RECORD
+
+
+def is_function(t):
+    return canon(t).kind in (T.FUNCTIONPROTO, T.FUNCTIONNOPROTO)
+
+
+def is_void(t):
+    return canon(t).kind == T.VOID
+
+
+def float_const(value, ty):
+    if ty == "float":
+        value = struct.unpack("<f", struct.pack("<f", value))[0]
+    return "0x%016X" % struct.unpack("<Q", struct.pack("<d", value))[0]
+
+
+class Module:
+    def __init__(self, tu):
+        self.tu = tu
+        self.structs = {}
+        self.struct_order = []
+        self.globals = []
+        self.functions = []
+        self.declared = {}
+        self.defined = set()
+        self.strings = 0
+        self.static_locals = {}
+        self.global_names = {}
+        self.intrinsics = set()
+        self.features = None
+
+    # ---- types ----
+
+    def llty(self, t):
+        t = canon(t)
+        k = t.kind
+        if k in INT_BITS:
+            return "i%d" % INT_BITS[k]
+        if k == T.FLOAT:
+            return "float"
+        if k == T.DOUBLE:
+            return "double"
+        if k == T.VOID:
+            return "void"
+        if k == T.POINTER:
+            return "ptr"
+        if k == T.CONSTANTARRAY:
+            return "[%d x %s]" % (t.element_count, self.llty(t.element_type))
+        if k == T.INCOMPLETEARRAY:
+            return "[0 x %s]" % self.llty(t.element_type)
+        if k == T.VECTOR:
+            return "<%d x %s>" % (t.element_count, self.llty(t.element_type))
+        if k == T.RECORD:
+            return self.struct_type(t)
+        if k in (T.FUNCTIONPROTO, T.FUNCTIONNOPROTO):
+            return "ptr"
+        raise CompileError("unsupported type " + t.spelling)
+
+    def struct_type(self, t):
+        decl = t.get_declaration()
+        key = decl.hash
+        if key in self.structs:
+            return self.structs[key][0]
+        name = decl.spelling or "anon.%d" % len(self.structs)
+        llname = "%%struct.%s.%d" % (name.replace(" ", "_").replace(":", "_").replace("(", "").replace(")", ""), len(self.structs))
+        if decl.kind == K.UNION_DECL:
+            raise CompileError("unions are not supported")
+        self.structs[key] = (llname, None)
+        fields = []
+        index = {}
+        offset = 0
+        for field in t.get_fields():
+            fo = field.get_field_offsetof() // 8
+            if fo > offset:
+                fields.append("[%d x i8]" % (fo - offset))
+                offset = fo
+            index[field.hash] = len(fields)
+            fields.append(self.llty(field.type))
+            offset += canon(field.type).get_size()
+        size = t.get_size()
+        if size > offset:
+            fields.append("[%d x i8]" % (size - offset))
+        self.structs[key] = (llname, index)
+        self.struct_order.append("%s = type { %s }" % (llname, ", ".join(fields)))
+        return llname
+
+    def field_index(self, record_type, field_cursor):
+        self.struct_type(canon(record_type))
+        return self.structs[canon(record_type).get_declaration().hash][1][field_cursor.hash]
+
+    def size_of(self, t):
+        return canon(t).get_size()
+
+    # ---- functions ----
+
+    def func_type(self, t):
+        t = canon(t)
+        ret = self.llty(t.get_result())
+        args = [self.llty(a) for a in t.argument_types()]
+        if t.is_function_variadic():
+            args.append("...")
+        return ret, args
+
+    def declare_function(self, cursor):
+        name = cursor.spelling
+        if name in self.declared or name in self.defined:
+            return
+        ret, args = self.func_type(cursor.type)
+        self.declared[name] = "declare %s @%s(%s)" % (ret, name, ", ".join(args))
+
+    def global_ref(self, decl):
+        key = (decl.location.file.name if decl.location.file else "", decl.location.offset)
+        if key in self.global_names:
+            return self.global_names[key]
+        return None
+
+    # ---- constants ----
+
+    def const_value(self, t, expr):
+        """LLVM constant for a static initializer."""
+        ty = self.llty(t)
+        if expr is None:
+            return "zeroinitializer" if not (is_int(t) or is_float(t) or is_ptr(t)) else self.zero(t)
+        expr = strip_parens(expr)
+        if expr.kind == K.INIT_LIST_EXPR:
+            items = list(expr.get_children())
+            ct = canon(t)
+            if ct.kind == T.CONSTANTARRAY:
+                et = ct.element_type
+                values = []
+                for i in range(ct.element_count):
+                    values.append("%s %s" % (self.llty(et), self.const_value(et, items[i] if i < len(items) else None)))
+                return "[%s]" % ", ".join(values)
+            if ct.kind == T.RECORD:
+                llname = self.struct_type(ct)
+                index = self.structs[ct.get_declaration().hash][1]
+                fields = list(ct.get_fields())
+                body = self.struct_order[[s.split(" = ")[0] for s in self.struct_order].index(llname)]
+                members = body[body.index("{") + 1 : body.rindex("}")].strip()
+                member_types = split_types(members)
+                values = ["%s zeroinitializer" % mt for mt in member_types]
+                for i, field in enumerate(fields):
+                    value = self.const_value(field.type, items[i] if i < len(items) else None)
+                    values[index[field.hash]] = "%s %s" % (member_types[index[field.hash]], value)
+                return "{ %s }" % ", ".join(values)
+            if len(items) == 1:
+                return self.const_value(t, items[0])
+            fail(expr, "unsupported initializer list")
+        # Function addresses, possibly behind decays and casts.
+        inner = expr
+        while inner.kind in (K.UNEXPOSED_EXPR, K.CSTYLE_CAST_EXPR, K.PAREN_EXPR):
+            children = [c for c in inner.get_children() if c.kind != K.TYPE_REF]
+            if not children:
+                break
+            inner = children[-1]
+        if inner.kind == K.DECL_REF_EXPR and inner.referenced.kind == K.FUNCTION_DECL:
+            return "@" + inner.referenced.spelling
+        if inner.kind == K.STRING_LITERAL and is_ptr(t):
+            return self.string_constant(inner)
+        if inner.kind == K.UNARY_OPERATOR and lib.clang_getCursorUnaryOperatorKind(inner) == UO_ADDROF:
+            target = list(inner.get_children())[0]
+            if target.kind == K.DECL_REF_EXPR:
+                ref = self.global_ref(target.referenced)
+                if ref:
+                    return ref
+        value = evaluate(expr)
+        if value is None and inner is not expr:
+            value = evaluate(inner)
+        if value is None:
+            if expr.kind == K.UNEXPOSED_EXPR and not list(expr.get_children()):
+                return self.zero(t)
+            fail(expr, "initializer is not constant")
+        if is_float(t):
+            return float_const(float(value), ty)
+        if is_int(t):
+            bits = INT_BITS[canon(t).kind]
+            value = int(value) & ((1 << bits) - 1)
+            if is_signed(t) and value >= 1 << (bits - 1):
+                value -= 1 << bits
+            return str(value)
+        if is_ptr(t):
+            return "null" if int(value) == 0 else "inttoptr (i32 %d to ptr)" % int(value)
+        fail(expr, "unsupported constant")
+
+    def string_constant(self, c):
+        text = eval(c.spelling)
+        data = text.encode("latin1") + b"\0"
+        name = "@.str.%d" % self.strings
+        self.strings += 1
+        esc = "".join(chr(b) if 32 <= b < 127 and chr(b) not in '"\\' else "\\%02X" % b for b in data)
+        self.globals.append('%s = private constant [%d x i8] c"%s"' % (name, len(data), esc))
+        return name
+
+    def zero(self, t):
+        if is_float(t):
+            return "0.0"
+        if is_int(t):
+            return "0"
+        if is_ptr(t):
+            return "null"
+        return "zeroinitializer"
+
+    # ---- top level ----
+
+    def compile(self):
+        for cursor in self.tu.cursor.get_children():
+            if cursor.kind == K.FUNCTION_DECL and cursor.is_definition():
+                self.defined.add(cursor.spelling)
+        for cursor in self.tu.cursor.get_children():
+            if cursor.kind == K.FUNCTION_DECL:
+                if cursor.is_definition():
+                    self.functions.append(FunctionCompiler(self, cursor).compile())
+            elif cursor.kind == K.VAR_DECL:
+                self.add_global(cursor)
+        for name in list(self.declared):
+            if name in self.defined:
+                del self.declared[name]
+        out = [
+            'target datalayout = "e-m:e-p:32:32-i64:64-n32:64-S128"',
+            'target triple = "wasm32-unknown-unknown"',
+            "",
+        ]
+        out += self.struct_order
+        out.append("")
+        out += self.globals
+        out.append("")
+        out += self.declared.values()
+        out += sorted(self.intrinsics)
+        out.append("")
+        out += self.functions
+        out.append("attributes #0 = { alwaysinline }")
+        return "\n".join(out) + "\n"
+
+    def add_global(self, cursor, function_name=None):
+        key = (cursor.location.file.name if cursor.location.file else "", cursor.location.offset)
+        if key in self.global_names:
+            return self.global_names[key]
+        storage = cursor.storage_class
+        init = var_init(cursor)
+        if function_name:
+            name = "@%s.%s.%d" % (function_name, cursor.spelling, len(self.global_names))
+        else:
+            name = "@" + cursor.spelling
+        self.global_names[key] = name
+        ty = self.llty(cursor.type)
+        if storage == ci.StorageClass.EXTERN and init is None:
+            self.globals.append("%s = external global %s" % (name, ty))
+            return name
+        linkage = "internal " if storage == ci.StorageClass.STATIC or function_name else ""
+        const = "constant" if cursor.type.is_const_qualified() or (
+            is_array(cursor.type) and canon(cursor.type).element_type.is_const_qualified()
+        ) else "global"
+        value = self.const_value(cursor.type, init)
+        align = canon(cursor.type).get_align()
+        self.globals.append("%s = %s%s %s %s, align %d" % (name, linkage, const, ty, value, align))
+        return name
+
+
+def split_types(text):
+    depth = 0
+    parts = []
+    current = ""
+    for ch in text:
+        if ch in "[{<(":
+            depth += 1
+        elif ch in "]}>)":
+            depth -= 1
+        if ch == "," and depth == 0:
+            parts.append(current.strip())
+            current = ""
+        else:
+            current += ch
+    if current.strip():
+        parts.append(current.strip())
+    return parts
+
+
+def strip_parens(cursor):
+    while cursor.kind == K.PAREN_EXPR:
+        cursor = list(cursor.get_children())[0]
+    return cursor
+
+
+def var_init(cursor):
+    """The initializer of a VAR_DECL, or None."""
+    tokens = [t.spelling for t in cursor.get_tokens()]
+    if "=" not in tokens:
+        return None
+    children = [c for c in cursor.get_children() if c.kind not in (K.TYPE_REF, K.UNEXPOSED_ATTR, K.VISIBILITY_ATTR)]
+    if not children:
+        return None
+    return children[-1]
+
+
+class Value:
+    __slots__ = ("v", "t")
+
+    def __init__(self, v, t):
+        self.v = v
+        self.t = t
+
+
+class FunctionCompiler:
+    def __init__(self, module, cursor):
+        self.m = module
+        self.cursor = cursor
+        self.lines = []
+        self.allocas = []
+        self.locals = {}
+        self.tmp = 0
+        self.labels = 0
+        self.terminated = False
+        self.breaks = []
+        self.continues = []
+        self.switches = []
+        self.flatten = False
+        self.ret_type = canon(cursor.type).get_result()
+
+    def new_tmp(self):
+        self.tmp += 1
+        return "%%t%d" % self.tmp
+
+    def new_label(self, hint="bb"):
+        self.labels += 1
+        return "%s.%d" % (hint, self.labels)
+
+    def emit(self, text):
+        if self.terminated:
+            self.place_label(self.new_label("dead"))
+        self.lines.append("  " + text)
+
+    def terminate(self, text):
+        self.emit(text)
+        self.terminated = True
+
+    def place_label(self, label):
+        if not self.terminated:
+            self.lines.append("  br label %%%s" % label)
+        self.lines.append("%s:" % label)
+        self.terminated = False
+
+    def op(self, text):
+        name = self.new_tmp()
+        self.emit("%s = %s" % (name, text))
+        return name
+
+    def local_key(self, decl):
+        return (decl.location.file.name if decl.location.file else "", decl.location.offset)
+
+    def alloca(self, t, name):
+        ty = self.m.llty(t)
+        ptr = "%%%s.%d" % (name, len(self.allocas))
+        self.allocas.append("  %s = alloca %s, align %d" % (ptr, ty, max(canon(t).get_align(), 1)))
+        return ptr
+
+    # ---- function ----
+
+    def compile(self):
+        c = self.cursor
+        m = self.m
+        ret, _ = m.func_type(c.type)
+        static = c.storage_class == ci.StorageClass.STATIC
+        attrs = []
+        for child in c.get_children():
+            if child.kind == K.UNEXPOSED_ATTR or child.kind.is_attribute():
+                spelling = " ".join(t.spelling for t in child.get_tokens())
+                if "flatten" in spelling:
+                    self.flatten = True
+                if "noinline" in spelling:
+                    attrs.append("noinline")
+                if "always_inline" in spelling:
+                    attrs.append("alwaysinline")
+        tokens = [t.spelling for t in c.get_tokens()]
+        body_start = tokens.index("{") if "{" in tokens else len(tokens)
+        if self.m.features:
+            attrs.append('"target-features"="%s"' % self.m.features)
+        if c.spelling in ("memcpy", "memmove", "memset"):
+            attrs.append('"no-builtins"')
+        if "inline" in tokens[:body_start] and "noinline" not in attrs:
+            attrs.append("inlinehint")
+        params = []
+        for arg in c.get_arguments():
+            name = arg.spelling or "arg"
+            pname = "%%p.%s.%d" % (name, len(params))
+            params.append((arg, pname))
+        self.lines.append("entry:")
+        for arg, pname in params:
+            ptr = self.alloca(arg.type, "a." + (arg.spelling or "arg"))
+            self.emit("store %s %s, ptr %s" % (m.llty(arg.type), pname, ptr))
+            self.locals[self.local_key(arg)] = (ptr, arg.type)
+        body = [ch for ch in c.get_children() if ch.kind == K.COMPOUND_STMT][0]
+        self.stmt(body)
+        if not self.terminated:
+            if is_void(self.ret_type):
+                self.terminate("ret void")
+            elif c.spelling == "main":
+                self.terminate("ret i32 0")
+            else:
+                self.terminate("unreachable")
+        linkage = "internal " if static else ""
+        plist = ", ".join("%s %s" % (m.llty(a.type), p) for a, p in params)
+        head = "define %s%s @%s(%s) %s{" % (linkage, ret, c.spelling, plist, " ".join(attrs) + " " if attrs else "")
+        body_lines = [self.lines[0]] + self.allocas + self.lines[1:]
+        return "\n".join([head] + body_lines + ["}", ""])
+
+    # ---- statements ----
+
+    def stmt(self, c):
+        k = c.kind
+        if k == K.COMPOUND_STMT:
+            for child in c.get_children():
+                self.stmt(child)
+        elif k == K.DECL_STMT:
+            for child in c.get_children():
+                if child.kind == K.VAR_DECL:
+                    self.local_var(child)
+                elif child.kind in (K.STRUCT_DECL, K.TYPEDEF_DECL, K.ENUM_DECL):
+                    pass
+                else:
+                    fail(child, "unsupported declaration %s" % child.kind)
+        elif k == K.RETURN_STMT:
+            children = list(c.get_children())
+            if children:
+                v = self.rvalue(children[0])
+                self.terminate("ret %s %s" % (self.m.llty(self.ret_type), v.v))
+            else:
+                self.terminate("ret void")
+        elif k == K.IF_STMT:
+            children = list(c.get_children())
+            cond = self.cond(children[0])
+            then_l, else_l, end_l = self.new_label("then"), self.new_label("else"), self.new_label("endif")
+            has_else = len(children) > 2
+            self.terminate("br i1 %s, label %%%s, label %%%s" % (cond, then_l, else_l if has_else else end_l))
+            self.place_label(then_l)
+            self.stmt(children[1])
+            self.branch(end_l)
+            if has_else:
+                self.place_label(else_l)
+                self.stmt(children[2])
+                self.branch(end_l)
+            self.place_label(end_l)
+        elif k == K.WHILE_STMT:
+            cond_c, body = list(c.get_children())
+            cond_l, body_l, end_l = self.new_label("while.cond"), self.new_label("while.body"), self.new_label("while.end")
+            self.branch(cond_l)
+            self.place_label(cond_l)
+            cond = self.cond(cond_c)
+            self.terminate("br i1 %s, label %%%s, label %%%s" % (cond, body_l, end_l))
+            self.place_label(body_l)
+            self.loop_body(body, end_l, cond_l)
+            self.branch(cond_l)
+            self.place_label(end_l)
+        elif k == K.DO_STMT:
+            body, cond_c = list(c.get_children())
+            body_l, cond_l, end_l = self.new_label("do.body"), self.new_label("do.cond"), self.new_label("do.end")
+            self.branch(body_l)
+            self.place_label(body_l)
+            self.loop_body(body, end_l, cond_l)
+            self.branch(cond_l)
+            self.place_label(cond_l)
+            cond = self.cond(cond_c)
+            self.terminate("br i1 %s, label %%%s, label %%%s" % (cond, body_l, end_l))
+            self.place_label(end_l)
+        elif k == K.FOR_STMT:
+            init, cond_c, inc, body = self.for_parts(c)
+            if init is not None:
+                self.stmt(init)
+            cond_l, body_l, inc_l, end_l = (
+                self.new_label("for.cond"),
+                self.new_label("for.body"),
+                self.new_label("for.inc"),
+                self.new_label("for.end"),
+            )
+            self.branch(cond_l)
+            self.place_label(cond_l)
+            if cond_c is not None:
+                cond = self.cond(cond_c)
+                self.terminate("br i1 %s, label %%%s, label %%%s" % (cond, body_l, end_l))
+            else:
+                self.branch(body_l)
+            self.place_label(body_l)
+            self.loop_body(body, end_l, inc_l)
+            self.branch(inc_l)
+            self.place_label(inc_l)
+            if inc is not None:
+                self.rvalue(inc, discard=True)
+            self.branch(cond_l)
+            self.place_label(end_l)
+        elif k == K.SWITCH_STMT:
+            children = list(c.get_children())
+            cond_c, body = children[0], children[-1]
+            v = self.rvalue(cond_c)
+            end_l = self.new_label("sw.end")
+            cases = []
+            default = [None]
+            self.collect_cases(body, cases, default)
+            ty = self.m.llty(v.t)
+            targets = " ".join("%s %d, label %%%s" % (ty, value, label) for value, label, _ in cases)
+            self.terminate("switch %s %s, label %%%s [ %s ]" % (ty, v.v, default[0][0] if default[0] else end_l, targets))
+            labels = {case.hash: label for _, label, case in cases}
+            if default[0]:
+                labels[default[0][1].hash] = default[0][0]
+            self.switches.append(labels)
+            self.breaks.append(end_l)
+            self.stmt(body)
+            self.breaks.pop()
+            self.switches.pop()
+            self.branch(end_l)
+            self.place_label(end_l)
+        elif k in (K.CASE_STMT, K.DEFAULT_STMT):
+            label = self.switches[-1][c.hash]
+            self.branch(label)
+            self.place_label(label)
+            children = list(c.get_children())
+            self.stmt(children[-1])
+        elif k == K.BREAK_STMT:
+            self.terminate("br label %%%s" % self.breaks[-1])
+        elif k == K.CONTINUE_STMT:
+            self.terminate("br label %%%s" % self.continues[-1])
+        elif k == K.NULL_STMT:
+            pass
+        elif k.is_expression() or k == K.UNEXPOSED_EXPR:
+            self.rvalue(c, discard=True)
+        else:
+            fail(c, "unsupported statement %s" % k)
+
+    def branch(self, label):
+        if not self.terminated:
+            self.terminate("br label %%%s" % label)
+
+    def loop_body(self, body, break_l, continue_l):
+        self.breaks.append(break_l)
+        self.continues.append(continue_l)
+        self.stmt(body)
+        self.breaks.pop()
+        self.continues.pop()
+
+    def collect_cases(self, c, cases, default):
+        for child in c.get_children():
+            if child.kind == K.SWITCH_STMT:
+                continue
+            if child.kind == K.CASE_STMT:
+                value = evaluate(list(child.get_children())[0])
+                if value is None:
+                    fail(child, "case value is not constant")
+                cases.append((int(value), self.new_label("sw.case"), child))
+            elif child.kind == K.DEFAULT_STMT:
+                default[0] = (self.new_label("sw.default"), child)
+            if child.kind.is_statement():
+                self.collect_cases(child, cases, default)
+
+    def for_parts(self, c):
+        tokens = list(c.get_tokens())
+        depth = 0
+        semis = []
+        close = None
+        for tok in tokens[1:]:
+            s = tok.spelling
+            if s == "(":
+                depth += 1
+            elif s == ")":
+                depth -= 1
+                if depth == 0:
+                    close = tok.extent.start.offset
+                    break
+            elif s == ";" and depth == 1:
+                semis.append(tok.extent.start.offset)
+        if len(semis) != 2 or close is None:
+            fail(c, "cannot split for statement")
+        init = cond = inc = body = None
+        for child in c.get_children():
+            start = child.extent.start.offset
+            if start < semis[0]:
+                init = child
+            elif start < semis[1]:
+                cond = child
+            elif start < close:
+                inc = child
+            else:
+                body = child
+        return init, cond, inc, body
+
+    def local_var(self, c):
+        if c.storage_class == ci.StorageClass.STATIC:
+            name = self.m.add_global(c, self.cursor.spelling)
+            self.locals[self.local_key(c)] = (name, c.type)
+            return
+        ptr = self.alloca(c.type, "v." + c.spelling)
+        self.locals[self.local_key(c)] = (ptr, c.type)
+        init = var_init(c)
+        if init is not None:
+            self.init_memory(ptr, c.type, init)
+
+    def init_memory(self, ptr, t, init):
+        init_s = strip_parens(init)
+        if init_s.kind == K.INIT_LIST_EXPR:
+            ct = canon(t)
+            items = list(init_s.get_children())
+            if ct.kind == T.RECORD or ct.kind == T.CONSTANTARRAY:
+                self.memset(ptr, self.m.size_of(t))
+                if ct.kind == T.CONSTANTARRAY:
+                    et = ct.element_type
+                    for i, item in enumerate(items):
+                        ep = self.op("getelementptr inbounds %s, ptr %s, i32 0, i32 %d" % (self.m.llty(t), ptr, i))
+                        self.init_memory(ep, et, item)
+                else:
+                    fields = list(ct.get_fields())
+                    for field, item in zip(fields, items):
+                        idx = self.m.field_index(ct, field)
+                        fp = self.op("getelementptr inbounds %s, ptr %s, i32 0, i32 %d" % (self.m.llty(t), ptr, idx))
+                        self.init_memory(fp, field.type, item)
+                return
+            if len(items) == 1:
+                init = items[0]
+            elif not items:
+                self.emit("store %s %s, ptr %s" % (self.m.llty(t), self.m.zero(t), ptr))
+                return
+        v = self.rvalue(init)
+        v = self.convert(v, t, init)
+        self.emit("store %s %s, ptr %s" % (self.m.llty(t), v.v, ptr))
+
+    def memset(self, ptr, size):
+        self.m.intrinsics.add("declare void @llvm.memset.p0.i32(ptr, i8, i32, i1)")
+        self.emit("call void @llvm.memset.p0.i32(ptr %s, i8 0, i32 %d, i1 false)" % (ptr, size))
+
+    # ---- expressions ----
+
+    def is_lvalue(self, c):
+        k = c.kind
+        if k == K.DECL_REF_EXPR:
+            return c.referenced.kind in (K.VAR_DECL, K.PARM_DECL)
+        if k == K.MEMBER_REF_EXPR:
+            base = list(c.get_children())[0]
+            return is_ptr(base.type) or self.is_lvalue(base)
+        if k == K.ARRAY_SUBSCRIPT_EXPR:
+            return True
+        if k == K.UNARY_OPERATOR:
+            return lib.clang_getCursorUnaryOperatorKind(c) == UO_DEREF
+        if k == K.PAREN_EXPR:
+            return self.is_lvalue(list(c.get_children())[0])
+        if k in (K.STRING_LITERAL, K.COMPOUND_LITERAL_EXPR):
+            return True
+        return False
+
+    def lvalue(self, c):
+        """Address of an lvalue expression."""
+        k = c.kind
+        m = self.m
+        if k == K.PAREN_EXPR:
+            return self.lvalue(list(c.get_children())[0])
+        if k == K.DECL_REF_EXPR:
+            ref = c.referenced
+            key = self.local_key(ref)
+            if key in self.locals:
+                return self.locals[key][0]
+            name = m.global_ref(ref)
+            if name is None:
+                if ref.kind == K.VAR_DECL:
+                    name = m.add_global(ref)
+                else:
+                    fail(c, "unknown variable %s" % ref.spelling)
+            return name
+        if k == K.MEMBER_REF_EXPR:
+            base = list(c.get_children())[0]
+            field = c.referenced
+            if is_ptr(base.type):
+                bp = self.rvalue(base).v
+                rt = canon(base.type).get_pointee()
+            else:
+                bp = self.lvalue(base)
+                rt = canon(base.type)
+            idx = m.field_index(rt, field)
+            return self.op("getelementptr inbounds %s, ptr %s, i32 0, i32 %d" % (m.llty(rt), bp, idx))
+        if k == K.ARRAY_SUBSCRIPT_EXPR:
+            base, index = list(c.get_children())
+            if not (is_ptr(base.type) or is_array(base.type)):
+                base, index = index, base
+            bv = self.rvalue(base)
+            iv = self.to_i32(self.rvalue(index))
+            return self.op("getelementptr inbounds %s, ptr %s, i32 %s" % (m.llty(c.type), bv.v, iv))
+        if k == K.UNARY_OPERATOR and lib.clang_getCursorUnaryOperatorKind(c) == UO_DEREF:
+            return self.rvalue(list(c.get_children())[0]).v
+        if k == K.STRING_LITERAL:
+            return m.string_constant(c)
+        if k == K.COMPOUND_LITERAL_EXPR:
+            ptr = self.alloca(c.type, "lit")
+            children = [ch for ch in c.get_children() if ch.kind != K.TYPE_REF]
+            self.init_memory(ptr, c.type, children[-1])
+            return ptr
+        if k == K.UNEXPOSED_EXPR:
+            children = list(c.get_children())
+            if len(children) == 1:
+                return self.lvalue(children[0])
+        if k == K.CALL_EXPR and is_record(c.type):
+            v = self.rvalue(c)
+            ptr = self.alloca(c.type, "rec")
+            self.emit("store %s %s, ptr %s" % (m.llty(c.type), v.v, ptr))
+            return ptr
+        fail(c, "not an lvalue: %s" % k)
+
+    def load(self, ptr, t):
+        return Value(self.op("load %s, ptr %s, align %d" % (self.m.llty(t), ptr, canon(t).get_align())), t)
+
+    def store(self, v, ptr, t):
+        self.emit("store %s %s, ptr %s, align %d" % (self.m.llty(t), v, ptr, canon(t).get_align()))
+
+    def to_i32(self, v):
+        if is_int(v.t):
+            bits = INT_BITS[canon(v.t).kind]
+            if bits < 32:
+                return self.op("%s %s %s to i32" % ("sext" if is_signed(v.t) else "zext", self.m.llty(v.t), v.v))
+            if bits > 32:
+                return self.op("trunc i64 %s to i32" % v.v)
+            return v.v
+        fail(None, "index is not an integer")
+
+    def cond(self, c):
+        v = self.rvalue(c)
+        return self.truth(v)
+
+    def truth(self, v):
+        t = v.t
+        if is_int(t):
+            return self.op("icmp ne %s %s, 0" % (self.m.llty(t), v.v))
+        if is_float(t):
+            return self.op("fcmp une %s %s, 0.0" % (self.m.llty(t), v.v))
+        if is_ptr(t):
+            return self.op("icmp ne ptr %s, null" % v.v)
+        fail(None, "bad condition type " + t.spelling)
+
+    def convert(self, v, dt, cursor=None):
+        st = v.t
+        if is_void(dt):
+            return Value("", dt)
+        sty, dty = self.m.llty(st), self.m.llty(dt)
+        if is_int(st) and is_int(dt):
+            if canon(dt).kind == T.BOOL:
+                b = self.truth(v)
+                return Value(self.op("zext i1 %s to i8" % b), dt)
+            sb, db = INT_BITS[canon(st).kind], INT_BITS[canon(dt).kind]
+            if sb == db:
+                return Value(v.v, dt)
+            if sb > db:
+                return Value(self.op("trunc %s %s to %s" % (sty, v.v, dty)), dt)
+            return Value(self.op("%s %s %s to %s" % ("sext" if is_signed(st) else "zext", sty, v.v, dty)), dt)
+        if is_int(st) and is_float(dt):
+            return Value(self.op("%s %s %s to %s" % ("sitofp" if is_signed(st) else "uitofp", sty, v.v, dty)), dt)
+        if is_float(st) and is_int(dt):
+            if canon(dt).kind == T.BOOL:
+                b = self.truth(v)
+                return Value(self.op("zext i1 %s to i8" % b), dt)
+            return Value(self.op("%s %s %s to %s" % ("fptosi" if is_signed(dt) else "fptoui", sty, v.v, dty)), dt)
+        if is_float(st) and is_float(dt):
+            if sty == dty:
+                return Value(v.v, dt)
+            return Value(self.op("%s %s %s to %s" % ("fpext" if sty == "float" else "fptrunc", sty, v.v, dty)), dt)
+        if is_ptr(st) and is_ptr(dt):
+            return Value(v.v, dt)
+        if is_int(st) and is_ptr(dt):
+            i = self.to_i32(v)
+            return Value(self.op("inttoptr i32 %s to ptr" % i), dt)
+        if is_ptr(st) and is_int(dt):
+            i = Value(self.op("ptrtoint ptr %s to i32" % v.v), canon(self.m.tu_int))
+            return self.convert(i, dt)
+        if is_vector(st) and is_vector(dt):
+            if sty == dty:
+                return Value(v.v, dt)
+            return Value(self.op("bitcast %s %s to %s" % (sty, v.v, dty)), dt)
+        if sty == dty:
+            return Value(v.v, dt)
+        fail(cursor, "unsupported conversion %s -> %s" % (st.spelling, dt.spelling))
+
+    def rvalue(self, c, discard=False):
+        k = c.kind
+        m = self.m
+        t = c.type
+        if k == K.PAREN_EXPR:
+            return self.rvalue(list(c.get_children())[0], discard)
+        if k == K.UNEXPOSED_EXPR:
+            children = list(c.get_children())
+            if not children:
+                return Value(m.zero(t), t)
+            sub = children[0]
+            st = sub.type
+            if is_array(st) and is_ptr(t):
+                return Value(self.lvalue(sub), t)
+            if is_function(st) and is_ptr(t):
+                ref = strip_parens(sub)
+                if ref.kind == K.DECL_REF_EXPR:
+                    if ref.referenced.spelling not in m.defined:
+                        m.declare_function(ref.referenced)
+                    return Value("@" + ref.referenced.spelling, t)
+                return self.rvalue(sub)
+            if self.is_lvalue(sub) and m.llty(st) == m.llty(t) and same_kind(st, t):
+                if is_record(st) or is_array(st):
+                    if discard:
+                        return Value("", t)
+                return self.load(self.lvalue(sub), t)
+            v = self.rvalue(sub, discard)
+            if discard:
+                return v
+            return self.convert(v, t, c)
+        if k == K.INTEGER_LITERAL:
+            value = evaluate(c)
+            if value is None:
+                value = parse_int(next(c.get_tokens()).spelling)
+            return Value(str(self.wrap_int(int(value), t)), t)
+        if k == K.CHARACTER_LITERAL:
+            return Value(str(evaluate(c)), t)
+        if k == K.FLOATING_LITERAL:
+            value = evaluate(c)
+            if value is None:
+                value = float(next(c.get_tokens()).spelling.rstrip("fFlL"))
+            return Value(float_const(value, m.llty(t)), t)
+        if k == K.DECL_REF_EXPR:
+            ref = c.referenced
+            if ref.kind == K.ENUM_CONSTANT_DECL:
+                return Value(str(ref.enum_value), t)
+            if ref.kind == K.FUNCTION_DECL:
+                return Value("@" + ref.spelling, t)
+            return self.load(self.lvalue(c), t)
+        if k in (K.MEMBER_REF_EXPR, K.ARRAY_SUBSCRIPT_EXPR, K.STRING_LITERAL, K.COMPOUND_LITERAL_EXPR):
+            if k == K.MEMBER_REF_EXPR and not self.is_lvalue(c):
+                base = list(c.get_children())[0]
+                bv = self.rvalue(base)
+                idx = m.field_index(base.type, c.referenced)
+                return Value(self.op("extractvalue %s %s, %d" % (m.llty(base.type), bv.v, idx)), t)
+            return self.load(self.lvalue(c), t)
+        if k == K.BINARY_OPERATOR:
+            return self.binary(c)
+        if k == K.COMPOUND_ASSIGNMENT_OPERATOR:
+            return self.compound_assign(c)
+        if k == K.UNARY_OPERATOR:
+            return self.unary(c)
+        if k == K.CONDITIONAL_OPERATOR:
+            cond_c, a_c, b_c = list(c.get_children())
+            cond = self.cond(cond_c)
+            a_l, b_l, end_l = self.new_label("cond.true"), self.new_label("cond.false"), self.new_label("cond.end")
+            self.terminate("br i1 %s, label %%%s, label %%%s" % (cond, a_l, b_l))
+            self.place_label(a_l)
+            av = self.rvalue(a_c)
+            if not is_void(t):
+                av = self.convert(av, t, a_c)
+            a_end = self.current_label()
+            self.branch(end_l)
+            self.place_label(b_l)
+            bv = self.rvalue(b_c)
+            if not is_void(t):
+                bv = self.convert(bv, t, b_c)
+            b_end = self.current_label()
+            self.branch(end_l)
+            self.place_label(end_l)
+            if is_void(t):
+                return Value("", t)
+            return Value(self.op("phi %s [ %s, %%%s ], [ %s, %%%s ]" % (m.llty(t), av.v, a_end, bv.v, b_end)), t)
+        if k == K.CALL_EXPR:
+            return self.call(c)
+        if k == K.CSTYLE_CAST_EXPR:
+            children = [ch for ch in c.get_children() if ch.kind != K.TYPE_REF]
+            inner = children[-1]
+            v = self.rvalue(inner, discard=is_void(t))
+            if is_void(t):
+                return Value("", t)
+            return self.convert(v, t, c)
+        if k == K.CXX_UNARY_EXPR:
+            value = evaluate(c)
+            if value is None:
+                fail(c, "cannot evaluate")
+            return Value(str(int(value)), t)
+        fail(c, "unsupported expression %s" % k)
+
+    def current_label(self):
+        for line in reversed(self.lines):
+            if line.endswith(":") and not line.startswith(" "):
+                return line[:-1]
+        return "entry"
+
+    def wrap_int(self, value, t):
+        bits = INT_BITS[canon(t).kind]
+        value &= (1 << bits) - 1
+        if value >= 1 << (bits - 1):
+            value -= 1 << bits
+        return value
+
+    def binary(self, c):
+        m = self.m
+        lhs, rhs = list(c.get_children())
+        opname = lib.clang_getBinaryOperatorKindSpelling(lib.clang_getCursorBinaryOperatorKind(c))
+        t = c.type
+        if opname == "=":
+            ptr = self.lvalue(lhs)
+            v = self.rvalue(rhs)
+            v = self.convert(v, lhs.type, c)
+            self.store(v.v, ptr, lhs.type)
+            return Value(v.v, lhs.type)
+        if opname == ",":
+            self.rvalue(lhs, discard=True)
+            return self.rvalue(rhs)
+        if opname in ("&&", "||"):
+            a = self.cond(lhs)
+            start = self.current_label()
+            rhs_l, end_l = self.new_label("land.rhs"), self.new_label("land.end")
+            if opname == "&&":
+                self.terminate("br i1 %s, label %%%s, label %%%s" % (a, rhs_l, end_l))
+            else:
+                self.terminate("br i1 %s, label %%%s, label %%%s" % (a, end_l, rhs_l))
+            self.place_label(rhs_l)
+            b = self.cond(rhs)
+            rhs_end = self.current_label()
+            self.branch(end_l)
+            self.place_label(end_l)
+            short = "false" if opname == "&&" else "true"
+            r = self.op("phi i1 [ %s, %%%s ], [ %s, %%%s ]" % (short, start, b, rhs_end))
+            return Value(self.op("zext i1 %s to i32" % r), t)
+        a = self.rvalue(lhs)
+        b = self.rvalue(rhs)
+        return self.arith(opname, a, b, t, c)
+
+    def arith(self, opname, a, b, t, c):
+        m = self.m
+        # Pointer arithmetic.
+        if opname in ("+", "-") and (is_ptr(a.t) or is_ptr(b.t)):
+            if is_ptr(a.t) and is_ptr(b.t):
+                et = canon(a.t).get_pointee()
+                ai = self.op("ptrtoint ptr %s to i32" % a.v)
+                bi = self.op("ptrtoint ptr %s to i32" % b.v)
+                d = self.op("sub i32 %s, %s" % (ai, bi))
+                return Value(self.op("sdiv exact i32 %s, %d" % (d, max(m.size_of(et), 1))), t)
+            if is_ptr(b.t):
+                a, b = b, a
+            et = canon(a.t).get_pointee()
+            i = self.to_i32(b)
+            if opname == "-":
+                i = self.op("sub i32 0, %s" % i)
+            ety = "i8" if is_void(et) else m.llty(et)
+            return Value(self.op("getelementptr inbounds %s, ptr %s, i32 %s" % (ety, a.v, i)), a.t)
+        cmp = {"<": ("slt", "ult", "olt"), ">": ("sgt", "ugt", "ogt"), "<=": ("sle", "ule", "ole"),
+               ">=": ("sge", "uge", "oge"), "==": ("eq", "eq", "oeq"), "!=": ("ne", "ne", "une")}
+        if opname in cmp:
+            s, u, f = cmp[opname]
+            ty = m.llty(a.t)
+            if is_float(a.t):
+                r = self.op("fcmp %s %s %s, %s" % (f, ty, a.v, b.v))
+            elif is_vector(a.t):
+                fail(c, "vector comparison")
+            else:
+                if is_ptr(a.t) or is_ptr(b.t):
+                    a = self.convert(a, a.t) if is_ptr(a.t) else Value("null", b.t)
+                    b = b if is_ptr(b.t) else Value("null", a.t)
+                    ty = "ptr"
+                r = self.op("icmp %s %s %s, %s" % (u if (is_ptr(a.t) or not is_signed(a.t)) else s, ty, a.v, b.v))
+            return Value(self.op("zext i1 %s to i32" % r), t)
+        ty = m.llty(t)
+        if opname in ("<<", ">>"):
+            bv = self.convert(b, t) if m.llty(b.t) != ty else b
+            if opname == "<<":
+                return Value(self.op("shl %s %s, %s" % (ty, a.v, bv.v)), t)
+            return Value(self.op("%s %s %s, %s" % ("ashr" if is_signed(t) else "lshr", ty, a.v, bv.v)), t)
+        if is_float(t):
+            fop = {"+": "fadd", "-": "fsub", "*": "fmul", "/": "fdiv", "%": "frem"}[opname]
+            return Value(self.op("%s %s %s, %s" % (fop, ty, a.v, b.v)), t)
+        if is_vector(t):
+            fail(c, "vector arithmetic")
+        signed = is_signed(t)
+        iop = {
+            "+": "add",
+            "-": "sub",
+            "*": "mul",
+            "/": "sdiv" if signed else "udiv",
+            "%": "srem" if signed else "urem",
+            "&": "and",
+            "|": "or",
+            "^": "xor",
+        }[opname]
+        return Value(self.op("%s %s %s, %s" % (iop, ty, a.v, b.v)), t)
+
+    def compound_assign(self, c):
+        m = self.m
+        lhs, rhs = list(c.get_children())
+        opname = lib.clang_getBinaryOperatorKindSpelling(lib.clang_getCursorBinaryOperatorKind(c))[:-1]
+        lt = lhs.type
+        ptr = self.lvalue(lhs)
+        old = self.load(ptr, lt)
+        b = self.rvalue(rhs)
+        if is_ptr(lt):
+            r = self.arith(opname, old, b, lt, c)
+        else:
+            if opname in ("<<", ">>"):
+                ct = self.m.tu_int if is_int(lt) and INT_BITS[canon(lt).kind] < 32 else lt
+            else:
+                ct = b.t
+            a = self.convert(old, ct)
+            r = self.arith(opname, a, b, ct, c)
+            r = self.convert(r, lt)
+        self.store(r.v, ptr, lt)
+        return Value(r.v, lt)
+
+    def unary(self, c):
+        m = self.m
+        kind = lib.clang_getCursorUnaryOperatorKind(c)
+        child = list(c.get_children())[0]
+        t = c.type
+        if kind in (UO_POSTINC, UO_POSTDEC, UO_PREINC, UO_PREDEC):
+            ptr = self.lvalue(child)
+            ct = child.type
+            old = self.load(ptr, ct)
+            delta = 1 if kind in (UO_POSTINC, UO_PREINC) else -1
+            ty = m.llty(ct)
+            if is_ptr(ct):
+                et = canon(ct).get_pointee()
+                new = self.op("getelementptr inbounds %s, ptr %s, i32 %d" % (m.llty(et), old.v, delta))
+            elif is_float(ct):
+                new = self.op("fadd %s %s, %s" % (ty, old.v, float_const(float(delta), ty)))
+            else:
+                new = self.op("add %s %s, %d" % (ty, old.v, delta))
+            self.store(new, ptr, ct)
+            return Value(old.v if kind in (UO_POSTINC, UO_POSTDEC) else new, ct)
+        if kind == UO_ADDROF:
+            if child.kind == K.DECL_REF_EXPR and child.referenced.kind == K.FUNCTION_DECL:
+                return Value("@" + child.referenced.spelling, t)
+            return Value(self.lvalue(child), t)
+        if kind == UO_DEREF:
+            ptr = self.rvalue(child).v
+            if is_function(t):
+                return Value(ptr, t)
+            return self.load(ptr, t)
+        v = self.rvalue(child)
+        ty = m.llty(t)
+        if kind == UO_PLUS:
+            return v
+        if kind == UO_MINUS:
+            if is_float(t):
+                return Value(self.op("fneg %s %s" % (ty, v.v)), t)
+            return Value(self.op("sub %s 0, %s" % (ty, v.v)), t)
+        if kind == UO_NOT:
+            return Value(self.op("xor %s %s, -1" % (ty, v.v)), t)
+        if kind == UO_LNOT:
+            b = self.truth(v)
+            n = self.op("xor i1 %s, true" % b)
+            return Value(self.op("zext i1 %s to i32" % n), t)
+        fail(c, "unsupported unary operator %d" % kind)
+
+    # ---- calls ----
+
+    def call(self, c):
+        m = self.m
+        children = list(c.get_children())
+        callee, args = children[0], children[1:]
+        t = c.type
+        direct = strip_parens(callee)
+        while direct.kind == K.UNEXPOSED_EXPR and list(direct.get_children()):
+            direct = strip_parens(list(direct.get_children())[0])
+        name = None
+        if direct.kind == K.DECL_REF_EXPR and direct.referenced.kind == K.FUNCTION_DECL:
+            name = direct.referenced.spelling
+            builtin = self.builtin(name, args, t, c)
+            if builtin is not None:
+                return builtin
+            if name not in m.defined:
+                m.declare_function(direct.referenced)
+            ftype = canon(direct.referenced.type)
+            target = "@" + name
+        else:
+            fv = self.rvalue(callee)
+            ftype = canon(canon(callee.type).get_pointee())
+            target = fv.v
+        param_types = list(ftype.argument_types())
+        values = []
+        for i, arg in enumerate(args):
+            v = self.rvalue(arg)
+            if i < len(param_types):
+                v = self.convert(v, param_types[i], arg)
+            values.append("%s %s" % (m.llty(v.t), v.v))
+        ret = m.llty(ftype.get_result())
+        suffix = " #0" if self.flatten and name is not None and name in m.defined else ""
+        if ret == "void":
+            self.emit("call void %s(%s)%s" % (target, ", ".join(values), suffix))
+            return Value("", t)
+        return Value(self.op("call %s %s(%s)%s" % (ret, target, ", ".join(values), suffix)), t)
+
+    def builtin(self, name, args, t, c):
+        m = self.m
+        unary_intrinsics = {
+            "sqrtf": ("llvm.sqrt.f32", "float"),
+            "sqrt": ("llvm.sqrt.f64", "double"),
+            "fabsf": ("llvm.fabs.f32", "float"),
+            "fabs": ("llvm.fabs.f64", "double"),
+            "floorf": ("llvm.floor.f32", "float"),
+            "ceilf": ("llvm.ceil.f32", "float"),
+            "truncf": ("llvm.trunc.f32", "float"),
+        }
+        if name in unary_intrinsics:
+            intrinsic, ty = unary_intrinsics[name]
+            m.intrinsics.add("declare %s @%s(%s)" % (ty, intrinsic, ty))
+            v = self.convert(self.rvalue(args[0]), t)
+            return Value(self.op("call %s @%s(%s %s)" % (ty, intrinsic, ty, v.v)), t)
+        if name == "__builtin_inff":
+            return Value(float_const(float("inf"), "float"), t)
+        if name == "__builtin_expect":
+            return self.rvalue(args[0])
+        if name == "__builtin_wasm_memory_size":
+            m.intrinsics.add("declare i32 @llvm.wasm.memory.size.i32(i32)")
+            return Value(self.op("call i32 @llvm.wasm.memory.size.i32(i32 0)"), t)
+        if name == "__builtin_wasm_memory_grow":
+            m.intrinsics.add("declare i32 @llvm.wasm.memory.grow.i32(i32, i32)")
+            v = self.rvalue(args[1])
+            return Value(self.op("call i32 @llvm.wasm.memory.grow.i32(i32 0, i32 %s)" % v.v), t)
+        if name.startswith("wasm_"):
+            return self.simd(name, args, t, c)
+        return None
+
+    def simd(self, name, args, t, c):
+        m = self.m
+        vals = [self.rvalue(a) for a in args]
+        i4, f4, d2 = "<4 x i32>", "<4 x float>", "<2 x double>"
+
+        def cast(v, ty):
+            src = m.llty(v.t)
+            if src == ty:
+                return v.v
+            return self.op("bitcast %s %s to %s" % (src, v.v, ty))
+
+        def ret(v, ty):
+            if ty == i4:
+                return Value(v, t)
+            return Value(self.op("bitcast %s %s to %s" % (ty, v, i4)), t)
+
+        binf = {"wasm_f32x4_add": "fadd", "wasm_f32x4_sub": "fsub", "wasm_f32x4_mul": "fmul", "wasm_f32x4_div": "fdiv"}
+        if name in binf:
+            return ret(self.op("%s %s %s, %s" % (binf[name], f4, cast(vals[0], f4), cast(vals[1], f4))), f4)
+        cmpf = {"wasm_f32x4_lt": "olt", "wasm_f32x4_gt": "ogt", "wasm_f32x4_le": "ole", "wasm_f32x4_ge": "oge"}
+        if name in cmpf:
+            r = self.op("fcmp %s %s %s, %s" % (cmpf[name], f4, cast(vals[0], f4), cast(vals[1], f4)))
+            return ret(self.op("sext <4 x i1> %s to %s" % (r, i4)), i4)
+        if name == "wasm_v128_load":
+            return ret(self.op("load %s, ptr %s, align 1" % (i4, vals[0].v)), i4)
+        if name == "wasm_v128_store":
+            self.emit("store %s %s, ptr %s, align 1" % (i4, cast(vals[1], i4), vals[0].v))
+            return Value("", t)
+        if name == "wasm_f32x4_splat":
+            v = self.convert(vals[0], canon(self.m.tu_float)).v
+            ins = self.op("insertelement %s undef, float %s, i32 0" % (f4, v))
+            return ret(self.op("shufflevector %s %s, %s undef, <4 x i32> zeroinitializer" % (f4, ins, f4)), f4)
+        if name == "wasm_f64x2_splat":
+            v = self.convert(vals[0], canon(self.m.tu_double)).v
+            ins = self.op("insertelement %s undef, double %s, i32 0" % (d2, v))
+            return ret(self.op("shufflevector %s %s, %s undef, <2 x i32> zeroinitializer" % (d2, ins, d2)), d2)
+        if name == "wasm_i32x4_splat":
+            v = self.convert(vals[0], canon(self.m.tu_int)).v
+            ins = self.op("insertelement %s undef, i32 %s, i32 0" % (i4, v))
+            return ret(self.op("shufflevector %s %s, %s undef, <4 x i32> zeroinitializer" % (i4, ins, i4)), i4)
+        if name == "wasm_i32x4_eq":
+            r = self.op("icmp eq %s %s, %s" % (i4, cast(vals[0], i4), cast(vals[1], i4)))
+            return ret(self.op("sext <4 x i1> %s to %s" % (r, i4)), i4)
+        if name in ("wasm_f32x4_min", "wasm_f32x4_max"):
+            # f32x4.min and max propagate NaN, like llvm.minimum and llvm.maximum.
+            op = "minimum" if name.endswith("min") else "maximum"
+            m.intrinsics.add("declare <4 x float> @llvm.%s.v4f32(<4 x float>, <4 x float>)" % op)
+            return ret(self.op("call %s @llvm.%s.v4f32(%s %s, %s %s)" % (f4, op, f4, cast(vals[0], f4), f4,
+                                                                          cast(vals[1], f4))), f4)
+        if name == "wasm_f32x4_abs":
+            m.intrinsics.add("declare <4 x float> @llvm.fabs.v4f32(<4 x float>)")
+            return ret(self.op("call %s @llvm.fabs.v4f32(%s %s)" % (f4, f4, cast(vals[0], f4))), f4)
+        if name == "wasm_f32x4_sqrt":
+            m.intrinsics.add("declare <4 x float> @llvm.sqrt.v4f32(<4 x float>)")
+            return ret(self.op("call %s @llvm.sqrt.v4f32(%s %s)" % (f4, f4, cast(vals[0], f4))), f4)
+        if name in ("wasm_v128_or", "wasm_v128_and"):
+            return ret(self.op("%s %s %s, %s" % (name[-2:].lstrip("_") if name.endswith("or") else "and", i4,
+                                                   cast(vals[0], i4), cast(vals[1], i4))), i4)
+        if name == "wasm_v128_bitselect":
+            a, b, mask = cast(vals[0], i4), cast(vals[1], i4), cast(vals[2], i4)
+            x = self.op("and %s %s, %s" % (i4, a, mask))
+            nm = self.op("xor %s %s, <i32 -1, i32 -1, i32 -1, i32 -1>" % (i4, mask))
+            y = self.op("and %s %s, %s" % (i4, b, nm))
+            return ret(self.op("or %s %s, %s" % (i4, x, y)), i4)
+        if name == "wasm_f64x2_div":
+            return ret(self.op("fdiv %s %s, %s" % (d2, cast(vals[0], d2), cast(vals[1], d2))), d2)
+        if name == "wasm_f64x2_sqrt":
+            m.intrinsics.add("declare <2 x double> @llvm.sqrt.v2f64(<2 x double>)")
+            return ret(self.op("call %s @llvm.sqrt.v2f64(%s %s)" % (d2, d2, cast(vals[0], d2))), d2)
+        if name == "wasm_f64x2_promote_low_f32x4":
+            low = self.op("shufflevector %s %s, %s undef, <2 x i32> <i32 0, i32 1>" % (f4, cast(vals[0], f4), f4))
+            return ret(self.op("fpext <2 x float> %s to %s" % (low, d2)), d2)
+        if name == "wasm_f32x4_demote_f64x2_zero":
+            low = self.op("fptrunc %s %s to <2 x float>" % (d2, cast(vals[0], d2)))
+            return ret(self.op("shufflevector <2 x float> %s, <2 x float> zeroinitializer, "
+                               "<4 x i32> <i32 0, i32 1, i32 2, i32 3>" % low), f4)
+        if name == "wasm_i32x4_shuffle":
+            lanes = [evaluate(a) for a in args[2:]]
+            if any(l is None for l in lanes):
+                fail(c, "shuffle lanes must be constant")
+            mask = ", ".join("i32 %d" % l for l in lanes)
+            return ret(self.op("shufflevector %s %s, %s %s, <4 x i32> <%s>" % (i4, cast(vals[0], i4), i4,
+                                                                              cast(vals[1], i4), mask)), i4)
+        if name == "wasm_f32x4_extract_lane":
+            lane = evaluate(args[1])
+            return Value(self.op("extractelement %s %s, i32 %d" % (f4, cast(vals[0], f4), lane)), t)
+        fail(c, "unsupported intrinsic " + name)
+
+
+def same_kind(a, b):
+    a, b = canon(a), canon(b)
+    if a.kind != b.kind:
+        return False
+    if a.kind == T.RECORD:
+        return a.get_declaration().hash == b.get_declaration().hash
+    return True
+
+
+def parse_int(text):
+    text = text.rstrip("uUlL")
+    return int(text, 0) if not (len(text) > 1 and text[0] == "0" and text[1] not in "xX") else int(text, 8)
+
+
+def main():
+    args = sys.argv[1:]
+    out = None
+    if "-o" in args:
+        i = args.index("-o")
+        out = args[i + 1]
+        del args[i : i + 2]
+    features = None
+    for a in list(args):
+        if a.startswith("-mattr="):
+            features = a[len("-mattr="):]
+            args.remove(a)
+    source = args[0]
+    flags = ["-target", "wasm32-unknown-unknown", "-nostdinc", "-std=gnu99", "-Wno-everything"] + args[1:]
+    index = ci.Index.create()
+    tu = index.parse(source, args=flags)
+    errors = [d for d in tu.diagnostics if d.severity >= ci.Diagnostic.Error]
+    for d in errors:
+        print(d, file=sys.stderr)
+    if errors:
+        sys.exit(1)
+    module = Module(tu)
+    module.features = features
+    # Builtin types needed for conversions the AST does not spell.
+    probe = index.parse("probe.c", args=["-target", "wasm32-unknown-unknown"],
+                        unsaved_files=[("probe.c", "int a; float b; double c;")])
+    decls = list(probe.cursor.get_children())
+    module.tu_int, module.tu_float, module.tu_double = decls[0].type, decls[1].type, decls[2].type
+    try:
+        ir = module.compile()
+    except CompileError as e:
+        print("error: %s" % e, file=sys.stderr)
+        sys.exit(1)
+    if out:
+        with open(out, "w") as f:
+            f.write(ir)
+    else:
+        sys.stdout.write(ir)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,18 @@
+#ifndef _MATH_H
+#define _MATH_H
+#define INFINITY (__builtin_inff())
+#define NAN (__builtin_nanf(""))
+float sqrtf(float);
+double sqrt(double);
+float fabsf(float);
+double fabs(double);
+float floorf(float);
+float ceilf(float);
+float truncf(float);
+float fminf(float, float);
+float fmaxf(float, float);
+float sinf(float);
+float cosf(float);
+float atan2f(float, float);
+float atanf(float);
+#endif
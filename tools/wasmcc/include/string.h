@@ -0,0 +1,7 @@
+#ifndef _STRING_H
+#define _STRING_H
+#include <stddef.h>
+void* memcpy(void* dst, const void* src, size_t n);
+void* memmove(void* dst, const void* src, size_t n);
+void* memset(void* dst, int c, size_t n);
+#endif
@@ -0,0 +1,32 @@
+#ifndef _WASM_SIMD128_H
+#define _WASM_SIMD128_H
+/* Intrinsics the wasmcc frontend lowers to LLVM vector IR, by name. */
+typedef int v128_t __attribute__((__vector_size__(16)));
+v128_t wasm_v128_load(const void* p);
+void wasm_v128_store(void* p, v128_t v);
+v128_t wasm_f32x4_splat(float v);
+v128_t wasm_f32x4_add(v128_t a, v128_t b);
+v128_t wasm_f32x4_sub(v128_t a, v128_t b);
+v128_t wasm_f32x4_mul(v128_t a, v128_t b);
+v128_t wasm_f32x4_div(v128_t a, v128_t b);
+v128_t wasm_f32x4_abs(v128_t a);
+v128_t wasm_f32x4_lt(v128_t a, v128_t b);
+v128_t wasm_f32x4_gt(v128_t a, v128_t b);
+v128_t wasm_f32x4_le(v128_t a, v128_t b);
+v128_t wasm_f32x4_ge(v128_t a, v128_t b);
+v128_t wasm_f32x4_min(v128_t a, v128_t b);
+v128_t wasm_f32x4_max(v128_t a, v128_t b);
+v128_t wasm_f32x4_sqrt(v128_t a);
+v128_t wasm_i32x4_splat(int v);
+v128_t wasm_i32x4_eq(v128_t a, v128_t b);
+v128_t wasm_v128_or(v128_t a, v128_t b);
+v128_t wasm_v128_and(v128_t a, v128_t b);
+v128_t wasm_v128_bitselect(v128_t a, v128_t b, v128_t m);
+v128_t wasm_f64x2_splat(double v);
+v128_t wasm_f64x2_div(v128_t a, v128_t b);
+v128_t wasm_f64x2_sqrt(v128_t a);
+v128_t wasm_f64x2_promote_low_f32x4(v128_t a);
+v128_t wasm_f32x4_demote_f64x2_zero(v128_t a);
+v128_t wasm_i32x4_shuffle(v128_t a, v128_t b, int c0, int c1, int c2, int c3);
+float wasm_f32x4_extract_lane(v128_t a, int lane);
+#endif
@@ -0,0 +1,352 @@
+#include <stddef.h>
+
+/* ---- memory ---- */
+
+void emscripten_notify_memory_growth(int memory_index);
+
+extern unsigned char __heap_base;
+
+struct Block {
+    unsigned int size; /* payload bytes */
+    struct Block *next;
+    unsigned int pad0;
+    unsigned int pad1;
+};
+
+static struct Block *free_list = 0;
+static unsigned char *heap_top = 0;
+
+static unsigned int align16(unsigned int n) { return (n + 15u) & ~15u; }
+
+void *malloc(size_t size) {
+    unsigned int n = align16(size == 0 ? 16 : (unsigned int)size);
+    struct Block *prev = 0;
+    struct Block *block = free_list;
+    while (block) {
+        if (block->size >= n) {
+            if (block->size - n >= 64) {
+                struct Block *rest = (struct Block *)((unsigned char *)block + sizeof(struct Block) + n);
+                rest->size = block->size - n - sizeof(struct Block);
+                rest->next = block->next;
+                block->size = n;
+                block->next = rest;
+            }
+            if (prev) {
+                prev->next = block->next;
+            } else {
+                free_list = block->next;
+            }
+            return (unsigned char *)block + sizeof(struct Block);
+        }
+        prev = block;
+        block = block->next;
+    }
+    if (!heap_top) {
+        heap_top = (unsigned char *)align16((unsigned int)(size_t)&__heap_base);
+    }
+    unsigned int need = (unsigned int)(size_t)heap_top + sizeof(struct Block) + n;
+    if (need < (unsigned int)(size_t)heap_top) {
+        return 0;
+    }
+    unsigned int end = (unsigned int)__builtin_wasm_memory_size(0) * 65536u;
+    if (need > end) {
+        unsigned int pages = (need - end + 65535u) / 65536u;
+        if (__builtin_wasm_memory_grow(0, pages) < 0) {
+            return 0;
+        }
+        emscripten_notify_memory_growth(0);
+    }
+    block = (struct Block *)heap_top;
+    block->size = n;
+    block->next = 0;
+    heap_top += sizeof(struct Block) + n;
+    return (unsigned char *)block + sizeof(struct Block);
+}
+
+/* Bytes malloc has taken from the heap. Freed blocks are reused but never given back, so it is a high-water mark. */
+size_t malloc_heap_bytes(void) {
+    return heap_top ? (size_t)(heap_top - &__heap_base) : 0;
+}
+
+void free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    struct Block *block = (struct Block *)((unsigned char *)ptr - sizeof(struct Block));
+    struct Block *prev = 0;
+    struct Block *next = free_list;
+    while (next && next < block) {
+        prev = next;
+        next = next->next;
+    }
+    block->next = next;
+    if (next && (unsigned char *)block + sizeof(struct Block) + block->size == (unsigned char *)next) {
+        block->size += sizeof(struct Block) + next->size;
+        block->next = next->next;
+    }
+    if (prev) {
+        prev->next = block;
+        if ((unsigned char *)prev + sizeof(struct Block) + prev->size == (unsigned char *)block) {
+            prev->size += sizeof(struct Block) + block->size;
+            prev->next = block->next;
+        }
+    } else {
+        free_list = block;
+    }
+}
+
+void *memset(void *dest, int c, size_t n);
+void *memcpy(void *dest, const void *src, size_t n);
+
+void *calloc(size_t count, size_t size) {
+    size_t n = count * size;
+    if (size && n / size != count) {
+        return 0;
+    }
+    void *ptr = malloc(n);
+    if (ptr) {
+        memset(ptr, 0, n);
+    }
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return malloc(size);
+    }
+    struct Block *block = (struct Block *)((unsigned char *)ptr - sizeof(struct Block));
+    if (block->size >= size) {
+        return ptr;
+    }
+    void *moved = malloc(size);
+    if (moved) {
+        memcpy(moved, ptr, block->size);
+        free(ptr);
+    }
+    return moved;
+}
+
+void *memcpy(void *dest, const void *src, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+    if ((((unsigned int)(size_t)d | (unsigned int)(size_t)s) & 3) == 0) {
+        while (n >= 4) {
+            *(unsigned int *)d = *(const unsigned int *)s;
+            d += 4;
+            s += 4;
+            n -= 4;
+        }
+    }
+    while (n) {
+        *d++ = *s++;
+        n--;
+    }
+    return dest;
+}
+
+void *memmove(void *dest, const void *src, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    const unsigned char *s = (const unsigned char *)src;
+    if (d == s || n == 0) {
+        return dest;
+    }
+    if (d < s) {
+        while (n) {
+            *d++ = *s++;
+            n--;
+        }
+    } else {
+        while (n) {
+            n--;
+            d[n] = s[n];
+        }
+    }
+    return dest;
+}
+
+void *memset(void *dest, int c, size_t n) {
+    unsigned char *d = (unsigned char *)dest;
+    while (n) {
+        *d++ = (unsigned char)c;
+        n--;
+    }
+    return dest;
+}
+
+/* ---- math, following musl ---- */
+
+static unsigned int float_bits(float x) { return *(unsigned int *)&x; }
+
+float fminf(float x, float y) {
+    if (x != x) return y;
+    if (y != y) return x;
+    if ((float_bits(x) >> 31) != (float_bits(y) >> 31)) return (float_bits(x) >> 31) ? x : y;
+    return x < y ? x : y;
+}
+
+float fmaxf(float x, float y) {
+    if (x != x) return y;
+    if (y != y) return x;
+    if ((float_bits(x) >> 31) != (float_bits(y) >> 31)) return (float_bits(x) >> 31) ? y : x;
+    return x < y ? y : x;
+}
+
+static double sindf(double x) {
+    const double S1 = -0x15555554cbac77.0p-55;
+    const double S2 = 0x111110896efbb2.0p-59;
+    const double S3 = -0x1a00f9e2cae774.0p-65;
+    const double S4 = 0x16cd878c3b46a7.0p-71;
+    double z = x * x;
+    double w = z * z;
+    double r = S3 + z * S4;
+    double s = z * x;
+    return (x + s * (S1 + z * S2)) + s * w * r;
+}
+
+static double cosdf(double x) {
+    const double C0 = -0x1ffffffd0c5e81.0p-54;
+    const double C1 = 0x155553e1053a42.0p-57;
+    const double C2 = -0x16c087e80f1e27.0p-62;
+    const double C3 = 0x199342e0ee5069.0p-68;
+    double z = x * x;
+    double w = z * z;
+    double r = C2 + z * C3;
+    return ((1.0 + z * C0) + w * C1) + (w * z) * r;
+}
+
+/* x = n * pi / 2 + y, |y| <= pi / 4; exact enough for |x| < 2^28 * pi / 2. */
+static int rem_pio2f(float x, double *y) {
+    const double toint = 1.5 / 2.22044604925031308085e-16;
+    const double invpio2 = 6.36619772367581382433e-01;
+    const double pio2_1 = 1.57079631090164184570e+00;
+    const double pio2_1t = 1.58932547735281966916e-08;
+    double fn = (double)x * invpio2 + toint - toint;
+    int n = (int)fn;
+    *y = (double)x - fn * pio2_1 - fn * pio2_1t;
+    return n;
+}
+
+float sinf(float x) {
+    if (x != x || x - x != 0.0f) return x - x;
+    double y;
+    int n = rem_pio2f(x, &y);
+    switch (n & 3) {
+    case 0: return (float)sindf(y);
+    case 1: return (float)cosdf(y);
+    case 2: return (float)-sindf(y);
+    default: return (float)-cosdf(y);
+    }
+}
+
+float cosf(float x) {
+    if (x != x || x - x != 0.0f) return x - x;
+    double y;
+    int n = rem_pio2f(x, &y);
+    switch (n & 3) {
+    case 0: return (float)cosdf(y);
+    case 1: return (float)-sindf(y);
+    case 2: return (float)-cosdf(y);
+    default: return (float)sindf(y);
+    }
+}
+
+static const float atanhi[] = {4.6364760399e-01f, 7.8539812565e-01f, 9.8279368877e-01f, 1.5707962513e+00f};
+static const float atanlo[] = {5.0121582440e-09f, 3.7748947079e-08f, 3.4473217170e-08f, 7.5497894159e-08f};
+static const float aT[] = {3.3333328366e-01f, -1.9999158382e-01f, 1.4253635705e-01f, -1.0648017377e-01f,
+                           6.1687607318e-02f};
+
+float atanf(float x) {
+    float w, s1, s2, z;
+    unsigned int ix = float_bits(x);
+    unsigned int sign = ix >> 31;
+    int id;
+    ix &= 0x7fffffff;
+    if (ix >= 0x4c800000) {
+        if (x != x) return x;
+        z = atanhi[3] + 0x1p-120f;
+        return sign ? -z : z;
+    }
+    if (ix < 0x3ee00000) {
+        if (ix < 0x39800000) return x;
+        id = -1;
+    } else {
+        x = x < 0 ? -x : x;
+        if (ix < 0x3f980000) {
+            if (ix < 0x3f300000) {
+                id = 0;
+                x = (2.0f * x - 1.0f) / (2.0f + x);
+            } else {
+                id = 1;
+                x = (x - 1.0f) / (x + 1.0f);
+            }
+        } else {
+            if (ix < 0x401c0000) {
+                id = 2;
+                x = (x - 1.5f) / (1.0f + 1.5f * x);
+            } else {
+                id = 3;
+                x = -1.0f / x;
+            }
+        }
+    }
+    z = x * x;
+    w = z * z;
+    s1 = z * (aT[0] + w * (aT[2] + w * aT[4]));
+    s2 = w * (aT[1] + w * aT[3]);
+    if (id < 0) return x - x * (s1 + s2);
+    z = atanhi[id] - ((x * (s1 + s2) - atanlo[id]) - x);
+    return sign ? -z : z;
+}
+
+float atan2f(float y, float x) {
+    const float pi = 3.1415927410e+00f;
+    const float pi_lo = -8.7422776573e-08f;
+    float z;
+    unsigned int m, ix, iy;
+    if (x != x || y != y) return x + y;
+    ix = float_bits(x);
+    iy = float_bits(y);
+    if (ix == 0x3f800000) return atanf(y);
+    m = ((iy >> 31) & 1) | ((ix >> 30) & 2);
+    ix &= 0x7fffffff;
+    iy &= 0x7fffffff;
+    if (iy == 0) {
+        switch (m) {
+        case 0:
+        case 1: return y;
+        case 2: return pi;
+        default: return -pi;
+        }
+    }
+    if (ix == 0) return m & 1 ? -pi / 2 : pi / 2;
+    if (ix == 0x7f800000) {
+        if (iy == 0x7f800000) {
+            switch (m) {
+            case 0: return pi / 4;
+            case 1: return -pi / 4;
+            case 2: return 3 * pi / 4;
+            default: return -3 * pi / 4;
+            }
+        } else {
+            switch (m) {
+            case 0: return 0.0f;
+            case 1: return -0.0f;
+            case 2: return pi;
+            default: return -pi;
+            }
+        }
+    }
+    if (ix + (26 << 23) < iy || iy == 0x7f800000) return m & 1 ? -pi / 2 : pi / 2;
+    if ((m & 2) && iy + (26 << 23) < ix) {
+        z = 0.0f;
+    } else {
+        float q = y / x;
+        z = atanf(q < 0 ? -q : q);
+    }
+    switch (m) {
+    case 0: return z;
+    case 1: return -z;
+    case 2: return pi - (z - pi_lo);
+    default: return (z - pi_lo) - pi;
+    }
+}